@@ -0,0 +1,130 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SDL2/SDL_render.h>   // for SDL_Renderer, SDL_Texture
+#include <SDL2/SDL_surface.h>  // for SDL_Surface
+#include <SDL2/SDL_timer.h>    // for SDL_GetTicks
+
+#include <common/draw/size.h>
+#include <common/macros.h>
+
+namespace common {
+namespace threads {
+template <typename RT>
+class Thread;
+}
+}  // namespace common
+
+namespace fastoplayer {
+namespace draw {
+
+// Decodes images on a pool of worker threads, pre-scales them to the size they are drawn at and keeps the results
+// as textures in an LRU limited by a byte budget. Scaled thumbnails are persisted in thumbnails_dir so the next run
+// skips the full size decode. GetTexture/UploadPending must be called from the render thread.
+class ImageCache {
+ public:
+  enum {
+    default_workers = 2,
+    default_texture_budget = 32 * 1024 * 1024,
+    default_uploads_per_frame = 4,
+    max_pending_requests = 256,
+    failed_retry_msec = 30000
+  };
+
+  ImageCache(size_t workers, size_t texture_budget, const std::string& thumbnails_dir);
+  ~ImageCache();
+
+  // returns nullptr while the image is decoding or failed to load, caller draws a placeholder; a failed image is
+  // requested again after failed_retry_msec
+  SDL_Texture* GetTexture(SDL_Renderer* renderer, const std::string& img_full_path, const common::draw::Size& size);
+
+  // uploads at most max_uploads decoded images, call once per frame
+  size_t UploadPending(SDL_Renderer* renderer, size_t max_uploads = default_uploads_per_frame);
+
+  void Clear();
+
+  size_t GetTextureBytes() const;
+  size_t GetTexturesCount() const;
+  size_t GetPendingCount() const;
+
+ private:
+  enum EntryState { DECODING, READY, FAILED };
+
+  struct Entry {
+    EntryState state;
+    SDL_Texture* texture;
+    SDL_Renderer* renderer;
+    size_t bytes;
+    Uint32 failed_ticks;
+    std::list<std::string>::iterator lru_pos;
+  };
+
+  struct Request {
+    std::string key;
+    std::string path;
+    common::draw::Size size;
+  };
+
+  struct Decoded {
+    std::string key;
+    SDL_Surface* surface;
+  };
+
+  int DecodeThread();
+  SDL_Surface* DecodeImage(const Request& request) const;
+  std::string GetThumbnailPath(const Request& request) const;
+
+  void Touch(Entry* entry);
+  void Evict(SDL_Texture* keep);
+  void DestroyEntry(Entry* entry);
+
+  const size_t texture_budget_;
+  const std::string thumbnails_dir_;
+
+  // render thread only
+  std::unordered_map<std::string, Entry> entries_;
+  std::list<std::string> lru_;
+  size_t texture_bytes_;
+
+  // shared with workers
+  typedef std::unique_lock<std::mutex> lock_t;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cond_;
+  std::deque<Request> requests_;
+  std::vector<Decoded> decoded_;
+  bool stop_;
+
+  std::vector<std::shared_ptr<common::threads::Thread<int>>> workers_;
+
+  DISALLOW_COPY_AND_ASSIGN(ImageCache);
+};
+
+}  // namespace draw
+}  // namespace fastoplayer
@@ -0,0 +1,116 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/error.h>
+#include <common/types.h>
+
+#include <player/playlist/mapped_file.h>
+
+namespace fastoplayer {
+namespace epg {
+
+struct ProgrammeInfo {
+  ProgrammeInfo();
+
+  common::time64_t start;  // utc msec
+  common::time64_t stop;   // utc msec
+  std::string title;
+  std::string description;
+};
+
+// Time index over a memory mapped XMLTV file. Only programme positions and
+// times are kept in memory, texts are decoded from the mapping on lookup.
+class EpgIndex {
+ public:
+  typedef uint32_t channel_index_t;
+  typedef uint32_t programme_index_t;
+  enum { cache_version = 2 };
+  static const programme_index_t invalid_programme;
+
+  EpgIndex();
+  ~EpgIndex();
+
+  // cache_path may be empty, threads == 0 means one per cpu core
+  common::Error Load(const std::string& xmltv_path, const std::string& cache_path, size_t threads) WARN_UNUSED_RESULT;
+  void Close();
+
+  bool IsLoaded() const;
+  bool IsLoadedFromCache() const;
+
+  size_t GetChannelsCount() const;
+  size_t GetProgrammesCount() const;
+  size_t GetMemoryUsage() const;
+
+  bool FindChannel(const std::string& channel_id, channel_index_t* channel) const WARN_UNUSED_RESULT;
+  std::string GetChannelId(channel_index_t channel) const;
+  std::string GetChannelDisplayName(channel_index_t channel) const;
+
+  // index only lookup, any of now/next is invalid_programme when absent
+  bool FindNowNext(channel_index_t channel,
+                   common::time64_t utc_msec,
+                   programme_index_t* now,
+                   programme_index_t* next) const WARN_UNUSED_RESULT;
+
+  bool GetProgrammeTitle(programme_index_t programme, std::string* title) const WARN_UNUSED_RESULT;
+  bool GetProgramme(programme_index_t programme, ProgrammeInfo* info) const WARN_UNUSED_RESULT;
+
+ private:
+  struct ProgrammeRecord {
+    uint32_t start;  // utc sec
+    uint32_t stop;   // utc sec
+    uint64_t offset;
+    uint32_t size;
+    uint32_t channel;
+  };
+
+  struct ChannelRecord {
+    std::string id;
+    uint64_t offset;  // <channel> element, 0 size if playlist has no definition
+    uint32_t size;
+  };
+
+  common::Error Parse(size_t threads);
+  // any record that doesn't fit the source or the index fails the cache, it is parsed again then
+  bool LoadCache(const std::string& cache_path, const std::string& source_path);
+  bool SaveCache(const std::string& cache_path, const std::string& source_path) const;
+
+  uint32_t GetChannelIndex(const std::string& id);
+  std::string DecodeElement(const ProgrammeRecord& record, const char* tag, size_t tag_size) const;
+
+  playlist::MappedFile file_;
+  bool from_cache_;
+
+  std::vector<ChannelRecord> channels_;
+  std::unordered_map<std::string, channel_index_t> channels_by_id_;
+  std::vector<ProgrammeRecord> programmes_;    // grouped by channel, sorted by start
+  std::vector<uint32_t> channel_programmes_;  // channel i owns [channel_programmes_[i], channel_programmes_[i + 1])
+
+  DISALLOW_COPY_AND_ASSIGN(EpgIndex);
+};
+
+}  // namespace epg
+}  // namespace fastoplayer
@@ -0,0 +1,117 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+
+#include <atomic>
+#include <new>
+
+#include <common/macros.h>
+
+namespace fastoplayer {
+namespace gui {
+namespace events {
+
+// Freelist of released event objects of one type. The main loop creates timer and input events on every
+// iteration and stream threads post their events to it, so reusing the memory keeps the loop off the heap
+// allocator. Objects are allocated on one thread and freed on another, the list is guarded by a spinlock which
+// is only held for a pointer swap.
+template <typename T>
+class EventPool {
+ public:
+  enum { max_cached = 64 };
+
+  static void* Allocate(size_t size) {
+    if (size == sizeof(T)) {
+      void* ptr = GetInstance()->Pop();
+      if (ptr) {
+        return ptr;
+      }
+    }
+    return ::operator new(size);
+  }
+
+  static void Free(void* ptr, size_t size) {
+    if (!ptr) {
+      return;
+    }
+
+    if (size == sizeof(T) && GetInstance()->Push(ptr)) {
+      return;
+    }
+    ::operator delete(ptr);
+  }
+
+ private:
+  struct Node {
+    Node* next;
+  };
+
+  EventPool() : locked_(false), head_(nullptr), count_(0) {}
+
+  // never destroyed, events still can be freed while static objects are torn down
+  static EventPool* GetInstance() {
+    static EventPool* pool = new EventPool;
+    return pool;
+  }
+
+  void Lock() {
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+    }
+  }
+
+  void Unlock() { locked_.store(false, std::memory_order_release); }
+
+  void* Pop() {
+    Lock();
+    Node* node = head_;
+    if (node) {
+      head_ = node->next;
+      count_--;
+    }
+    Unlock();
+    return node;
+  }
+
+  bool Push(void* ptr) {
+    Lock();
+    if (count_ == max_cached) {
+      Unlock();
+      return false;
+    }
+    Node* node = static_cast<Node*>(ptr);
+    node->next = head_;
+    head_ = node;
+    count_++;
+    Unlock();
+    return true;
+  }
+
+  std::atomic<bool> locked_;
+  Node* head_;
+  size_t count_;
+
+  DISALLOW_COPY_AND_ASSIGN(EventPool);
+};
+
+}  // namespace events
+}  // namespace gui
+}  // namespace fastoplayer
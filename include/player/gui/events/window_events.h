@@ -36,9 +36,17 @@ struct WindowResizeInfo {
 struct WindowExposeInfo {};
 struct WindowCloseInfo {};
 
+// hidden or minimized window, nothing drawn is seen
+struct WindowVisibilityInfo {
+  explicit WindowVisibilityInfo(bool visible);
+
+  bool visible;
+};
+
 typedef EventBase<WINDOW_RESIZE_EVENT, WindowResizeInfo> WindowResizeEvent;
 typedef EventBase<WINDOW_EXPOSE_EVENT, WindowExposeInfo> WindowExposeEvent;
 typedef EventBase<WINDOW_CLOSE_EVENT, WindowCloseInfo> WindowCloseEvent;
+typedef EventBase<WINDOW_VISIBILITY_EVENT, WindowVisibilityInfo> WindowVisibilityEvent;
 
 }  // namespace events
 }  // namespace gui
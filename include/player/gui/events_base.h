@@ -18,8 +18,12 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include <common/event.h>
 
+#include <player/gui/event_pool.h>
+
 #define EVENT_LOOP_ID 0
 
 enum EventsType : common::IEvent::event_id_t {
@@ -35,6 +39,7 @@ enum EventsType : common::IEvent::event_id_t {
   WINDOW_RESIZE_EVENT,
   WINDOW_EXPOSE_EVENT,
   WINDOW_CLOSE_EVENT,
+  WINDOW_VISIBILITY_EVENT,
   MOUSE_CHANGE_STATE_EVENT,
   MOUSE_MOVE_EVENT,
   MOUSE_PRESS_EVENT,
@@ -83,6 +88,9 @@ class EventBase : public common::Event<EventsType, event_t> {
 
   EventBase(senders_t* sender, info_t info) : base_class_t(sender), info_(info) {}
 
+  static void* operator new(size_t size) { return EventPool<EventBase>::Allocate(size); }
+  static void operator delete(void* ptr, size_t size) { EventPool<EventBase>::Free(ptr, size); }
+
   info_t GetInfo() const { return info_; }
 
  private:
@@ -97,6 +105,9 @@ class EventBase<event_t, void> : public common::Event<EventsType, event_t> {
   typedef typename base_class_t::senders_t senders_t;
 
   explicit EventBase(senders_t* sender) : base_class_t(sender) {}
+
+  static void* operator new(size_t size) { return EventPool<EventBase>::Allocate(size); }
+  static void operator delete(void* ptr, size_t size) { EventPool<EventBase>::Free(ptr, size); }
 };
 
 }  // namespace events
@@ -0,0 +1,103 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include <common/macros.h>
+
+namespace fastoplayer {
+namespace gui {
+
+// Bounded lock-free queue, any thread may push, only one thread may pop.
+// Every cell carries a sequence number which tells the producers and the consumer whose turn it is, so neither
+// side ever waits for the other; Push fails instead of blocking when the queue is full.
+template <typename T, size_t capacity>
+class BoundedMpscQueue {
+ public:
+  static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0, "capacity should be power of two");
+
+  BoundedMpscQueue() : cells_(), enqueue_pos_(0), dequeue_pos_(0) {
+    for (size_t i = 0; i < capacity; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool Push(const T& value) {
+    Cell* cell = nullptr;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & (capacity - 1)];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {  // full
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->value = value;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer thread only
+  bool IsEmpty() const {
+    const Cell* cell = &cells_[dequeue_pos_ & (capacity - 1)];
+    return cell->sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1;
+  }
+
+  // consumer thread only
+  bool Pop(T* value) {
+    Cell* cell = &cells_[dequeue_pos_ & (capacity - 1)];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    if (seq != dequeue_pos_ + 1) {  // empty or producer has not finished writing yet
+      return false;
+    }
+
+    *value = cell->value;
+    cell->sequence.store(dequeue_pos_ + capacity, std::memory_order_release);
+    dequeue_pos_++;
+    return true;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  Cell cells_[capacity];
+  std::atomic<size_t> enqueue_pos_;
+  size_t dequeue_pos_;
+
+  DISALLOW_COPY_AND_ASSIGN(BoundedMpscQueue);
+};
+
+}  // namespace gui
+}  // namespace fastoplayer
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include <SDL2/SDL_events.h>  // for SDL_MouseButtonEvent
 #include <SDL2/SDL_stdinc.h>  // for Uint32
 
@@ -26,6 +28,7 @@
 #include <common/threads/event_dispatcher.h>  // for EventDispatcher
 
 #include <player/gui/events_base.h>  // for Event, EventsType
+#include <player/gui/mpsc_queue.h>
 #include <player/media/types.h>
 
 namespace fastoplayer {
@@ -35,7 +38,7 @@ namespace application {
 class Sdl2Application : public common::application::IApplication {
  public:
   typedef Uint32 update_display_timeout_t;
-  enum { event_timeout_wait_msec = 1000 / DEFAULT_FRAME_PER_SEC };
+  enum { event_timeout_wait_msec = 1000 / DEFAULT_FRAME_PER_SEC, posted_events_queue_size = 1024 };
   Sdl2Application(int argc, char** argv);
   ~Sdl2Application();
 
@@ -58,6 +61,10 @@ class Sdl2Application : public common::application::IApplication {
   update_display_timeout_t GetDisplayUpdateTimeout() const;
   void SetDisplayUpdateTimeout(update_display_timeout_t msec);
 
+  // in idle mode no timer events are generated, main loop sleeps until an input or posted event arrives
+  void SetIdleMode(bool idle);
+  bool IsIdleMode() const;
+
  protected:
   virtual void HandleEvent(gui::events::Event* event);
 
@@ -82,10 +89,16 @@ class Sdl2Application : public common::application::IApplication {
 
  private:
   void ProcessEvent(SDL_Event* event);
+  bool ProcessPostedEvents();  // false if exit requested
+  void WaitEvents();
 
   common::threads::EventDispatcher<EventsType> dispatcher_;
+  BoundedMpscQueue<common::IEvent*, posted_events_queue_size> posted_events_;
   update_display_timeout_t update_display_timeout_msec_;
   bool cursor_visible_;
+  bool idle_mode_;
+  std::atomic<bool> waiting_events_;
+  std::atomic<size_t> overflowed_events_;  // posted through SDL, the next posts follow them to keep the order
 };
 
 }  // namespace application
@@ -18,9 +18,14 @@
 
 #pragma once
 
+#include <string>
+
 #include <player/gui/widgets/label.h>
 
 namespace fastoplayer {
+namespace draw {
+class ImageCache;
+}
 namespace gui {
 
 class IconLabel : public Label {
@@ -41,6 +46,13 @@ class IconLabel : public Label {
   void SetIconTexture(SDL_Texture* icon_img);
   SDL_Texture* GetIconTexture() const;
 
+  // icon is decoded in background by cache, placeholder is drawn until it is ready
+  void SetIconPath(draw::ImageCache* cache, const std::string& icon_path);
+  std::string GetIconPath() const;
+
+  void SetIconPlaceholderColor(const SDL_Color& color);
+  SDL_Color GetIconPlaceholderColor() const;
+
   void Draw(SDL_Renderer* render) override;
 
  protected:
@@ -48,6 +60,9 @@ class IconLabel : public Label {
 
  private:
   SDL_Texture* icon_img_;
+  draw::ImageCache* icon_cache_;
+  std::string icon_path_;
+  SDL_Color icon_placeholder_color_;
   common::draw::Size icon_size_;
   int space_betwen_image_and_label_;
 };
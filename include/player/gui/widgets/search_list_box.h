@@ -0,0 +1,57 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <string>
+
+#include <player/gui/widgets/list_box.h>
+#include <player/playlist/search_index.h>
+
+namespace fastoplayer {
+namespace gui {
+
+// List model over SearchIndex results, usually fed by LineEdit text changes:
+// line_edit->SetTextChangedCallback([list](const std::string& text) { list->SetQuery(text); });
+class SearchListBox : public IListBox {
+ public:
+  typedef IListBox base_class;
+  typedef playlist::SearchIndex::entry_id_t entry_id_t;
+
+  explicit SearchListBox(playlist::SearchIndex* index, Window* parent = nullptr);
+  SearchListBox(playlist::SearchIndex* index, const SDL_Color& back_ground_color, Window* parent = nullptr);
+  ~SearchListBox() override;
+
+  void SetQuery(const std::string& query);
+  std::string GetQuery() const;
+
+  bool GetEntryId(size_t row, entry_id_t* id) const WARN_UNUSED_RESULT;
+
+  size_t GetRowCount() const override;
+
+ protected:
+  void DrawRow(SDL_Renderer* render, size_t pos, bool active, bool hover, const SDL_Rect& row_rect) override;
+
+ private:
+  playlist::SearchIndex* const index_;
+  std::string query_;
+};
+
+}  // namespace gui
+}  // namespace fastoplayer
@@ -18,8 +18,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <SDL2/SDL_ttf.h>  // for TTF_Font
 
@@ -34,6 +38,7 @@
 #include <player/gui/stream_events.h>
 #include <player/media/app_options.h>  // for AppOptions, ComplexOp...
 #include <player/media/types.h>
+#include <player/media/wakeup_counters.h>
 #include <player/player_options.h>
 #include <player/stream_handler.h>
 
@@ -47,21 +52,33 @@ class Thread;
 namespace fastoplayer {
 
 namespace draw {
+class ImageCache;
 class TextureSaver;
-}
+}  // namespace draw
 namespace media {
+namespace dsp {
+class MixBus;
+}
 struct AudioParams;
+class DecoderCache;
+class DemuxSource;
+class GopKeeper;
+class TeardownService;
+class ThumbnailService;
+class WorkerPool;
 }  // namespace media
 
 namespace gui {
+class IconLabel;
 class Label;
-}
+}  // namespace gui
 
 class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
  public:
   typedef common::Optional<common::file_system::ascii_file_string_path> file_string_path_t;
   enum {
     volume_height = 30,
+    banner_height = 60,
     space_height = 10,
     space_width = 10,
     x_start = 10,
@@ -77,6 +94,11 @@ class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
 
   enum States { INIT_STATE, PLAYING_STATE, FAILED_STATE };
 
+  struct StreamLocation {
+    media::stream_id sid;
+    common::uri::GURL uri;
+  };
+
   void SetFullScreen(bool full_screen);
   void SetMute(bool mute);
   void UpdateVolume(int8_t step);
@@ -94,9 +116,31 @@ class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
                               const common::uri::GURL& uri,
                               media::AppOptions opt,
                               media::ComplexOptions copt);
+  // multiview: up to 4x4 streams in one window, each scaled down to its tile by the filter graph and decoded on one
+  // thread; the focused tile takes the playback controls and is heard, the others at duck_volume, Tab or a click
+  // moves the focus
+  void SetMosaicLocations(const std::vector<StreamLocation>& locations,
+                          media::AppOptions opt,
+                          media::ComplexOptions copt);
+  // channels likely zapped to next: kept open with their last GOP, a stream created for one of them takes it over
+  void SetStandbyLocations(const std::vector<common::uri::GURL>& uris, media::ComplexOptions copt);
+  // picture-in-picture: a second stream drawn in a corner of the display, heard at duck_volume, refused over the
+  // mosaic; it decodes at full size, on one thread with pip_cpu_share of a core, after the other streams: its tasks
+  // with worker_pool, its decoder thread at a lower priority without it (linux)
+  void SetPipLocation(media::stream_id sid,
+                      const common::uri::GURL& uri,
+                      media::AppOptions opt,
+                      media::ComplexOptions copt);
+  void ClosePip();
+  // the streams trade places and budgets, their video decoders are reopened with the threads of the new places;
+  // false without a picture-in-picture playing
+  virtual bool SwapPip();
 
  protected:
-  ISimplePlayer(const PlayerOptions& options, const file_string_path_t& absolute_font_path);
+  // channel logos are decoded by one image cache, its scaled thumbnails are kept in icons_cache_dir if it isn't empty
+  ISimplePlayer(const PlayerOptions& options,
+                const file_string_path_t& absolute_font_path,
+                const std::string& icons_cache_dir);
 
   void HandleEvent(event_t* event) override;
   void HandleExceptionEvent(event_t* event, common::Error err) override;
@@ -105,6 +149,7 @@ class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
                                    int64_t wanted_channel_layout,
                                    int wanted_nb_channels,
                                    int wanted_sample_rate,
+                                   int wanted_sample_format,
                                    media::AudioParams* audio_hw_params,
                                    int* audio_buff_size) override;
   void HanleAudioMix(uint8_t* audio_stream_ptr, const uint8_t* src, uint32_t len, int volume) override;
@@ -131,6 +176,7 @@ class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
   virtual void HandleWindowResizeEvent(gui::events::WindowResizeEvent* event);
   virtual void HandleWindowExposeEvent(gui::events::WindowExposeEvent* event);
   virtual void HandleWindowCloseEvent(gui::events::WindowCloseEvent* event);
+  virtual void HandleWindowVisibilityEvent(gui::events::WindowVisibilityEvent* event);
 
   virtual void HandleMousePressEvent(gui::events::MousePressEvent* event);
   virtual void HandleMouseMoveEvent(gui::events::MouseMoveEvent* event);
@@ -145,12 +191,19 @@ class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
   virtual void DrawFailedStatus();
   virtual void DrawInitStatus();
 
-  virtual void DrawInfo();  // statistic + volume
+  virtual void DrawInfo();  // statistic + volume + scrub thumbnail + channel banner
 
   virtual void DrawStatistic();
   virtual void DrawVolume();
+  virtual void DrawBanner();
+
+  // name and logo of the channel at the top of the display for a while, the logo is a local image file or empty
+  void ShowBanner(const std::string& name, const std::string& logo_path);
 
   bool IsMouseVisible() const;
+  bool IsMosaic() const;
+  size_t GetMosaicFocus() const;
+  bool HasPip() const;
 
   virtual media::VideoState* CreateStream(media::stream_id sid,
                                           const common::uri::GURL& uri,
@@ -163,30 +216,82 @@ class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
 
   SDL_Renderer* GetRenderer() const;
   TTF_Font* GetFont() const;
+  draw::ImageCache* GetImageCache() const;  // for the icon labels of the derived players
 
   virtual void OnWindowCreated(SDL_Window* window, SDL_Renderer* render);
 
  private:
+  typedef void (ISimplePlayer::*event_handler_t)(event_t* event);
+
+  template <typename event_type, void (ISimplePlayer::*handler)(event_type*)>
+  void DispatchEvent(event_t* event) {
+    (this->*handler)(static_cast<event_type*>(event));
+  }
+
+  // indexed by EventsType, nullptr for not handled types
+  static const event_handler_t* GetEventHandlers();
+
+  struct MosaicTile;
+
   void SwitchToChannelErrorMode(common::Error err);
 
   void FreeStreamSafe(bool fast_cleanup);
+  void FreeMosaic(bool fast_cleanup);
+  MosaicTile* FindMosaicTile(media::VideoState* stream) const;  // the picture-in-picture too
+  void SetMosaicFocus(size_t tile);
+  SDL_Rect GetMosaicTileRect(size_t tile) const;
+  void DrawMosaic();  // every tile uploaded and composited in one render pass
+  bool UploadMosaicTile(MosaicTile* tile);  // true if the stream had a new picture
+  void DrawMosaicTile(MosaicTile* tile, const SDL_Rect& cell, bool focused);
+  void FreePip(bool fast_cleanup);
+  void UpdatePipBudget();  // the primary stream first and unbounded
+  SDL_Rect GetPipRect() const;
+  void DrawPip();
+  void RefreshStreams();
 
   void UpdateDisplayInterval(AVRational fps);
 
+  // paused stream without OSD: audio device paused, main loop sleeps until events
+  void UpdateIdleState();
+  void SetIdle(bool idle);
+
   /* prepare a new audio buffer */
   static void sdl_audio_callback(void* user_data, uint8_t* stream, int len);
+  // under audio_pump_mutex_: the focused stream is mixed at the volume, the other tiles and the picture-in-picture
+  // at duck_volume of it
+  void UpdateAudioBuffers(uint8_t* stream, int len, int output_delay_bytes);
+  void MixAudioSource(media::VideoState* source, int volume, int len, int output_delay_bytes);
+  // under audio_pump_mutex_: a stream at the same address later is a new source, not this one's ramp
+  void RemoveAudioSource(media::VideoState* source);
+  // low latency mode: keeps the SDL queue a few periods ahead, delay is measured from the queue size
+  int AudioPumpThread();
+  void StopAudioPump();
 
   void CalculateDispalySize();
 
   // channel events
   void ToggleMute();
   void PauseStream();
+  void ChangeSpeed(int step);  // to the previous or next rate, 0 resets to 1.0
+  void ChangeScan(int direction);  // the same direction doubles the scan rate, the other one halves it, 0 leaves it
+  void ToggleReverse();
 
   // player modes
   void ToggleShowStatistic();
+  void ToggleRadioMode();
+  // audio only while the window is hidden or in radio mode
+  void UpdateVideoSuspend();
+
+  // seek bar thumbnail above the volume while scrubbing
+  void StartThumbnails();
+  void DrawThumbnail();
 
   SDL_Rect GetStatisticRect() const;
   SDL_Rect GetVolumeRect() const;
+  SDL_Rect GetBannerRect() const;
+
+  // decoded icons to textures, a few per drawn frame; true if one changed
+  bool UploadIcons();
 
   SDL_Renderer* renderer_;
   TTF_Font* font_;
@@ -195,7 +300,13 @@ class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
 
   media::AudioParams* audio_params_;
   int audio_buff_size_;
+  media::dsp::MixBus* mix_bus_;         // streams of the device, nullptr for a format it can't mix
+  std::vector<uint8_t> source_audio_;  // period of one stream before it is mixed
   SDL_AudioDeviceID audio_device_;
+  bool audio_device_paused_;
+  std::shared_ptr<common::threads::Thread<int>> audio_pump_tid_;
+  std::atomic<bool> audio_pump_stop_;
+  std::mutex audio_pump_mutex_;  // guards stream_ against the pump thread
 
   SDL_Window* window_;
 
@@ -204,6 +315,10 @@ class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
   gui::Label* volume_label_;
   media::msec_t volume_last_shown_;
 
+  draw::ImageCache* image_cache_;
+  gui::IconLabel* banner_label_;
+  media::msec_t banner_last_shown_;
+
   media::msec_t last_mouse_left_click_;
 
   std::shared_ptr<common::threads::Thread<int>> exec_tid_;
@@ -219,12 +334,40 @@ class ISimplePlayer : public StreamHandler, public gui::events::EventListener {
   gui::Label* statistic_label_;
 
   draw::TextureSaver* render_texture_;
+  // last uploaded picture of the primary stream, redrawn under a new picture-in-picture one
+  Uint32 picture_format_;
+  int picture_width_;
+  int picture_height_;
+  AVRational picture_sar_;
+  bool picture_flip_v_;
+  media::ThumbnailService* thumbnails_;
+  draw::TextureSaver* thumbnail_texture_;
+
+  std::vector<MosaicTile*> mosaic_;  // guarded by audio_pump_mutex_ against the audio threads
+  size_t mosaic_focus_;
+  int mosaic_side_;
+  gui::Label* mosaic_label_;
+  MosaicTile* pip_;  // guarded by audio_pump_mutex_ against the audio threads
+
+  std::shared_ptr<media::WorkerPool> worker_pool_;      // shared by the decoders of all the streams, if enabled
+  media::TeardownService* teardown_;                    // closed streams are joined and deleted there
+  std::shared_ptr<media::DecoderCache> decoder_cache_;  // decoders of the closed streams, for the next channel
+  // running demuxers by mux url, the streams of its programs keep one alive
+  std::map<std::string, std::weak_ptr<media::DemuxSource>> demux_sources_;
+  media::GopKeeper* gop_keeper_;  // standby channels
 
   uint32_t update_video_timer_interval_msec_;
 
   media::clock64_t last_pts_checkpoint_;
   size_t video_frames_handled_;
   const file_string_path_t absolute_font_path_;
+
+  bool window_hidden_;
+  bool radio_mode_;
+
+  bool idle_;
+  media::msec_t idle_start_msec_;
+  media::WakeupsSnapshot idle_wakeups_;
 };
 
 }  // namespace fastoplayer
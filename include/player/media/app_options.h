@@ -65,6 +65,8 @@ struct AppOptions {
   bool auto_exit;  // exit from stream if eos
   bool enable_video;
   bool enable_audio;
+  int reverse_cache_mb;  // memory budget of the decoded frames for backward playback
+  bool accurate_seek;    // decode from the keyframe and show the frame at the seek target
 #if CONFIG_AVFILTER
   std::string vfilters;
   std::string afilters;
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <string>
+
 #include <player/media/ffmpeg_config.h>  // for CONFIG_AVFILTER
 
 extern "C" {
@@ -27,11 +29,16 @@ extern "C" {
 #include <libavformat/avformat.h>  // for AVFormatContext, AVStream
 #include <libavutil/frame.h>       // for AVFrame
 #include <libavutil/rational.h>    // for AVRational
+#include <libavutil/samplefmt.h>   // for AVSampleFormat
 }
 
+#include <player/media/dsp/audio_dsp.h>  // for SampleFormat
+
 namespace fastoplayer {
 namespace media {
 
+std::string ffmpeg_errno_to_string(int err);
+
 double q2d_diff(AVRational a);
 
 AVRational guess_sample_aspect_ratio(AVStream* stream, AVFrame* frame);
@@ -40,6 +47,8 @@ double get_rotation(AVStream* st);
 
 bool is_realtime(AVFormatContext* s);
 
+bool convert_to_dsp_format(AVSampleFormat fmt, dsp::SampleFormat* out);  // packed formats only
+
 #if CONFIG_AVFILTER
 int configure_filtergraph(AVFilterGraph* graph,
                           const char* filtergraph,
@@ -36,6 +36,9 @@ class Clock {
   clock64_t LastUpdated() const;
 
   void SetPaused(bool paused);
+  // playback rate, the clock advances speed msec per real msec
+  void SetSpeed(double speed);
+  double GetSpeed() const;
 
  private:
   bool paused_;
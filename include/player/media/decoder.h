@@ -43,9 +43,16 @@ class Decoder {
 
   AVMediaType GetCodecType() const;
   AVCodecContext* GetAvCtx() const;
+  AVCodecContext* ReleaseAvCtx();  // the caller owns the context, the decoder is not used after
+  size_t GetFlushCount() const;  // flush packets handled, frames after a change follow a discontinuity
+  int GetSerial() const;         // queue serial of the frames being decoded, stale if the queue moved on
+  // pool tasks can't wait for packets: DecodeFrame returns 0 instead and IsStarved() tells it ran out of them
+  void SetNonBlocking(bool nonblocking);
+  bool IsStarved() const;
 
  protected:
-  void Flush();
+  void Flush(int serial);
+  int GetPacket(AVPacket* pkt);  // < 0 if aborted, 0 if starved, > 0 if packet
 
   Decoder(AVCodecContext* avctx, PacketQueue* queue);
 
@@ -54,6 +61,10 @@ class Decoder {
 
  private:
   bool finished_;
+  size_t flush_count_;
+  int serial_;
+  bool nonblocking_;
+  bool starved_;
 };
 
 class IFrameDecoder : public Decoder {
@@ -82,6 +93,11 @@ class VideoDecoder : public IFrameDecoder {
   int GetHeight() const;
 
   int DecodeFrame(AVFrame* frame) override;
+  size_t GetDrainCount() const;  // drain packets completed, every frame sent before one was returned
+
+ private:
+  bool draining_;
+  size_t drain_count_;
 };
 
 }  // namespace media
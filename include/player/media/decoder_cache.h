@@ -0,0 +1,97 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <mutex>
+#include <string>
+
+#include <player/media/ffmpeg_config.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>  // for AVCodecContext, AVCodecParameters
+#include <libavutil/dict.h>      // for AVDictionary
+}
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace fastoplayer {
+namespace media {
+
+/* Opened decoders kept after their stream is closed, so a channel switch to a stream with the same codec
+ * parameters gets a flushed context instead of allocating and opening a new one. Software decoders only: a
+ * hardware decoder belongs to the device set up by its stream. */
+class DecoderCache {
+ public:
+  struct Key {
+    Key();
+    // opts: the options the decoder is opened with, threads and lowres included
+    Key(const AVCodec* codec, const AVCodecParameters* par, const AVDictionary* opts, int flags2);
+
+    bool IsValid() const;
+    bool Equals(const Key& other) const;
+
+    const AVCodec* codec;
+    int profile;
+    int width;
+    int height;
+    int format;
+    int sample_rate;
+    int channels;
+    uint64_t channel_layout;
+    int extradata_size;
+    uint64_t extradata_hash;
+    int flags2;
+    std::string options;
+  };
+
+  explicit DecoderCache(size_t capacity);
+  ~DecoderCache();
+
+  AVCodecContext* Take(const Key& key);  // nullptr if none matches
+  // flushes and keeps the context with the skip options it was opened with, the oldest one is freed past the
+  // capacity
+  void Put(const Key& key, AVCodecContext* avctx);
+  void Clear();
+
+  size_t GetCount() const;
+  size_t GetHits() const;
+  size_t GetMisses() const;
+
+ private:
+  struct Entry {
+    Key key;
+    AVCodecContext* avctx;
+  };
+  typedef std::unique_lock<std::mutex> lock_t;
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  std::list<Entry> entries_;  // most recently put first
+  size_t hits_;
+  size_t misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(DecoderCache);
+};
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -0,0 +1,141 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <player/media/ffmpeg_config.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>    // for AVPacket
+#include <libavformat/avformat.h>  // for AVFormatContext
+#include <libavutil/dict.h>        // for AVDictionary
+}
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+#include <common/uri/gurl.h>
+
+namespace common {
+namespace threads {
+template <typename RT>
+class Thread;
+}
+}  // namespace common
+
+namespace fastoplayer {
+namespace media {
+
+class DemuxSource;
+
+// url#program=N: service N of the mux at url, the streams of one mux share its demuxer
+bool SplitProgramUrl(const common::uri::GURL& uri, common::uri::GURL* source, int* program);
+
+/* One program of a shared mux as one player sees it: a format context with only the streams of the program, the
+ * packets carry its stream indexes. The queue is bounded, when the player falls behind its packets are dropped
+ * up to the next video keyframe, the demuxer and the other players go on. */
+class DemuxConsumer {
+ public:
+  ~DemuxConsumer();  // leaves the source
+
+  // waits for the input to be open, the context is freed with avformat_free_context, never read from
+  int Open(AVFormatContext** ic);
+  // 0 with a packet, AVERROR(EAGAIN) if none came for a while, AVERROR_EOF at the end, AVERROR_EXIT if aborted
+  int Read(AVPacket* pkt);
+  void Abort();
+
+  bool IsRealtime() const;
+  size_t GetDroppedCount() const;
+
+ private:
+  friend class DemuxSource;
+  DemuxConsumer(DemuxSource* source, int program);
+
+  bool IsFull() const;  // under the source mutex
+  void Push(AVPacket* pkt);
+
+  DemuxSource* const source_;
+  const int program_;
+
+  // under the source mutex
+  std::condition_variable cond_;
+  std::deque<AVPacket> queue_;
+  size_t queue_bytes_;
+  std::vector<int> map_;  // source stream index to ours, -1 for the other programs, empty until open
+  std::vector<bool> video_;
+  bool wait_keyframe_;
+  bool aborted_;
+  size_t dropped_;
+
+  DISALLOW_COPY_AND_ASSIGN(DemuxConsumer);
+};
+
+/* Reads a multi-program mux (a DVB multicast or file) once for every player watching one of its services, instead
+ * of each opening and demuxing the whole mux. The reader only waits when every consumer is full, so a slow player
+ * loses its own packets but never stalls the others. The mux is not sought, its players see it as live. */
+class DemuxSource {
+ public:
+  DemuxSource(const common::uri::GURL& uri, const AVDictionary* format_opts);
+  ~DemuxSource();
+
+  bool Start();
+  void Stop();
+
+  DemuxConsumer* Subscribe(int program);  // the consumer leaves when deleted, before the source
+
+ private:
+  friend class DemuxConsumer;
+  friend class DemuxSourcePeer;  // tests
+  enum State { OPENING, READY, FAILED, ENDED };
+  typedef std::unique_lock<std::mutex> lock_t;
+
+  static int decode_interrupt_callback(void* user_data);
+
+  int Exec();
+  int OpenInput(AVFormatContext* ic);
+  void Route(AVPacket* pkt);
+  bool CanRead() const;  // under the mutex
+  void SetState(State state, int error);
+  void Unsubscribe(DemuxConsumer* consumer);
+
+  const common::uri::GURL uri_;
+  AVDictionary* format_opts_;
+
+  std::shared_ptr<common::threads::Thread<int>> tid_;
+  std::atomic<bool> stop_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<DemuxConsumer*> consumers_;
+  State state_;
+  int error_;
+  AVFormatContext* streams_;  // copy of the streams and programs once open, consumers take theirs from it
+  bool realtime_;
+
+  DISALLOW_COPY_AND_ASSIGN(DemuxSource);
+};
+
+}  // namespace media
+}  // namespace fastoplayer
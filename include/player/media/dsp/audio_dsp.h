@@ -0,0 +1,112 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace fastoplayer {
+namespace media {
+namespace dsp {
+
+// Interleaved sample formats, matching AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32 and AV_SAMPLE_FMT_FLT.
+enum SampleFormat { SAMPLE_FMT_S16 = 0, SAMPLE_FMT_S32, SAMPLE_FMT_FLT, SAMPLE_FMT_COUNT };
+
+enum Isa { ISA_SCALAR = 0, ISA_SSE2, ISA_AVX2, ISA_NEON, ISA_COUNT };
+
+// Gain in Q30 fixed point, only the upper Q14 bits (gain >> 16) are applied to samples, so every kernel produces
+// bit-exact results whatever instruction set it uses. Valid range is [0, 2.0).
+typedef int32_t gain_t;
+const gain_t unity_gain = 1 << 30;
+
+gain_t VolumeToGain(int volume);  // 0-100
+size_t GetBytesPerSample(SampleFormat fmt);
+const char* IsaToString(Isa isa);
+
+bool IsIsaSupported(Isa isa);  // compiled in and supported by the cpu
+Isa GetBestIsa();
+
+// count is number of samples (frames * channels), gain of sample i is start + i * step.
+// Scale: dst = src * gain, dst may be equal to src.
+// Mix: dst = dst + src * gain, saturated (float is clipped to [-1.0, 1.0]).
+void Scale(SampleFormat fmt, void* dst, const void* src, size_t count, gain_t start, gain_t step);
+void Mix(SampleFormat fmt, void* dst, const void* src, size_t count, gain_t start, gain_t step);
+bool Convert(SampleFormat dst_fmt, void* dst, SampleFormat src_fmt, const void* src, size_t count);
+// planar to interleaved, same sample format
+void Interleave(SampleFormat fmt, void* dst, const uint8_t* const* planes, size_t channels, size_t nb_frames);
+
+// Moves gain linearly to the target over ramp_samples instead of jumping, so volume changes don't produce
+// zipper noise. Not thread safe, owned by the thread that produces audio.
+class GainRamp {
+ public:
+  explicit GainRamp(size_t ramp_samples, gain_t gain = unity_gain);
+
+  void SetTarget(gain_t gain);
+  gain_t GetTarget() const;
+  gain_t GetCurrent() const;
+  bool IsUnity() const;  // nothing to do, Scale would copy
+
+  void Reset(gain_t gain);  // jump without ramp
+
+  void Scale(SampleFormat fmt, void* dst, const void* src, size_t count);
+  void Mix(SampleFormat fmt, void* dst, const void* src, size_t count);
+
+ private:
+  typedef void (*apply_t)(SampleFormat fmt, void* dst, const void* src, size_t count, gain_t start, gain_t step);
+  void Apply(apply_t func, SampleFormat fmt, void* dst, const void* src, size_t count);
+
+  const size_t ramp_samples_;
+  gain_t current_;
+  gain_t target_;
+  gain_t step_;
+  size_t ramp_left_;
+};
+
+// Sums sources of the same format into one buffer, saturated like Mix. Each source keeps its own gain ramp, so
+// moving the focus or ducking fades instead of clicking. Sources are told apart by an opaque key, the ramp of one
+// not added to a buffer is dropped. The slots are allocated up front, nothing is allocated while mixing. Not thread
+// safe, owned by the thread that feeds the device.
+class MixBus {
+ public:
+  MixBus(SampleFormat fmt, size_t ramp_samples, size_t max_sources);
+  ~MixBus();
+
+  void Begin(void* dst, size_t count);  // count samples, silence unless a source is added
+  // a new source starts at its gain, a known one ramps to it; false if all the slots are taken, it is not heard
+  bool Add(const void* key, const void* src, gain_t gain);
+  void End();
+  void Remove(const void* key);  // a new source with the same key starts over
+
+  size_t GetSourcesCount() const;
+
+ private:
+  struct Source;
+
+  const SampleFormat fmt_;
+  std::vector<Source> sources_;
+  void* dst_;
+  size_t count_;
+  bool filled_;
+};
+
+}  // namespace dsp
+}  // namespace media
+}  // namespace fastoplayer
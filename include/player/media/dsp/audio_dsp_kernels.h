@@ -0,0 +1,69 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <player/media/dsp/audio_dsp.h>
+
+namespace fastoplayer {
+namespace media {
+namespace dsp {
+
+typedef void (*gain_kernel_t)(void* dst, const void* src, size_t count, gain_t start, gain_t step);
+typedef void (*convert_kernel_t)(void* dst, const void* src, size_t count);
+
+// Per instruction set implementations, all of them must match the scalar ones bit by bit.
+struct Kernels {
+  gain_kernel_t scale[SAMPLE_FMT_COUNT];
+  gain_kernel_t mix[SAMPLE_FMT_COUNT];
+  convert_kernel_t s16_to_flt;
+  convert_kernel_t flt_to_s16;
+  convert_kernel_t s32_to_flt;
+  convert_kernel_t flt_to_s32;
+};
+
+const Kernels* GetKernels(Isa isa);  // nullptr if not supported
+
+// wraps like the 32 bit lanes of simd registers do
+inline gain_t GainAt(gain_t start, gain_t step, size_t i) {
+  return static_cast<gain_t>(static_cast<uint32_t>(start) + static_cast<uint32_t>(i) * static_cast<uint32_t>(step));
+}
+
+// reference implementations, also used for the tails of simd loops
+void ScaleS16Scalar(void* dst, const void* src, size_t count, gain_t start, gain_t step);
+void MixS16Scalar(void* dst, const void* src, size_t count, gain_t start, gain_t step);
+void ScaleS32Scalar(void* dst, const void* src, size_t count, gain_t start, gain_t step);
+void MixS32Scalar(void* dst, const void* src, size_t count, gain_t start, gain_t step);
+void ScaleFltScalar(void* dst, const void* src, size_t count, gain_t start, gain_t step);
+void MixFltScalar(void* dst, const void* src, size_t count, gain_t start, gain_t step);
+void S16ToFltScalar(void* dst, const void* src, size_t count);
+void FltToS16Scalar(void* dst, const void* src, size_t count);
+void S32ToFltScalar(void* dst, const void* src, size_t count);
+void FltToS32Scalar(void* dst, const void* src, size_t count);
+
+#if defined(HAVE_AUDIO_DSP_X86)
+const Kernels* GetSse2Kernels();
+const Kernels* GetAvx2Kernels();
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+const Kernels* GetNeonKernels();
+#endif
+
+}  // namespace dsp
+}  // namespace media
+}  // namespace fastoplayer
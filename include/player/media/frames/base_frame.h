@@ -35,6 +35,7 @@ struct BaseFrame {
   clock64_t pts;      /* presentation timestamp for the frame */
   clock64_t duration; /* estimated duration of the frame */
   int64_t pos;        /* byte position of the frame in the input file */
+  int serial;         /* packet queue serial the frame was decoded in */
 
   void ClearFrame();
 
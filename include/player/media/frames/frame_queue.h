@@ -41,7 +41,7 @@ class BaseFrameQueue : public RingBuffer<T, buffer_size> {
     }
     fp->ClearFrame();
     base_class::RindexUpInner();
-    base_class::Signal();
+    base_class::SignalRelease();
   }
 
   int64_t GetLastPos() const {
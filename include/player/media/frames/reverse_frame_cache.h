@@ -0,0 +1,108 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <player/media/types.h>
+
+namespace fastoplayer {
+namespace media {
+namespace frames {
+
+struct VideoFrame;
+
+/* Decoded GOPs for backward playback. The read thread opens a segment [start, end), the decoder fills it
+ * forward and closes it while the previous segment is shown from its last frame, so one GOP is decoded ahead.
+ * Memory is capped: the decoder waits while shown frames are released, and a segment that does not fit alone
+ * keeps its latest frames, the earlier ones are decoded again by the next segment. Frame objects are pooled. */
+class ReverseFrameCache {
+ public:
+  typedef std::function<void()> notify_t;
+
+  explicit ReverseFrameCache(size_t budget_bytes);
+  ~ReverseFrameCache();
+
+  // read thread
+  bool CanBeginSegment() const;  // the previous segment is shown or being shown
+  void BeginSegment(clock64_t start, clock64_t end);
+  clock64_t GetNextEnd() const;  // earliest frame held, where the next segment ends
+  bool IsEmpty() const;          // nothing left to show
+
+  // decoder thread, frames outside of the open segment are dropped, takes the frame reference
+  void Put(AVFrame* frame, clock64_t pts, clock64_t duration, int64_t pos);
+  // decoder that can't wait (a pool task): false and the frame is left alone while Put would wait, the release
+  // notify is then called when frames are released
+  bool TryPut(AVFrame* frame, clock64_t pts, clock64_t duration, int64_t pos);
+  void SetReleaseNotify(notify_t notify);  // called under the cache lock
+  void EndSegment();
+
+  // presenting thread
+  VideoFrame* Peek();            // next frame back in time, nullptr while the decoder is behind
+  VideoFrame* PeekLast() const;  // shown frame
+  VideoFrame* Pop();             // shows and returns the next frame, the previous one goes back to the pool
+
+  void Clear(clock64_t next_end);  // drop all frames and the open segment
+  void Stop();
+
+  size_t GetBudget() const;
+  size_t GetSize() const;  // bytes held
+
+ private:
+  enum SegmentState { SEGMENT_NONE, SEGMENT_OPEN, SEGMENT_READY };
+  typedef std::unique_lock<std::mutex> lock_t;
+
+  bool HasRoom(size_t frame_size) const;
+  bool Accepts(clock64_t pts) const;  // in the open segment
+  void Store(AVFrame* frame, size_t frame_size, clock64_t pts, clock64_t duration, int64_t pos);
+  void NotifyRelease();
+  VideoFrame* TakeFromPool();
+  void ReturnToPool(VideoFrame* frame);
+  void SwapSegments();
+
+  const size_t budget_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+
+  std::vector<VideoFrame*> pool_;
+  std::deque<VideoFrame*> showing_;  // pts ascending, shown from the back
+  std::deque<VideoFrame*> filling_;  // pts ascending
+  VideoFrame* shown_;
+  SegmentState filling_state_;
+  clock64_t filling_start_;
+  clock64_t filling_end_;
+  clock64_t next_end_;
+  size_t size_;
+  bool stoped_;
+  notify_t release_notify_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReverseFrameCache);
+};
+
+}  // namespace frames
+}  // namespace media
+}  // namespace fastoplayer
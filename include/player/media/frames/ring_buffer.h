@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 
 namespace fastoplayer {
@@ -30,9 +31,18 @@ template <typename T, size_t buffer_size>
 class RingBuffer {
  public:
   typedef T* pointer_type;
+  typedef std::function<void()> notify_t;
 
   RingBuffer()
-      : queue_cond_(), queue_mutex_(), queue_(), rindex_shown_(0), rindex_(0), windex_(0), size_(0), stoped_(false) {
+      : queue_cond_(),
+        queue_mutex_(),
+        release_notify_(),
+        queue_(),
+        rindex_shown_(0),
+        rindex_(0),
+        windex_(0),
+        size_(0),
+        stoped_(false) {
     for (size_t i = 0; i < buffer_size; i++) {
       queue_[i] = new T;
     }
@@ -91,6 +101,21 @@ class RingBuffer {
     queue_cond_.notify_one();
   }
 
+  // called under the queue lock when a frame is released, for a producer that does not wait in GetPeekWritable
+  // (a pool task)
+  void SetReleaseNotify(notify_t notify) {
+    lock_t lock(queue_mutex_);
+    release_notify_ = notify;
+  }
+
+  void SignalRelease() {
+    lock_t lock(queue_mutex_);
+    queue_cond_.notify_one();
+    if (release_notify_) {
+      release_notify_();
+    }
+  }
+
   void Stop() {
     lock_t lock(queue_mutex_);
     stoped_ = true;
@@ -141,6 +166,7 @@ class RingBuffer {
   typedef std::unique_lock<std::mutex> lock_t;
   std::condition_variable queue_cond_;
   std::mutex queue_mutex_;
+  notify_t release_notify_;
 
   pointer_type queue_[buffer_size];
   mutable size_t rindex_shown_;  // in mostly const
@@ -0,0 +1,78 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <deque>
+#include <vector>
+
+#include <player/media/ffmpeg_config.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>    // for AVPacket
+#include <libavformat/avformat.h>  // for AVFormatContext
+#include <libavutil/dict.h>        // for AVDictionary
+}
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+#include <common/uri/gurl.h>
+
+namespace fastoplayer {
+namespace media {
+
+class TeardownService;
+
+/* Standby inputs of the channels around the one on screen. Each is opened and demuxed on its own thread, nothing
+ * is decoded, and only the packets since the last video keyframe are kept. A zap to one of them takes over its open
+ * input with those packets, so the decoder starts from a keyframe at once instead of waiting up to a GOP of the
+ * live stream. A GOP over the budget of a channel is not kept, the channel waits for the next keyframe. A channel
+ * leaving the keeper is joined and closed on the teardown service, a stalled input never holds the caller. */
+class GopKeeper {
+ public:
+  typedef std::deque<AVPacket> packets_t;
+
+  GopKeeper(size_t channel_max_bytes, TeardownService* teardown);  // teardown nullptr: channels closed by the caller
+  ~GopKeeper();
+
+  // starts the channels not kept yet, stops the ones not in the list
+  void SetChannels(const std::vector<common::uri::GURL>& uris, const AVDictionary* format_opts);
+  // the open input of the channel and its packets since the keyframe, oldest first, none before the first one; the
+  // channel leaves the keeper either way, false if its input was not open yet or its reader didn't stop between two
+  // packets within a short wait
+  bool Take(const common::uri::GURL& uri, AVFormatContext** ic, packets_t* gop);
+  void Clear();
+
+  size_t GetChannelsCount() const;
+  size_t GetHeldBytes() const;  // packets of all the channels
+
+ private:
+  class Channel;
+
+  void Dispose(Channel* channel);  // interrupted at once, joined and deleted on teardown_
+
+  const size_t channel_max_bytes_;
+  TeardownService* const teardown_;
+  std::vector<Channel*> channels_;
+
+  DISALLOW_COPY_AND_ASSIGN(GopKeeper);
+};
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <queue>
 
@@ -36,15 +37,27 @@ namespace media {
 
 class PacketQueue {  // compressed queue data
  public:
+  typedef std::function<void()> notify_t;
+
   PacketQueue();
   ~PacketQueue();
 
   void Flush();
   void Abort();
   int Put(AVPacket* pkt);
+  // flush packet, drops every queued packet and starts a new serial carried by the flush packet
   int PutNullpacket(int stream_index);
+  int GetSerial() const;  // serial of the last flush packet, packets queued after it belong to it
+  static int GetFlushSerial(const AVPacket& pkt);
+  // empty packet at the end: the decoder outputs the frames it holds back for reordering, then starts over
+  int PutDrainPacket(int stream_index);
+  static bool IsDrainPacket(const AVPacket& pkt);
+  bool Get(AVPacket* pkt);  // waits for a packet, false if aborted
   /* return < 0 if aborted, 0 if no packet and > 0 if packet.  */
-  bool Get(AVPacket* pkt);
+  int TryGet(AVPacket* pkt);
+  // called under the queue lock when a packet is queued or the queue is aborted, for a consumer that does not wait
+  // in Get (a pool task)
+  void SetNotify(notify_t notify);
   void Start();
 
   bool IsAborted();
@@ -53,14 +66,16 @@ class PacketQueue {  // compressed queue data
   int64_t GetDuration() const;
 
  private:
-  int PushFront(AVPacket* pkt);
   int PushBack(AVPacket* pkt);
+  void ClearInner();
   DISALLOW_COPY_AND_ASSIGN(PacketQueue);
 
   std::deque<AVPacket> queue_;
   std::atomic<int> size_;
   std::atomic<int64_t> duration_;
+  std::atomic<int> serial_;
   bool abort_request_;
+  notify_t notify_;
   typedef std::unique_lock<std::mutex> lock_t;
   std::condition_variable cond_;
   std::mutex mutex_;
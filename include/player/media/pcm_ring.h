@@ -0,0 +1,113 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include <player/media/types.h>  // for clock64_t
+
+namespace fastoplayer {
+namespace media {
+
+// Single producer / single consumer ring of interleaved PCM bytes between the audio decoder thread and the audio
+// device callback. The consumer side (Read, Drop, GetReadClock) never blocks and never allocates, so it is safe to
+// call from the realtime callback: it takes no lock either, it wakes a waiting producer only when the room it waits
+// for is free. Writes are tagged with the packet serial they were decoded from; after Drop(serial) the consumer
+// skips the bytes of any other serial, so samples converted before a seek are never played.
+class PcmRing {
+ public:
+  typedef std::function<void()> notify_t;
+
+  explicit PcmRing(size_t capacity);  // bytes
+  ~PcmRing();
+
+  size_t GetCapacity() const;
+  size_t GetReadable() const;
+  size_t GetWritable() const;
+  bool IsEmpty() const;
+
+  // producer, end_clock is the pts (msec) of the sample right after the written data
+  bool WaitWritable(size_t size);  // false if stopped
+  // producer that can't wait (a pool task): false while there is no room for size, the notify is then called by
+  // every read once there is, until the producer arms again; true if stopped, the next write tells
+  bool ArmWritable(size_t size);
+  void SetNotify(notify_t notify);  // before the producer arms, cleared after Stop
+  bool Write(const uint8_t* data, size_t size, clock64_t end_clock, int serial = 0);  // all or nothing
+  void Stop();
+  bool IsStopped() const;
+
+  // consumer
+  size_t Read(uint8_t* out, size_t size);
+  void Drop(int serial = 0);  // all written data, only serial is read next; no clock until the next write
+  clock64_t GetReadClock(int bytes_per_sec) const;  // pts of the next byte to be read
+
+ private:
+  struct WriteMark {
+    uint64_t pos;         // write position after the last write
+    clock64_t clock;      // pts at pos
+    int serial;           // serial of the last write
+    uint64_t serial_pos;  // position its serial started at
+  };
+
+  WriteMark LoadMark() const;
+  void NotifyProducer();
+
+  uint8_t* const data_;
+  const size_t capacity_;
+
+  std::atomic<uint64_t> write_pos_;  // total bytes written
+  std::atomic<uint64_t> read_pos_;   // total bytes read
+
+  // WriteMark of the last write, written by producer under seqlock
+  std::atomic<uint32_t> mark_seq_;
+  std::atomic<uint64_t> mark_pos_;
+  std::atomic<clock64_t> mark_clock_;
+  std::atomic<int> mark_serial_;
+  std::atomic<uint64_t> mark_serial_pos_;
+
+  // producer only
+  int write_serial_;
+  uint64_t write_serial_pos_;
+
+  // consumer only
+  int drop_serial_;    // serial kept by the last Drop, -1 if none
+  uint64_t drop_pos_;  // write position at the last Drop
+
+  std::atomic<size_t> wait_size_;  // room the producer waits for, 0 if it doesn't
+  std::atomic<bool> notifying_;    // the consumer is in notify_
+  notify_t notify_;
+  std::atomic<bool> stopped_;
+  typedef std::unique_lock<std::mutex> lock_t;
+  std::condition_variable cond_;
+  std::mutex mutex_;
+
+  DISALLOW_COPY_AND_ASSIGN(PcmRing);
+};
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -60,6 +60,8 @@ class Stream {
   void SetClockAt(clock64_t pts, clock64_t time);
   void SetClock(clock64_t pts);
   void SetPaused(bool pause);
+  void SetClockSpeed(double speed);
+  double GetClockSpeed() const;
 
   clock64_t LastUpdatedClock() const;
 
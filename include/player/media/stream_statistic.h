@@ -26,6 +26,14 @@ namespace media {
 typedef uint32_t stream_format_t;
 enum StreamFmt : stream_format_t { UNKNOWN_STREAM = 0, HAVE_AUDIO_STREAM = (1 << 0), HAVE_VIDEO_STREAM = (1 << 1) };
 
+// how decoded audio reaches the device format
+enum AudioPath {
+  AUDIO_PATH_NONE = 0,
+  AUDIO_PATH_DIRECT,      // decoder output is already in the device format
+  AUDIO_PATH_INTERLEAVE,  // planar to packed copy
+  AUDIO_PATH_RESAMPLE     // swresample, format/rate/layout conversion or sync compensation
+};
+
 struct Stats {  // stream realtime statistic
   Stats();
 
@@ -49,11 +57,19 @@ struct Stats {  // stream realtime statistic
   common::media::bandwidth_t audio_bandwidth;  // bytes/s
   HWDeviceType active_hwaccel;
 
+  size_t audio_underruns;         // callbacks which found not enough samples
+  clock64_t audio_underrun_msec;  // silence inserted by them
+  clock64_t audio_latency_msec;   // device buffering behind the audio clock
+  AudioPath audio_path;
+  double audio_convert_load;  // % of one core spent converting audio on this path
+  double cpu_load;            // % of one core used by the read and decoder threads of the stream
+
  private:
   const common::time64_t start_ts_;
 };
 
 std::string ConvertStreamFormatToString(stream_format_t fmt);
+std::string ConvertAudioPathToString(AudioPath path);
 
 }  // namespace media
 }  // namespace fastoplayer
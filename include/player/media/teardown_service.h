@@ -0,0 +1,87 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace common {
+namespace threads {
+template <typename RT>
+class Thread;
+}
+}  // namespace common
+
+namespace fastoplayer {
+namespace media {
+
+/* Streams closed by zapping are joined and deleted here, off the main thread, on a fixed number of threads: a burst
+ * of channel changes queues its teardowns instead of starting a thread for each. The memory the dying streams still
+ * hold is tracked, and Stop() waits for every teardown, none is left running at exit. */
+class TeardownService {
+ public:
+  typedef std::function<void()> teardown_t;
+
+  explicit TeardownService(size_t threads_count);
+  ~TeardownService();
+
+  bool Start();
+  void Stop();  // waits for the queued teardowns, the ones posted after it run on the caller
+
+  // held_bytes: memory kept until the teardown is done
+  void Post(teardown_t teardown, size_t held_bytes);
+
+  size_t GetPendingCount() const;  // queued or running
+  size_t GetHeldBytes() const;
+  size_t GetPeakHeldBytes() const;
+
+ private:
+  struct Teardown {
+    teardown_t teardown;
+    size_t held_bytes;
+  };
+  typedef std::unique_lock<std::mutex> lock_t;
+
+  int WorkerRoutine();
+  void RunNext(lock_t* lock);  // runs the first queued teardown with the lock released
+
+  const size_t threads_count_;
+  std::vector<std::shared_ptr<common::threads::Thread<int>>> workers_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<Teardown> queue_;
+  size_t pending_;
+  size_t held_bytes_;
+  size_t peak_held_bytes_;
+  bool stop_;
+
+  DISALLOW_COPY_AND_ASSIGN(TeardownService);
+};
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -0,0 +1,93 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include <player/media/types.h>  // for clock64_t
+
+namespace fastoplayer {
+namespace media {
+
+struct Thumbnail {
+  Thumbnail(clock64_t pts, int width, int height);
+
+  const clock64_t pts;  // keyframe shown for the slot
+  const int width;
+  const int height;
+  std::vector<uint8_t> rgb;  // RGB24, width * 3 bytes per line
+};
+typedef std::shared_ptr<const Thumbnail> thumbnail_t;
+
+/* Thumbnails on a fixed time grid, one slot per interval. The generator takes the missing slot nearest to the
+ * focus (the scrub or playback position), so thumbnails around it come first; over max_count the slots farthest
+ * from the focus are dropped and generated again once the focus gets back to them. */
+class ThumbnailCache {
+ public:
+  ThumbnailCache(clock64_t start, clock64_t duration, clock64_t interval, size_t max_count);
+
+  size_t GetSlotsCount() const;
+  clock64_t GetSlotPts(size_t slot) const;
+  size_t GetSlot(clock64_t pos) const;
+
+  void SetFocus(clock64_t pos);
+  // generator: false when every slot is done or the cache is full of slots nearer to the focus
+  bool TakeNextMissing(size_t* slot);
+  void Put(size_t slot, thumbnail_t thumbnail);  // nullptr if nothing could be decoded for the slot
+
+  thumbnail_t Find(clock64_t pos) const;  // the slot of pos or a neighbour, nullptr if none is generated yet
+  size_t GetCount() const;
+
+  // binary PPM grid of the generated thumbnails in slot order, the header keeps the grid and the filled slots
+  bool SaveSpriteSheet(const std::string& path) const;
+  bool LoadSpriteSheet(const std::string& path, int width, int height);
+
+ private:
+  enum SlotState { SLOT_MISSING, SLOT_PENDING, SLOT_READY, SLOT_EMPTY };
+  struct Slot {
+    SlotState state;
+    thumbnail_t thumbnail;
+  };
+  typedef std::unique_lock<std::mutex> lock_t;
+
+  size_t GetDistance(size_t slot) const;
+  void EvictFarthest();
+
+  const clock64_t start_;
+  const clock64_t interval_;
+  const size_t max_count_;
+
+  mutable std::mutex mutex_;
+  std::vector<Slot> slots_;
+  size_t focus_;
+  size_t count_;  // ready slots
+
+  DISALLOW_COPY_AND_ASSIGN(ThumbnailCache);
+};
+
+}  // namespace media
+}  // namespace fastoplayer
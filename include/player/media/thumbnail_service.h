@@ -0,0 +1,107 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <player/media/ffmpeg_config.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>    // for AVCodecContext
+#include <libavformat/avformat.h>  // for AVFormatContext
+#include <libavutil/frame.h>       // for AVFrame
+}
+
+#include <common/uri/gurl.h>
+
+#include <player/media/thumbnail_cache.h>
+
+struct SwsContext;
+
+namespace common {
+namespace threads {
+template <typename RT>
+class Thread;
+}
+}  // namespace common
+
+namespace fastoplayer {
+namespace media {
+
+struct ThumbnailOptions {
+  enum { width = 160, height = 90, interval_msec = 10000, cpu_share = 10, memory_mb = 32 };
+  ThumbnailOptions();
+
+  int thumbnail_width;
+  int thumbnail_height;
+  clock64_t interval;       // msec between two thumbnails
+  int cpu_share_percent;    // of one core, the generator sleeps the rest of the time
+  int memory_budget_mb;     // thumbnails kept in memory
+  std::string sprite_path;  // sprite sheet loaded at start and saved at stop, empty to keep them in memory only
+};
+
+/* Seek bar thumbnails generated in the background with its own demuxer and decoder, so the playback is never
+ * touched: only keyframes are decoded, at the lowest resolution the decoder offers above the thumbnail size, on
+ * one thread working for the cpu share of the time. Seekable inputs with a known duration only. */
+class ThumbnailService {
+ public:
+  ThumbnailService(const common::uri::GURL& uri, const ThumbnailOptions& opt);
+  ~ThumbnailService();
+
+  bool Start();
+  void Stop();
+
+  void SetFocus(clock64_t pos);  // scrub or playback position, thumbnails around it come first
+  thumbnail_t GetThumbnail(clock64_t pos) const;
+
+ private:
+  static int decode_interrupt_callback(void* user_data);
+
+  int Exec();
+  ThumbnailCache* OpenInput(AVFormatContext* ic);
+  thumbnail_t Generate(AVFormatContext* ic, clock64_t pts, AVFrame* frame);
+  thumbnail_t Scale(AVFrame* frame, clock64_t pts);
+
+  const common::uri::GURL uri_;
+  ThumbnailOptions opt_;
+
+  std::shared_ptr<common::threads::Thread<int>> tid_;
+  std::atomic<bool> stop_;
+
+  // generator thread
+  AVCodecContext* avctx_;
+  int stream_index_;
+  SwsContext* sws_ctx_;
+
+  typedef std::unique_lock<std::mutex> lock_t;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  ThumbnailCache* cache_;  // once the input is open
+  clock64_t focus_;
+  bool focus_changed_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThumbnailService);
+};
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -55,6 +55,9 @@ common::media::bandwidth_t CalculateBandwidth(size_t total_downloaded_bytes, mse
 
 bool IsValidClock(clock64_t clock);
 clock64_t GetRealClockTime();  // msec
+int64_t GetThreadCpuUsec();    // cpu time used by the calling thread
+// the calling thread runs after the others on a busy cpu, for as long as it lives; false where it isn't supported
+bool LowerThreadPriority();
 
 msec_t ClockToMsec(clock64_t clock);
 msec_t GetCurrentMsec();
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -36,9 +37,13 @@ extern "C" {
 #include <common/uri/gurl.h>       // for Uri
 
 #include <player/media/app_options.h>   // for AppOptions, ComplexOptions
-#include <player/media/audio_params.h>  // for AudioParams
+#include <player/media/audio_params.h>   // for AudioParams
+#include <player/media/decoder_cache.h>  // for DecoderCache
+#include <player/media/demux_source.h>   // for DemuxSource
+#include <player/media/gop_keeper.h>     // for GopKeeper
 #include <player/media/stream_statistic.h>
-#include <player/media/types.h>  // for clock64_t, AvSyncType
+#include <player/media/types.h>        // for clock64_t, AvSyncType
+#include <player/media/worker_pool.h>  // for TaskPriority
 
 struct SwrContext;
 struct InputStream;
@@ -52,7 +57,6 @@ class Thread;
 
 /* no AV correction is done if too big error */
 #define VIDEO_PICTURE_QUEUE_SIZE 3
-#define SAMPLE_QUEUE_SIZE 9
 
 namespace fastoplayer {
 namespace media {
@@ -61,15 +65,21 @@ class VideoStateHandler;
 
 class AudioDecoder;
 class AudioStream;
+class PcmRing;
+class SerialJob;
 class VideoDecoder;
 class VideoStream;
+struct AudioDecodeContext;
+struct VideoDecodeContext;
+
+namespace dsp {
+class GainRamp;
+}  // namespace dsp
 
 namespace frames {
-struct AudioFrame;
+class ReverseFrameCache;
 struct VideoFrame;
 template <size_t buffer_size>
-class AudioFrameQueue;
-template <size_t buffer_size>
 class VideoFrameQueue;
 }  // namespace frames
 
@@ -77,13 +87,28 @@ class VideoState {
  public:
   typedef std::shared_ptr<Stats> stats_t;
   typedef frames::VideoFrameQueue<VIDEO_PICTURE_QUEUE_SIZE> video_frame_queue_t;
-  typedef frames::AudioFrameQueue<SAMPLE_QUEUE_SIZE> audio_frame_queue_t;
 
   enum { invalid_stream_index = -1 };
   VideoState(stream_id id, const common::uri::GURL& uri, const AppOptions& opt, const ComplexOptions& copt);
   void SetHandler(VideoStateHandler* handler);
+  // before Exec: the decoders run as serial jobs of the shared pool instead of a thread each, the demuxer keeps
+  // its thread since it blocks on I/O
+  void SetWorkerPool(std::shared_ptr<WorkerPool> pool);
+  // on-screen or focused streams first; without a pool a low priority lowers the one of the video decoder thread
+  // when it starts, on linux
+  void SetTaskPriority(TaskPriority priority);
+  // percent of one core for the whole stream, 0 for no limit: over it the video decoder keeps reference frames
+  // only, then keyframes only, and decodes nothing for the rest of a window it used up; can change while playing
+  void SetDecodeBudget(int cpu_percent);
+  // before Exec: decoders are taken from it when the parameters match and given back on close
+  void SetDecoderCache(std::shared_ptr<DecoderCache> cache);
+  // before Exec: the program is read from the shared demuxer instead of opening the uri, it can't be sought
+  void SetDemuxSource(std::shared_ptr<DemuxSource> source, int program);
+  // before Exec: the open input of a standby channel and its packets since the keyframe, queued first; owned after
+  void SetStandbyInput(AVFormatContext* ic, GopKeeper::packets_t* gop);
 
   int Exec() WARN_UNUSED_RESULT;
+  // the queued packets are dropped at once, the threads finish on their own and are joined by whoever runs Exec
   void Abort();
 
   bool IsVideoThread() const;
@@ -101,30 +126,57 @@ class VideoState {
   bool IsPaused() const;
 
   void StepToNextFrame();
+  // audio only (hidden window, radio mode): video packets are discarded by the demuxer and the decoder idles,
+  // on resume decode restarts at the next keyframe, ignored when there is no audio to follow
+  void SetVideoSuspended(bool suspended);
+  bool IsVideoSuspended() const;
+  // playback rate 0.25 - 4.0, audio is time-stretched with the pitch kept, above 1.5 only reference frames are
+  // decoded; live streams stay at 1.0
+  void SetSpeed(double speed);
+  double GetSpeed() const;
+  // keyframe scan, rate is +-4/8/16/32 or 0 for normal playback: one keyframe is sought, decoded and shown per
+  // step at a fixed step rate, so the work does not depend on the rate; audio is off while scanning
+  void SetTrickPlay(int rate);
+  int GetTrickPlay() const;
+  // backward playback: each GOP is decoded forward into the reverse frame cache, bounded by the reverse cache
+  // budget, and shown from its end while the previous GOP is decoded; audio is off
+  void SetReverse(bool reverse);
+  bool IsReverse() const;
+  void StepToPrevFrame();
   void SeekNextChunk();
   void SeekPrevChunk();
   void SeekChapter(int incr);
   void Seek(clock64_t msec);
   void SeekMsec(clock64_t msec);
+  clock64_t GetScrubPosition() const;  // last requested seek target while scrubbing, invalid_clock() otherwise
   void StreamCycleChannel(AVMediaType codec_type);
+  // like StreamCycleChannel, from the thread drawing the stream: the video decoder is opened again with this many
+  // threads, 0 for auto, and with the current task priority
+  void ReopenVideoDecoder(int threads);
 
   common::Error RequestVideo(int width, int height, int av_pixel_format, AVRational aspect_ratio) WARN_UNUSED_RESULT;
 
   frames::VideoFrame* TryToGetVideoFrame();
-  void UpdateAudioBuffer(uint8_t* stream, int len, int audio_volume);
+  // audio device callback: only copies prepared samples out of the PCM ring, never blocks
+  // output_delay_bytes: device buffering between the speaker and the end of stream, this buffer included
+  void UpdateAudioBuffer(uint8_t* stream, int len, int audio_volume, int output_delay_bytes);
 
   stats_t GetStatistic() const;
   AVRational GetFrameRate() const;
+  size_t GetMemoryUsage() const;  // bytes of queued packets and decoded pictures, an estimate
 
  private:
   static int decode_interrupt_callback(void* user_data);
   stream_format_t GetStreamFormat() const;
 
   void StreamSeek(int64_t pos, int64_t rel, bool seek_by_bytes);
+  void WakeupReadThread();
   frames::VideoFrame* GetVideoFrame();
+  frames::VideoFrame* GetReverseVideoFrame();
   frames::VideoFrame* SelectVideoFrame() const;
 
   void ResetStats();
+  void AccountThreadCpu(int64_t* last_cpu_usec);  // adds what the calling thread used since the last call
   void Close();
 
   bool IsVideoReady() const;
@@ -135,6 +187,7 @@ class VideoState {
   /* open a given stream. Return 0 if OK */
   int StreamComponentOpen(int stream_index);
   void StreamComponentClose(int stream_index);
+  int OpenCodecContext(const AVCodec* codec, AVStream* stream, int lowres, AVDictionary** opts, AVCodecContext** out);
   void StreamTogglePause();
 
   AvSyncType GetMasterSyncType() const;
@@ -151,20 +204,50 @@ class VideoState {
    * or external master clock */
   int SynchronizeAudio(int nb_samples);
   /**
-   * Decode one audio frame and return its uncompressed size.
+   * Convert one decoded audio frame to the device format, apply sync
+   * compensation and volume and write it into the PCM ring.
    *
-   * The processed audio frame is decoded, converted if required, and
-   * stored in is->audio_buf, with size in bytes given by the return
-   * value.
+   * Called from the audio decoder thread, waits while the ring is full.
+   * Returns the written size in bytes, or < 0 if stopped or failed.
    */
-  int AudioDecodeFrame();
+  int QueueAudioFrame(AVFrame* frame, clock64_t pts);
   int GetVideoFrame(AVFrame* frame);
-  int QueuePicture(AVFrame* src_frame, clock64_t pts, clock64_t duration, int64_t pos);
-
+  int QueuePicture(AVFrame* src_frame, clock64_t pts, clock64_t duration, int64_t pos, int serial);
+
+  void ApplyVideoSuspend(bool suspend);
+  void SetAudioDiscard(bool discard);
+  void ApplyTrickPlay(int rate);
+  void TrickPlayStep();
+  void ApplyReverse(bool reverse);
+  void ReverseStep();
+  void SeekPreview();
+  // set ic_ or quit the stream, < 0 on failure
+  int OpenInput();
+  int OpenSharedInput();
+  int OpenStandbyInput();
+  void QueueStandbyPackets();
   int ReadRoutine();
   int VideoThread();
   int AudioThread();
 
+  // one turn of the decoder loops, shared by the decoder threads and the pool jobs
+  int InitVideoDecode(VideoDecodeContext* ctx);
+  void FreeVideoDecode(VideoDecodeContext* ctx);
+  int DecodeVideo(VideoDecodeContext* ctx);       // < 0 at the end, > 0 if a frame went to the filters
+  int OutputVideoFrame(VideoDecodeContext* ctx);  // < 0 at the end, > 0 if a filtered frame was queued
+  bool PutHeldReverseFrame(VideoDecodeContext* ctx);  // false while the reverse cache has no room for it
+  AVDiscard UpdateDecodeBudget(VideoDecodeContext* ctx);  // frames the budget skips
+  int InitAudioDecode(AudioDecodeContext* ctx);
+  void FreeAudioDecode(AudioDecodeContext* ctx);
+  int DecodeAudio(AudioDecodeContext* ctx);
+  int OutputAudioFrame(AudioDecodeContext* ctx);
+
+  // pool jobs: a step returns true while it can go on, false waiting for packets or room in its output
+  int StartVideoJob();
+  int StartAudioJob();
+  bool VideoStep();
+  bool AudioStep();
+
   const stream_id id_;
   const common::uri::GURL uri_;
 
@@ -183,7 +266,8 @@ class VideoState {
   AudioDecoder* auddec_;
 
   video_frame_queue_t* video_frame_queue_;
-  audio_frame_queue_t* audio_frame_queue_;
+  frames::ReverseFrameCache* reverse_cache_;
+  PcmRing* audio_ring_;
 
   clock64_t audio_clock_;
   clock64_t audio_diff_cum_; /* used for AV difference average computation */
@@ -191,18 +275,32 @@ class VideoState {
   double audio_diff_threshold_;
   int audio_diff_avg_count_;
   int audio_hw_buf_size_;
-  uint8_t* audio_buf_;
   uint8_t* audio_buf1_;
-  unsigned int audio_buf_size_; /* in bytes */
   unsigned int audio_buf1_size_;
-  int audio_buf_index_; /* in bytes */
-  int audio_write_buf_size_;
+  uint8_t* audio_mix_buf_;
+  unsigned int audio_mix_buf_size_;
+  dsp::GainRamp* audio_gain_;
+  std::atomic<int> audio_volume_;
+  std::atomic<bool> audio_flush_req_;
+  std::atomic<int64_t> audio_last_pos_;
+  std::atomic<size_t> audio_underruns_;
+  std::atomic<size_t> audio_underrun_bytes_;
+  std::atomic<int> audio_output_delay_bytes_;
   AudioParams audio_src_;
 #if CONFIG_AVFILTER
   AudioParams audio_filter_src_;
 #endif
   AudioParams audio_tgt_;
+  std::atomic<double> speed_;             // requested playback rate
+  double audio_filter_speed_;             // rate of the atempo chain, audio thread
+  std::atomic<double> audio_ring_speed_;  // rate the ring content was stretched with
+  clock64_t audio_tempo_start_;           // first atempo output pts, audio thread
+  size_t audio_flush_count_;
   struct SwrContext* swr_ctx_;
+  int swr_idle_frames_;
+  std::atomic<int> audio_path_;                // AudioPath of the last frame
+  std::atomic<int64_t> audio_convert_usec_;    // time spent on the current path
+  std::atomic<int64_t> audio_converted_usec_;  // audio duration converted by it
 
   clock64_t frame_timer_;
   clock64_t frame_last_returned_time_;
@@ -227,6 +325,25 @@ class VideoState {
   std::shared_ptr<common::threads::Thread<int>> vdecoder_tid_;
   std::shared_ptr<common::threads::Thread<int>> adecoder_tid_;
 
+  std::shared_ptr<WorkerPool> worker_pool_;
+  std::atomic<TaskPriority> task_priority_;
+  SerialJob* video_job_;
+  SerialJob* audio_job_;
+  VideoDecodeContext* video_decode_;  // state kept between the steps of the jobs
+  AudioDecodeContext* audio_decode_;
+
+  std::shared_ptr<DecoderCache> decoder_cache_;
+  DecoderCache::Key video_cache_key_;  // invalid if the decoder can't be kept
+  DecoderCache::Key audio_cache_key_;
+  bool video_decoder_reused_;
+  clock64_t exec_start_time_;
+  bool first_picture_queued_;  // video thread
+
+  std::shared_ptr<DemuxSource> demux_source_;
+  DemuxConsumer* demux_consumer_;
+  AVFormatContext* standby_ic_;
+  GopKeeper::packets_t standby_gop_;
+
   bool paused_;
   bool last_paused_;
   bool eof_;
@@ -235,13 +352,42 @@ class VideoState {
   volatile bool abort_request_;
 
   stats_t stats_;
+  std::atomic<int64_t> cpu_usec_;  // used by the read and decoder threads
+  int64_t cpu_sample_usec_;        // main thread, cpu load statistic window
+  clock64_t cpu_sample_time_;
+  std::atomic<int> decode_budget_;         // percent of a core, 0 for no limit
+  std::atomic<size_t> video_frame_bytes_;  // size of the last decoded picture
   VideoStateHandler* handler_;
   InputStream* input_st_;
 
-  bool seek_req_;
+  std::atomic<bool> video_suspend_req_;
+  bool video_suspended_;      // read thread
+  bool video_wait_keyframe_;  // read thread, drop video packets until a keyframe after resume
+
+  std::atomic<int> trick_rate_req_;
+  int trick_rate_;       // read thread
+  clock64_t trick_pos_;  // pts of the last keyframe sent, read thread
+  clock64_t trick_next_step_;
+
+  std::atomic<bool> reverse_req_;
+  bool reverse_;                        // read thread
+  bool reverse_at_start_;               // read thread, no keyframe before the cached frames
+  std::atomic<clock64_t> reverse_pos_;  // pts of the last frame shown backward
+
+  // the latest request replaces a pending one, the read thread takes it under seek_mutex_
+  std::atomic<bool> seek_req_;
   int64_t seek_pos_;
   int64_t seek_rel_;
   int seek_flags_;
+  bool seek_preview_req_;        // requested while scrubbing, show the keyframe found first
+  clock64_t seek_scrub_target_;  // last requested position, relative seeks add up from it while scrubbing
+  clock64_t seek_scrub_time_;
+  mutable std::mutex seek_mutex_;
+  std::atomic<bool> video_preview_req_;  // taken by the video thread at its next flush
+  std::atomic<bool> seek_preview_;       // the first frame of the new serial is shown without waiting for sync
+  // accurate seek, taken by the decoder threads at their next flush, frames before it are decoded and dropped
+  std::atomic<clock64_t> video_seek_target_;
+  std::atomic<clock64_t> audio_seek_target_;
 
   std::condition_variable read_thread_cond_;
   std::mutex read_thread_mutex_;
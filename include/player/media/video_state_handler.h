@@ -44,6 +44,7 @@ class VideoStateHandler {
                                            int64_t wanted_channel_layout,
                                            int wanted_nb_channels,
                                            int wanted_sample_rate,
+                                           int wanted_sample_format,  // AVSampleFormat
                                            AudioParams* audio_hw_params,
                                            int* audio_buff_size) WARN_UNUSED_RESULT = 0;  // init audio
   virtual void HanleAudioMix(uint8_t* audio_stream_ptr,
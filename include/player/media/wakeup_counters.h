@@ -0,0 +1,55 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+namespace fastoplayer {
+namespace media {
+
+// Per thread counters of loop iterations / callback invocations, used to check that nothing runs while the
+// player is idle (paused, window hidden). Every thread counts in its own slot, the counts are summed on read.
+enum WakeupSource {
+  MAIN_LOOP_WAKEUP = 0,
+  READ_THREAD_WAKEUP,
+  VIDEO_DECODER_WAKEUP,
+  AUDIO_DECODER_WAKEUP,
+  AUDIO_CALLBACK_WAKEUP,
+  WAKEUP_SOURCES_COUNT
+};
+
+struct WakeupsSnapshot {
+  WakeupsSnapshot();
+
+  uint64_t counts[WAKEUP_SOURCES_COUNT];
+};
+
+void RegisterWakeup(WakeupSource source);
+uint64_t GetWakeupsCount(WakeupSource source);
+const char* WakeupSourceToString(WakeupSource source);
+
+WakeupsSnapshot GetWakeupsSnapshot();
+// wakeups happened since snapshot, as "main: 1, read: 0, ..."
+std::string WakeupsSinceToString(const WakeupsSnapshot& snapshot);
+
+}  // namespace media
+}  // namespace fastoplayer
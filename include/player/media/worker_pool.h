@@ -0,0 +1,125 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace fastoplayer {
+namespace media {
+
+class SerialJob;
+
+enum TaskPriority { TASK_PRIORITY_HIGH = 0, TASK_PRIORITY_NORMAL, TASK_PRIORITY_LOW, TASK_PRIORITIES_COUNT };
+
+/* Fixed number of threads shared by all the streams. Every worker has a queue per priority; a task posted from a
+ * worker goes to its own queue, others are spread round robin. An idle worker takes the highest priority task
+ * there is, from its own queues first, then steals from the other workers, so a high priority task never waits
+ * behind lower ones while any worker is free. Tasks must not block for long: a blocked task holds a worker. */
+class WorkerPool {
+ public:
+  typedef std::function<void()> task_t;
+
+  explicit WorkerPool(size_t threads_count);  // 0 for the number of cores
+  ~WorkerPool();
+
+  bool Start();
+  void Stop();  // drops the queued tasks and waits for the running ones, which still run what they post meanwhile
+
+  size_t GetThreadsCount() const;
+  size_t GetStolenCount() const;  // tasks run by another worker than the one they were queued on
+
+  void Post(task_t task, TaskPriority priority);
+
+ private:
+  friend class SerialJob;
+  class Worker;
+  typedef std::unique_lock<std::mutex> lock_t;
+
+  int WorkerRoutine(size_t index);
+  bool TakeTask(size_t index, task_t* task);
+  void DropTasks();  // queued ones
+  size_t GetCurrentWorker() const;  // index of the calling worker, the workers count if it is not one
+
+  void AddJob(SerialJob* job);
+  void RemoveJob(SerialJob* job);
+  void Wake();             // no lock, no allocation; the notify may be lost if the mutex is busy
+  void SignalWokenJobs();  // on a worker
+
+  const size_t threads_count_;
+  std::vector<Worker*> workers_;
+  std::atomic<size_t> next_worker_;
+  std::atomic<size_t> pending_;  // tasks queued on all the workers
+  std::atomic<size_t> stolen_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stop_;
+
+  std::atomic<bool> woken_;  // some job was woken
+  std::mutex jobs_mutex_;
+  std::vector<SerialJob*> jobs_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+/* One stream step function run on the pool, never two at once, so the steps of a stream keep their order.
+ * Signal() schedules it when something changed (a packet queued, room made for the output); a signal coming while
+ * the step runs makes it run once more, so no wakeup is lost. The step returns true while it has work right away
+ * and false to sleep until the next signal. */
+class SerialJob {
+ public:
+  typedef std::function<bool()> step_t;
+
+  SerialJob(std::shared_ptr<WorkerPool> pool, step_t step, TaskPriority priority);
+  ~SerialJob();
+
+  void Signal();
+  // Signal for a realtime thread: no lock and no allocation, a worker signals the job. The wakeup may be lost while
+  // the pool is busy with its mutex, the caller repeats it until the job runs.
+  void Wake();
+  void SetPriority(TaskPriority priority);  // taken when the job is queued again
+  // no step runs after it, waits for a running one unless called from the step itself
+  void Cancel();
+
+ private:
+  struct State;
+
+  static void Run(std::shared_ptr<State> state);
+  static void Schedule(const std::shared_ptr<State>& state);  // under the state mutex
+
+  friend class WorkerPool;
+
+  const std::shared_ptr<WorkerPool> pool_;
+  const std::shared_ptr<State> state_;  // shared with the queued tasks, which may outlive the job
+  std::atomic<bool> woken_;
+
+  DISALLOW_COPY_AND_ASSIGN(SerialJob);
+};
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -25,7 +25,17 @@
 namespace fastoplayer {
 
 struct PlayerOptions {
-  enum { width = 640, height = 480, volume = 100 };
+  enum {
+    width = 640,
+    height = 480,
+    volume = 100,
+    thumbnails_cpu = 10,
+    mosaic_side = 1,
+    worker_pool = 0,
+    standby = 0,
+    pip_cpu = 50,
+    duck = 0
+  };
   PlayerOptions();
 
   bool is_full_screen;
@@ -34,6 +44,14 @@ struct PlayerOptions {
   common::draw::Size screen_size;
 
   media::audio_volume_t audio_volume;  // Range: 0 - 100
+  bool low_latency_audio;              // small device buffers fed from the SDL queue, measured output delay
+  bool thumbnails;                     // seek bar thumbnails of local files, generated in the background
+  int thumbnails_cpu_share;            // Range: 1 - 100, percent of one core the thumbnails may take
+  int mosaic;                          // Range: 1 - 4, playlist channels per side of the multiview, 1 for off
+  int worker_pool_threads;             // Range: 0 - 64, decoder threads shared by all the streams, 0 for off
+  int standby_channels;                // Range: 0 - 4, playlist channels each side kept demuxed for a fast zap
+  int pip_cpu_share;                   // Range: 1 - 100, percent of one core the picture-in-picture may decode with
+  int duck_volume;                     // Range: 0 - 100, percent of the volume the streams not focused are heard at
   media::stream_id last_showed_channel_id;
 };
 
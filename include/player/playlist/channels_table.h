@@ -0,0 +1,77 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <player/playlist/string_arena.h>
+
+namespace fastoplayer {
+namespace playlist {
+
+struct ChannelEntry {
+  ChannelEntry();
+
+  StringRef name;
+  StringRef url;
+  StringRef tvg_id;
+  StringRef tvg_name;
+  StringRef logo;
+  StringRef group;
+  int32_t duration;  // sec, -1 for live streams
+};
+
+// Compact channel list, all strings live in one arena.
+class ChannelsTable {
+ public:
+  ChannelsTable();
+
+  void Clear();
+  void ShrinkToFit();
+
+  size_t GetCount() const;
+  const ChannelEntry& GetEntry(size_t index) const;
+
+  std::string GetName(size_t index) const;
+  std::string GetUrl(size_t index) const;
+  std::string GetTvgId(size_t index) const;
+  std::string GetTvgName(size_t index) const;
+  std::string GetLogo(size_t index) const;
+  std::string GetGroup(size_t index) const;
+
+  // tvg-id when playlist provides it, url otherwise
+  std::string GetStreamId(size_t index) const;
+  bool FindByStreamId(const std::string& sid, size_t* index) const WARN_UNUSED_RESULT;
+
+  size_t GetMemoryUsage() const;
+
+  StringArena* GetArena();
+  void AddChannel(const ChannelEntry& entry);
+
+ private:
+  StringArena arena_;
+  std::vector<ChannelEntry> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChannelsTable);
+};
+
+}  // namespace playlist
+}  // namespace fastoplayer
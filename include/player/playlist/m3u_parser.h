@@ -0,0 +1,39 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <string>
+
+#include <common/error.h>
+
+#include <player/playlist/channels_table.h>
+
+namespace fastoplayer {
+namespace playlist {
+
+// Single pass parser, lines are read straight from the mapped file and only
+// the needed fields are copied into the table:
+// #EXTINF:-1 tvg-id="id" tvg-name="name" tvg-logo="url" group-title="group",Title
+// url
+common::Error ParseM3uFile(const std::string& path, ChannelsTable* table) WARN_UNUSED_RESULT;
+common::Error ParseM3u(const char* data, size_t size, ChannelsTable* table) WARN_UNUSED_RESULT;
+
+}  // namespace playlist
+}  // namespace fastoplayer
@@ -0,0 +1,60 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <common/error.h>
+#include <common/macros.h>
+
+namespace fastoplayer {
+namespace playlist {
+
+// Read only mapping of a whole file, pages are loaded by the kernel on access.
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+
+  common::ErrnoError Open(const std::string& path) WARN_UNUSED_RESULT;
+  void Close();
+
+  bool IsOpened() const;
+  const char* GetData() const;
+  size_t GetSize() const;
+  int64_t GetModificationTime() const;  // seconds since epoch, used to validate caches
+
+ private:
+  const char* data_;
+  size_t size_;
+  int64_t mtime_;
+#if defined(OS_WIN)
+  void* file_;
+  void* mapping_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace playlist
+}  // namespace fastoplayer
@@ -0,0 +1,88 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/macros.h>
+
+namespace fastoplayer {
+namespace playlist {
+
+// In-memory index over channel names, built from trigram posting lists.
+// Search keeps the previous result set, so a query which extends the last one
+// (user typing one more symbol) only rescans the previous matches.
+class SearchIndex {
+ public:
+  typedef uint32_t entry_id_t;
+  typedef std::vector<entry_id_t> results_t;
+  enum MatchMode { NO_MATCH, SUBSTRING_MATCH, FUZZY_MATCH };
+  enum { gram_size = 3, max_fuzzy_results = 256 };
+
+  SearchIndex();
+
+  void Reserve(size_t count);
+  entry_id_t Add(const std::string& name);
+  void Clear();
+
+  size_t GetCount() const;
+  const std::string& GetName(entry_id_t id) const;
+
+  // results ordered by rank: name prefix, word prefix, substring, fuzzy score
+  const results_t& Search(const std::string& query);
+  const results_t& GetResults() const;
+  MatchMode GetMatchMode() const;
+  void ResetSearch();
+
+ private:
+  typedef uint32_t gram_t;
+  typedef std::unordered_map<gram_t, results_t> grams_t;
+
+  static std::string Fold(const std::string& text);
+  static gram_t MakeGram(const char* data);
+
+  void SearchAll(const std::string& folded);
+  void SearchNarrow(const std::string& folded);
+  void SearchGrams(const std::string& folded);
+  void SearchFuzzy(const std::string& folded);
+  void RankAndStore(const std::string& folded, const results_t& candidates);
+
+  std::vector<std::string> names_;
+  std::vector<std::string> folded_;
+  grams_t grams_;
+
+  std::string last_query_;
+  MatchMode last_mode_;
+  results_t results_;
+
+  // scratch buffers reused between keystrokes
+  results_t candidates_;
+  results_t ranked_[3];
+  std::vector<uint16_t> scores_;
+
+  DISALLOW_COPY_AND_ASSIGN(SearchIndex);
+};
+
+}  // namespace playlist
+}  // namespace fastoplayer
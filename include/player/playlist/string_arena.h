@@ -0,0 +1,75 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/macros.h>
+
+namespace fastoplayer {
+namespace playlist {
+
+struct StringRef {
+  StringRef();
+  StringRef(uint32_t offset, uint32_t size);
+
+  bool IsEmpty() const;
+
+  uint32_t offset;
+  uint32_t size;
+};
+
+// Append only storage for many small strings, addressed by 8 byte references.
+// Interned strings (groups, logos) are stored once however often they repeat.
+class StringArena {
+ public:
+  StringArena();
+
+  void Reserve(size_t bytes);
+  void Clear();
+  void ShrinkToFit();
+
+  StringRef Append(const char* data, size_t size);
+  StringRef Intern(const char* data, size_t size);
+
+  std::string GetString(const StringRef& ref) const;
+  const char* GetData(const StringRef& ref) const;
+  bool IsEqual(const StringRef& ref, const char* data, size_t size) const;
+
+  size_t GetSize() const;
+  size_t GetMemoryUsage() const;
+  size_t GetInternedCount() const;
+
+ private:
+  static uint64_t Hash(const char* data, size_t size);
+
+  std::vector<char> buffer_;
+  std::unordered_map<uint64_t, StringRef> interned_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringArena);
+};
+
+}  // namespace playlist
+}  // namespace fastoplayer
@@ -20,6 +20,10 @@
 
 #include <SDL2/SDL_audio.h>
 
+extern "C" {
+#include <libavutil/samplefmt.h>  // for AVSampleFormat
+}
+
 #include <common/macros.h>
 
 #define INVALID_AUDIO_DEVICE_ID 0
@@ -32,13 +36,20 @@ struct AudioParams;
 
 int ConvertToSDLVolume(int val);
 
-bool init_audio_params(int64_t wanted_channel_layout, int freq, int channels, media::AudioParams* audio_hw_params)
-    WARN_UNUSED_RESULT;
+bool init_audio_params(int64_t wanted_channel_layout,
+                       int freq,
+                       int channels,
+                       AVSampleFormat fmt,
+                       media::AudioParams* audio_hw_params) WARN_UNUSED_RESULT;
 
+// opens the device in the decoder format when it supports it (s16, s32 or float), so no conversion is needed
+// low_latency asks for ~5 msec device periods instead of ~30 msec, cb == nullptr opens the device in queue mode
 bool audio_open(void* opaque,
                 int64_t wanted_channel_layout,
                 int wanted_nb_channels,
                 int wanted_sample_rate,
+                AVSampleFormat wanted_sample_fmt,
+                bool low_latency,
                 SDL_AudioCallback cb,
                 media::AudioParams* audio_hw_params,
                 int* audio_buff_size,
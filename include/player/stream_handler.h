@@ -30,6 +30,7 @@ class StreamHandler : public media::VideoStateHandler {
                                    int64_t wanted_channel_layout,
                                    int wanted_nb_channels,
                                    int wanted_sample_rate,
+                                   int wanted_sample_format,
                                    media::AudioParams* audio_hw_params,
                                    int* audio_buff_size) override = 0;
   void HanleAudioMix(uint8_t* audio_stream_ptr, const uint8_t* src, uint32_t len, int volume) override = 0;
@@ -16,6 +16,8 @@
     along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <string>
+
 #include <player/media/app_options.h>  // for AppOptions
 #include <player/player_options.h>     // for PlayerOptions
 
@@ -27,6 +29,8 @@ struct TVConfig {
 
   bool power_off_on_exit;
   common::logging::LOG_LEVEL loglevel;
+  std::string playlist_path;  // m3u, channels selected by player_options.last_showed_channel_id
+  std::string epg_path;       // xmltv, matched with playlist by tvg-id
 
   media::AppOptions app_options;
   PlayerOptions player_options;
@@ -80,6 +80,7 @@ extern "C" {
   "    -help [topic]  show help\n"                                            \
   "    -license  show license\n"                                              \
   "    -i [input_file] read specified file\n"                                 \
+  "    -playlist [m3u_file] play channels from playlist\n"                    \
   "    -buildconf  show build configuration\n"                                \
   "    -formats  show available formats\n"                                    \
   "    -devices  show available devices\n"                                    \
@@ -105,6 +106,7 @@ extern "C" {
   "ALT + left, ALT + right       seek backward/forward 1 minute\n"            \
   "CTRL + left, CTRL + right     seek backward/forward 10 minutes\n"          \
   "F3                            stream statistic\n"                          \
+  "page up, page down            next/previous playlist channel\n"            \
   "left double-click             toggle full screen\n"
 
 #define HELP_TEXT_TV_PLAYER                                                   \
@@ -35,12 +35,22 @@
 #define CONFIG_MAIN_OPTIONS "main_options"
 #define CONFIG_MAIN_OPTIONS_LOG_LEVEL_FIELD "loglevel"
 #define CONFIG_MAIN_OPTIONS_POWEROFF_ON_EXIT_FIELD "poweroffonexit"
+#define CONFIG_MAIN_OPTIONS_PLAYLIST_FIELD "playlist"
+#define CONFIG_MAIN_OPTIONS_EPG_FIELD "epg"
 
 #define CONFIG_PLAYER_OPTIONS "player_options"
 #define CONFIG_PLAYER_OPTIONS_WIDTH_FIELD "width"
 #define CONFIG_PLAYER_OPTIONS_HEIGHT_FIELD "height"
 #define CONFIG_PLAYER_OPTIONS_FULLSCREEN_FIELD "fullscreen"
 #define CONFIG_PLAYER_OPTIONS_VOLUME_FIELD "volume"
+#define CONFIG_PLAYER_OPTIONS_LOW_LATENCY_AUDIO_FIELD "low_latency_audio"
+#define CONFIG_PLAYER_OPTIONS_THUMBNAILS_FIELD "thumbnails"
+#define CONFIG_PLAYER_OPTIONS_THUMBNAILS_CPU_FIELD "thumbnails_cpu"
+#define CONFIG_PLAYER_OPTIONS_MOSAIC_FIELD "mosaic"
+#define CONFIG_PLAYER_OPTIONS_WORKER_POOL_FIELD "worker_pool"
+#define CONFIG_PLAYER_OPTIONS_STANDBY_CHANNELS_FIELD "standby_channels"
+#define CONFIG_PLAYER_OPTIONS_PIP_CPU_FIELD "pip_cpu"
+#define CONFIG_PLAYER_OPTIONS_DUCK_VOLUME_FIELD "duck_volume"
 #define CONFIG_PLAYER_OPTIONS_LAST_SHOWED_CHANNEL_ID_FIELD "last_showed_channel_id"
 
 #define CONFIG_APP_OPTIONS "app_options"
@@ -57,6 +67,8 @@
 #define CONFIG_APP_OPTIONS_AF_FIELD "af"
 #define CONFIG_APP_OPTIONS_VN_FIELD "vn"
 #define CONFIG_APP_OPTIONS_AN_FIELD "an"
+#define CONFIG_APP_OPTIONS_REVERSE_CACHE_FIELD "reverse_cache"
+#define CONFIG_APP_OPTIONS_ACCURATE_SEEK_FIELD "accurate_seek"
 #define CONFIG_APP_OPTIONS_ACODEC_FIELD "acodec"
 #define CONFIG_APP_OPTIONS_VCODEC_FIELD "vcodec"
 #define CONFIG_APP_OPTIONS_HWACCEL_FIELD "hwaccel"
@@ -74,6 +86,8 @@
   loglevel=INFO ["EMERG", "ALLERT", "CRITICAL", "ERROR", "WARNING", "NOTICE",
   "INFO", "DEBUG"]
   poweroffonexit=false [true,false]
+  playlist=std::string() []
+  epg=std::string() []
 
   [app_options]
   ast=0 [0, INT_MAX]
@@ -85,6 +99,8 @@
   sync=audio [audio, video]
   framedrop=-1 [-1, 0, 1]
   infbuf=-1 [-1, 0, 1]
+  reverse_cache=512 [16, 16384] MB
+  accurate_seek=false [true,false]
   vf=std::string() []
   af=std::string() []
   acodec=std::string() []
@@ -100,6 +116,13 @@
   height=0 [0, INT_MAX]
   fullscreen=false [true,false]
   volume=100 [0,100]
+  thumbnails=false [true,false]
+  thumbnails_cpu=10 [1,100] percent of one core
+  mosaic=1 [1,4] channels per side
+  worker_pool=0 [0,64] decoder threads shared by the streams, 0 for threads per stream
+  standby_channels=0 [0,4] playlist channels each side of the current one kept ready to zap
+  pip_cpu=50 [1,100] percent of one core the picture-in-picture decodes with on one thread, at a lower priority
+  duck_volume=0 [0,100] percent of the volume the mosaic tiles not focused and the picture-in-picture are heard at
   exitonkeydown=false [true,false]
   exitonmousedown=false [true,false]
 */
@@ -128,6 +151,12 @@ int ini_handler_fasto(void* user, const char* section, const char* name, const c
       pconfig->power_off_on_exit = exit;
     }
     return 1;
+  } else if (MATCH(CONFIG_MAIN_OPTIONS, CONFIG_MAIN_OPTIONS_PLAYLIST_FIELD)) {
+    pconfig->playlist_path = value;
+    return 1;
+  } else if (MATCH(CONFIG_MAIN_OPTIONS, CONFIG_MAIN_OPTIONS_EPG_FIELD)) {
+    pconfig->epg_path = value;
+    return 1;
   } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_WIDTH_FIELD)) {
     int width;
     if (parse_number(value, -1, std::numeric_limits<int>::max(), &width)) {
@@ -152,6 +181,54 @@ int ini_handler_fasto(void* user, const char* section, const char* name, const c
       pconfig->player_options.audio_volume = volume;
     }
     return 1;
+  } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_LOW_LATENCY_AUDIO_FIELD)) {
+    bool low_latency_audio;
+    if (parse_bool(value, &low_latency_audio)) {
+      pconfig->player_options.low_latency_audio = low_latency_audio;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_THUMBNAILS_FIELD)) {
+    bool thumbnails;
+    if (parse_bool(value, &thumbnails)) {
+      pconfig->player_options.thumbnails = thumbnails;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_THUMBNAILS_CPU_FIELD)) {
+    int thumbnails_cpu;
+    if (parse_number(value, 1, 100, &thumbnails_cpu)) {
+      pconfig->player_options.thumbnails_cpu_share = thumbnails_cpu;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_MOSAIC_FIELD)) {
+    int mosaic;
+    if (parse_number(value, 1, 4, &mosaic)) {
+      pconfig->player_options.mosaic = mosaic;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_WORKER_POOL_FIELD)) {
+    int worker_pool;
+    if (parse_number(value, 0, 64, &worker_pool)) {
+      pconfig->player_options.worker_pool_threads = worker_pool;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_STANDBY_CHANNELS_FIELD)) {
+    int standby_channels;
+    if (parse_number(value, 0, 4, &standby_channels)) {
+      pconfig->player_options.standby_channels = standby_channels;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_PIP_CPU_FIELD)) {
+    int pip_cpu;
+    if (parse_number(value, 1, 100, &pip_cpu)) {
+      pconfig->player_options.pip_cpu_share = pip_cpu;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_DUCK_VOLUME_FIELD)) {
+    int duck_volume;
+    if (parse_number(value, 0, 100, &duck_volume)) {
+      pconfig->player_options.duck_volume = duck_volume;
+    }
+    return 1;
   } else if (MATCH(CONFIG_PLAYER_OPTIONS, CONFIG_PLAYER_OPTIONS_LAST_SHOWED_CHANNEL_ID_FIELD)) {
     pconfig->player_options.last_showed_channel_id = value;
     return 1;
@@ -230,6 +307,18 @@ int ini_handler_fasto(void* user, const char* section, const char* name, const c
       pconfig->app_options.enable_audio = !disable_audio;
     }
     return 1;
+  } else if (MATCH(CONFIG_APP_OPTIONS, CONFIG_APP_OPTIONS_REVERSE_CACHE_FIELD)) {
+    int reverse_cache_mb;
+    if (parse_number(value, 16, 16384, &reverse_cache_mb)) {
+      pconfig->app_options.reverse_cache_mb = reverse_cache_mb;
+    }
+    return 1;
+  } else if (MATCH(CONFIG_APP_OPTIONS, CONFIG_APP_OPTIONS_ACCURATE_SEEK_FIELD)) {
+    bool accurate_seek;
+    if (parse_bool(value, &accurate_seek)) {
+      pconfig->app_options.accurate_seek = accurate_seek;
+    }
+    return 1;
 #if CONFIG_AVFILTER
   } else if (MATCH(CONFIG_APP_OPTIONS, CONFIG_APP_OPTIONS_VF_FIELD)) {
     std::vector<std::string> tokens;
@@ -319,6 +408,8 @@ common::ErrnoError save_config_file(const std::string& config_absolute_path, TVC
                                  common::logging::log_level_to_text(options->loglevel));
   config_save_file.WriteFormated(CONFIG_MAIN_OPTIONS_POWEROFF_ON_EXIT_FIELD "=%s\n",
                                  common::ConvertToString(options->power_off_on_exit));
+  config_save_file.WriteFormated(CONFIG_MAIN_OPTIONS_PLAYLIST_FIELD "=%s\n", options->playlist_path);
+  config_save_file.WriteFormated(CONFIG_MAIN_OPTIONS_EPG_FIELD "=%s\n", options->epg_path);
 
   config_save_file.Write("[" CONFIG_APP_OPTIONS "]\n");
   config_save_file.WriteFormated(CONFIG_APP_OPTIONS_AST_FIELD "=%s\n",
@@ -342,6 +433,9 @@ common::ErrnoError save_config_file(const std::string& config_absolute_path, TVC
                                  common::ConvertToString(!options->app_options.enable_video));
   config_save_file.WriteFormated(CONFIG_APP_OPTIONS_AN_FIELD "=%s\n",
                                  common::ConvertToString(!options->app_options.enable_audio));
+  config_save_file.WriteFormated(CONFIG_APP_OPTIONS_REVERSE_CACHE_FIELD "=%d\n", options->app_options.reverse_cache_mb);
+  config_save_file.WriteFormated(CONFIG_APP_OPTIONS_ACCURATE_SEEK_FIELD "=%s\n",
+                                 common::ConvertToString(options->app_options.accurate_seek));
 #if CONFIG_AVFILTER
   config_save_file.WriteFormated(CONFIG_APP_OPTIONS_VF_FIELD "=%s\n", options->app_options.vfilters);
   config_save_file.WriteFormated(CONFIG_APP_OPTIONS_AF_FIELD "=%s\n", options->app_options.afilters);
@@ -364,6 +458,19 @@ common::ErrnoError save_config_file(const std::string& config_absolute_path, TVC
   config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_FULLSCREEN_FIELD "=%s\n",
                                  common::ConvertToString(options->player_options.is_full_screen));
   config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_VOLUME_FIELD "=%d\n", options->player_options.audio_volume);
+  config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_LOW_LATENCY_AUDIO_FIELD "=%s\n",
+                                 common::ConvertToString(options->player_options.low_latency_audio));
+  config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_THUMBNAILS_FIELD "=%s\n",
+                                 common::ConvertToString(options->player_options.thumbnails));
+  config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_THUMBNAILS_CPU_FIELD "=%d\n",
+                                 options->player_options.thumbnails_cpu_share);
+  config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_MOSAIC_FIELD "=%d\n", options->player_options.mosaic);
+  config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_WORKER_POOL_FIELD "=%d\n",
+                                 options->player_options.worker_pool_threads);
+  config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_STANDBY_CHANNELS_FIELD "=%d\n",
+                                 options->player_options.standby_channels);
+  config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_PIP_CPU_FIELD "=%d\n", options->player_options.pip_cpu_share);
+  config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_DUCK_VOLUME_FIELD "=%d\n", options->player_options.duck_volume);
   config_save_file.WriteFormated(CONFIG_PLAYER_OPTIONS_LAST_SHOWED_CHANNEL_ID_FIELD "=%s\n",
                                  options->player_options.last_showed_channel_id);
 
@@ -0,0 +1,371 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/draw/image_cache.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+#include <SDL2/SDL_image.h>
+
+#include <common/sprintf.h>
+#include <common/threads/thread_manager.h>
+
+namespace fastoplayer {
+
+namespace draw {
+
+namespace {
+
+uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::string MakeKey(const std::string& img_full_path, const common::draw::Size& size) {
+  return common::MemSPrintf("%dx%d:", size.width(), size.height()) + img_full_path;
+}
+
+SDL_Surface* ScaleSurface(SDL_Surface* img, const common::draw::Size& size) {
+  SDL_Surface* converted = SDL_ConvertSurfaceFormat(img, SDL_PIXELFORMAT_ARGB8888, 0);
+  if (!converted) {
+    return nullptr;
+  }
+
+  if (!size.IsValid() || (converted->w == size.width() && converted->h == size.height())) {
+    return converted;
+  }
+
+  SDL_Surface* scaled = SDL_CreateRGBSurfaceWithFormat(0, size.width(), size.height(), 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!scaled) {
+    SDL_FreeSurface(converted);
+    return nullptr;
+  }
+
+  SDL_SetSurfaceBlendMode(converted, SDL_BLENDMODE_NONE);
+  int res = SDL_BlitScaled(converted, nullptr, scaled, nullptr);
+  SDL_FreeSurface(converted);
+  if (res != 0) {
+    SDL_FreeSurface(scaled);
+    return nullptr;
+  }
+  return scaled;
+}
+
+}  // namespace
+
+ImageCache::ImageCache(size_t workers, size_t texture_budget, const std::string& thumbnails_dir)
+    : texture_budget_(texture_budget),
+      thumbnails_dir_(thumbnails_dir),
+      entries_(),
+      lru_(),
+      texture_bytes_(0),
+      queue_mutex_(),
+      queue_cond_(),
+      requests_(),
+      decoded_(),
+      stop_(false),
+      workers_() {
+  for (size_t i = 0; i < std::max(workers, size_t(1)); ++i) {
+    auto tid = THREAD_MANAGER()->CreateThread(&ImageCache::DecodeThread, this);
+    if (!tid->Start()) {
+      WARNING_LOG() << "Failed to start image decoding thread";
+      continue;
+    }
+    workers_.push_back(tid);
+  }
+}
+
+ImageCache::~ImageCache() {
+  {
+    lock_t lock(queue_mutex_);
+    stop_ = true;
+  }
+  queue_cond_.notify_all();
+  for (auto tid : workers_) {
+    tid->Join();
+  }
+
+  Clear();
+}
+
+SDL_Texture* ImageCache::GetTexture(SDL_Renderer* renderer,
+                                    const std::string& img_full_path,
+                                    const common::draw::Size& size) {
+  if (!renderer || img_full_path.empty() || workers_.empty()) {
+    return nullptr;
+  }
+
+  const std::string key = MakeKey(img_full_path, size);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    Entry* entry = &it->second;
+    const bool retry = entry->state == FAILED && SDL_GetTicks() - entry->failed_ticks > failed_retry_msec;
+    if (!retry && (entry->state != READY || entry->renderer == renderer)) {
+      Touch(entry);
+      return entry->texture;
+    }
+
+    // renderer was recreated, texture belongs to the old one; or the file may be there now
+    DestroyEntry(entry);
+    entries_.erase(it);
+  }
+
+  lru_.push_front(key);
+  Entry entry = {DECODING, nullptr, renderer, 0, 0, lru_.begin()};
+  entries_[key] = entry;
+
+  std::string dropped;
+  {
+    lock_t lock(queue_mutex_);
+    requests_.push_back({key, img_full_path, size});
+    if (requests_.size() > max_pending_requests) {
+      // rows scrolled out of view long ago, they will be requested again if needed
+      dropped = requests_.front().key;
+      requests_.pop_front();
+    }
+  }
+  queue_cond_.notify_one();
+
+  if (!dropped.empty()) {
+    auto dit = entries_.find(dropped);
+    if (dit != entries_.end()) {
+      DestroyEntry(&dit->second);
+      entries_.erase(dit);
+    }
+  }
+  return nullptr;
+}
+
+size_t ImageCache::UploadPending(SDL_Renderer* renderer, size_t max_uploads) {
+  if (!renderer || max_uploads == 0) {
+    return 0;
+  }
+
+  std::vector<Decoded> batch;
+  {
+    lock_t lock(queue_mutex_);
+    size_t count = std::min(max_uploads, decoded_.size());
+    batch.assign(decoded_.begin(), decoded_.begin() + count);
+    decoded_.erase(decoded_.begin(), decoded_.begin() + count);
+  }
+
+  size_t uploaded = 0;
+  for (const Decoded& decoded : batch) {
+    auto it = entries_.find(decoded.key);
+    if (it == entries_.end() || it->second.state != DECODING) {
+      if (decoded.surface) {
+        SDL_FreeSurface(decoded.surface);
+      }
+      continue;
+    }
+
+    Entry* entry = &it->second;
+    if (!decoded.surface) {
+      entry->state = FAILED;
+      entry->failed_ticks = SDL_GetTicks();
+      continue;
+    }
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, decoded.surface);
+    const size_t bytes = static_cast<size_t>(decoded.surface->w) * decoded.surface->h * 4;
+    SDL_FreeSurface(decoded.surface);
+    if (!texture) {
+      entry->state = FAILED;
+      entry->failed_ticks = SDL_GetTicks();
+      continue;
+    }
+
+    entry->state = READY;
+    entry->texture = texture;
+    entry->renderer = renderer;
+    entry->bytes = bytes;
+    texture_bytes_ += bytes;
+    Touch(entry);
+    Evict(texture);
+    uploaded++;
+  }
+  return uploaded;
+}
+
+void ImageCache::Clear() {
+  {
+    lock_t lock(queue_mutex_);
+    requests_.clear();
+    for (const Decoded& decoded : decoded_) {
+      if (decoded.surface) {
+        SDL_FreeSurface(decoded.surface);
+      }
+    }
+    decoded_.clear();
+  }
+
+  for (auto& it : entries_) {
+    DestroyEntry(&it.second);
+  }
+  entries_.clear();
+  lru_.clear();
+  texture_bytes_ = 0;
+}
+
+size_t ImageCache::GetTextureBytes() const {
+  return texture_bytes_;
+}
+
+size_t ImageCache::GetTexturesCount() const {
+  size_t count = 0;
+  for (const auto& it : entries_) {
+    if (it.second.state == READY) {
+      count++;
+    }
+  }
+  return count;
+}
+
+size_t ImageCache::GetPendingCount() const {
+  size_t count = 0;
+  for (const auto& it : entries_) {
+    if (it.second.state == DECODING) {
+      count++;
+    }
+  }
+  return count;
+}
+
+int ImageCache::DecodeThread() {
+  while (true) {
+    Request request;
+    {
+      lock_t lock(queue_mutex_);
+      queue_cond_.wait(lock, [this]() { return stop_ || !requests_.empty(); });
+      if (stop_) {
+        return 0;
+      }
+
+      // newest first, these are the rows which just scrolled into view
+      request = requests_.back();
+      requests_.pop_back();
+    }
+
+    SDL_Surface* surface = DecodeImage(request);
+    lock_t lock(queue_mutex_);
+    if (stop_) {
+      if (surface) {
+        SDL_FreeSurface(surface);
+      }
+      return 0;
+    }
+    decoded_.push_back({request.key, surface});
+  }
+}
+
+SDL_Surface* ImageCache::DecodeImage(const Request& request) const {
+  const std::string thumbnail_path = GetThumbnailPath(request);
+  if (!thumbnail_path.empty()) {
+    SDL_Surface* thumbnail = SDL_LoadBMP(thumbnail_path.c_str());
+    if (thumbnail) {
+      if (thumbnail->w == request.size.width() && thumbnail->h == request.size.height()) {
+        return thumbnail;
+      }
+      SDL_FreeSurface(thumbnail);
+    }
+  }
+
+  SDL_Surface* img = IMG_Load(request.path.c_str());
+  if (!img) {
+    return nullptr;
+  }
+
+  SDL_Surface* scaled = ScaleSurface(img, request.size);
+  SDL_FreeSurface(img);
+  if (scaled && !thumbnail_path.empty()) {
+    const std::string tmp_path = thumbnail_path + ".tmp";
+    if (SDL_SaveBMP(scaled, tmp_path.c_str()) == 0) {
+      remove(thumbnail_path.c_str());
+      rename(tmp_path.c_str(), thumbnail_path.c_str());
+    }
+  }
+  return scaled;
+}
+
+std::string ImageCache::GetThumbnailPath(const Request& request) const {
+  if (thumbnails_dir_.empty() || !request.size.IsValid()) {
+    return std::string();
+  }
+
+  struct stat st;
+  if (stat(request.path.c_str(), &st) != 0) {
+    return std::string();
+  }
+
+  // source size and mtime are part of the name, so a replaced logo is decoded again
+  uint64_t hash = HashBytes(14695981039346656037ULL, request.path.data(), request.path.size());
+  const int64_t size = st.st_size;
+  const int64_t mtime = st.st_mtime;
+  hash = HashBytes(hash, &size, sizeof(size));
+  hash = HashBytes(hash, &mtime, sizeof(mtime));
+  return common::MemSPrintf("%s/%016llx_%dx%d.bmp", thumbnails_dir_, static_cast<unsigned long long>(hash),
+                            request.size.width(), request.size.height());
+}
+
+void ImageCache::Touch(Entry* entry) {
+  if (entry->lru_pos != lru_.begin()) {
+    lru_.splice(lru_.begin(), lru_, entry->lru_pos);
+  }
+}
+
+void ImageCache::Evict(SDL_Texture* keep) {
+  auto it = lru_.end();
+  while (texture_bytes_ > texture_budget_ && it != lru_.begin()) {
+    --it;
+    auto eit = entries_.find(*it);
+    if (eit == entries_.end() || eit->second.state == DECODING || eit->second.texture == keep) {
+      continue;
+    }
+
+    auto next = std::next(it);
+    DestroyEntry(&eit->second);
+    entries_.erase(eit);
+    it = next;
+  }
+}
+
+void ImageCache::DestroyEntry(Entry* entry) {
+  if (entry->texture) {
+    SDL_DestroyTexture(entry->texture);
+    entry->texture = nullptr;
+    texture_bytes_ -= entry->bytes;
+    entry->bytes = 0;
+  }
+  if (entry->lru_pos != lru_.end()) {
+    lru_.erase(entry->lru_pos);
+    entry->lru_pos = lru_.end();
+  }
+}
+
+}  // namespace draw
+
+}  // namespace fastoplayer
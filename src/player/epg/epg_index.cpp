@@ -0,0 +1,728 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/epg/epg_index.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <common/sprintf.h>
+
+#define PROGRAMME_TAG "<programme"
+#define PROGRAMME_END_TAG "</programme>"
+#define CHANNEL_TAG "<channel"
+#define CHANNEL_END_TAG "</channel>"
+#define TITLE_TAG "<title"
+#define DESC_TAG "<desc"
+#define DISPLAY_NAME_TAG "<display-name"
+#define CACHE_MAGIC "FEPGIDX"
+
+namespace fastoplayer {
+namespace epg {
+
+namespace {
+
+struct Slice {
+  Slice() : data(nullptr), size(0) {}
+  Slice(const char* data, size_t size) : data(data), size(size) {}
+
+  std::string ToString() const { return std::string(data, size); }
+
+  const char* data;
+  size_t size;
+};
+
+struct RawProgramme {
+  uint32_t start;
+  uint32_t stop;
+  uint64_t offset;
+  uint32_t size;
+  uint32_t channel;  // chunk local
+};
+
+struct RawChannel {
+  Slice id;
+  uint64_t offset;
+  uint32_t size;
+};
+
+struct ParsedChunk {
+  std::vector<RawProgramme> programmes;
+  std::vector<std::string> channel_ids;  // chunk local channel index -> id
+  std::vector<RawChannel> channels;
+};
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t channels_count;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t programmes_count;
+  uint32_t source_path_size;  // the path follows, one cache file may be shared by several sources
+};
+
+const char* FindString(const char* cur, const char* end, const char* str, size_t str_size) {
+  while (cur + str_size <= end) {
+    const char* found = static_cast<const char*>(memchr(cur, str[0], end - cur - str_size + 1));
+    if (!found) {
+      return nullptr;
+    }
+    if (memcmp(found, str, str_size) == 0) {
+      return found;
+    }
+    cur = found + 1;
+  }
+  return nullptr;
+}
+
+bool IsTagNameEnd(char c) {
+  return c == ' ' || c == '>' || c == '\t' || c == '\r' || c == '\n' || c == '/';
+}
+
+bool GetAttribute(const char* tag_begin, const char* tag_end, const char* name, size_t name_size, Slice* value) {
+  const char* cur = tag_begin;
+  while (cur < tag_end) {
+    const char* found = FindString(cur, tag_end, name, name_size);
+    if (!found) {
+      return false;
+    }
+
+    const char* eq = found + name_size;
+    if ((found[-1] == ' ' || found[-1] == '\t' || found[-1] == '\n' || found[-1] == '\r') && eq + 1 < tag_end &&
+        *eq == '=' && (eq[1] == '"' || eq[1] == '\'')) {
+      const char quote = eq[1];
+      const char* start = eq + 2;
+      const char* stop = static_cast<const char*>(memchr(start, quote, tag_end - start));
+      if (!stop) {
+        return false;
+      }
+      *value = Slice(start, stop - start);
+      return true;
+    }
+    cur = found + 1;
+  }
+  return false;
+}
+
+int64_t DaysFromCivil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+bool ParseDigits(const char* data, size_t count, int* result) {
+  int value = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (data[i] < '0' || data[i] > '9') {
+      return false;
+    }
+    value = value * 10 + (data[i] - '0');
+  }
+  *result = value;
+  return true;
+}
+
+// XMLTV: YYYYMMDDhhmmss +zzzz, seconds and zone are optional
+bool ParseXmltvTime(const Slice& text, uint32_t* utc_sec) {
+  int year, month, day, hour, min, sec = 0;
+  if (text.size < 12 || !ParseDigits(text.data, 4, &year) || !ParseDigits(text.data + 4, 2, &month) ||
+      !ParseDigits(text.data + 6, 2, &day) || !ParseDigits(text.data + 8, 2, &hour) ||
+      !ParseDigits(text.data + 10, 2, &min)) {
+    return false;
+  }
+
+  size_t pos = 12;
+  if (text.size >= 14 && ParseDigits(text.data + 12, 2, &sec)) {
+    pos = 14;
+  }
+
+  int64_t result = DaysFromCivil(year, month, day) * 86400 + hour * 3600 + min * 60 + sec;
+  while (pos < text.size && text.data[pos] == ' ') {
+    pos++;
+  }
+
+  int zone_hours, zone_mins;
+  if (pos + 5 <= text.size && (text.data[pos] == '+' || text.data[pos] == '-') &&
+      ParseDigits(text.data + pos + 1, 2, &zone_hours) && ParseDigits(text.data + pos + 3, 2, &zone_mins)) {
+    const int64_t zone = zone_hours * 3600 + zone_mins * 60;
+    result += text.data[pos] == '+' ? -zone : zone;
+  }
+
+  if (result < 0 || result > UINT32_MAX) {
+    return false;
+  }
+  *utc_sec = static_cast<uint32_t>(result);
+  return true;
+}
+
+void AppendUtf8(uint32_t code, std::string* out) {
+  if (code < 0x80) {
+    out->push_back(static_cast<char>(code));
+  } else if (code < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  } else if (code < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  } else if (code < 0x110000) {
+    out->push_back(static_cast<char>(0xF0 | (code >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  }
+}
+
+std::string UnescapeXml(const Slice& text) {
+  std::string result;
+  result.reserve(text.size);
+  const char* end = text.data + text.size;
+  for (const char* cur = text.data; cur < end; ++cur) {
+    if (*cur != '&') {
+      result.push_back(*cur);
+      continue;
+    }
+
+    const char* semicolon = static_cast<const char*>(memchr(cur, ';', std::min<size_t>(end - cur, 10)));
+    if (!semicolon) {
+      result.push_back(*cur);
+      continue;
+    }
+
+    const Slice entity(cur + 1, semicolon - cur - 1);
+    if (entity.size > 1 && entity.data[0] == '#') {
+      const bool hex = entity.data[1] == 'x' || entity.data[1] == 'X';
+      const unsigned long code = strtoul(std::string(entity.data + (hex ? 2 : 1), semicolon).c_str(), nullptr,
+                                         hex ? 16 : 10);
+      AppendUtf8(static_cast<uint32_t>(code), &result);
+    } else if (entity.size == 3 && memcmp(entity.data, "amp", 3) == 0) {
+      result.push_back('&');
+    } else if (entity.size == 2 && memcmp(entity.data, "lt", 2) == 0) {
+      result.push_back('<');
+    } else if (entity.size == 2 && memcmp(entity.data, "gt", 2) == 0) {
+      result.push_back('>');
+    } else if (entity.size == 4 && memcmp(entity.data, "quot", 4) == 0) {
+      result.push_back('"');
+    } else if (entity.size == 4 && memcmp(entity.data, "apos", 4) == 0) {
+      result.push_back('\'');
+    } else {  // unknown entity stays as is
+      result.append(cur, semicolon + 1);
+    }
+    cur = semicolon;
+  }
+  return result;
+}
+
+// text of the first element with tag inside [begin, end)
+bool FindElementText(const char* begin, const char* end, const char* tag, size_t tag_size, Slice* text) {
+  const char* cur = begin;
+  while (true) {
+    const char* found = FindString(cur, end, tag, tag_size);
+    if (!found || found + tag_size >= end) {
+      return false;
+    }
+
+    cur = found + tag_size;
+    if (IsTagNameEnd(*cur)) {
+      break;
+    }
+  }
+
+  const char* content = static_cast<const char*>(memchr(cur, '>', end - cur));
+  if (!content || content[-1] == '/') {  // <title/>
+    return false;
+  }
+
+  content++;
+  const char* content_end = static_cast<const char*>(memchr(content, '<', end - content));
+  if (!content_end) {
+    return false;
+  }
+
+  *text = Slice(content, content_end - content);
+  return true;
+}
+
+void ParseChunk(const char* data, size_t begin, size_t end, size_t total, ParsedChunk* chunk) {
+  const char* data_end = data + total;
+  const char* cur = data + begin;
+  const char* chunk_end = data + end;
+  std::unordered_map<std::string, uint32_t> local_ids;
+  Slice last_channel;
+  uint32_t last_channel_index = 0;
+  while (cur < chunk_end) {
+    const char* lt = static_cast<const char*>(memchr(cur, '<', chunk_end - cur));
+    if (!lt) {
+      break;
+    }
+
+    const size_t rest = data_end - lt;
+    const bool is_programme = rest > sizeof(PROGRAMME_TAG) && memcmp(lt, PROGRAMME_TAG, sizeof(PROGRAMME_TAG) - 1) == 0 &&
+                              IsTagNameEnd(lt[sizeof(PROGRAMME_TAG) - 1]);
+    const bool is_channel = !is_programme && rest > sizeof(CHANNEL_TAG) &&
+                            memcmp(lt, CHANNEL_TAG, sizeof(CHANNEL_TAG) - 1) == 0 &&
+                            IsTagNameEnd(lt[sizeof(CHANNEL_TAG) - 1]);
+    if (!is_programme && !is_channel) {
+      cur = lt + 1;
+      continue;
+    }
+
+    const char* tag_end = static_cast<const char*>(memchr(lt, '>', rest));
+    if (!tag_end) {
+      break;
+    }
+
+    const char* end_tag = is_programme ? PROGRAMME_END_TAG : CHANNEL_END_TAG;
+    const size_t end_tag_size = is_programme ? sizeof(PROGRAMME_END_TAG) - 1 : sizeof(CHANNEL_END_TAG) - 1;
+    const char* element_end = tag_end + 1;
+    if (tag_end[-1] != '/') {
+      const char* found = FindString(tag_end, data_end, end_tag, end_tag_size);
+      if (!found) {
+        break;
+      }
+      element_end = found + end_tag_size;
+    }
+
+    const uint64_t offset = lt - data;
+    const uint32_t size = static_cast<uint32_t>(element_end - lt);
+    if (is_programme) {
+      Slice start, stop, channel;
+      RawProgramme programme;
+      if (GetAttribute(lt, tag_end, "start", 5, &start) && GetAttribute(lt, tag_end, "channel", 7, &channel) &&
+          ParseXmltvTime(start, &programme.start)) {
+        if (!GetAttribute(lt, tag_end, "stop", 4, &stop) || !ParseXmltvTime(stop, &programme.stop)) {
+          programme.stop = programme.start;  // fixed up from the next programme later
+        }
+
+        // programmes usually come grouped by channel
+        if (!last_channel.data || last_channel.size != channel.size ||
+            memcmp(last_channel.data, channel.data, channel.size) != 0) {
+          const std::string id = channel.ToString();
+          auto it = local_ids.find(id);
+          if (it == local_ids.end()) {
+            it = local_ids.insert(std::make_pair(id, static_cast<uint32_t>(chunk->channel_ids.size()))).first;
+            chunk->channel_ids.push_back(id);
+          }
+          last_channel = channel;
+          last_channel_index = it->second;
+        }
+
+        programme.offset = offset;
+        programme.size = size;
+        programme.channel = last_channel_index;
+        chunk->programmes.push_back(programme);
+      }
+    } else {
+      RawChannel raw;
+      if (GetAttribute(lt, tag_end, "id", 2, &raw.id)) {
+        raw.offset = offset;
+        raw.size = size;
+        chunk->channels.push_back(raw);
+      }
+    }
+    cur = element_end;
+  }
+}
+
+}  // namespace
+
+const EpgIndex::programme_index_t EpgIndex::invalid_programme = UINT32_MAX;
+
+ProgrammeInfo::ProgrammeInfo() : start(0), stop(0), title(), description() {}
+
+EpgIndex::EpgIndex()
+    : file_(), from_cache_(false), channels_(), channels_by_id_(), programmes_(), channel_programmes_() {}
+
+EpgIndex::~EpgIndex() {
+  Close();
+}
+
+common::Error EpgIndex::Load(const std::string& xmltv_path, const std::string& cache_path, size_t threads) {
+  Close();
+  common::ErrnoError errn = file_.Open(xmltv_path);
+  if (errn) {
+    return common::make_error(common::MemSPrintf("Can't open epg %s: %s", xmltv_path, errn->GetDescription()));
+  }
+
+  if (!cache_path.empty() && LoadCache(cache_path, xmltv_path)) {
+    from_cache_ = true;
+    return common::Error();
+  }
+
+  common::Error err = Parse(threads);
+  if (err) {
+    Close();
+    return err;
+  }
+
+  if (!cache_path.empty() && !SaveCache(cache_path, xmltv_path)) {
+    WARNING_LOG() << "Can't save epg index cache: " << cache_path;
+  }
+  return common::Error();
+}
+
+void EpgIndex::Close() {
+  file_.Close();
+  from_cache_ = false;
+  channels_.clear();
+  channels_by_id_.clear();
+  programmes_.clear();
+  channel_programmes_.clear();
+}
+
+bool EpgIndex::IsLoaded() const {
+  return !channel_programmes_.empty();
+}
+
+bool EpgIndex::IsLoadedFromCache() const {
+  return from_cache_;
+}
+
+size_t EpgIndex::GetChannelsCount() const {
+  return channels_.size();
+}
+
+size_t EpgIndex::GetProgrammesCount() const {
+  return programmes_.size();
+}
+
+size_t EpgIndex::GetMemoryUsage() const {
+  size_t channels = 0;
+  for (const ChannelRecord& channel : channels_) {
+    channels += sizeof(ChannelRecord) + channel.id.capacity() + sizeof(channel_index_t) + 2 * sizeof(void*);
+  }
+  return channels + programmes_.capacity() * sizeof(ProgrammeRecord) + channel_programmes_.capacity() * sizeof(uint32_t);
+}
+
+bool EpgIndex::FindChannel(const std::string& channel_id, channel_index_t* channel) const {
+  if (!channel) {
+    return false;
+  }
+
+  auto it = channels_by_id_.find(channel_id);
+  if (it == channels_by_id_.end()) {
+    return false;
+  }
+
+  *channel = it->second;
+  return true;
+}
+
+std::string EpgIndex::GetChannelId(channel_index_t channel) const {
+  if (channel >= channels_.size()) {
+    return std::string();
+  }
+
+  return channels_[channel].id;
+}
+
+std::string EpgIndex::GetChannelDisplayName(channel_index_t channel) const {
+  if (channel >= channels_.size()) {
+    return std::string();
+  }
+
+  const ChannelRecord& record = channels_[channel];
+  const char* begin = file_.GetData() + record.offset;
+  Slice text;
+  if (record.size == 0 || !FindElementText(begin, begin + record.size, DISPLAY_NAME_TAG,
+                                           sizeof(DISPLAY_NAME_TAG) - 1, &text)) {
+    return record.id;
+  }
+  return UnescapeXml(text);
+}
+
+bool EpgIndex::FindNowNext(channel_index_t channel,
+                           common::time64_t utc_msec,
+                           programme_index_t* now,
+                           programme_index_t* next) const {
+  if (!now || !next || channel >= channels_.size()) {
+    return false;
+  }
+
+  *now = invalid_programme;
+  *next = invalid_programme;
+  const uint32_t first = channel_programmes_[channel];
+  const uint32_t last = channel_programmes_[channel + 1];
+  if (first == last) {
+    return true;
+  }
+
+  const uint32_t utc_sec = static_cast<uint32_t>(utc_msec / 1000);
+  auto begin = programmes_.begin() + first;
+  auto end = programmes_.begin() + last;
+  auto it = std::upper_bound(begin, end, utc_sec,
+                             [](uint32_t sec, const ProgrammeRecord& record) { return sec < record.start; });
+  if (it != begin) {
+    auto prev = it - 1;
+    if (utc_sec < prev->stop) {
+      *now = static_cast<programme_index_t>(prev - programmes_.begin());
+    }
+  }
+  if (it != end) {
+    *next = static_cast<programme_index_t>(it - programmes_.begin());
+  }
+  return true;
+}
+
+bool EpgIndex::GetProgrammeTitle(programme_index_t programme, std::string* title) const {
+  if (!title || programme >= programmes_.size()) {
+    return false;
+  }
+
+  *title = DecodeElement(programmes_[programme], TITLE_TAG, sizeof(TITLE_TAG) - 1);
+  return true;
+}
+
+bool EpgIndex::GetProgramme(programme_index_t programme, ProgrammeInfo* info) const {
+  if (!info || programme >= programmes_.size()) {
+    return false;
+  }
+
+  const ProgrammeRecord& record = programmes_[programme];
+  info->start = static_cast<common::time64_t>(record.start) * 1000;
+  info->stop = static_cast<common::time64_t>(record.stop) * 1000;
+  info->title = DecodeElement(record, TITLE_TAG, sizeof(TITLE_TAG) - 1);
+  info->description = DecodeElement(record, DESC_TAG, sizeof(DESC_TAG) - 1);
+  return true;
+}
+
+common::Error EpgIndex::Parse(size_t threads) {
+  const char* data = file_.GetData();
+  const size_t size = file_.GetSize();
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // small files are not worth the threads
+  threads = std::max<size_t>(1, std::min<size_t>(threads, size / (1024 * 1024)));
+
+  // chunk i parses elements which start inside [i * size / threads, (i + 1) * size / threads)
+  std::vector<ParsedChunk> chunks(threads);
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threads; ++i) {
+    workers.push_back(std::thread(ParseChunk, data, i * size / threads, (i + 1) * size / threads, size, &chunks[i]));
+  }
+  ParseChunk(data, 0, size / threads, size, &chunks[0]);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  size_t programmes_count = 0;
+  for (const ParsedChunk& chunk : chunks) {
+    for (const RawChannel& raw : chunk.channels) {
+      const uint32_t index = GetChannelIndex(raw.id.ToString());
+      channels_[index].offset = raw.offset;
+      channels_[index].size = raw.size;
+    }
+    programmes_count += chunk.programmes.size();
+  }
+
+  // counting sort by channel
+  std::vector<std::vector<uint32_t>> chunk_to_global(chunks.size());
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    for (const std::string& id : chunks[i].channel_ids) {
+      chunk_to_global[i].push_back(GetChannelIndex(id));
+    }
+  }
+
+  channel_programmes_.assign(channels_.size() + 1, 0);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    for (const RawProgramme& raw : chunks[i].programmes) {
+      channel_programmes_[chunk_to_global[i][raw.channel] + 1]++;
+    }
+  }
+  for (size_t i = 1; i < channel_programmes_.size(); ++i) {
+    channel_programmes_[i] += channel_programmes_[i - 1];
+  }
+
+  std::vector<uint32_t> fill(channel_programmes_.begin(), channel_programmes_.end() - 1);
+  programmes_.resize(programmes_count);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    for (const RawProgramme& raw : chunks[i].programmes) {
+      const uint32_t channel = chunk_to_global[i][raw.channel];
+      ProgrammeRecord record = {raw.start, raw.stop, raw.offset, raw.size, channel};
+      programmes_[fill[channel]++] = record;
+    }
+    std::vector<RawProgramme>().swap(chunks[i].programmes);
+  }
+
+  for (size_t i = 0; i < channels_.size(); ++i) {
+    auto begin = programmes_.begin() + channel_programmes_[i];
+    auto end = programmes_.begin() + channel_programmes_[i + 1];
+    std::stable_sort(begin, end,
+                     [](const ProgrammeRecord& lhs, const ProgrammeRecord& rhs) { return lhs.start < rhs.start; });
+    for (auto it = begin; it != end; ++it) {
+      if (it->stop <= it->start) {  // no stop time, programme lasts until the next one
+        auto next = it + 1;
+        it->stop = next != end ? next->start : it->start;
+      }
+    }
+  }
+  return common::Error();
+}
+
+bool EpgIndex::LoadCache(const std::string& cache_path, const std::string& source_path) {
+  FILE* file = fopen(cache_path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+
+  bool ok = fseek(file, 0, SEEK_END) == 0;
+  const long cache_size = ftell(file);
+  ok = ok && cache_size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+  CacheHeader header;
+  ok = ok && fread(&header, sizeof(header), 1, file) == 1 &&
+       memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && header.version == cache_version &&
+       header.source_size == file_.GetSize() && header.source_mtime == file_.GetModificationTime() &&
+       header.source_path_size == source_path.size();
+  if (ok) {
+    std::string path(header.source_path_size, '\0');
+    ok = (path.empty() || fread(&path[0], path.size(), 1, file) == 1) && path == source_path;
+  }
+  for (uint32_t i = 0; ok && i < header.channels_count; ++i) {
+    uint32_t id_size = 0;
+    ChannelRecord record;
+    ok = fread(&id_size, sizeof(id_size), 1, file) == 1 && id_size < 4096;
+    if (ok) {
+      record.id.resize(id_size);
+      ok = (id_size == 0 || fread(&record.id[0], id_size, 1, file) == 1) &&
+           fread(&record.offset, sizeof(record.offset), 1, file) == 1 &&
+           fread(&record.size, sizeof(record.size), 1, file) == 1 && record.offset <= header.source_size &&
+           record.size <= header.source_size - record.offset;
+    }
+    if (ok) {
+      channels_by_id_[record.id] = i;
+      channels_.push_back(record);
+    }
+  }
+
+  if (ok) {  // the counts must fit in what is left of the file before anything is allocated for them
+    const long pos = ftell(file);
+    const uint64_t left = pos >= 0 && pos <= cache_size ? static_cast<uint64_t>(cache_size - pos) : 0;
+    const uint64_t ranges_size = (static_cast<uint64_t>(header.channels_count) + 1) * sizeof(uint32_t);
+    ok = ranges_size <= left && header.programmes_count < invalid_programme &&
+         header.programmes_count <= (left - ranges_size) / sizeof(ProgrammeRecord);
+  }
+  if (ok) {
+    channel_programmes_.resize(header.channels_count + 1);
+    programmes_.resize(header.programmes_count);
+    ok = fread(channel_programmes_.data(), sizeof(uint32_t), channel_programmes_.size(), file) ==
+             channel_programmes_.size() &&
+         (programmes_.empty() ||
+          fread(programmes_.data(), sizeof(ProgrammeRecord), programmes_.size(), file) == programmes_.size()) &&
+         channel_programmes_.front() == 0 && channel_programmes_.back() == programmes_.size();
+  }
+  fclose(file);
+
+  /* lookups index the mapping with these without checks */
+  for (size_t i = 0; ok && i + 1 < channel_programmes_.size(); ++i) {
+    ok = channel_programmes_[i] <= channel_programmes_[i + 1];
+  }
+  const uint64_t source_size = file_.GetSize();
+  for (channel_index_t channel = 0; ok && channel < header.channels_count; ++channel) {
+    for (programme_index_t i = channel_programmes_[channel]; ok && i < channel_programmes_[channel + 1]; ++i) {
+      const ProgrammeRecord& record = programmes_[i];
+      ok = record.channel == channel && record.start <= record.stop && record.offset <= source_size &&
+           record.size <= source_size - record.offset;
+    }
+  }
+
+  if (!ok) {
+    channels_.clear();
+    channels_by_id_.clear();
+    programmes_.clear();
+    channel_programmes_.clear();
+  }
+  return ok;
+}
+
+bool EpgIndex::SaveCache(const std::string& cache_path, const std::string& source_path) const {
+  const std::string tmp_path = cache_path + ".tmp";
+  FILE* file = fopen(tmp_path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = cache_version;
+  header.channels_count = static_cast<uint32_t>(channels_.size());
+  header.source_size = file_.GetSize();
+  header.source_mtime = file_.GetModificationTime();
+  header.programmes_count = programmes_.size();
+  header.source_path_size = static_cast<uint32_t>(source_path.size());
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            (source_path.empty() || fwrite(source_path.data(), source_path.size(), 1, file) == 1);
+  for (const ChannelRecord& record : channels_) {
+    const uint32_t id_size = static_cast<uint32_t>(record.id.size());
+    ok = ok && fwrite(&id_size, sizeof(id_size), 1, file) == 1 &&
+         (id_size == 0 || fwrite(record.id.data(), id_size, 1, file) == 1) &&
+         fwrite(&record.offset, sizeof(record.offset), 1, file) == 1 &&
+         fwrite(&record.size, sizeof(record.size), 1, file) == 1;
+  }
+  ok = ok &&
+       fwrite(channel_programmes_.data(), sizeof(uint32_t), channel_programmes_.size(), file) ==
+           channel_programmes_.size() &&
+       (programmes_.empty() ||
+        fwrite(programmes_.data(), sizeof(ProgrammeRecord), programmes_.size(), file) == programmes_.size());
+  ok = fclose(file) == 0 && ok;
+#if defined(OS_WIN)
+  remove(cache_path.c_str());  // rename doesn't replace existing files
+#endif
+  if (!ok || rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+uint32_t EpgIndex::GetChannelIndex(const std::string& id) {
+  auto it = channels_by_id_.find(id);
+  if (it != channels_by_id_.end()) {
+    return it->second;
+  }
+
+  const channel_index_t index = static_cast<channel_index_t>(channels_.size());
+  ChannelRecord record;
+  record.id = id;
+  record.offset = 0;
+  record.size = 0;
+  channels_.push_back(record);
+  channels_by_id_[id] = index;
+  return index;
+}
+
+std::string EpgIndex::DecodeElement(const ProgrammeRecord& record, const char* tag, size_t tag_size) const {
+  const char* begin = file_.GetData() + record.offset;
+  Slice text;
+  if (!FindElementText(begin, begin + record.size, tag, tag_size, &text)) {
+    return std::string();
+  }
+  return UnescapeXml(text);
+}
+
+}  // namespace epg
+}  // namespace fastoplayer
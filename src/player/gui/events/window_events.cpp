@@ -25,6 +25,8 @@ namespace events {
 
 WindowResizeInfo::WindowResizeInfo(const common::draw::Size& size) : size(size) {}
 
+WindowVisibilityInfo::WindowVisibilityInfo(bool visible) : visible(visible) {}
+
 }  // namespace events
 }  // namespace gui
 
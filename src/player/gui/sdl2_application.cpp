@@ -35,7 +35,10 @@
 #include <player/gui/events/mouse_events.h>
 #include <player/gui/events/window_events.h>
 
+#include <player/media/wakeup_counters.h>
+
 #define FASTO_EVENT (SDL_USEREVENT)
+#define FASTO_WAKEUP_EVENT (SDL_USEREVENT + 1)
 
 namespace {
 
@@ -54,8 +57,12 @@ namespace application {
 Sdl2Application::Sdl2Application(int argc, char** argv)
     : common::application::IApplication(argc, argv),
       dispatcher_(),
+      posted_events_(),
       update_display_timeout_msec_(event_timeout_wait_msec),
-      cursor_visible_(false) {
+      cursor_visible_(false),
+      idle_mode_(false),
+      waiting_events_(false),
+      overflowed_events_(0) {
   CHECK(THREAD_MANAGER()->IsMainThread());
 }
 
@@ -94,10 +101,17 @@ int Sdl2Application::PreExecImpl() {
 int Sdl2Application::ExecImpl() {
   SDL_PumpEvents();
   while (true) {
+    media::RegisterWakeup(media::MAIN_LOOP_WAKEUP);
+    if (!ProcessPostedEvents()) {
+      break;
+    }
+
     SDL_Event event;
     Uint32 start_wait_ts = SDL_GetTicks();
     int res = SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT);
-    if (res == -1) {        // error
+    if (res == -1) {                      // error
+    } else if (res == 0 && idle_mode_) {  // no events, nothing to draw
+      WaitEvents();
     } else if (res == 0) {  // no events
       events::TimeInfo inf;
       events::TimerEvent* timer_event = new events::TimerEvent(this, inf);
@@ -108,9 +122,17 @@ int Sdl2Application::ExecImpl() {
         SDL_Delay(sleep_timeout);
       }
     } else {  // some events
-      bool is_stop_event = event.type == FASTO_EVENT && event.user.data1 == nullptr;
-      if (is_stop_event) {
-        break;
+      if (event.type == FASTO_EVENT) {
+        // an overflowed event goes after the ones queued before it, the later ones wait behind it in SDL
+        events::Event* fevent = static_cast<events::Event*>(event.user.data1);
+        if (!fevent) {
+          break;
+        }
+        if (!ProcessPostedEvents()) {
+          delete fevent;
+          break;
+        }
+        overflowed_events_.fetch_sub(1);
       }
 
       ProcessEvent(&event);
@@ -169,8 +191,36 @@ void Sdl2Application::ProcessEvent(SDL_Event* event) {
   }
 }
 
+void Sdl2Application::WaitEvents() {
+  waiting_events_.store(true);
+  // pairs with the fence in PostEvent, either we see the posted event or the poster sees us waiting
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (posted_events_.IsEmpty()) {
+    SDL_WaitEvent(nullptr);  // leaves the event in queue
+  }
+  waiting_events_.store(false);
+}
+
+bool Sdl2Application::ProcessPostedEvents() {
+  common::IEvent* event = nullptr;
+  while (posted_events_.Pop(&event)) {
+    if (!event) {
+      return false;
+    }
+
+    events::Event* fevent = static_cast<events::Event*>(event);
+    HandleEvent(fevent);
+  }
+  return true;
+}
+
 int Sdl2Application::PostExecImpl() {
   TTF_Quit();
+  common::IEvent* posted = nullptr;
+  while (posted_events_.Pop(&posted)) {
+    delete posted;
+  }
+
   SDL_Event event;
   while (SDL_PollEvent(&event)) {
     if (event.type == FASTO_EVENT) {
@@ -190,6 +240,15 @@ void Sdl2Application::SetDisplayUpdateTimeout(update_display_timeout_t msec) {
   update_display_timeout_msec_ = msec;
 }
 
+void Sdl2Application::SetIdleMode(bool idle) {
+  CHECK(THREAD_MANAGER()->IsMainThread());
+  idle_mode_ = idle;
+}
+
+bool Sdl2Application::IsIdleMode() const {
+  return idle_mode_;
+}
+
 void Sdl2Application::Subscribe(common::IListener* listener, common::events_size_t id) {
   dispatcher_.Subscribe(static_cast<events::EventListener*>(listener), id);
 }
@@ -214,12 +273,26 @@ void Sdl2Application::SendEvent(common::IEvent* event) {
 }
 
 void Sdl2Application::PostEvent(common::IEvent* event) {
+  if (overflowed_events_.load() == 0 && posted_events_.Push(event)) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_events_.load(std::memory_order_relaxed)) {
+      SDL_Event wakeup_event;
+      SDL_zero(wakeup_event);
+      wakeup_event.type = FASTO_WAKEUP_EVENT;
+      SDL_PushEvent(&wakeup_event);
+    }
+    return;
+  }
+
+  // queue is full, slow path through SDL until the main loop catches up
+  overflowed_events_.fetch_add(1);
   SDL_Event sevent;
   sevent.type = FASTO_EVENT;
   sevent.user.data1 = event;
   int res = SDL_PushEvent(&sevent);
   if (res != 1) {
     DNOTREACHED();
+    overflowed_events_.fetch_sub(1);
     delete event;
   }
 }
@@ -307,6 +380,14 @@ void Sdl2Application::HandleWindowEvent(SDL_WindowEvent* event) {  // SDL_Window
     events::WindowCloseInfo inf;
     events::WindowCloseEvent* wind_close = new events::WindowCloseEvent(this, inf);
     HandleEvent(wind_close);
+  } else if (event->event == SDL_WINDOWEVENT_HIDDEN || event->event == SDL_WINDOWEVENT_MINIMIZED) {
+    events::WindowVisibilityInfo inf(false);
+    events::WindowVisibilityEvent* wind_vis = new events::WindowVisibilityEvent(this, inf);
+    HandleEvent(wind_vis);
+  } else if (event->event == SDL_WINDOWEVENT_SHOWN || event->event == SDL_WINDOWEVENT_RESTORED) {
+    events::WindowVisibilityInfo inf(true);
+    events::WindowVisibilityEvent* wind_vis = new events::WindowVisibilityEvent(this, inf);
+    HandleEvent(wind_vis);
   }
 }
 
@@ -18,16 +18,36 @@
 
 #include <player/gui/widgets/icon_label.h>
 
+#include <string>
+
+#include <common/error.h>
+
+#include <player/draw/draw.h>
+#include <player/draw/image_cache.h>
+
 namespace fastoplayer {
 
 namespace gui {
 
+namespace {
+const SDL_Color kDefaultPlaceholderColor = {128, 128, 128, 64};
+}
+
 IconLabel::IconLabel(Window* parent)
-    : base_class(parent), icon_img_(nullptr), icon_size_(), space_betwen_image_and_label_(default_space) {}
+    : base_class(parent),
+      icon_img_(nullptr),
+      icon_cache_(nullptr),
+      icon_path_(),
+      icon_placeholder_color_(kDefaultPlaceholderColor),
+      icon_size_(),
+      space_betwen_image_and_label_(default_space) {}
 
 IconLabel::IconLabel(const SDL_Color& back_ground_color, Window* parent)
     : base_class(back_ground_color, parent),
       icon_img_(nullptr),
+      icon_cache_(nullptr),
+      icon_path_(),
+      icon_placeholder_color_(kDefaultPlaceholderColor),
       icon_size_(),
       space_betwen_image_and_label_(default_space) {}
 
@@ -47,17 +67,27 @@ void IconLabel::Draw(SDL_Renderer* render) {
     return;
   }
 
-  if (!icon_img_) {
+  SDL_Texture* icon_img = icon_img_;
+  if (!icon_img && icon_cache_ && !icon_path_.empty()) {
+    icon_img = icon_cache_->GetTexture(render, icon_path_, icon_size_);
+  }
+
+  if (!icon_img && (!icon_cache_ || icon_path_.empty())) {
     base_class::Draw(render);
     return;
   }
 
   FontWindow::Draw(render);
   SDL_Rect area_rect = GetRect();
-  SDL_Rect icon_rect = {area_rect.x, area_rect.y, icon_size_.height(), icon_size_.width()};
+  SDL_Rect icon_rect = {area_rect.x, area_rect.y, icon_size_.width(), icon_size_.height()};
 
   int shift = icon_size_.width() + space_betwen_image_and_label_;
-  DrawImage(render, icon_img_, icon_rect);
+  if (icon_img) {
+    DrawImage(render, icon_img, icon_rect);
+  } else {
+    common::Error err = draw::FillRectColor(render, icon_rect, icon_placeholder_color_);
+    DCHECK(!err) << err->GetDescription();
+  }
   SDL_Rect text_rect = {area_rect.x + shift, area_rect.y, area_rect.w - shift, area_rect.h};
   const std::string text = GetText();
   base_class::DrawText(render, text, text_rect, GetDrawType());
@@ -83,6 +113,23 @@ SDL_Texture* IconLabel::GetIconTexture() const {
   return icon_img_;
 }
 
+void IconLabel::SetIconPath(draw::ImageCache* cache, const std::string& icon_path) {
+  icon_cache_ = cache;
+  icon_path_ = icon_path;
+}
+
+std::string IconLabel::GetIconPath() const {
+  return icon_path_;
+}
+
+void IconLabel::SetIconPlaceholderColor(const SDL_Color& color) {
+  icon_placeholder_color_ = color;
+}
+
+SDL_Color IconLabel::GetIconPlaceholderColor() const {
+  return icon_placeholder_color_;
+}
+
 }  // namespace gui
 
 }  // namespace fastoplayer
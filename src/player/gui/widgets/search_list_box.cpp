@@ -0,0 +1,77 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/gui/widgets/search_list_box.h>
+
+#include <player/draw/types.h>
+
+namespace fastoplayer {
+namespace gui {
+
+SearchListBox::SearchListBox(playlist::SearchIndex* index, Window* parent)
+    : base_class(parent), index_(index), query_() {
+  CHECK(index_);
+  index_->Search(query_);
+}
+
+SearchListBox::SearchListBox(playlist::SearchIndex* index, const SDL_Color& back_ground_color, Window* parent)
+    : base_class(back_ground_color, parent), index_(index), query_() {
+  CHECK(index_);
+  index_->Search(query_);
+}
+
+SearchListBox::~SearchListBox() {}
+
+void SearchListBox::SetQuery(const std::string& query) {
+  query_ = query;
+  index_->Search(query_);
+  SetActiveRow(GetRowCount() ? 0 : draw::invalid_row_position);
+}
+
+std::string SearchListBox::GetQuery() const {
+  return query_;
+}
+
+bool SearchListBox::GetEntryId(size_t row, entry_id_t* id) const {
+  const playlist::SearchIndex::results_t& results = index_->GetResults();
+  if (!id || row >= results.size()) {
+    return false;
+  }
+
+  *id = results[row];
+  return true;
+}
+
+size_t SearchListBox::GetRowCount() const {
+  return index_->GetResults().size();
+}
+
+void SearchListBox::DrawRow(SDL_Renderer* render, size_t pos, bool active, bool hover, const SDL_Rect& row_rect) {
+  UNUSED(active);
+  UNUSED(hover);
+  entry_id_t id;
+  if (!GetEntryId(pos, &id)) {
+    return;
+  }
+
+  DrawText(render, index_->GetName(id), row_rect, GetDrawType());
+}
+
+}  // namespace gui
+}  // namespace fastoplayer
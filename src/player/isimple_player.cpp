@@ -18,7 +18,14 @@
 
 #include <player/isimple_player.h>
 
+#include <stdlib.h>
+
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
 #include <thread>
+#include <vector>
 
 #include <common/application/application.h>  // for fApp, Application
 #include <common/threads/thread_manager.h>
@@ -31,47 +38,128 @@
 #include <player/av_sdl_utils.h>
 #include <player/sdl_utils.h>
 
+#include <player/media/av_utils.h>
+#include <player/media/decoder_cache.h>
+#include <player/media/demux_source.h>
+#include <player/media/dsp/audio_dsp.h>
 #include <player/media/frames/audio_frame.h>  // for AudioFrame
 #include <player/media/frames/video_frame.h>  // for VideoFrame
+#include <player/media/gop_keeper.h>
 #include <player/media/hwaccels/ffmpeg_hw.h>
+#include <player/media/teardown_service.h>
+#include <player/media/thumbnail_service.h>
 #include <player/media/video_state.h>  // for VideoState
+#include <player/media/worker_pool.h>
 
 #include <player/gui/sdl2_application.h>
+#include <player/gui/widgets/icon_label.h>
 #include <player/gui/widgets/label.h>
 
 #include <player/draw/draw.h>
 #include <player/draw/font.h>
+#include <player/draw/image_cache.h>
 #include <player/draw/texture_saver.h>
 #include <player/draw/types.h>
 
 /* Step size for volume control */
 #define VOLUME_STEP 1
 
+/* first keyframe scan rate, doubled on each press */
+#define SCAN_MIN_RATE 4
+
 #define CURSOR_HIDE_DELAY_MSEC 1000  // 1 sec
+/* Low latency audio: device periods kept queued ahead of the driver */
+#define AUDIO_QUEUE_TARGET_PERIODS 2
+/* periods held by SDL and the driver after the queue, SDL has no api to ask the backend */
+#define AUDIO_QUEUE_DEVICE_PERIODS 1
+#define AUDIO_PUMP_PAUSED_SLEEP_MSEC 100
 #define VOLUME_HIDE_DELAY_MSEC 2000  // 2 sec
+#define BANNER_HIDE_DELAY_MSEC 3000  // 3 sec
+
+/* channel logos: decoded ones turned into textures per drawn frame, the rest wait for the next */
+#define ICON_UPLOADS_PER_FRAME 2
+
+/* multiview: tiles per side at most */
+#define MOSAIC_MAX_SIDE 4
+#define MOSAIC_STATS_LINES_COUNT 5
+/* picture-in-picture: part of the display width and height */
+#define PIP_SIZE_DIVIDER 4
+
+/* mix bus: a change of focus fades over this duration */
+#define AUDIO_MIX_RAMP_MSEC 20
+/* mosaic tiles, the picture-in-picture and the main stream */
+#define AUDIO_MIX_MAX_SOURCES (MOSAIC_MAX_SIDE * MOSAIC_MAX_SIDE + 2)
+
+/* closed streams joined at once, the others wait in the queue */
+#define TEARDOWN_THREADS_COUNT 2
+/* opened decoders kept for the next channel, the video and audio ones of the last two */
+#define DECODER_CACHE_SIZE 4
+/* packets held per standby channel, a longer GOP is not kept */
+#define GOP_KEEPER_CHANNEL_MAX_BYTES (16 * 1024 * 1024)
 
 #define USER_FIELD "user"
 #define URLS_FIELD "urls"
 
 namespace fastoplayer {
+namespace {
+const double playback_speeds[] = {0.25, 0.5, 0.75, 1.0, 1.25, 1.5, 2.0, 3.0, 4.0};
+}  // namespace
+
+struct ISimplePlayer::MosaicTile {
+  explicit MosaicTile(media::VideoState* stream)
+      : stream(stream),
+        tid(),
+        texture(new draw::TextureSaver),
+        format(0),
+        width(0),
+        height(0),
+        sar({0, 1}),
+        flip_v(false),
+        error() {}
+  ~MosaicTile() { destroy(&texture); }
+
+  media::VideoState* stream;
+  std::shared_ptr<common::threads::Thread<int>> tid;
+  draw::TextureSaver* texture;  // main thread
+  // last uploaded picture, redrawn until the stream has a new one
+  Uint32 format;
+  int width;
+  int height;
+  AVRational sar;
+  bool flip_v;
+  std::string error;  // the stream quit, shown instead of its picture
+};
 
 const SDL_Color ISimplePlayer::text_color = {255, 255, 255, 0};
 const AVRational ISimplePlayer::min_fps = {25, 1};
 const SDL_Color ISimplePlayer::stream_statistic_color = {171, 217, 98, Uint8(SDL_ALPHA_OPAQUE * 0.5)};
 const SDL_Color ISimplePlayer::volume_color = stream_statistic_color;
 
-ISimplePlayer::ISimplePlayer(const PlayerOptions& options, const file_string_path_t& absolute_font_path)
+ISimplePlayer::ISimplePlayer(const PlayerOptions& options,
+                             const file_string_path_t& absolute_font_path,
+                             const std::string& icons_cache_dir)
     : StreamHandler(),
       renderer_(nullptr),
       font_(nullptr),
       options_(options),
       audio_params_(nullptr),
       audio_buff_size_(0),
+      mix_bus_(nullptr),
+      source_audio_(),
       audio_device_(INVALID_AUDIO_DEVICE_ID),
+      audio_device_paused_(false),
+      audio_pump_tid_(),
+      audio_pump_stop_(false),
+      audio_pump_mutex_(),
       window_(nullptr),
       cursor_last_shown_(0),
       volume_label_(nullptr),
       volume_last_shown_(0),
+      image_cache_(new draw::ImageCache(draw::ImageCache::default_workers,
+                                        draw::ImageCache::default_texture_budget,
+                                        icons_cache_dir)),
+      banner_label_(nullptr),
+      banner_last_shown_(0),
       last_mouse_left_click_(0),
       exec_tid_(),
       stream_(nullptr),
@@ -82,10 +170,32 @@ ISimplePlayer::ISimplePlayer(const PlayerOptions& options, const file_string_pat
       muted_(false),
       statistic_label_(nullptr),
       render_texture_(nullptr),
+      picture_format_(0),
+      picture_width_(0),
+      picture_height_(0),
+      picture_sar_({0, 1}),
+      picture_flip_v_(false),
+      thumbnails_(nullptr),
+      thumbnail_texture_(nullptr),
+      mosaic_(),
+      mosaic_focus_(0),
+      mosaic_side_(0),
+      mosaic_label_(nullptr),
+      pip_(nullptr),
+      worker_pool_(),
+      teardown_(new media::TeardownService(TEARDOWN_THREADS_COUNT)),
+      decoder_cache_(std::make_shared<media::DecoderCache>(DECODER_CACHE_SIZE)),
+      demux_sources_(),
+      gop_keeper_(new media::GopKeeper(GOP_KEEPER_CHANNEL_MAX_BYTES, teardown_)),
       update_video_timer_interval_msec_(0),
       last_pts_checkpoint_(media::invalid_clock()),
       video_frames_handled_(0),
-      absolute_font_path_(absolute_font_path) {
+      absolute_font_path_(absolute_font_path),
+      window_hidden_(false),
+      radio_mode_(false),
+      idle_(false),
+      idle_start_msec_(0),
+      idle_wakeups_() {
   UpdateDisplayInterval(min_fps);
 
   fApp->Subscribe(this, gui::events::PostExecEvent::EventType);
@@ -105,6 +215,7 @@ ISimplePlayer::ISimplePlayer(const PlayerOptions& options, const file_string_pat
   fApp->Subscribe(this, gui::events::WindowResizeEvent::EventType);
   fApp->Subscribe(this, gui::events::WindowExposeEvent::EventType);
   fApp->Subscribe(this, gui::events::WindowCloseEvent::EventType);
+  fApp->Subscribe(this, gui::events::WindowVisibilityEvent::EventType);
 
   fApp->Subscribe(this, gui::events::QuitEvent::EventType);
 
@@ -113,18 +224,40 @@ ISimplePlayer::ISimplePlayer(const PlayerOptions& options, const file_string_pat
   volume_label_->SetDrawType(gui::Label::CENTER_TEXT);
   volume_label_->SetTextColor(text_color);
 
+  // channel banner
+  banner_label_ = new gui::IconLabel(volume_color);
+  banner_label_->SetDrawType(gui::Label::CENTER_TEXT);
+  banner_label_->SetTextColor(text_color);
+  banner_label_->SetIconSize(common::draw::Size(banner_height, banner_height));
+  banner_label_->SetSpace(space_width);
+  banner_label_->SetVisible(false);
+
   // statistic label
   statistic_label_ = new gui::Label(stream_statistic_color);
   statistic_label_->SetDrawType(gui::Label::WRAPPED_TEXT);
   statistic_label_->SetTextColor(text_color);
+
+  // mosaic tile statistic and errors
+  mosaic_label_ = new gui::Label(stream_statistic_color);
+  mosaic_label_->SetDrawType(gui::Label::WRAPPED_TEXT);
+  mosaic_label_->SetTextColor(text_color);
+
+  if (!teardown_->Start()) {
+    WARNING_LOG() << "Failed to start the teardown threads, streams are closed on the main thread.";
+  }
+  if (options_.worker_pool_threads > 0) {
+    worker_pool_ = std::make_shared<media::WorkerPool>(options_.worker_pool_threads);
+    if (!worker_pool_->Start()) {
+      WARNING_LOG() << "Failed to start the worker pool, streams decode on their own threads.";
+      worker_pool_.reset();
+    }
+  }
 }
 
 void ISimplePlayer::SetFullScreen(bool full_screen) {
   options_.is_full_screen = full_screen;
   SDL_SetWindowFullscreen(window_, full_screen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0);
-  if (stream_) {
-    stream_->RefreshRequest();
-  }
+  RefreshStreams();
 }
 
 void ISimplePlayer::SetMute(bool mute) {
@@ -132,8 +265,14 @@ void ISimplePlayer::SetMute(bool mute) {
 }
 
 ISimplePlayer::~ISimplePlayer() {
+  StopAudioPump();
+  destroy(&gop_keeper_);
+  destroy(&teardown_);
+  destroy(&mosaic_label_);
   destroy(&statistic_label_);
+  destroy(&banner_label_);
   destroy(&volume_label_);
+  destroy(&image_cache_);
 
   if (media::hw_device_ctx) {
     av_buffer_unref(&media::hw_device_ctx);
@@ -159,51 +298,222 @@ void ISimplePlayer::SetUrlLocation(media::stream_id sid,
   SetStream(stream);
 }
 
+void ISimplePlayer::SetMosaicLocations(const std::vector<StreamLocation>& locations,
+                                       media::AppOptions opt,
+                                       media::ComplexOptions copt) {
+  FreePip(true);
+  FreeStreamSafe(true);
+  const size_t count = std::min<size_t>(locations.size(), MOSAIC_MAX_SIDE * MOSAIC_MAX_SIDE);
+  const int side = static_cast<int>(ceil(sqrt(static_cast<double>(count))));
+  if (side < 1) {
+    SwitchToChannelErrorMode(common::make_error("Mosaic without streams"));
+    return;
+  }
+
+  /* tiles are decoded at their size and on one thread each, so their cpu load is all of their decoding */
+  CalculateDispalySize();
+  const int tile_width = (window_size_.width() / side) & ~1;
+  const int tile_height = (window_size_.height() / side) & ~1;
+#if CONFIG_AVFILTER
+  const std::string scale =
+      common::MemSPrintf("scale=w=%d:h=%d:force_original_aspect_ratio=decrease", tile_width, tile_height);
+  opt.vfilters = opt.vfilters.empty() ? scale : opt.vfilters + "," + scale;
+#endif
+  av_dict_set(&copt.codec_opts, "threads", "1", 0);
+
+  std::vector<MosaicTile*> tiles;
+  for (size_t i = 0; i < count; ++i) {
+    media::VideoState* stream = CreateStream(locations[i].sid, locations[i].uri, opt, copt);
+    if (!stream) {
+      WARNING_LOG() << "Mosaic skips invalid url: " << locations[i].uri.spec();
+      continue;
+    }
+    stream->SetHandler(this);
+    stream->SetTaskPriority(tiles.empty() ? media::TASK_PRIORITY_HIGH : media::TASK_PRIORITY_NORMAL);
+    tiles.push_back(new MosaicTile(stream));
+  }
+  if (tiles.empty()) {
+    SwitchToChannelErrorMode(common::make_error("Failed to create mosaic streams"));
+    return;
+  }
+
+  options_.last_showed_channel_id = tiles[0]->stream->GetId();
+  mosaic_side_ = side;
+  mosaic_focus_ = 0;
+  {
+    std::unique_lock<std::mutex> lock(audio_pump_mutex_);
+    mosaic_ = tiles;
+    stream_ = tiles[0]->stream;
+  }
+  UpdateVideoSuspend();
+  UpdateDisplayInterval(min_fps);
+  for (MosaicTile* tile : tiles) {
+    tile->tid = THREAD_MANAGER()->CreateThread(&media::VideoState::Exec, tile->stream);
+    if (!tile->tid->Start()) {
+      tile->tid.reset();
+      tile->error = "Failed to start stream";
+    }
+  }
+  INFO_LOG() << "Mosaic " << side << "x" << side << " of " << tiles.size() << " streams, tile " << tile_width << "x"
+             << tile_height;
+}
+
+void ISimplePlayer::SetStandbyLocations(const std::vector<common::uri::GURL>& uris, media::ComplexOptions copt) {
+  std::vector<common::uri::GURL> standby;
+  for (const common::uri::GURL& uri : uris) {
+    common::uri::GURL mux;
+    int program = 0;
+    if (!media::SplitProgramUrl(uri, &mux, &program)) {  // programs of a mux already share its demuxer
+      standby.push_back(uri);
+    }
+  }
+  gop_keeper_->SetChannels(standby, copt.format_opts);
+}
+
+void ISimplePlayer::SetPipLocation(media::stream_id sid,
+                                   const common::uri::GURL& uri,
+                                   media::AppOptions opt,
+                                   media::ComplexOptions copt) {
+  if (!mosaic_.empty()) {
+    WARNING_LOG() << "Picture-in-picture is not shown over the mosaic.";
+    return;
+  }
+
+  FreePip(true);
+  /* the decode budget counts the stream's own threads, frame threads of the codec would escape it; a swap reopens
+   * the video decoders with the threads of their new places */
+  av_dict_set(&copt.codec_opts, "threads", "1", 0);
+  const media::stream_id last_showed = options_.last_showed_channel_id;  // the primary stream is still the one
+  media::VideoState* stream = CreateStream(sid, uri, opt, copt);
+  options_.last_showed_channel_id = last_showed;
+  if (!stream) {
+    WARNING_LOG() << "Picture-in-picture skips invalid url: " << uri.spec();
+    return;
+  }
+
+  stream->SetHandler(this);
+  MosaicTile* pip = new MosaicTile(stream);
+  {
+    std::unique_lock<std::mutex> lock(audio_pump_mutex_);
+    pip_ = pip;
+  }
+  UpdatePipBudget();
+  UpdateVideoSuspend();
+  pip->tid = THREAD_MANAGER()->CreateThread(&media::VideoState::Exec, stream);
+  if (!pip->tid->Start()) {
+    pip->tid.reset();
+    pip->error = "Failed to start stream";
+  }
+  INFO_LOG() << "Picture-in-picture " << uri.spec() << ", decode budget " << options_.pip_cpu_share << "%";
+}
+
+void ISimplePlayer::ClosePip() {
+  FreePip(true);
+}
+
+bool ISimplePlayer::SwapPip() {
+  CHECK(THREAD_MANAGER()->IsMainThread());
+  if (!pip_ || !stream_ || !pip_->tid || !pip_->error.empty() || !render_texture_) {
+    return false;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(audio_pump_mutex_);
+    std::swap(stream_, pip_->stream);
+  }
+  std::swap(exec_tid_, pip_->tid);
+  /* the last pictures trade places too, nothing goes black until the next frames */
+  std::swap(render_texture_, pip_->texture);
+  std::swap(picture_format_, pip_->format);
+  std::swap(picture_width_, pip_->width);
+  std::swap(picture_height_, pip_->height);
+  std::swap(picture_sar_, pip_->sar);
+  std::swap(picture_flip_v_, pip_->flip_v);
+  UpdatePipBudget();
+  /* the primary stream takes the codec threads and the other one goes back to the thread the budget counts */
+  stream_->ReopenVideoDecoder(0);
+  pip_->stream->ReopenVideoDecoder(1);
+
+  media::ThumbnailService* thumbnails = thumbnails_;
+  thumbnails_ = nullptr;
+  if (thumbnails) {
+    teardown_->Post([thumbnails]() { delete thumbnails; }, 0);
+  }
+  StartThumbnails();
+
+  options_.last_showed_channel_id = stream_->GetId();
+  last_pts_checkpoint_ = media::invalid_clock();
+  UpdateDisplayInterval(stream_->GetFrameRate());
+  if (window_) {
+    SDL_SetWindowTitle(window_, GetCurrentUrlName().c_str());
+  }
+  return true;
+}
+
 void ISimplePlayer::HandleEvent(event_t* event) {
-  if (event->GetEventType() == gui::events::PreExecEvent::EventType) {
-    gui::events::PreExecEvent* pre_event = static_cast<gui::events::PreExecEvent*>(event);
-    HandlePreExecEvent(pre_event);
-  } else if (event->GetEventType() == gui::events::PostExecEvent::EventType) {
-    gui::events::PostExecEvent* post_event = static_cast<gui::events::PostExecEvent*>(event);
-    HandlePostExecEvent(post_event);
-  } else if (event->GetEventType() == gui::events::RequestVideoEvent::EventType) {
-    gui::events::RequestVideoEvent* avent = static_cast<gui::events::RequestVideoEvent*>(event);
-    HandleRequestVideoEvent(avent);
-  } else if (event->GetEventType() == gui::events::QuitStreamEvent::EventType) {
-    gui::events::QuitStreamEvent* quit_stream_event = static_cast<gui::events::QuitStreamEvent*>(event);
-    HandleQuitStreamEvent(quit_stream_event);
-  } else if (event->GetEventType() == gui::events::TimerEvent::EventType) {
-    gui::events::TimerEvent* tevent = static_cast<gui::events::TimerEvent*>(event);
-    HandleTimerEvent(tevent);
-  } else if (event->GetEventType() == gui::events::KeyPressEvent::EventType) {
-    gui::events::KeyPressEvent* key_press_event = static_cast<gui::events::KeyPressEvent*>(event);
-    HandleKeyPressEvent(key_press_event);
-  } else if (event->GetEventType() == gui::events::LircPressEvent::EventType) {
-    gui::events::LircPressEvent* lirc_press_event = static_cast<gui::events::LircPressEvent*>(event);
-    HandleLircPressEvent(lirc_press_event);
-  } else if (event->GetEventType() == gui::events::WindowResizeEvent::EventType) {
-    gui::events::WindowResizeEvent* win_resize_event = static_cast<gui::events::WindowResizeEvent*>(event);
-    HandleWindowResizeEvent(win_resize_event);
-  } else if (event->GetEventType() == gui::events::WindowExposeEvent::EventType) {
-    gui::events::WindowExposeEvent* win_expose = static_cast<gui::events::WindowExposeEvent*>(event);
-    HandleWindowExposeEvent(win_expose);
-  } else if (event->GetEventType() == gui::events::WindowCloseEvent::EventType) {
-    gui::events::WindowCloseEvent* window_close = static_cast<gui::events::WindowCloseEvent*>(event);
-    HandleWindowCloseEvent(window_close);
-  } else if (event->GetEventType() == gui::events::MouseMoveEvent::EventType) {
-    gui::events::MouseMoveEvent* mouse_move = static_cast<gui::events::MouseMoveEvent*>(event);
-    HandleMouseMoveEvent(mouse_move);
-  } else if (event->GetEventType() == gui::events::MousePressEvent::EventType) {
-    gui::events::MousePressEvent* mouse_press = static_cast<gui::events::MousePressEvent*>(event);
-    HandleMousePressEvent(mouse_press);
-  } else if (event->GetEventType() == gui::events::QuitEvent::EventType) {
-    gui::events::QuitEvent* quit_event = static_cast<gui::events::QuitEvent*>(event);
-    HandleQuitEvent(quit_event);
+  const common::IEvent::event_id_t event_type = event->GetEventType();
+  if (event_type >= USER_EVENTS) {
+    return;
+  }
+
+  if (idle_ && event_type != TIMER_EVENT) {  // something may need to be redrawn
+    SetIdle(false);
+  }
+
+  event_handler_t handler = GetEventHandlers()[event_type];
+  if (handler) {
+    (this->*handler)(event);
   }
 }
 
+const ISimplePlayer::event_handler_t* ISimplePlayer::GetEventHandlers() {
+  static const struct EventHandlers {
+    EventHandlers() : table() {
+      table[gui::events::PreExecEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::PreExecEvent, &ISimplePlayer::HandlePreExecEvent>;
+      table[gui::events::PostExecEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::PostExecEvent, &ISimplePlayer::HandlePostExecEvent>;
+      table[gui::events::RequestVideoEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::RequestVideoEvent, &ISimplePlayer::HandleRequestVideoEvent>;
+      table[gui::events::QuitStreamEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::QuitStreamEvent, &ISimplePlayer::HandleQuitStreamEvent>;
+      table[gui::events::TimerEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::TimerEvent, &ISimplePlayer::HandleTimerEvent>;
+      table[gui::events::KeyPressEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::KeyPressEvent, &ISimplePlayer::HandleKeyPressEvent>;
+      table[gui::events::LircPressEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::LircPressEvent, &ISimplePlayer::HandleLircPressEvent>;
+      table[gui::events::WindowResizeEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::WindowResizeEvent, &ISimplePlayer::HandleWindowResizeEvent>;
+      table[gui::events::WindowExposeEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::WindowExposeEvent, &ISimplePlayer::HandleWindowExposeEvent>;
+      table[gui::events::WindowCloseEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::WindowCloseEvent, &ISimplePlayer::HandleWindowCloseEvent>;
+      table[gui::events::WindowVisibilityEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::WindowVisibilityEvent,
+                                        &ISimplePlayer::HandleWindowVisibilityEvent>;
+      table[gui::events::MouseMoveEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::MouseMoveEvent, &ISimplePlayer::HandleMouseMoveEvent>;
+      table[gui::events::MousePressEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::MousePressEvent, &ISimplePlayer::HandleMousePressEvent>;
+      table[gui::events::QuitEvent::EventType] =
+          &ISimplePlayer::DispatchEvent<gui::events::QuitEvent, &ISimplePlayer::HandleQuitEvent>;
+    }
+
+    event_handler_t table[USER_EVENTS];
+  } handlers;
+  return handlers.table;
+}
+
 void ISimplePlayer::HandleExceptionEvent(event_t* event, common::Error err) {
   if (event->GetEventType() == gui::events::QuitStreamEvent::EventType) {
+    gui::events::QuitStreamEvent* qevent = static_cast<gui::events::QuitStreamEvent*>(event);
+    MosaicTile* tile = FindMosaicTile(qevent->GetInfo().stream_);
+    if (tile) {  // the other streams keep playing
+      tile->error = err->GetDescription();
+      ERROR_LOG() << "Tile " << tile->stream->GetId() << " failed: " << tile->error;
+      return;
+    }
     SwitchToChannelErrorMode(err);
   }
 }
@@ -212,6 +522,7 @@ common::Error ISimplePlayer::HandleRequestAudio(media::VideoState* stream,
                                                 int64_t wanted_channel_layout,
                                                 int wanted_nb_channels,
                                                 int wanted_sample_rate,
+                                                int wanted_sample_format,
                                                 media::AudioParams* audio_hw_params,
                                                 int* audio_buff_size) {
   UNUSED(stream);
@@ -225,14 +536,40 @@ common::Error ISimplePlayer::HandleRequestAudio(media::VideoState* stream,
   /* prepare audio output */
   media::AudioParams laudio_hw_params;
   int laudio_buff_size;
-  if (!audio_open(this, wanted_channel_layout, wanted_nb_channels, wanted_sample_rate, sdl_audio_callback,
-                  &laudio_hw_params, &laudio_buff_size, &audio_device_)) {
+  const bool low_latency = options_.low_latency_audio;
+  if (!audio_open(this, wanted_channel_layout, wanted_nb_channels, wanted_sample_rate,
+                  static_cast<AVSampleFormat>(wanted_sample_format), low_latency,
+                  low_latency ? nullptr : sdl_audio_callback, &laudio_hw_params, &laudio_buff_size, &audio_device_)) {
     return common::make_error("Can't init audio system.");
   }
 
-  SDL_PauseAudioDevice(audio_device_, 0);
   audio_params_ = new media::AudioParams(laudio_hw_params);
   audio_buff_size_ = laudio_buff_size;
+  source_audio_.resize(audio_buff_size_);  // a period, the device thread doesn't allocate
+  /* every stream resamples to this format on its own audio thread, the bus only sums them */
+  media::dsp::SampleFormat dsp_fmt;
+  if (media::convert_to_dsp_format(audio_params_->fmt, &dsp_fmt)) {
+    const size_t ramp_samples =
+        static_cast<size_t>(audio_params_->freq) * audio_params_->channels * AUDIO_MIX_RAMP_MSEC / 1000;
+    mix_bus_ = new media::dsp::MixBus(dsp_fmt, ramp_samples, AUDIO_MIX_MAX_SOURCES);
+  } else {
+    WARNING_LOG() << "Audio device format can't be mixed, only the focused stream is heard.";
+  }
+  INFO_LOG() << "Audio device opened, period: " << audio_buff_size_ * 1000 / audio_params_->bytes_per_sec
+             << " msec" << (low_latency ? ", low latency queue mode" : "");
+  if (low_latency) {
+    audio_pump_stop_ = false;
+    audio_pump_tid_ = THREAD_MANAGER()->CreateThread(&ISimplePlayer::AudioPumpThread, this);
+    if (!audio_pump_tid_->Start()) {
+      audio_pump_tid_.reset();
+      SDL_CloseAudioDevice(audio_device_);
+      audio_device_ = INVALID_AUDIO_DEVICE_ID;
+      destroy(&mix_bus_);
+      destroy(&audio_params_);
+      return common::make_error("Can't start audio pump.");
+    }
+  }
+  SDL_PauseAudioDevice(audio_device_, 0);
 
   *audio_hw_params = *audio_params_;
   *audio_buff_size = audio_buff_size_;
@@ -240,8 +577,13 @@ common::Error ISimplePlayer::HandleRequestAudio(media::VideoState* stream,
 }
 
 void ISimplePlayer::HanleAudioMix(uint8_t* audio_stream_ptr, const uint8_t* src, uint32_t len, int volume) {
-  int sdl_volume = ConvertToSDLVolume(volume);
-  SDL_MixAudioFormat(audio_stream_ptr, src, AUDIO_S16SYS, len, sdl_volume);
+  media::dsp::SampleFormat fmt;
+  if (!audio_params_ || !media::convert_to_dsp_format(audio_params_->fmt, &fmt)) {
+    return;
+  }
+
+  const size_t count = len / media::dsp::GetBytesPerSample(fmt);
+  media::dsp::Mix(fmt, audio_stream_ptr, src, count, media::dsp::VolumeToGain(volume), 0);
 }
 
 common::Error ISimplePlayer::HandleRequestVideo(media::VideoState* stream,
@@ -255,6 +597,20 @@ common::Error ISimplePlayer::HandleRequestVideo(media::VideoState* stream,
     return common::make_error_inval();
   }
 
+  if (pip_ && stream == pip_->stream) {  // drawn in the window of the primary stream
+    return common::Error();
+  }
+
+  if (!mosaic_.empty()) {  // the window is sized for the wall, the display keeps up with the fastest tile
+    InitWindow(GetCurrentUrlName(), PLAYING_STATE);
+    AVRational frame_rate = stream->GetFrameRate();
+    if (frame_rate.num && frame_rate.den &&
+        static_cast<uint32_t>(frame_rate.den * 1000 / frame_rate.num) < update_video_timer_interval_msec_) {
+      UpdateDisplayInterval(frame_rate);
+    }
+    return common::Error();
+  }
+
   SDL_Rect rect = CalculateDisplayRect(xleft_, ytop_, INT_MAX, height, width, height, aspect_ratio);
   options_.default_size.set_width(rect.w);
   options_.default_size.set_height(rect.h);
@@ -269,6 +625,10 @@ common::Error ISimplePlayer::HandleRequestVideo(media::VideoState* stream,
 void ISimplePlayer::HandleRequestVideoEvent(gui::events::RequestVideoEvent* event) {
   gui::events::RequestVideoEvent* avent = static_cast<gui::events::RequestVideoEvent*>(event);
   gui::events::FrameInfo fr = avent->GetInfo();
+  if (fr.stream_ != stream_ && !FindMosaicTile(fr.stream_)) {  // posted by a stream already released
+    return;
+  }
+
   common::Error err = fr.stream_->RequestVideo(fr.width, fr.height, fr.av_pixel_format, fr.aspect_ratio);
   if (err) {
     SwitchToChannelErrorMode(err);
@@ -284,6 +644,7 @@ void ISimplePlayer::HandlePreExecEvent(gui::events::PreExecEvent* event) {
   gui::events::PreExecInfo inf = event->GetInfo();
   if (inf.code == EXIT_SUCCESS) {
     render_texture_ = new draw::TextureSaver;
+    thumbnail_texture_ = new draw::TextureSaver;
 
     if (!absolute_font_path_) {
       WARNING_LOG() << "Couldn't open font file path invalid!";
@@ -299,23 +660,34 @@ void ISimplePlayer::HandlePreExecEvent(gui::events::PreExecEvent* event) {
   }
 
   volume_label_->SetFont(font_);
+  banner_label_->SetFont(font_);
   statistic_label_->SetFont(font_);
+  mosaic_label_->SetFont(font_);
 }
 
 void ISimplePlayer::HandlePostExecEvent(gui::events::PostExecEvent* event) {
   gui::events::PostExecInfo inf = event->GetInfo();
   if (inf.code == EXIT_SUCCESS) {
+    FreePip(false);
     FreeStreamSafe(false);
+    gop_keeper_->Clear();  // the standby inputs close along with the streams
+    teardown_->Stop();     // streams closed before still hold the decoders and the audio device
+    decoder_cache_->Clear();
     if (font_) {
       TTF_CloseFont(font_);
       font_ = nullptr;
     }
 
+    StopAudioPump();
     SDL_CloseAudioDevice(audio_device_);
     audio_device_ = INVALID_AUDIO_DEVICE_ID;
+    audio_device_paused_ = false;
+    destroy(&mix_bus_);
     destroy(&audio_params_);
 
     destroy(&render_texture_);
+    destroy(&thumbnail_texture_);
+    image_cache_->Clear();  // textures of the renderer
 
     if (renderer_) {
       SDL_DestroyRenderer(renderer_);
@@ -342,7 +714,13 @@ void ISimplePlayer::HandleTimerEvent(gui::events::TimerEvent* event) {
   if (volume_label_->IsVisible() && diff_volume > VOLUME_HIDE_DELAY_MSEC) {
     volume_label_->SetVisible(false);
   }
+
+  media::msec_t diff_banner = cur_time - banner_last_shown_;
+  if (banner_label_->IsVisible() && diff_banner > BANNER_HIDE_DELAY_MSEC) {
+    banner_label_->SetVisible(false);
+  }
   DrawDisplay();
+  UpdateIdleState();
 }
 
 void ISimplePlayer::HandleLircPressEvent(gui::events::LircPressEvent* event) {
@@ -371,14 +749,25 @@ void ISimplePlayer::HandleKeyPressEvent(gui::events::KeyPressEvent* event) {
     SetFullScreen(full_screen);
   } else if (scan_code == SDL_SCANCODE_F3) {
     ToggleShowStatistic();
+  } else if (scan_code == SDL_SCANCODE_TAB) {
+    if (!mosaic_.empty()) {
+      SetMosaicFocus((mosaic_focus_ + 1) % mosaic_.size());
+    }
   } else if (scan_code == SDL_SCANCODE_SPACE) {
     PauseStream();
   } else if (scan_code == SDL_SCANCODE_M) {
     ToggleMute();
-  } else if (scan_code == SDL_SCANCODE_S) {  // Step to next frame
+  } else if (scan_code == SDL_SCANCODE_S) {  // Step to next frame, with shift to the previous one
     if (stream_) {
-      stream_->StepToNextFrame();
+      if (modifier & KMOD_SHIFT) {
+        stream_->StepToPrevFrame();
+      } else {
+        stream_->SetReverse(false);
+        stream_->StepToNextFrame();
+      }
     }
+  } else if (scan_code == SDL_SCANCODE_B) {
+    ToggleReverse();
   } else if (scan_code == SDL_SCANCODE_A) {
     if (stream_) {
       stream_->StreamCycleChannel(AVMEDIA_TYPE_AUDIO);
@@ -392,6 +781,16 @@ void ISimplePlayer::HandleKeyPressEvent(gui::events::KeyPressEvent* event) {
       stream_->StreamCycleChannel(AVMEDIA_TYPE_VIDEO);
       stream_->StreamCycleChannel(AVMEDIA_TYPE_AUDIO);
     }
+  } else if (scan_code == SDL_SCANCODE_R) {
+    ToggleRadioMode();
+  } else if (scan_code == SDL_SCANCODE_X) {
+    SwapPip();
+  } else if (scan_code == SDL_SCANCODE_LEFTBRACKET) {
+    ChangeSpeed(-1);
+  } else if (scan_code == SDL_SCANCODE_RIGHTBRACKET) {
+    ChangeSpeed(1);
+  } else if (scan_code == SDL_SCANCODE_BACKSLASH) {
+    ChangeSpeed(0);
   } else if (scan_code == SDL_SCANCODE_T) {
     // StreamCycleChannel(AVMEDIA_TYPE_SUBTITLE);
   } else if (scan_code == SDL_SCANCODE_W) {
@@ -408,6 +807,8 @@ void ISimplePlayer::HandleKeyPressEvent(gui::events::KeyPressEvent* event) {
       if (stream_) {
         stream_->SeekPrevChunk();
       }
+    } else {
+      ChangeScan(-1);
     }
   } else if (scan_code == SDL_SCANCODE_RIGHT) {
     if (modifier & KMOD_SHIFT) {
@@ -422,6 +823,8 @@ void ISimplePlayer::HandleKeyPressEvent(gui::events::KeyPressEvent* event) {
       if (stream_) {
         stream_->SeekNextChunk();
       }
+    } else {
+      ChangeScan(1);
     }
   } else if (scan_code == SDL_SCANCODE_UP) {
     if (modifier & KMOD_CTRL) {
@@ -437,6 +840,16 @@ void ISimplePlayer::HandleKeyPressEvent(gui::events::KeyPressEvent* event) {
 void ISimplePlayer::HandleMousePressEvent(gui::events::MousePressEvent* event) {
   media::msec_t cur_time = media::GetCurrentMsec();
   gui::events::MousePressInfo inf = event->GetInfo();
+  if (inf.mevent.button == SDL_BUTTON_LEFT && !mosaic_.empty()) {
+    for (size_t i = 0; i < mosaic_.size(); ++i) {
+      const SDL_Rect cell = GetMosaicTileRect(i);
+      const SDL_Point point = {inf.mevent.x, inf.mevent.y};
+      if (SDL_PointInRect(&point, &cell)) {
+        SetMosaicFocus(i);
+        break;
+      }
+    }
+  }
   if (inf.mevent.button == SDL_BUTTON_LEFT) {
     if (cur_time - last_mouse_left_click_ <= 500) {  // double click 0.5 sec
       bool full_screen = !options_.is_full_screen;
@@ -465,16 +878,12 @@ void ISimplePlayer::HandleMouseMoveEvent(gui::events::MouseMoveEvent* event) {
 void ISimplePlayer::HandleWindowResizeEvent(gui::events::WindowResizeEvent* event) {
   gui::events::WindowResizeInfo inf = event->GetInfo();
   window_size_ = inf.size;
-  if (stream_) {
-    stream_->RefreshRequest();
-  }
+  RefreshStreams();
 }
 
 void ISimplePlayer::HandleWindowExposeEvent(gui::events::WindowExposeEvent* event) {
   UNUSED(event);
-  if (stream_) {
-    stream_->RefreshRequest();
-  }
+  RefreshStreams();
 }
 
 void ISimplePlayer::HandleWindowCloseEvent(gui::events::WindowCloseEvent* event) {
@@ -482,6 +891,12 @@ void ISimplePlayer::HandleWindowCloseEvent(gui::events::WindowCloseEvent* event)
   Quit();
 }
 
+void ISimplePlayer::HandleWindowVisibilityEvent(gui::events::WindowVisibilityEvent* event) {
+  gui::events::WindowVisibilityInfo inf = event->GetInfo();
+  window_hidden_ = !inf.visible;
+  UpdateVideoSuspend();
+}
+
 void ISimplePlayer::HandleQuitEvent(gui::events::QuitEvent* event) {
   UNUSED(event);
   Quit();
@@ -489,33 +904,191 @@ void ISimplePlayer::HandleQuitEvent(gui::events::QuitEvent* event) {
 
 void ISimplePlayer::FreeStreamSafe(bool fast_cleanup) {
   CHECK(THREAD_MANAGER()->IsMainThread());
+  picture_width_ = 0;  // not redrawn under the picture-in-picture
+  if (!mosaic_.empty()) {
+    FreeMosaic(fast_cleanup);
+    return;
+  }
   if (!stream_) {
     return;
   }
 
   if (fast_cleanup) {
     media::VideoState* vs = stream_;
+    media::ThumbnailService* thumbnails = thumbnails_;
     auto tid = exec_tid_;
 
     exec_tid_.reset();
-    stream_ = nullptr;
+    thumbnails_ = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(audio_pump_mutex_);
+      stream_ = nullptr;
+      RemoveAudioSource(vs);
+    }
 
     vs->SetHandler(nullptr);
-    std::thread out_cleanup([vs, tid]() {
-      vs->Abort();
-      tid->Join();
-      delete vs;
-    });
-    out_cleanup.detach();
+    vs->Abort();
+    teardown_->Post(
+        [vs, tid, thumbnails]() {
+          delete thumbnails;
+          tid->Join();
+          delete vs;
+        },
+        vs->GetMemoryUsage());
   } else {
-    stream_->Abort();
+    media::VideoState* vs = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(audio_pump_mutex_);  // the audio callback only waits for the swap
+      std::swap(vs, stream_);
+      RemoveAudioSource(vs);
+    }
+    destroy(&thumbnails_);
+    vs->Abort();
     exec_tid_->Join();
     exec_tid_.reset();
-    destroy(&stream_);
+    destroy(&vs);
   }
 
   CHECK(!stream_);
   CHECK(!exec_tid_);
+  CHECK(!thumbnails_);
+}
+
+void ISimplePlayer::FreeMosaic(bool fast_cleanup) {
+  std::vector<MosaicTile*> tiles;
+  {
+    std::unique_lock<std::mutex> lock(audio_pump_mutex_);
+    tiles.swap(mosaic_);
+    stream_ = nullptr;
+    for (MosaicTile* tile : tiles) {
+      RemoveAudioSource(tile->stream);
+    }
+  }
+  mosaic_focus_ = 0;
+  mosaic_side_ = 0;
+
+  std::vector<std::pair<media::VideoState*, std::shared_ptr<common::threads::Thread<int>>>> streams;
+  for (MosaicTile* tile : tiles) {
+    tile->stream->SetHandler(nullptr);
+    streams.push_back(std::make_pair(tile->stream, tile->tid));
+    delete tile;  // textures belong to the main thread
+  }
+
+  /* all the tiles are aborted before the first one is waited for */
+  for (const auto& stream : streams) {
+    stream.first->Abort();
+  }
+  for (const auto& stream : streams) {
+    media::VideoState* vs = stream.first;
+    auto tid = stream.second;
+    auto cleanup = [vs, tid]() {
+      if (tid) {
+        tid->Join();
+      }
+      delete vs;
+    };
+    if (fast_cleanup) {
+      teardown_->Post(cleanup, vs->GetMemoryUsage());
+    } else {
+      cleanup();
+    }
+  }
+}
+
+void ISimplePlayer::FreePip(bool fast_cleanup) {
+  MosaicTile* pip = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(audio_pump_mutex_);
+    std::swap(pip, pip_);
+    if (pip) {
+      RemoveAudioSource(pip->stream);
+    }
+  }
+  if (!pip) {
+    return;
+  }
+
+  media::VideoState* vs = pip->stream;
+  auto tid = pip->tid;
+  delete pip;  // the texture belongs to the main thread
+  vs->SetHandler(nullptr);
+  vs->Abort();
+  auto cleanup = [vs, tid]() {
+    if (tid) {
+      tid->Join();
+    }
+    delete vs;
+  };
+  if (fast_cleanup) {
+    teardown_->Post(cleanup, vs->GetMemoryUsage());
+  } else {
+    cleanup();
+  }
+}
+
+void ISimplePlayer::UpdatePipBudget() {
+  if (stream_) {
+    stream_->SetTaskPriority(media::TASK_PRIORITY_HIGH);
+    stream_->SetDecodeBudget(0);
+  }
+  if (pip_) {
+    pip_->stream->SetTaskPriority(media::TASK_PRIORITY_LOW);
+    pip_->stream->SetDecodeBudget(options_.pip_cpu_share);
+  }
+}
+
+ISimplePlayer::MosaicTile* ISimplePlayer::FindMosaicTile(media::VideoState* stream) const {
+  for (MosaicTile* tile : mosaic_) {
+    if (tile->stream == stream) {
+      return tile;
+    }
+  }
+  if (pip_ && pip_->stream == stream) {
+    return pip_;
+  }
+  return nullptr;
+}
+
+void ISimplePlayer::SetMosaicFocus(size_t tile) {
+  if (tile >= mosaic_.size() || tile == mosaic_focus_) {
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(audio_pump_mutex_);
+    mosaic_focus_ = tile;
+    stream_ = mosaic_[tile]->stream;
+  }
+  for (MosaicTile* mtile : mosaic_) {
+    mtile->stream->SetTaskPriority(mtile->stream == stream_ ? media::TASK_PRIORITY_HIGH : media::TASK_PRIORITY_NORMAL);
+  }
+  if (window_) {
+    SDL_SetWindowTitle(window_, GetCurrentUrlName().c_str());
+  }
+}
+
+SDL_Rect ISimplePlayer::GetMosaicTileRect(size_t tile) const {
+  const SDL_Rect display_rect = GetDisplayRect();
+  const int side = std::max(mosaic_side_, 1);
+  const int w = display_rect.w / side;
+  const int h = display_rect.h / side;
+  const int column = static_cast<int>(tile) % side;
+  const int row = static_cast<int>(tile) / side;
+  return {display_rect.x + column * w, display_rect.y + row * h, w, h};
+}
+
+void ISimplePlayer::RefreshStreams() {
+  if (stream_) {
+    stream_->RefreshRequest();
+  }
+  for (MosaicTile* tile : mosaic_) {
+    if (tile->stream != stream_) {
+      tile->stream->RefreshRequest();
+    }
+  }
+  if (pip_) {
+    pip_->stream->RefreshRequest();
+  }
 }
 
 void ISimplePlayer::UpdateDisplayInterval(AVRational fps) {
@@ -529,14 +1102,131 @@ void ISimplePlayer::UpdateDisplayInterval(AVRational fps) {
   app->SetDisplayUpdateTimeout(update_video_timer_interval_msec_);
 }
 
+void ISimplePlayer::UpdateIdleState() {
+  /* the tiles not focused and the picture-in-picture keep playing on the audio device */
+  const bool stream_paused = stream_ && stream_->IsPaused() && mosaic_.empty() && !pip_;
+  if (audio_device_ != INVALID_AUDIO_DEVICE_ID && audio_device_paused_ != stream_paused) {
+    SDL_PauseAudioDevice(audio_device_, stream_paused ? 1 : 0);
+    audio_device_paused_ = stream_paused;
+  }
+
+  const bool idle = stream_paused && current_state_ == PLAYING_STATE && !fApp->IsCursorVisible() &&
+                    !volume_label_->IsVisible() && !banner_label_->IsVisible() && !statistic_label_->IsVisible();
+  SetIdle(idle);
+}
+
+void ISimplePlayer::SetIdle(bool idle) {
+  if (idle_ == idle) {
+    return;
+  }
+
+  idle_ = idle;
+  gui::application::Sdl2Application* app = static_cast<gui::application::Sdl2Application*>(fApp);
+  app->SetIdleMode(idle);
+  if (idle) {
+    idle_start_msec_ = media::GetCurrentMsec();
+    idle_wakeups_ = media::GetWakeupsSnapshot();
+    INFO_LOG() << "Enter idle mode.";
+    return;
+  }
+
+  INFO_LOG() << "Leave idle mode after " << media::GetCurrentMsec() - idle_start_msec_
+             << " msec, wakeups: " << media::WakeupsSinceToString(idle_wakeups_);
+}
+
 void ISimplePlayer::sdl_audio_callback(void* user_data, uint8_t* stream, int len) {
+  media::RegisterWakeup(media::AUDIO_CALLBACK_WAKEUP);
   ISimplePlayer* player = static_cast<ISimplePlayer*>(user_data);
-  media::VideoState* st = player->stream_;
-  if (!player->muted_ && st && st->IsStreamReady()) {
-    st->UpdateAudioBuffer(stream, len, player->options_.audio_volume);
+  std::unique_lock<std::mutex> lock(player->audio_pump_mutex_);
+  /* Let's assume the audio driver that is used by SDL has two periods. */
+  player->UpdateAudioBuffers(stream, len, 2 * len);
+}
+
+void ISimplePlayer::UpdateAudioBuffers(uint8_t* stream, int len, int output_delay_bytes) {
+  media::VideoState* st = stream_;
+  const int volume = muted_ ? 0 : options_.audio_volume;
+  if (mix_bus_) {
+    mix_bus_->Begin(stream, len / av_get_bytes_per_sample(audio_params_->fmt));
+    MixAudioSource(st, volume, len, output_delay_bytes);
+  } else if (st && st->IsStreamReady()) {
+    st->UpdateAudioBuffer(stream, len, volume, output_delay_bytes);
   } else {
     memset(stream, 0, len);
   }
+
+  const int ducked = volume * options_.duck_volume / 100;
+  for (MosaicTile* tile : mosaic_) {
+    if (tile->stream != st) {
+      MixAudioSource(tile->stream, ducked, len, output_delay_bytes);
+    }
+  }
+  if (pip_) {
+    MixAudioSource(pip_->stream, ducked, len, output_delay_bytes);
+  }
+  if (mix_bus_) {
+    mix_bus_->End();
+  }
+}
+
+void ISimplePlayer::RemoveAudioSource(media::VideoState* source) {
+  if (mix_bus_) {
+    mix_bus_->Remove(source);
+  }
+}
+
+void ISimplePlayer::MixAudioSource(media::VideoState* source, int volume, int len, int output_delay_bytes) {
+  if (!source || !source->IsStreamReady() || source_audio_.size() < static_cast<size_t>(len)) {
+    return;
+  }
+
+  /* every stream is read for the same device delay, so each audio clock keeps driving its own pictures; the bus
+   * applies the volume, a stream gives its samples at unity and a focus change fades within one period */
+  source->UpdateAudioBuffer(source_audio_.data(), len, mix_bus_ ? 100 : 0, output_delay_bytes);
+  if (mix_bus_) {
+    mix_bus_->Add(source, source_audio_.data(), media::dsp::VolumeToGain(volume));
+  }
+}
+
+int ISimplePlayer::AudioPumpThread() {
+  const Uint32 period = static_cast<Uint32>(audio_buff_size_);
+  const Uint32 target = period * AUDIO_QUEUE_TARGET_PERIODS;
+  const int bytes_per_sec = audio_params_->bytes_per_sec;
+  std::vector<uint8_t> buffer(period);
+  while (!audio_pump_stop_) {
+    if (SDL_GetAudioDeviceStatus(audio_device_) == SDL_AUDIO_PAUSED) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_PUMP_PAUSED_SLEEP_MSEC));
+      continue;
+    }
+
+    const Uint32 queued = SDL_GetQueuedAudioSize(audio_device_);
+    if (queued >= target) {
+      const int64_t sleep_msec = static_cast<int64_t>(queued - target) * 1000 / bytes_per_sec;
+      std::this_thread::sleep_for(std::chrono::milliseconds(std::max<int64_t>(sleep_msec, 1)));
+      continue;
+    }
+
+    media::RegisterWakeup(media::AUDIO_CALLBACK_WAKEUP);
+    {
+      std::unique_lock<std::mutex> lock(audio_pump_mutex_);
+      /* measured: what is still queued, this buffer and what the device holds */
+      const int delay = static_cast<int>(queued + period + period * AUDIO_QUEUE_DEVICE_PERIODS);
+      UpdateAudioBuffers(buffer.data(), period, delay);
+    }
+    if (SDL_QueueAudio(audio_device_, buffer.data(), period) != 0) {
+      WARNING_LOG() << "SDL_QueueAudio failed: " << SDL_GetError();
+    }
+  }
+  return 0;
+}
+
+void ISimplePlayer::StopAudioPump() {
+  if (!audio_pump_tid_) {
+    return;
+  }
+
+  audio_pump_stop_ = true;
+  audio_pump_tid_->Join();
+  audio_pump_tid_.reset();
 }
 
 void ISimplePlayer::UpdateVolume(int8_t step) {
@@ -585,14 +1275,24 @@ void ISimplePlayer::DrawFailedStatus() {
     return;
   }
 
+  UploadIcons();
   common::Error err = draw::FlushRender(renderer_, draw::black_color);
   DCHECK(!err) << err->GetDescription();
+  if (pip_) {
+    UploadMosaicTile(pip_);
+    DrawPip();
+  }
   DrawInfo();
   SDL_RenderPresent(renderer_);
 }
 
 void ISimplePlayer::DrawPlayingStatus() {
   CHECK(THREAD_MANAGER()->IsMainThread());
+  if (!mosaic_.empty()) {
+    DrawMosaic();
+    return;
+  }
+
   media::frames::VideoFrame* frame = stream_->TryToGetVideoFrame();
   uint32_t frames_per_sec = 1000 / update_video_timer_interval_msec_;
   uint32_t mod = frames_per_sec * no_data_panic_sec;
@@ -610,49 +1310,64 @@ void ISimplePlayer::DrawPlayingStatus() {
     last_pts_checkpoint_ = cl;
   }
 
-  if (!frame || !render_texture_ || !renderer_) {
+  if (!render_texture_ || !renderer_) {
     return;
   }
 
-  int format = frame->format;
-  int width = frame->width;
-  int height = frame->height;
+  const bool pip_updated = pip_ && UploadMosaicTile(pip_);
+  const bool icons_updated = UploadIcons();
+  if (frame) {
+    int format = frame->format;
+    int width = frame->width;
+    int height = frame->height;
 
-  Uint32 sdl_format;
-  if (format == AV_PIX_FMT_YUV420P) {
-    sdl_format = SDL_PIXELFORMAT_YV12;
-  } else {
-    sdl_format = SDL_PIXELFORMAT_ARGB8888;
-  }
+    Uint32 sdl_format;
+    if (format == AV_PIX_FMT_YUV420P) {
+      sdl_format = SDL_PIXELFORMAT_YV12;
+    } else {
+      sdl_format = SDL_PIXELFORMAT_ARGB8888;
+    }
 
-  SDL_Texture* texture = render_texture_->GetTexture(renderer_, width, height, sdl_format);
-  if (!texture) {
-    /* SDL allocates a buffer smaller than requested if the video
-     * overlay hardware is unable to support the requested size. */
+    SDL_Texture* texture = render_texture_->GetTexture(renderer_, width, height, sdl_format);
+    if (!texture) {
+      /* SDL allocates a buffer smaller than requested if the video
+       * overlay hardware is unable to support the requested size. */
 
-    ERROR_LOG() << "Error: the video system does not support an image\n"
-                   "size of "
-                << width << "x" << height
-                << " pixels. Try using -lowres or -vf \"scale=w:h\"\n"
-                   "to reduce the image size.";
-    return;
-  }
+      ERROR_LOG() << "Error: the video system does not support an image\n"
+                     "size of "
+                  << width << "x" << height
+                  << " pixels. Try using -lowres or -vf \"scale=w:h\"\n"
+                     "to reduce the image size.";
+      return;
+    }
 
-  common::Error err = UploadTexture(texture, frame->frame);
-  if (err) {
-    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    common::Error err = UploadTexture(texture, frame->frame);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    picture_format_ = sdl_format;
+    picture_width_ = width;
+    picture_height_ = height;
+    picture_sar_ = frame->sar;
+    picture_flip_v_ = frame->frame->linesize[0] < 0;
+  } else if (!pip_updated && !icons_updated) {
     return;
   }
 
-  bool flip_v = frame->frame->linesize[0] < 0;
-
-  err = draw::FlushRender(renderer_, draw::black_color);
+  common::Error err = draw::FlushRender(renderer_, draw::black_color);
   DCHECK(!err) << err->GetDescription();
 
-  SDL_Rect rect = CalculateDisplayRect(xleft_, ytop_, window_size_.width(), window_size_.height(), frame->width,
-                                       frame->height, frame->sar);
-  SDL_RenderCopyEx(renderer_, texture, nullptr, &rect, 0, nullptr, flip_v ? SDL_FLIP_VERTICAL : SDL_FLIP_NONE);
+  if (picture_width_) {
+    SDL_Texture* texture = render_texture_->GetTexture(renderer_, picture_width_, picture_height_, picture_format_);
+    SDL_Rect rect = CalculateDisplayRect(xleft_, ytop_, window_size_.width(), window_size_.height(), picture_width_,
+                                         picture_height_, picture_sar_);
+    SDL_RenderCopyEx(renderer_, texture, nullptr, &rect, 0, nullptr,
+                     picture_flip_v_ ? SDL_FLIP_VERTICAL : SDL_FLIP_NONE);
+  }
 
+  DrawPip();
   DrawInfo();
   SDL_RenderPresent(renderer_);
 }
@@ -662,15 +1377,109 @@ void ISimplePlayer::DrawInitStatus() {
     return;
   }
 
+  UploadIcons();
   common::Error err = draw::FlushRender(renderer_, draw::black_color);
   DCHECK(!err) << err->GetDescription();
   DrawInfo();
   SDL_RenderPresent(renderer_);
 }
 
+void ISimplePlayer::DrawMosaic() {
+  if (!renderer_) {
+    return;
+  }
+
+  UploadIcons();
+  common::Error err = draw::FlushRender(renderer_, draw::black_color);
+  DCHECK(!err) << err->GetDescription();
+  for (size_t i = 0; i < mosaic_.size(); ++i) {
+    UploadMosaicTile(mosaic_[i]);
+    DrawMosaicTile(mosaic_[i], GetMosaicTileRect(i), i == mosaic_focus_);
+  }
+  DrawInfo();
+  SDL_RenderPresent(renderer_);
+}
+
+bool ISimplePlayer::UploadMosaicTile(MosaicTile* tile) {
+  media::frames::VideoFrame* frame = tile->error.empty() ? tile->stream->TryToGetVideoFrame() : nullptr;
+  if (!frame) {
+    return false;
+  }
+
+  const Uint32 sdl_format = frame->format == AV_PIX_FMT_YUV420P ? SDL_PIXELFORMAT_YV12 : SDL_PIXELFORMAT_ARGB8888;
+  SDL_Texture* texture = tile->texture->GetTexture(renderer_, frame->width, frame->height, sdl_format);
+  common::Error err = texture ? UploadTexture(texture, frame->frame) : common::make_error("No tile texture");
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    tile->width = 0;
+    return true;
+  }
+
+  tile->format = sdl_format;
+  tile->width = frame->width;
+  tile->height = frame->height;
+  tile->sar = frame->sar;
+  tile->flip_v = frame->frame->linesize[0] < 0;
+  return true;
+}
+
+void ISimplePlayer::DrawMosaicTile(MosaicTile* tile, const SDL_Rect& cell, bool focused) {
+  if (tile->width && tile->error.empty()) {
+    SDL_Texture* texture = tile->texture->GetTexture(renderer_, tile->width, tile->height, tile->format);
+    SDL_Rect rect = CalculateDisplayRect(cell.x, cell.y, cell.w, cell.h, tile->width, tile->height, tile->sar);
+    SDL_RenderCopyEx(renderer_, texture, nullptr, &rect, 0, nullptr,
+                     tile->flip_v ? SDL_FLIP_VERTICAL : SDL_FLIP_NONE);
+  }
+
+  if (font_ && (!tile->error.empty() || statistic_label_->IsVisible())) {
+    std::string text = tile->stream->GetId() + "\n" + tile->error;
+    if (tile->error.empty()) {
+      media::VideoState::stats_t stats = tile->stream->GetStatistic();
+      text = common::MemSPrintf("%s\nFPS: %s\nFRAMEDROP: %d/%d\nVQUEUE: %d KB\nCPU: %s %%", tile->stream->GetId(),
+                                common::ConvertToString(stats->GetFps()), stats->frame_drops_early,
+                                stats->frame_drops_late, stats->video_queue_size / 1024,
+                                common::ConvertToString(stats->cpu_load, 1));
+    }
+    const int h = std::min(TTF_FontLineSkip(font_) * MOSAIC_STATS_LINES_COUNT, cell.h);
+    mosaic_label_->SetText(text);
+    mosaic_label_->SetRect({cell.x, cell.y, cell.w, h});
+    mosaic_label_->Draw(renderer_);
+  }
+
+  if (focused && mosaic_.size() > 1) {
+    common::Error err = draw::DrawBorder(renderer_, cell, volume_color);
+    DCHECK(!err) << err->GetDescription();
+  }
+}
+
+SDL_Rect ISimplePlayer::GetPipRect() const {
+  const SDL_Rect draw_rect = GetDrawRect();
+  const SDL_Rect volume_rect = GetVolumeRect();
+  const int w = draw_rect.w / PIP_SIZE_DIVIDER;
+  const int h = draw_rect.h / PIP_SIZE_DIVIDER;
+  return {draw_rect.x + draw_rect.w - w, volume_rect.y - space_height - h, w, h};
+}
+
+void ISimplePlayer::DrawPip() {
+  if (!pip_) {
+    return;
+  }
+
+  const SDL_Rect rect = GetPipRect();
+  common::Error err = draw::FillRectColor(renderer_, rect, draw::black_color);
+  DCHECK(!err) << err->GetDescription();
+  DrawMosaicTile(pip_, rect, false);
+  err = draw::DrawBorder(renderer_, rect, volume_color);
+  DCHECK(!err) << err->GetDescription();
+}
+
 void ISimplePlayer::DrawInfo() {
-  DrawStatistic();
+  if (mosaic_.empty()) {  // each tile draws its own
+    DrawStatistic();
+  }
   DrawVolume();
+  DrawBanner();
+  DrawThumbnail();
 }
 
 SDL_Rect ISimplePlayer::GetStatisticRect() const {
@@ -684,6 +1493,12 @@ SDL_Rect ISimplePlayer::GetVolumeRect() const {
   return {display_rect.x, display_rect.h - volume_height + display_rect.y, display_rect.w, volume_height};
 }
 
+SDL_Rect ISimplePlayer::GetBannerRect() const {
+  const SDL_Rect display_rect = GetDrawRect();
+  int padding_left = display_rect.w / 4;
+  return {display_rect.x + padding_left, display_rect.y, display_rect.w - padding_left * 2, banner_height};
+}
+
 SDL_Rect ISimplePlayer::GetDrawRect() const {
   const SDL_Rect dr = GetDisplayRect();
   return {dr.x + x_start, dr.y + y_start, dr.w - x_start * 2, dr.h - y_start * 2};
@@ -726,8 +1541,22 @@ void ISimplePlayer::DrawStatistic() {
       (stats->fmt & media::HAVE_VIDEO_STREAM ? common::ConvertToString(stats->video_queue_size / 1024) : "N/A");
   std::string audio_queue_text =
       (stats->fmt & media::HAVE_AUDIO_STREAM ? common::ConvertToString(stats->audio_queue_size / 1024) : "N/A");
-
-#define STATS_LINES_COUNT 10
+  std::string underruns_text =
+      (stats->fmt & media::HAVE_AUDIO_STREAM
+           ? common::MemSPrintf("%zu/%lld", stats->audio_underruns, static_cast<long long>(stats->audio_underrun_msec))
+           : "N/A");
+
+  std::string audio_path_text =
+      (stats->fmt & media::HAVE_AUDIO_STREAM ? media::ConvertAudioPathToString(stats->audio_path) + " " +
+                                                   common::ConvertToString(stats->audio_convert_load, 2) + "%"
+                                             : "N/A");
+  std::string audio_latency_text =
+      (stats->fmt & media::HAVE_AUDIO_STREAM ? common::ConvertToString(stats->audio_latency_msec) : "N/A");
+  std::string cpu_text = (is_unknown ? "N/A" : common::ConvertToString(stats->cpu_load, 1));
+  std::string standby_text =
+      common::MemSPrintf("%zu/%zu KB", gop_keeper_->GetChannelsCount(), gop_keeper_->GetHeldBytes() / 1024);
+
+#define STATS_LINES_COUNT 15
   const std::string result_text = common::MemSPrintf(
       "FMT: %s\n"
       "HWACCEL: %s\n"
@@ -738,9 +1567,14 @@ void ISimplePlayer::DrawStatistic() {
       "VBITRATE: %s kb/s\n"
       "ABITRATE: %s kb/s\n"
       "VQUEUE: %s KB\n"
-      "AQUEUE: %s KB",
+      "AQUEUE: %s KB\n"
+      "AUNDERRUN: %s msec\n"
+      "APATH: %s cpu\n"
+      "ALATENCY: %s msec\n"
+      "CPU: %s %%\n"
+      "STANDBY: %s",
       fmt_text, hwaccel_text, diff_text, pts_text, fps_text, fd_text, vbitrate_text, abitrate_text, video_queue_text,
-      audio_queue_text);
+      audio_queue_text, underruns_text, audio_path_text, audio_latency_text, cpu_text, standby_text);
 
   int h = TTF_FontLineSkip(font_) * STATS_LINES_COUNT;
   if (h > statistic_rect.h) {
@@ -767,10 +1601,70 @@ void ISimplePlayer::DrawVolume() {
   volume_label_->Draw(renderer_);
 }
 
+void ISimplePlayer::DrawBanner() {
+  if (!font_) {
+    return;
+  }
+
+  banner_label_->SetRect(GetBannerRect());
+  banner_label_->Draw(renderer_);
+}
+
+void ISimplePlayer::ShowBanner(const std::string& name, const std::string& logo_path) {
+  banner_last_shown_ = media::GetCurrentMsec();
+  banner_label_->SetVisible(true);
+  banner_label_->SetText(name);
+  banner_label_->SetIconPath(image_cache_, logo_path);
+}
+
+bool ISimplePlayer::UploadIcons() {
+  return image_cache_->UploadPending(renderer_, ICON_UPLOADS_PER_FRAME) > 0;
+}
+
+void ISimplePlayer::DrawThumbnail() {
+  if (!thumbnails_ || !stream_ || !thumbnail_texture_) {
+    return;
+  }
+
+  const media::clock64_t scrub = stream_->GetScrubPosition();
+  if (!media::IsValidClock(scrub)) {
+    return;
+  }
+
+  thumbnails_->SetFocus(scrub);
+  media::thumbnail_t thumbnail = thumbnails_->GetThumbnail(scrub);
+  if (!thumbnail) {
+    return;
+  }
+
+  SDL_Texture* texture =
+      thumbnail_texture_->GetTexture(renderer_, thumbnail->width, thumbnail->height, SDL_PIXELFORMAT_RGB24);
+  if (!texture || SDL_UpdateTexture(texture, nullptr, thumbnail->rgb.data(), thumbnail->width * 3) != 0) {
+    return;
+  }
+
+  const SDL_Rect volume_rect = GetVolumeRect();
+  SDL_Rect dst = {volume_rect.x + (volume_rect.w - thumbnail->width) / 2,
+                  volume_rect.y - space_height - thumbnail->height, thumbnail->width, thumbnail->height};
+  SDL_RenderCopy(renderer_, texture, nullptr, &dst);
+}
+
 bool ISimplePlayer::IsMouseVisible() const {
   return fApp->IsCursorVisible();
 }
 
+bool ISimplePlayer::IsMosaic() const {
+  return !mosaic_.empty();
+}
+
+bool ISimplePlayer::HasPip() const {
+  return pip_ != nullptr;
+}
+
+size_t ISimplePlayer::GetMosaicFocus() const {
+  return mosaic_focus_;
+}
+
 SDL_Renderer* ISimplePlayer::GetRenderer() const {
   return renderer_;
 }
@@ -779,6 +1673,10 @@ TTF_Font* ISimplePlayer::GetFont() const {
   return font_;
 }
 
+draw::ImageCache* ISimplePlayer::GetImageCache() const {
+  return image_cache_;
+}
+
 void ISimplePlayer::InitWindow(const std::string& title, States status) {
   CalculateDispalySize();
   if (!window_) {
@@ -818,20 +1716,112 @@ void ISimplePlayer::ToggleShowStatistic() {
   statistic_label_->ToggleVisible();
 }
 
+void ISimplePlayer::ChangeSpeed(int step) {
+  if (!stream_) {
+    return;
+  }
+
+  const size_t count = SIZEOFMASS(playback_speeds);
+  const double current = stream_->GetSpeed();
+  double speed = 1.0;
+  if (step > 0) {
+    speed = playback_speeds[count - 1];
+    for (size_t i = 0; i < count; ++i) {
+      if (playback_speeds[i] > current) {
+        speed = playback_speeds[i];
+        break;
+      }
+    }
+  } else if (step < 0) {
+    speed = playback_speeds[0];
+    for (size_t i = count; i > 0; --i) {
+      if (playback_speeds[i - 1] < current) {
+        speed = playback_speeds[i - 1];
+        break;
+      }
+    }
+  }
+  stream_->SetSpeed(speed);
+
+  volume_last_shown_ = media::GetCurrentMsec();
+  volume_label_->SetVisible(true);
+  volume_label_->SetText(common::MemSPrintf("SPEED: %.2fx", stream_->GetSpeed()));
+}
+
+void ISimplePlayer::ChangeScan(int direction) {
+  if (!stream_) {
+    return;
+  }
+
+  const int rate = stream_->GetTrickPlay();
+  int new_rate = 0;
+  if (rate == 0 || direction == 0) {
+    new_rate = direction * SCAN_MIN_RATE;
+  } else if ((rate > 0) == (direction > 0)) {
+    new_rate = rate * 2;
+  } else if (std::abs(rate) > SCAN_MIN_RATE) {
+    new_rate = rate / 2;
+  }
+  stream_->SetTrickPlay(new_rate);
+
+  const int current = stream_->GetTrickPlay();
+  volume_last_shown_ = media::GetCurrentMsec();
+  volume_label_->SetVisible(true);
+  volume_label_->SetText(current ? common::MemSPrintf("SCAN: %dx", current) : std::string("PLAY"));
+}
+
+void ISimplePlayer::ToggleReverse() {
+  if (!stream_) {
+    return;
+  }
+
+  stream_->SetReverse(!stream_->IsReverse());
+  volume_last_shown_ = media::GetCurrentMsec();
+  volume_label_->SetVisible(true);
+  volume_label_->SetText(stream_->IsReverse() ? "REVERSE" : "FORWARD");
+}
+
+void ISimplePlayer::ToggleRadioMode() {
+  radio_mode_ = !radio_mode_;
+  UpdateVideoSuspend();
+}
+
+void ISimplePlayer::UpdateVideoSuspend() {
+  const bool suspended = window_hidden_ || radio_mode_;
+  if (stream_) {
+    stream_->SetVideoSuspended(suspended);
+  }
+  for (MosaicTile* tile : mosaic_) {
+    tile->stream->SetVideoSuspended(suspended);
+  }
+  if (pip_) {
+    pip_->stream->SetVideoSuspended(suspended);
+  }
+}
+
 void ISimplePlayer::ToggleMute() {
   bool muted = !muted_;
   SetMute(muted);
 }
 
 void ISimplePlayer::PauseStream() {
+  if (stream_ && stream_->GetTrickPlay()) {  // leave the scan first
+    ChangeScan(0);
+    return;
+  }
+
   if (stream_) {
     stream_->TogglePause();
+    UpdateIdleState();
   }
 }
 
 void ISimplePlayer::SetStream(media::VideoState* stream) {
   FreeStreamSafe(true);
-  stream_ = stream;
+  {
+    std::unique_lock<std::mutex> lock(audio_pump_mutex_);
+    stream_ = stream;
+  }
 
   if (!stream_) {
     common::Error err = common::make_error("Failed to create stream");
@@ -840,11 +1830,27 @@ void ISimplePlayer::SetStream(media::VideoState* stream) {
   }
 
   stream_->SetHandler(this);
+  UpdatePipBudget();
+  UpdateVideoSuspend();
   exec_tid_ = THREAD_MANAGER()->CreateThread(&media::VideoState::Exec, stream_);
   bool is_started = exec_tid_->Start();
   if (!is_started) {
     common::Error err = common::make_error("Failed to start stream");
     SwitchToChannelErrorMode(err);
+    return;
+  }
+
+  StartThumbnails();
+}
+
+void ISimplePlayer::StartThumbnails() {
+  if (options_.thumbnails && stream_->GetUri().SchemeIsFile()) {
+    media::ThumbnailOptions topt;
+    topt.cpu_share_percent = options_.thumbnails_cpu_share;
+    thumbnails_ = new media::ThumbnailService(stream_->GetUri(), topt);
+    if (!thumbnails_->Start()) {
+      destroy(&thumbnails_);
+    }
   }
 }
 
@@ -857,6 +1863,31 @@ media::VideoState* ISimplePlayer::CreateStream(media::stream_id sid,
   }
 
   media::VideoState* stream = new media::VideoState(sid, uri, opt, copt);
+  if (worker_pool_) {
+    stream->SetWorkerPool(worker_pool_);
+  }
+  stream->SetDecoderCache(decoder_cache_);
+  common::uri::GURL mux;
+  int program = 0;
+  if (media::SplitProgramUrl(uri, &mux, &program)) {
+    for (auto it = demux_sources_.begin(); it != demux_sources_.end();) {
+      it = it->second.expired() ? demux_sources_.erase(it) : std::next(it);
+    }
+    std::shared_ptr<media::DemuxSource> source = demux_sources_[mux.spec()].lock();
+    if (!source) {
+      source = std::make_shared<media::DemuxSource>(mux, copt.format_opts);
+      if (source->Start()) {
+        demux_sources_[mux.spec()] = source;
+      }
+    }
+    stream->SetDemuxSource(source, program);
+  } else {
+    AVFormatContext* standby = nullptr;
+    media::GopKeeper::packets_t gop;
+    if (gop_keeper_->Take(uri, &standby, &gop)) {
+      stream->SetStandbyInput(standby, &gop);
+    }
+  }
   options_.last_showed_channel_id = sid;
   return stream;
 }
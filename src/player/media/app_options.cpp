@@ -39,7 +39,9 @@ AppOptions::AppOptions()
       hwaccel_output_format(),
       auto_exit(true),
       enable_video(true),
-      enable_audio(true)
+      enable_audio(true),
+      reverse_cache_mb(512),
+      accurate_seek(false)
 #if CONFIG_AVFILTER
       ,
       vfilters(),
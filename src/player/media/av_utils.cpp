@@ -18,8 +18,11 @@
 
 #include <player/media/av_utils.h>
 
+#include <string.h>
+
 extern "C" {
 #include <libavutil/display.h>
+#include <libavutil/error.h>
 #include <libavutil/eval.h>
 #include <libavutil/opt.h>
 #include <libavcodec/avcodec.h>
@@ -38,6 +41,14 @@ int check_stream_specifier(AVFormatContext* s, AVStream* st, const char* spec) {
   return ret;
 }
 
+std::string ffmpeg_errno_to_string(int err) {
+  char errbuf[128];
+  if (av_strerror(err, errbuf, sizeof(errbuf)) < 0) {
+    return strerror(AVUNERROR(err));
+  }
+  return errbuf;
+}
+
 double q2d_diff(AVRational a) {
   double div = a.num / static_cast<double>(a.den);
   return div * 1000.0;
@@ -110,6 +121,22 @@ bool is_realtime(AVFormatContext* s) {
   return false;
 }
 
+bool convert_to_dsp_format(AVSampleFormat fmt, dsp::SampleFormat* out) {
+  switch (fmt) {
+    case AV_SAMPLE_FMT_S16:
+      *out = dsp::SAMPLE_FMT_S16;
+      return true;
+    case AV_SAMPLE_FMT_S32:
+      *out = dsp::SAMPLE_FMT_S32;
+      return true;
+    case AV_SAMPLE_FMT_FLT:
+      *out = dsp::SAMPLE_FMT_FLT;
+      return true;
+    default:
+      return false;
+  }
+}
+
 #if CONFIG_AVFILTER
 int configure_filtergraph(AVFilterGraph* graph,
                           const char* filtergraph,
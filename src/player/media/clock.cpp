@@ -57,5 +57,16 @@ void Clock::SetPaused(bool paused) {
   paused_ = paused;
 }
 
+void Clock::SetSpeed(double speed) {
+  if (IsValidClock(pts_)) {  // rebase, so the value does not jump
+    SetClock(GetClock());
+  }
+  speed_ = speed;
+}
+
+double Clock::GetSpeed() const {
+  return speed_;
+}
+
 }  // namespace media
 }  // namespace fastoplayer
@@ -28,7 +28,14 @@ extern "C" {
 namespace fastoplayer {
 namespace media {
 
-Decoder::Decoder(AVCodecContext* avctx, PacketQueue* queue) : avctx_(avctx), queue_(queue), finished_(false) {
+Decoder::Decoder(AVCodecContext* avctx, PacketQueue* queue)
+    : avctx_(avctx),
+      queue_(queue),
+      finished_(false),
+      flush_count_(0),
+      serial_(0),
+      nonblocking_(false),
+      starved_(false) {
   CHECK(queue);
 }
 
@@ -61,9 +68,43 @@ AVCodecContext* Decoder::GetAvCtx() const {
   return avctx_;
 }
 
-void Decoder::Flush() {
-  queue_->Flush();
+AVCodecContext* Decoder::ReleaseAvCtx() {
+  AVCodecContext* avctx = avctx_;
+  avctx_ = nullptr;
+  return avctx;
+}
+
+size_t Decoder::GetFlushCount() const {
+  return flush_count_;
+}
+
+int Decoder::GetSerial() const {
+  return serial_;
+}
+
+void Decoder::SetNonBlocking(bool nonblocking) {
+  nonblocking_ = nonblocking;
+}
+
+bool Decoder::IsStarved() const {
+  return starved_;
+}
+
+int Decoder::GetPacket(AVPacket* pkt) {
+  if (!nonblocking_) {
+    starved_ = false;
+    return queue_->Get(pkt) ? 1 : -1;
+  }
+
+  const int ret = queue_->TryGet(pkt);
+  starved_ = ret == 0;
+  return ret;
+}
+
+void Decoder::Flush(int serial) {
   avcodec_flush_buffers(avctx_);
+  serial_ = serial;
+  flush_count_++;
 }
 
 IFrameDecoder::IFrameDecoder(AVCodecContext* avctx, PacketQueue* queue) : Decoder(avctx, queue) {}
@@ -82,13 +123,14 @@ int AudioDecoder::DecodeFrame(AVFrame* frame) {
   int got_frame = 0;
   do {
     AVPacket packet;
-    if (!queue_->Get(&packet)) {
-      return -1;
+    const int got_packet = GetPacket(&packet);
+    if (got_packet <= 0) {
+      return got_packet < 0 ? -1 : 0;
     }
 
     if (packet.data == nullptr) {  // flush packet
       SetFinished(false);
-      Flush();
+      Flush(PacketQueue::GetFlushSerial(packet));
       return 0;
     }
 
@@ -134,7 +176,8 @@ int AudioDecoder::DecodeFrame(AVFrame* frame) {
   return got_frame;
 }
 
-VideoDecoder::VideoDecoder(AVCodecContext* avctx, PacketQueue* queue) : IFrameDecoder(avctx, queue) {
+VideoDecoder::VideoDecoder(AVCodecContext* avctx, PacketQueue* queue)
+    : IFrameDecoder(avctx, queue), draining_(false), drain_count_(0) {
   CHECK(GetCodecType() == AVMEDIA_TYPE_VIDEO);
 }
 
@@ -146,17 +189,44 @@ int VideoDecoder::GetHeight() const {
   return avctx_->height;
 }
 
+size_t VideoDecoder::GetDrainCount() const {
+  return drain_count_;
+}
+
 int VideoDecoder::DecodeFrame(AVFrame* frame) {
   int got_frame = 0;
   do {
+    if (draining_) {  // return the held back frames before taking the next packet
+      int retcd = avcodec_receive_frame(avctx_, frame);
+      if (retcd == 0) {
+        frame->pts = frame->best_effort_timestamp;
+        return 1;
+      }
+      if (retcd != AVERROR_EOF) {
+        ERROR_LOG() << "video avcodec_receive_frame error while draining: " << retcd;
+      }
+      draining_ = false;
+      avcodec_flush_buffers(avctx_);
+      drain_count_++;
+      return 0;
+    }
+
     AVPacket packet;
-    if (!queue_->Get(&packet)) {
-      return -1;
+    const int got_packet = GetPacket(&packet);
+    if (got_packet <= 0) {
+      return got_packet < 0 ? -1 : 0;
+    }
+
+    if (PacketQueue::IsDrainPacket(packet)) {
+      avcodec_send_packet(avctx_, nullptr);
+      draining_ = true;
+      continue;
     }
 
     if (packet.data == nullptr) {  // flush packet
       SetFinished(false);
-      Flush();
+      draining_ = false;
+      Flush(PacketQueue::GetFlushSerial(packet));
       return 0;
     }
 
@@ -0,0 +1,171 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/decoder_cache.h>
+
+extern "C" {
+#include <libavutil/mem.h>  // for av_free
+#include <libavutil/opt.h>  // for av_opt_set
+}
+
+namespace fastoplayer {
+namespace media {
+
+namespace {
+uint64_t hash_bytes(const uint8_t* data, int size) {  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (int i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::string options_to_string(const AVDictionary* opts) {
+  char* buffer = nullptr;
+  if (av_dict_get_string(opts, &buffer, '=', ',') < 0 || !buffer) {
+    return std::string();
+  }
+
+  const std::string result(buffer);
+  av_free(buffer);
+  return result;
+}
+
+/* streams lower these while playing (trick play, fast speeds, a decode budget), the next one starts from the
+ * values it is opened with */
+void reset_skip_options(AVCodecContext* avctx, const std::string& options) {
+  static const char* const skip_options[] = {"skip_frame", "skip_idct", "skip_loop_filter"};
+  AVDictionary* opts = nullptr;
+  av_dict_parse_string(&opts, options.c_str(), "=", ",", 0);
+  for (const char* name : skip_options) {
+    const AVDictionaryEntry* entry = av_dict_get(opts, name, nullptr, 0);
+    av_opt_set(avctx, name, entry ? entry->value : "default", 0);
+  }
+  av_dict_free(&opts);
+}
+}  // namespace
+
+DecoderCache::Key::Key()
+    : codec(nullptr),
+      profile(0),
+      width(0),
+      height(0),
+      format(0),
+      sample_rate(0),
+      channels(0),
+      channel_layout(0),
+      extradata_size(0),
+      extradata_hash(0),
+      flags2(0),
+      options() {}
+
+DecoderCache::Key::Key(const AVCodec* codec, const AVCodecParameters* par, const AVDictionary* opts, int flags2)
+    : codec(codec),
+      profile(par->profile),
+      width(par->width),
+      height(par->height),
+      format(par->format),
+      sample_rate(par->sample_rate),
+      channels(par->channels),
+      channel_layout(par->channel_layout),
+      extradata_size(par->extradata_size),
+      extradata_hash(hash_bytes(par->extradata, par->extradata_size)),
+      flags2(flags2),
+      options(options_to_string(opts)) {}
+
+bool DecoderCache::Key::IsValid() const {
+  return codec != nullptr;
+}
+
+bool DecoderCache::Key::Equals(const Key& other) const {
+  return codec == other.codec && profile == other.profile && width == other.width && height == other.height &&
+         format == other.format && sample_rate == other.sample_rate && channels == other.channels &&
+         channel_layout == other.channel_layout && extradata_size == other.extradata_size &&
+         extradata_hash == other.extradata_hash && flags2 == other.flags2 && options == other.options;
+}
+
+DecoderCache::DecoderCache(size_t capacity) : capacity_(capacity), mutex_(), entries_(), hits_(0), misses_(0) {}
+
+DecoderCache::~DecoderCache() {
+  Clear();
+}
+
+AVCodecContext* DecoderCache::Take(const Key& key) {
+  if (!key.IsValid()) {
+    return nullptr;
+  }
+
+  lock_t lock(mutex_);
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->key.Equals(key)) {
+      AVCodecContext* avctx = it->avctx;
+      entries_.erase(it);
+      hits_++;
+      return avctx;
+    }
+  }
+  misses_++;
+  return nullptr;
+}
+
+void DecoderCache::Put(const Key& key, AVCodecContext* avctx) {
+  if (!avctx) {
+    return;
+  }
+  if (!key.IsValid() || !capacity_) {
+    avcodec_free_context(&avctx);
+    return;
+  }
+
+  /* the next stream starts from a keyframe, nothing of the previous one is held */
+  avcodec_flush_buffers(avctx);
+  reset_skip_options(avctx, key.options);
+  lock_t lock(mutex_);
+  entries_.push_front({key, avctx});
+  while (entries_.size() > capacity_) {
+    avcodec_free_context(&entries_.back().avctx);
+    entries_.pop_back();
+  }
+}
+
+void DecoderCache::Clear() {
+  lock_t lock(mutex_);
+  for (Entry& entry : entries_) {
+    avcodec_free_context(&entry.avctx);
+  }
+  entries_.clear();
+}
+
+size_t DecoderCache::GetCount() const {
+  lock_t lock(mutex_);
+  return entries_.size();
+}
+
+size_t DecoderCache::GetHits() const {
+  lock_t lock(mutex_);
+  return hits_;
+}
+
+size_t DecoderCache::GetMisses() const {
+  lock_t lock(mutex_);
+  return misses_;
+}
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -0,0 +1,461 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/demux_source.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include <common/logger.h>
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+#include <player/media/av_utils.h>  // for ffmpeg_errno_to_string, is_realtime
+#include <player/media/types.h>     // for make_url
+
+/* packets queued for one player before its own are dropped */
+#define DEMUX_CONSUMER_MAX_BYTES (8 * 1024 * 1024)
+/* longest wait of a reader for packets, the player read loop checks its requests in between */
+#define DEMUX_READ_WAIT_MSEC 10
+
+#define PROGRAM_URL_FRAGMENT "#program="
+
+namespace fastoplayer {
+namespace media {
+
+namespace {
+AVProgram* find_program(const AVFormatContext* ic, int id) {
+  for (unsigned int i = 0; i < ic->nb_programs; ++i) {
+    if (ic->programs[i]->id == id) {
+      return ic->programs[i];
+    }
+  }
+  return nullptr;
+}
+
+bool program_has_stream(const AVProgram* program, unsigned int index) {
+  for (unsigned int i = 0; i < program->nb_stream_indexes; ++i) {
+    if (program->stream_index[i] == index) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* a context describing the streams only, of one program or all of them, packets are never read through it */
+AVFormatContext* copy_streams(const AVFormatContext* src, const AVProgram* program, std::vector<int>* map) {
+  AVFormatContext* ic = avformat_alloc_context();
+  if (!ic) {
+    return nullptr;
+  }
+
+  ic->iformat = src->iformat;  // for the format flags and name
+  ic->start_time = src->start_time;
+  ic->duration = src->duration;
+  ic->bit_rate = src->bit_rate;
+  av_dict_copy(&ic->metadata, src->metadata, 0);
+  map->assign(src->nb_streams, -1);
+  for (unsigned int i = 0; i < src->nb_streams; ++i) {
+    if (program && !program_has_stream(program, i)) {
+      continue;
+    }
+
+    const AVStream* in = src->streams[i];
+    AVStream* out = avformat_new_stream(ic, nullptr);
+    if (!out || avcodec_parameters_copy(out->codecpar, in->codecpar) < 0) {
+      avformat_free_context(ic);
+      return nullptr;
+    }
+    out->id = in->id;
+    out->time_base = in->time_base;
+    out->start_time = in->start_time;
+    out->duration = in->duration;
+    out->avg_frame_rate = in->avg_frame_rate;
+    out->r_frame_rate = in->r_frame_rate;
+    out->sample_aspect_ratio = in->sample_aspect_ratio;
+    out->disposition = in->disposition;
+    av_dict_copy(&out->metadata, in->metadata, 0);
+    (*map)[i] = out->index;
+  }
+
+  for (unsigned int i = 0; i < src->nb_programs; ++i) {
+    const AVProgram* in = src->programs[i];
+    if (program && in->id != program->id) {
+      continue;
+    }
+
+    AVProgram* out = av_new_program(ic, in->id);
+    if (!out) {
+      continue;
+    }
+    av_dict_copy(&out->metadata, in->metadata, 0);
+    for (unsigned int j = 0; j < in->nb_stream_indexes; ++j) {
+      const unsigned int index = in->stream_index[j];
+      if (index < map->size() && (*map)[index] >= 0) {
+        av_program_add_stream_index(ic, out->id, (*map)[index]);
+      }
+    }
+  }
+  return ic;
+}
+}  // namespace
+
+bool SplitProgramUrl(const common::uri::GURL& uri, common::uri::GURL* source, int* program) {
+  if (!source || !program) {
+    return false;
+  }
+
+  const std::string spec = uri.spec();
+  const std::string::size_type pos = spec.rfind(PROGRAM_URL_FRAGMENT);
+  if (pos == std::string::npos) {
+    return false;
+  }
+
+  const std::string number = spec.substr(pos + strlen(PROGRAM_URL_FRAGMENT));
+  char* end = nullptr;
+  const long value = strtol(number.c_str(), &end, 10);
+  if (number.empty() || *end || value < 0 || value > INT32_MAX) {
+    return false;
+  }
+
+  *source = common::uri::GURL(spec.substr(0, pos));
+  *program = static_cast<int>(value);
+  return source->is_valid();
+}
+
+DemuxConsumer::DemuxConsumer(DemuxSource* source, int program)
+    : source_(source),
+      program_(program),
+      cond_(),
+      queue_(),
+      queue_bytes_(0),
+      map_(),
+      video_(),
+      wait_keyframe_(true),
+      aborted_(false),
+      dropped_(0) {}
+
+DemuxConsumer::~DemuxConsumer() {
+  source_->Unsubscribe(this);
+  for (AVPacket& pkt : queue_) {
+    av_packet_unref(&pkt);
+  }
+}
+
+int DemuxConsumer::Open(AVFormatContext** ic) {
+  if (!ic) {
+    return AVERROR(EINVAL);
+  }
+
+  DemuxSource::lock_t lock(source_->mutex_);
+  cond_.wait(lock, [this]() { return aborted_ || source_->state_ != DemuxSource::OPENING; });
+  if (aborted_) {
+    return AVERROR_EXIT;
+  }
+  if (source_->state_ != DemuxSource::READY) {
+    return source_->error_ < 0 ? source_->error_ : AVERROR_EOF;
+  }
+
+  const AVProgram* program = find_program(source_->streams_, program_);
+  if (!program) {
+    WARNING_LOG() << "Program " << program_ << " is not in the mux.";
+    return AVERROR_STREAM_NOT_FOUND;
+  }
+
+  std::vector<int> map;
+  AVFormatContext* streams = copy_streams(source_->streams_, program, &map);
+  if (!streams) {
+    return AVERROR(ENOMEM);
+  }
+
+  video_.assign(map.size(), false);
+  for (size_t i = 0; i < map.size(); ++i) {
+    video_[i] = source_->streams_->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
+  }
+  map_ = map;
+  source_->cond_.notify_one();
+  *ic = streams;
+  return 0;
+}
+
+int DemuxConsumer::Read(AVPacket* pkt) {
+  if (!pkt) {
+    return AVERROR(EINVAL);
+  }
+
+  DemuxSource::lock_t lock(source_->mutex_);
+  cond_.wait_for(lock, std::chrono::milliseconds(DEMUX_READ_WAIT_MSEC), [this]() {
+    return aborted_ || !queue_.empty() || source_->state_ != DemuxSource::READY;
+  });
+  if (aborted_) {
+    return AVERROR_EXIT;
+  }
+  if (queue_.empty()) {
+    if (source_->state_ == DemuxSource::READY) {
+      return AVERROR(EAGAIN);
+    }
+    /* the caller loops on the end, it is not woken faster than the packets used to come */
+    cond_.wait_for(lock, std::chrono::milliseconds(DEMUX_READ_WAIT_MSEC), [this]() { return aborted_; });
+    return aborted_ ? AVERROR_EXIT : AVERROR_EOF;
+  }
+
+  *pkt = queue_.front();
+  queue_.pop_front();
+  queue_bytes_ -= pkt->size;
+  source_->cond_.notify_one();  // the reader may be waiting for room
+  return 0;
+}
+
+void DemuxConsumer::Abort() {
+  DemuxSource::lock_t lock(source_->mutex_);
+  aborted_ = true;
+  cond_.notify_all();
+  source_->cond_.notify_one();
+}
+
+bool DemuxConsumer::IsRealtime() const {
+  DemuxSource::lock_t lock(source_->mutex_);
+  return source_->realtime_;
+}
+
+size_t DemuxConsumer::GetDroppedCount() const {
+  DemuxSource::lock_t lock(source_->mutex_);
+  return dropped_;
+}
+
+bool DemuxConsumer::IsFull() const {
+  return queue_bytes_ >= DEMUX_CONSUMER_MAX_BYTES;
+}
+
+void DemuxConsumer::Push(AVPacket* pkt) {
+  const bool video = video_[pkt->stream_index];
+  if (IsFull()) {  // behind, the decoder starts over at the next keyframe
+    wait_keyframe_ = true;
+    dropped_++;
+    av_packet_unref(pkt);
+    return;
+  }
+  if (video && wait_keyframe_) {
+    if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+      dropped_++;
+      av_packet_unref(pkt);
+      return;
+    }
+    wait_keyframe_ = false;
+  }
+
+  pkt->stream_index = map_[pkt->stream_index];
+  queue_.push_back(*pkt);
+  queue_bytes_ += pkt->size;
+  cond_.notify_one();
+}
+
+DemuxSource::DemuxSource(const common::uri::GURL& uri, const AVDictionary* format_opts)
+    : uri_(uri),
+      format_opts_(nullptr),
+      tid_(),
+      stop_(false),
+      mutex_(),
+      cond_(),
+      consumers_(),
+      state_(OPENING),
+      error_(0),
+      streams_(nullptr),
+      realtime_(false) {
+  av_dict_copy(&format_opts_, format_opts, 0);
+}
+
+DemuxSource::~DemuxSource() {
+  Stop();
+  DCHECK(consumers_.empty());
+  avformat_free_context(streams_);
+  av_dict_free(&format_opts_);
+}
+
+bool DemuxSource::Start() {
+  if (tid_) {
+    return true;
+  }
+
+  stop_ = false;
+  tid_ = THREAD_MANAGER()->CreateThread(&DemuxSource::Exec, this);
+  if (!tid_->Start()) {
+    tid_.reset();
+    SetState(FAILED, AVERROR(EAGAIN));
+    return false;
+  }
+  return true;
+}
+
+void DemuxSource::Stop() {
+  if (!tid_) {
+    return;
+  }
+
+  {
+    lock_t lock(mutex_);
+    stop_ = true;
+    cond_.notify_all();
+  }
+  tid_->Join();
+  tid_.reset();
+}
+
+DemuxConsumer* DemuxSource::Subscribe(int program) {
+  DemuxConsumer* consumer = new DemuxConsumer(this, program);
+  lock_t lock(mutex_);
+  consumers_.push_back(consumer);
+  return consumer;
+}
+
+void DemuxSource::Unsubscribe(DemuxConsumer* consumer) {
+  lock_t lock(mutex_);
+  consumers_.erase(std::remove(consumers_.begin(), consumers_.end(), consumer), consumers_.end());
+  cond_.notify_one();
+}
+
+int DemuxSource::decode_interrupt_callback(void* user_data) {
+  DemuxSource* source = static_cast<DemuxSource*>(user_data);
+  return source->stop_;
+}
+
+int DemuxSource::Exec() {
+  AVFormatContext* ic = avformat_alloc_context();
+  if (!ic) {
+    SetState(FAILED, AVERROR(ENOMEM));
+    return ERROR_RESULT_VALUE;
+  }
+
+  const std::string uri_str = make_url(uri_);
+  ic->interrupt_callback.callback = decode_interrupt_callback;
+  ic->interrupt_callback.opaque = this;
+  AVDictionary* opts = nullptr;
+  av_dict_copy(&opts, format_opts_, 0);
+  av_dict_set(&opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
+  int ret = avformat_open_input(&ic, uri_str.c_str(), nullptr, &opts);
+  av_dict_free(&opts);
+  if (ret < 0) {
+    WARNING_LOG() << "Shared demuxer can't open the input: " << ffmpeg_errno_to_string(ret);
+    SetState(FAILED, ret);
+    return ERROR_RESULT_VALUE;
+  }
+
+  ret = OpenInput(ic);
+  if (ret < 0) {
+    avformat_close_input(&ic);
+    SetState(FAILED, ret);
+    return ERROR_RESULT_VALUE;
+  }
+
+  AVPacket pkt1, *pkt = &pkt1;
+  while (!stop_) {
+    {
+      /* a file is not read ahead of every player, a live mux is dropped at the socket instead */
+      lock_t lock(mutex_);
+      if (!CanRead()) {
+        cond_.wait_for(lock, std::chrono::milliseconds(DEMUX_READ_WAIT_MSEC));
+        continue;
+      }
+    }
+
+    ret = av_read_frame(ic, pkt);
+    if (ret < 0) {
+      if (ret == AVERROR_EOF || avio_feof(ic->pb) || (ic->pb && ic->pb->error)) {
+        break;
+      }
+      lock_t lock(mutex_);
+      cond_.wait_for(lock, std::chrono::milliseconds(DEMUX_READ_WAIT_MSEC), [this]() { return stop_.load(); });
+      continue;
+    }
+
+    Route(pkt);
+  }
+
+  INFO_LOG() << "Shared demuxer finished: " << (stop_ ? "stopped" : ffmpeg_errno_to_string(ret));
+  SetState(ENDED, ret < 0 ? ret : AVERROR_EOF);
+  avformat_close_input(&ic);
+  return SUCCESS_RESULT_VALUE;
+}
+
+int DemuxSource::OpenInput(AVFormatContext* ic) {
+  int ret = avformat_find_stream_info(ic, nullptr);
+  if (ret < 0) {
+    WARNING_LOG() << "Shared demuxer can't read the input: " << ffmpeg_errno_to_string(ret);
+    return ret;
+  }
+
+  std::vector<int> map;
+  AVFormatContext* streams = copy_streams(ic, nullptr, &map);
+  if (!streams) {
+    return AVERROR(ENOMEM);
+  }
+
+  INFO_LOG() << "Shared demuxer opened: " << ic->nb_programs << " programs, " << ic->nb_streams << " streams";
+  lock_t lock(mutex_);
+  streams_ = streams;
+  realtime_ = is_realtime(ic);
+  state_ = READY;
+  for (DemuxConsumer* consumer : consumers_) {
+    consumer->cond_.notify_all();
+  }
+  return 0;
+}
+
+void DemuxSource::Route(AVPacket* pkt) {
+  lock_t lock(mutex_);
+  for (DemuxConsumer* consumer : consumers_) {
+    const size_t index = pkt->stream_index;
+    if (consumer->aborted_ || index >= consumer->map_.size() || consumer->map_[index] < 0) {
+      continue;
+    }
+
+    AVPacket copy;
+    av_init_packet(&copy);
+    copy.data = nullptr;
+    copy.size = 0;
+    if (av_packet_ref(&copy, pkt) == 0) {
+      consumer->Push(&copy);
+    }
+  }
+  av_packet_unref(pkt);
+}
+
+bool DemuxSource::CanRead() const {
+  for (DemuxConsumer* consumer : consumers_) {
+    if (!consumer->map_.empty() && !consumer->aborted_ && !consumer->IsFull()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void DemuxSource::SetState(State state, int error) {
+  lock_t lock(mutex_);
+  state_ = state;
+  error_ = error;
+  for (DemuxConsumer* consumer : consumers_) {
+    consumer->cond_.notify_all();
+  }
+}
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -0,0 +1,529 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/dsp/audio_dsp.h>
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <player/media/dsp/audio_dsp_kernels.h>
+
+namespace fastoplayer {
+namespace media {
+namespace dsp {
+
+namespace {
+
+// same operand order and NaN behaviour as maxps/minps, so that simd kernels can match them exactly
+inline float MaxF(float a, float b) {
+  return a > b ? a : b;
+}
+
+inline float MinF(float a, float b) {
+  return a < b ? a : b;
+}
+
+inline double MaxD(double a, double b) {
+  return a > b ? a : b;
+}
+
+inline double MinD(double a, double b) {
+  return a < b ? a : b;
+}
+
+inline int32_t Q14(gain_t gain) {
+  return gain >> 16;
+}
+
+inline int16_t ScaleS16(int16_t x, gain_t gain) {
+  const int32_t val = (x * Q14(gain) + (1 << 13)) >> 14;
+  return static_cast<int16_t>(std::min(std::max(val, INT16_MIN), INT16_MAX));
+}
+
+inline int32_t RoundToS32(double val) {
+  return static_cast<int32_t>(lrint(MinD(MaxD(val, -2147483648.0), 2147483647.0)));
+}
+
+inline int32_t ScaleS32(int32_t x, gain_t gain) {
+  const double g = static_cast<double>(Q14(gain)) * (1.0 / 16384.0);
+  return RoundToS32(static_cast<double>(x) * g);
+}
+
+inline float ScaleFlt(float x, gain_t gain) {
+  const float g = static_cast<float>(Q14(gain)) * (1.0f / 16384.0f);
+  return x * g;
+}
+
+const Kernels scalar_kernels = {{ScaleS16Scalar, ScaleS32Scalar, ScaleFltScalar},
+                                {MixS16Scalar, MixS32Scalar, MixFltScalar},
+                                S16ToFltScalar,
+                                FltToS16Scalar,
+                                S32ToFltScalar,
+                                FltToS32Scalar};
+
+bool IsCpuSupportsAvx2() {
+#if defined(HAVE_AUDIO_DSP_X86) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+template <typename T>
+void InterleaveImpl(T* out, const uint8_t* const* planes, size_t channels, size_t nb_frames) {
+  if (channels == 2) {
+    const T* left = reinterpret_cast<const T*>(planes[0]);
+    const T* right = reinterpret_cast<const T*>(planes[1]);
+    for (size_t i = 0; i < nb_frames; ++i) {
+      out[2 * i] = left[i];
+      out[2 * i + 1] = right[i];
+    }
+    return;
+  }
+
+  for (size_t ch = 0; ch < channels; ++ch) {
+    const T* in = reinterpret_cast<const T*>(planes[ch]);
+    T* dst = out + ch;
+    for (size_t i = 0; i < nb_frames; ++i) {
+      dst[i * channels] = in[i];
+    }
+  }
+}
+
+const Kernels* GetActiveKernels() {
+  static const Kernels* kernels = GetKernels(GetBestIsa());
+  return kernels;
+}
+
+}  // namespace
+
+void ScaleS16Scalar(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = ScaleS16(in[i], GainAt(start, step, i));
+  }
+}
+
+void MixS16Scalar(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    const int32_t val = out[i] + ScaleS16(in[i], GainAt(start, step, i));
+    out[i] = static_cast<int16_t>(std::min(std::max(val, INT16_MIN), INT16_MAX));
+  }
+}
+
+void ScaleS32Scalar(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = ScaleS32(in[i], GainAt(start, step, i));
+  }
+}
+
+void MixS32Scalar(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    const int32_t scaled = ScaleS32(in[i], GainAt(start, step, i));
+    out[i] = RoundToS32(static_cast<double>(out[i]) + static_cast<double>(scaled));
+  }
+}
+
+void ScaleFltScalar(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  float* out = static_cast<float*>(dst);
+  const float* in = static_cast<const float*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = ScaleFlt(in[i], GainAt(start, step, i));
+  }
+}
+
+void MixFltScalar(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  float* out = static_cast<float*>(dst);
+  const float* in = static_cast<const float*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    const float val = out[i] + ScaleFlt(in[i], GainAt(start, step, i));
+    out[i] = MinF(MaxF(val, -1.0f), 1.0f);
+  }
+}
+
+void S16ToFltScalar(void* dst, const void* src, size_t count) {
+  float* out = static_cast<float*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = static_cast<float>(in[i]) * (1.0f / 32768.0f);
+  }
+}
+
+void FltToS16Scalar(void* dst, const void* src, size_t count) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const float* in = static_cast<const float*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    const float val = MinF(MaxF(in[i] * 32768.0f, -32768.0f), 32767.0f);
+    out[i] = static_cast<int16_t>(lrintf(val));
+  }
+}
+
+void S32ToFltScalar(void* dst, const void* src, size_t count) {
+  float* out = static_cast<float*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = static_cast<float>(in[i]) * (1.0f / 2147483648.0f);
+  }
+}
+
+void FltToS32Scalar(void* dst, const void* src, size_t count) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const float* in = static_cast<const float*>(src);
+  for (size_t i = 0; i < count; ++i) {
+    // 2147483520 is the largest float below 2^31
+    const float val = MinF(MaxF(in[i] * 2147483648.0f, -2147483648.0f), 2147483520.0f);
+    out[i] = static_cast<int32_t>(lrintf(val));
+  }
+}
+
+const Kernels* GetKernels(Isa isa) {
+  if (!IsIsaSupported(isa)) {
+    return nullptr;
+  }
+
+  switch (isa) {
+    case ISA_SCALAR:
+      return &scalar_kernels;
+#if defined(HAVE_AUDIO_DSP_X86)
+    case ISA_SSE2:
+      return GetSse2Kernels();
+    case ISA_AVX2:
+      return GetAvx2Kernels();
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    case ISA_NEON:
+      return GetNeonKernels();
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+gain_t VolumeToGain(int volume) {
+  volume = std::min(std::max(volume, 0), 100);
+  return static_cast<gain_t>(static_cast<int64_t>(unity_gain) * volume / 100);
+}
+
+size_t GetBytesPerSample(SampleFormat fmt) {
+  switch (fmt) {
+    case SAMPLE_FMT_S16:
+      return sizeof(int16_t);
+    case SAMPLE_FMT_S32:
+      return sizeof(int32_t);
+    case SAMPLE_FMT_FLT:
+      return sizeof(float);
+    default:
+      return 0;
+  }
+}
+
+const char* IsaToString(Isa isa) {
+  switch (isa) {
+    case ISA_SCALAR:
+      return "scalar";
+    case ISA_SSE2:
+      return "sse2";
+    case ISA_AVX2:
+      return "avx2";
+    case ISA_NEON:
+      return "neon";
+    default:
+      return "unknown";
+  }
+}
+
+bool IsIsaSupported(Isa isa) {
+  switch (isa) {
+    case ISA_SCALAR:
+      return true;
+#if defined(HAVE_AUDIO_DSP_X86)
+    case ISA_SSE2:
+      return true;  // x86_64 baseline
+    case ISA_AVX2: {
+      static const bool avx2 = IsCpuSupportsAvx2();
+      return avx2;
+    }
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    case ISA_NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+Isa GetBestIsa() {
+  static const Isa isas[] = {ISA_AVX2, ISA_SSE2, ISA_NEON};
+  for (Isa isa : isas) {
+    if (IsIsaSupported(isa)) {
+      return isa;
+    }
+  }
+  return ISA_SCALAR;
+}
+
+void Scale(SampleFormat fmt, void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  if (fmt < 0 || fmt >= SAMPLE_FMT_COUNT) {
+    return;
+  }
+
+  if (start == unity_gain && step == 0) {
+    if (dst != src) {
+      memcpy(dst, src, count * GetBytesPerSample(fmt));
+    }
+    return;
+  }
+  GetActiveKernels()->scale[fmt](dst, src, count, start, step);
+}
+
+void Mix(SampleFormat fmt, void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  if (fmt < 0 || fmt >= SAMPLE_FMT_COUNT) {
+    return;
+  }
+
+  if (start == 0 && step == 0) {
+    return;
+  }
+  GetActiveKernels()->mix[fmt](dst, src, count, start, step);
+}
+
+bool Convert(SampleFormat dst_fmt, void* dst, SampleFormat src_fmt, const void* src, size_t count) {
+  if (dst_fmt == src_fmt) {
+    memmove(dst, src, count * GetBytesPerSample(dst_fmt));
+    return true;
+  }
+
+  const Kernels* kernels = GetActiveKernels();
+  if (src_fmt == SAMPLE_FMT_S16 && dst_fmt == SAMPLE_FMT_FLT) {
+    kernels->s16_to_flt(dst, src, count);
+  } else if (src_fmt == SAMPLE_FMT_FLT && dst_fmt == SAMPLE_FMT_S16) {
+    kernels->flt_to_s16(dst, src, count);
+  } else if (src_fmt == SAMPLE_FMT_S32 && dst_fmt == SAMPLE_FMT_FLT) {
+    kernels->s32_to_flt(dst, src, count);
+  } else if (src_fmt == SAMPLE_FMT_FLT && dst_fmt == SAMPLE_FMT_S32) {
+    kernels->flt_to_s32(dst, src, count);
+  } else if (src_fmt == SAMPLE_FMT_S16 && dst_fmt == SAMPLE_FMT_S32) {
+    int32_t* out = static_cast<int32_t*>(dst);
+    const int16_t* in = static_cast<const int16_t*>(src);
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = in[i] * 65536;
+    }
+  } else if (src_fmt == SAMPLE_FMT_S32 && dst_fmt == SAMPLE_FMT_S16) {
+    int16_t* out = static_cast<int16_t*>(dst);
+    const int32_t* in = static_cast<const int32_t*>(src);
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = static_cast<int16_t>(in[i] >> 16);
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void Interleave(SampleFormat fmt, void* dst, const uint8_t* const* planes, size_t channels, size_t nb_frames) {
+  switch (fmt) {
+    case SAMPLE_FMT_S16:
+      InterleaveImpl(static_cast<int16_t*>(dst), planes, channels, nb_frames);
+      break;
+    case SAMPLE_FMT_S32:
+      InterleaveImpl(static_cast<int32_t*>(dst), planes, channels, nb_frames);
+      break;
+    case SAMPLE_FMT_FLT:
+      InterleaveImpl(static_cast<float*>(dst), planes, channels, nb_frames);
+      break;
+    default:
+      break;
+  }
+}
+
+GainRamp::GainRamp(size_t ramp_samples, gain_t gain)
+    : ramp_samples_(ramp_samples), current_(gain), target_(gain), step_(0), ramp_left_(0) {}
+
+void GainRamp::SetTarget(gain_t gain) {
+  if (gain == target_) {
+    return;
+  }
+
+  target_ = gain;
+  if (!ramp_samples_ || gain == current_) {
+    Reset(gain);
+    return;
+  }
+
+  // restarts from the current gain if the previous ramp is not finished yet
+  step_ = static_cast<gain_t>((static_cast<int64_t>(target_) - current_) / static_cast<int64_t>(ramp_samples_));
+  ramp_left_ = ramp_samples_;
+}
+
+gain_t GainRamp::GetTarget() const {
+  return target_;
+}
+
+gain_t GainRamp::GetCurrent() const {
+  return current_;
+}
+
+bool GainRamp::IsUnity() const {
+  return !ramp_left_ && current_ == unity_gain;
+}
+
+void GainRamp::Reset(gain_t gain) {
+  current_ = gain;
+  target_ = gain;
+  step_ = 0;
+  ramp_left_ = 0;
+}
+
+void GainRamp::Scale(SampleFormat fmt, void* dst, const void* src, size_t count) {
+  Apply(&dsp::Scale, fmt, dst, src, count);
+}
+
+void GainRamp::Mix(SampleFormat fmt, void* dst, const void* src, size_t count) {
+  Apply(&dsp::Mix, fmt, dst, src, count);
+}
+
+void GainRamp::Apply(apply_t func, SampleFormat fmt, void* dst, const void* src, size_t count) {
+  const size_t bytes_per_sample = GetBytesPerSample(fmt);
+  uint8_t* out = static_cast<uint8_t*>(dst);
+  const uint8_t* in = static_cast<const uint8_t*>(src);
+  if (ramp_left_) {
+    const size_t ramp = std::min(count, ramp_left_);
+    func(fmt, out, in, ramp, current_, step_);
+    current_ = GainAt(current_, step_, ramp);
+    ramp_left_ -= ramp;
+    if (!ramp_left_) {
+      current_ = target_;
+      step_ = 0;
+    }
+    out += ramp * bytes_per_sample;
+    in += ramp * bytes_per_sample;
+    count -= ramp;
+  }
+
+  if (count) {
+    func(fmt, out, in, count, current_, 0);
+  }
+}
+
+struct MixBus::Source {
+  explicit Source(size_t ramp_samples) : key(nullptr), ramp(ramp_samples), used(false), added(false) {}
+
+  const void* key;
+  GainRamp ramp;
+  bool used;   // the slot holds a source
+  bool added;  // to the current buffer
+};
+
+MixBus::MixBus(SampleFormat fmt, size_t ramp_samples, size_t max_sources)
+    : fmt_(fmt),
+      sources_(max_sources, Source(ramp_samples)),
+      dst_(nullptr),
+      count_(0),
+      filled_(false) {}
+
+MixBus::~MixBus() {}
+
+void MixBus::Begin(void* dst, size_t count) {
+  dst_ = dst;
+  count_ = count;
+  filled_ = false;
+  for (Source& source : sources_) {
+    source.added = false;
+  }
+}
+
+bool MixBus::Add(const void* key, const void* src, gain_t gain) {
+  Source* source = nullptr;
+  Source* free_slot = nullptr;
+  for (Source& slot : sources_) {
+    if (slot.used && slot.key == key) {
+      source = &slot;
+      break;
+    }
+    if (!slot.used && !free_slot) {
+      free_slot = &slot;
+    }
+  }
+  if (source) {
+    source->ramp.SetTarget(gain);
+  } else if (free_slot) {
+    source = free_slot;
+    source->key = key;
+    source->ramp.Reset(gain);
+    source->used = true;
+  } else {
+    return false;
+  }
+  source->added = true;
+
+  // the first source is scaled into the buffer, no need to clear it before
+  if (filled_) {
+    source->ramp.Mix(fmt_, dst_, src, count_);
+  } else {
+    source->ramp.Scale(fmt_, dst_, src, count_);
+    filled_ = true;
+  }
+  return true;
+}
+
+void MixBus::End() {
+  if (!filled_ && dst_) {
+    memset(dst_, 0, count_ * GetBytesPerSample(fmt_));
+  }
+
+  for (Source& source : sources_) {
+    if (!source.added) {
+      source.used = false;
+    }
+  }
+  dst_ = nullptr;
+  count_ = 0;
+}
+
+void MixBus::Remove(const void* key) {
+  for (Source& source : sources_) {
+    if (source.used && source.key == key) {
+      source.used = false;
+    }
+  }
+}
+
+size_t MixBus::GetSourcesCount() const {
+  size_t count = 0;
+  for (const Source& source : sources_) {
+    if (source.used) {
+      count++;
+    }
+  }
+  return count;
+}
+
+}  // namespace dsp
+}  // namespace media
+}  // namespace fastoplayer
@@ -0,0 +1,242 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/dsp/audio_dsp_kernels.h>
+
+#if defined(HAVE_AUDIO_DSP_X86)
+#include <immintrin.h>
+
+namespace fastoplayer {
+namespace media {
+namespace dsp {
+
+namespace {
+
+inline __m256i GainLanes(gain_t start, gain_t step, int i0, int i1, int i2, int i3, int i4, int i5, int i6, int i7) {
+  return _mm256_setr_epi32(GainAt(start, step, i0), GainAt(start, step, i1), GainAt(start, step, i2),
+                           GainAt(start, step, i3), GainAt(start, step, i4), GainAt(start, step, i5),
+                           GainAt(start, step, i6), GainAt(start, step, i7));
+}
+
+inline __m256i Combine(__m128i lo, __m128i hi) {
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+// pack and unpack work inside 128 bit halves, so gain_a holds samples 0-3 and 8-11, gain_b holds 4-7 and 12-15
+inline __m256i ScaleS16x16(__m256i x, __m256i gain_a, __m256i gain_b) {
+  const __m256i g = _mm256_packs_epi32(_mm256_srai_epi32(gain_a, 16), _mm256_srai_epi32(gain_b, 16));
+  const __m256i lo = _mm256_mullo_epi16(x, g);
+  const __m256i hi = _mm256_mulhi_epi16(x, g);
+  const __m256i round = _mm256_set1_epi32(1 << 13);
+  const __m256i p0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi), round), 14);
+  const __m256i p1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi), round), 14);
+  return _mm256_packs_epi32(p0, p1);
+}
+
+inline __m256d GainToPd(__m128i gain) {
+  return _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_srai_epi32(gain, 16)), _mm256_set1_pd(1.0 / 16384.0));
+}
+
+inline __m128i RoundToS32x4(__m256d val) {
+  val = _mm256_min_pd(_mm256_max_pd(val, _mm256_set1_pd(-2147483648.0)), _mm256_set1_pd(2147483647.0));
+  return _mm256_cvtpd_epi32(val);
+}
+
+inline __m256i ScaleS32x8(__m256i x, __m256i gain) {
+  const __m256d v0 = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x)),
+                                   GainToPd(_mm256_castsi256_si128(gain)));
+  const __m256d v1 = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)),
+                                   GainToPd(_mm256_extracti128_si256(gain, 1)));
+  return Combine(RoundToS32x4(v0), RoundToS32x4(v1));
+}
+
+inline __m256i AddS32x8(__m256i a, __m256i b) {
+  const __m256d s0 = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)),
+                                   _mm256_cvtepi32_pd(_mm256_castsi256_si128(b)));
+  const __m256d s1 = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)),
+                                   _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1)));
+  return Combine(RoundToS32x4(s0), RoundToS32x4(s1));
+}
+
+inline __m256 ScaleFltx8(__m256 x, __m256i gain) {
+  const __m256 g = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(gain, 16)), _mm256_set1_ps(1.0f / 16384.0f));
+  return _mm256_mul_ps(x, g);
+}
+
+void ScaleS16Avx2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  __m256i gain_a = GainLanes(start, step, 0, 1, 2, 3, 8, 9, 10, 11);
+  __m256i gain_b = GainLanes(start, step, 4, 5, 6, 7, 12, 13, 14, 15);
+  const __m256i inc = _mm256_set1_epi32(GainAt(0, step, 16));
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), ScaleS16x16(x, gain_a, gain_b));
+    gain_a = _mm256_add_epi32(gain_a, inc);
+    gain_b = _mm256_add_epi32(gain_b, inc);
+  }
+  ScaleS16Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void MixS16Avx2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  __m256i gain_a = GainLanes(start, step, 0, 1, 2, 3, 8, 9, 10, 11);
+  __m256i gain_b = GainLanes(start, step, 4, 5, 6, 7, 12, 13, 14, 15);
+  const __m256i inc = _mm256_set1_epi32(GainAt(0, step, 16));
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_adds_epi16(d, ScaleS16x16(x, gain_a, gain_b)));
+    gain_a = _mm256_add_epi32(gain_a, inc);
+    gain_b = _mm256_add_epi32(gain_b, inc);
+  }
+  MixS16Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void ScaleS32Avx2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  __m256i gain = GainLanes(start, step, 0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i inc = _mm256_set1_epi32(GainAt(0, step, 8));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), ScaleS32x8(x, gain));
+    gain = _mm256_add_epi32(gain, inc);
+  }
+  ScaleS32Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void MixS32Avx2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  __m256i gain = GainLanes(start, step, 0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i inc = _mm256_set1_epi32(GainAt(0, step, 8));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), AddS32x8(d, ScaleS32x8(x, gain)));
+    gain = _mm256_add_epi32(gain, inc);
+  }
+  MixS32Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void ScaleFltAvx2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  float* out = static_cast<float*>(dst);
+  const float* in = static_cast<const float*>(src);
+  __m256i gain = GainLanes(start, step, 0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i inc = _mm256_set1_epi32(GainAt(0, step, 8));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_ps(out + i, ScaleFltx8(_mm256_loadu_ps(in + i), gain));
+    gain = _mm256_add_epi32(gain, inc);
+  }
+  ScaleFltScalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void MixFltAvx2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  float* out = static_cast<float*>(dst);
+  const float* in = static_cast<const float*>(src);
+  __m256i gain = GainLanes(start, step, 0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i inc = _mm256_set1_epi32(GainAt(0, step, 8));
+  const __m256 min = _mm256_set1_ps(-1.0f);
+  const __m256 max = _mm256_set1_ps(1.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256 val = _mm256_add_ps(_mm256_loadu_ps(out + i), ScaleFltx8(_mm256_loadu_ps(in + i), gain));
+    _mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(val, min), max));
+    gain = _mm256_add_epi32(gain, inc);
+  }
+  MixFltScalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void S16ToFltAvx2(void* dst, const void* src, size_t count) {
+  float* out = static_cast<float*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+  }
+  S16ToFltScalar(out + i, in + i, count - i);
+}
+
+void FltToS16Avx2(void* dst, const void* src, size_t count) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const float* in = static_cast<const float*>(src);
+  const __m256 scale = _mm256_set1_ps(32768.0f);
+  const __m256 min = _mm256_set1_ps(-32768.0f);
+  const __m256 max = _mm256_set1_ps(32767.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256 val = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), min), max);
+    const __m256i r = _mm256_cvtps_epi32(val);
+    const __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+  }
+  FltToS16Scalar(out + i, in + i, count - i);
+}
+
+void S32ToFltAvx2(void* dst, const void* src, size_t count) {
+  float* out = static_cast<float*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+  }
+  S32ToFltScalar(out + i, in + i, count - i);
+}
+
+void FltToS32Avx2(void* dst, const void* src, size_t count) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const float* in = static_cast<const float*>(src);
+  const __m256 scale = _mm256_set1_ps(2147483648.0f);
+  const __m256 min = _mm256_set1_ps(-2147483648.0f);
+  const __m256 max = _mm256_set1_ps(2147483520.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256 val = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), min), max);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_cvtps_epi32(val));
+  }
+  FltToS32Scalar(out + i, in + i, count - i);
+}
+
+const Kernels avx2_kernels = {{ScaleS16Avx2, ScaleS32Avx2, ScaleFltAvx2},
+                              {MixS16Avx2, MixS32Avx2, MixFltAvx2},
+                              S16ToFltAvx2,
+                              FltToS16Avx2,
+                              S32ToFltAvx2,
+                              FltToS32Avx2};
+
+}  // namespace
+
+const Kernels* GetAvx2Kernels() {
+  return &avx2_kernels;
+}
+
+}  // namespace dsp
+}  // namespace media
+}  // namespace fastoplayer
+#endif
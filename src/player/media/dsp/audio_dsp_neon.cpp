@@ -0,0 +1,250 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/dsp/audio_dsp_kernels.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+namespace fastoplayer {
+namespace media {
+namespace dsp {
+
+namespace {
+
+inline int32x4_t GainLanes(gain_t start, gain_t step) {
+  const int32_t lanes[4] = {GainAt(start, step, 0), GainAt(start, step, 1), GainAt(start, step, 2),
+                            GainAt(start, step, 3)};
+  return vld1q_s32(lanes);
+}
+
+// vmaxq/vminq propagate NaN, select explicitly to behave like the scalar reference
+inline float32x4_t MaxF(float32x4_t a, float32x4_t b) {
+  return vbslq_f32(vcgtq_f32(a, b), a, b);
+}
+
+inline float32x4_t MinF(float32x4_t a, float32x4_t b) {
+  return vbslq_f32(vcltq_f32(a, b), a, b);
+}
+
+// round to nearest even, like lrintf with the default rounding mode
+inline int32x4_t RoundToS32(float32x4_t val) {
+#if defined(__aarch64__)
+  return vcvtnq_s32_f32(val);
+#else
+  // 1.5 * 2^23 trick, exact for |val| < 2^22
+  const float32x4_t magic = vdupq_n_f32(12582912.0f);
+  return vsubq_s32(vreinterpretq_s32_f32(vaddq_f32(val, magic)), vreinterpretq_s32_f32(magic));
+#endif
+}
+
+inline int16x8_t ScaleS16x8(int16x8_t x, int32x4_t gain_lo, int32x4_t gain_hi) {
+  const int16x4_t g_lo = vshrn_n_s32(gain_lo, 16);
+  const int16x4_t g_hi = vshrn_n_s32(gain_hi, 16);
+  const int32x4_t p0 = vrshrq_n_s32(vmull_s16(vget_low_s16(x), g_lo), 14);
+  const int32x4_t p1 = vrshrq_n_s32(vmull_s16(vget_high_s16(x), g_hi), 14);
+  return vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1));
+}
+
+inline float32x4_t ScaleFltx4(float32x4_t x, int32x4_t gain) {
+  const float32x4_t g = vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(gain, 16)), 1.0f / 16384.0f);
+  return vmulq_f32(x, g);
+}
+
+void ScaleS16Neon(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  int32x4_t gain_lo = GainLanes(start, step);
+  int32x4_t gain_hi = GainLanes(GainAt(start, step, 4), step);
+  const int32x4_t inc = vdupq_n_s32(GainAt(0, step, 8));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    vst1q_s16(out + i, ScaleS16x8(vld1q_s16(in + i), gain_lo, gain_hi));
+    gain_lo = vaddq_s32(gain_lo, inc);
+    gain_hi = vaddq_s32(gain_hi, inc);
+  }
+  ScaleS16Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void MixS16Neon(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  int32x4_t gain_lo = GainLanes(start, step);
+  int32x4_t gain_hi = GainLanes(GainAt(start, step, 4), step);
+  const int32x4_t inc = vdupq_n_s32(GainAt(0, step, 8));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const int16x8_t scaled = ScaleS16x8(vld1q_s16(in + i), gain_lo, gain_hi);
+    vst1q_s16(out + i, vqaddq_s16(vld1q_s16(out + i), scaled));
+    gain_lo = vaddq_s32(gain_lo, inc);
+    gain_hi = vaddq_s32(gain_hi, inc);
+  }
+  MixS16Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void ScaleFltNeon(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  float* out = static_cast<float*>(dst);
+  const float* in = static_cast<const float*>(src);
+  int32x4_t gain = GainLanes(start, step);
+  const int32x4_t inc = vdupq_n_s32(GainAt(0, step, 4));
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    vst1q_f32(out + i, ScaleFltx4(vld1q_f32(in + i), gain));
+    gain = vaddq_s32(gain, inc);
+  }
+  ScaleFltScalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void MixFltNeon(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  float* out = static_cast<float*>(dst);
+  const float* in = static_cast<const float*>(src);
+  int32x4_t gain = GainLanes(start, step);
+  const int32x4_t inc = vdupq_n_s32(GainAt(0, step, 4));
+  const float32x4_t min = vdupq_n_f32(-1.0f);
+  const float32x4_t max = vdupq_n_f32(1.0f);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const float32x4_t val = vaddq_f32(vld1q_f32(out + i), ScaleFltx4(vld1q_f32(in + i), gain));
+    vst1q_f32(out + i, MinF(MaxF(val, min), max));
+    gain = vaddq_s32(gain, inc);
+  }
+  MixFltScalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void S16ToFltNeon(void* dst, const void* src, size_t count) {
+  float* out = static_cast<float*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const int16x8_t x = vld1q_s16(in + i);
+    vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), 1.0f / 32768.0f));
+    vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), 1.0f / 32768.0f));
+  }
+  S16ToFltScalar(out + i, in + i, count - i);
+}
+
+void FltToS16Neon(void* dst, const void* src, size_t count) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const float* in = static_cast<const float*>(src);
+  const float32x4_t min = vdupq_n_f32(-32768.0f);
+  const float32x4_t max = vdupq_n_f32(32767.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const float32x4_t v0 = MinF(MaxF(vmulq_n_f32(vld1q_f32(in + i), 32768.0f), min), max);
+    const float32x4_t v1 = MinF(MaxF(vmulq_n_f32(vld1q_f32(in + i + 4), 32768.0f), min), max);
+    vst1q_s16(out + i, vcombine_s16(vqmovn_s32(RoundToS32(v0)), vqmovn_s32(RoundToS32(v1))));
+  }
+  FltToS16Scalar(out + i, in + i, count - i);
+}
+
+#if defined(__aarch64__)
+inline float64x2_t GainToF64(int32x2_t gain) {
+  return vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vshr_n_s32(gain, 16))), 1.0 / 16384.0);
+}
+
+inline int32x2_t RoundToS32x2(float64x2_t val) {
+  const float64x2_t min = vdupq_n_f64(-2147483648.0);
+  const float64x2_t max = vdupq_n_f64(2147483647.0);
+  val = vbslq_f64(vcgtq_f64(val, min), val, min);
+  val = vbslq_f64(vcltq_f64(val, max), val, max);
+  return vmovn_s64(vcvtnq_s64_f64(val));
+}
+
+inline int32x4_t ScaleS32x4(int32x4_t x, int32x4_t gain) {
+  const float64x2_t v0 = vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(x))), GainToF64(vget_low_s32(gain)));
+  const float64x2_t v1 = vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(x))), GainToF64(vget_high_s32(gain)));
+  return vcombine_s32(RoundToS32x2(v0), RoundToS32x2(v1));
+}
+
+void ScaleS32Neon(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  int32x4_t gain = GainLanes(start, step);
+  const int32x4_t inc = vdupq_n_s32(GainAt(0, step, 4));
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    vst1q_s32(out + i, ScaleS32x4(vld1q_s32(in + i), gain));
+    gain = vaddq_s32(gain, inc);
+  }
+  ScaleS32Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void MixS32Neon(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  int32x4_t gain = GainLanes(start, step);
+  const int32x4_t inc = vdupq_n_s32(GainAt(0, step, 4));
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const int32x4_t scaled = ScaleS32x4(vld1q_s32(in + i), gain);
+    // both operands are 32 bit, the saturating add is exact
+    vst1q_s32(out + i, vqaddq_s32(vld1q_s32(out + i), scaled));
+    gain = vaddq_s32(gain, inc);
+  }
+  MixS32Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void S32ToFltNeon(void* dst, const void* src, size_t count) {
+  float* out = static_cast<float*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(in + i)), 1.0f / 2147483648.0f));
+  }
+  S32ToFltScalar(out + i, in + i, count - i);
+}
+
+void FltToS32Neon(void* dst, const void* src, size_t count) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const float* in = static_cast<const float*>(src);
+  const float32x4_t min = vdupq_n_f32(-2147483648.0f);
+  const float32x4_t max = vdupq_n_f32(2147483520.0f);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const float32x4_t val = MinF(MaxF(vmulq_n_f32(vld1q_f32(in + i), 2147483648.0f), min), max);
+    vst1q_s32(out + i, RoundToS32(val));
+  }
+  FltToS32Scalar(out + i, in + i, count - i);
+}
+
+const Kernels neon_kernels = {{ScaleS16Neon, ScaleS32Neon, ScaleFltNeon},
+                              {MixS16Neon, MixS32Neon, MixFltNeon},
+                              S16ToFltNeon,
+                              FltToS16Neon,
+                              S32ToFltNeon,
+                              FltToS32Neon};
+#else
+// armv7 has no double precision simd and no round to nearest conversion wide enough for s32
+const Kernels neon_kernels = {{ScaleS16Neon, ScaleS32Scalar, ScaleFltNeon},
+                              {MixS16Neon, MixS32Scalar, MixFltNeon},
+                              S16ToFltNeon,
+                              FltToS16Neon,
+                              S32ToFltScalar,
+                              FltToS32Scalar};
+#endif
+
+}  // namespace
+
+const Kernels* GetNeonKernels() {
+  return &neon_kernels;
+}
+
+}  // namespace dsp
+}  // namespace media
+}  // namespace fastoplayer
+#endif
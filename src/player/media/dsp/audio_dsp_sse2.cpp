@@ -0,0 +1,239 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/dsp/audio_dsp_kernels.h>
+
+#if defined(HAVE_AUDIO_DSP_X86)
+#include <emmintrin.h>
+
+namespace fastoplayer {
+namespace media {
+namespace dsp {
+
+namespace {
+
+// gains of 4 consecutive samples
+inline __m128i GainLanes(gain_t start, gain_t step) {
+  return _mm_setr_epi32(GainAt(start, step, 0), GainAt(start, step, 1), GainAt(start, step, 2),
+                        GainAt(start, step, 3));
+}
+
+inline __m128i ScaleS16x8(__m128i x, __m128i gain_lo, __m128i gain_hi) {
+  const __m128i g = _mm_packs_epi32(_mm_srai_epi32(gain_lo, 16), _mm_srai_epi32(gain_hi, 16));
+  const __m128i lo = _mm_mullo_epi16(x, g);
+  const __m128i hi = _mm_mulhi_epi16(x, g);
+  const __m128i round = _mm_set1_epi32(1 << 13);
+  const __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 14);
+  const __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 14);
+  return _mm_packs_epi32(p0, p1);
+}
+
+inline __m128d GainToPd(__m128i gain) {
+  return _mm_mul_pd(_mm_cvtepi32_pd(_mm_srai_epi32(gain, 16)), _mm_set1_pd(1.0 / 16384.0));
+}
+
+inline __m128i RoundToS32x2(__m128d val) {
+  val = _mm_min_pd(_mm_max_pd(val, _mm_set1_pd(-2147483648.0)), _mm_set1_pd(2147483647.0));
+  return _mm_cvtpd_epi32(val);
+}
+
+inline __m128i ScaleS32x4(__m128i x, __m128i gain) {
+  const __m128d g0 = GainToPd(gain);
+  const __m128d g1 = GainToPd(_mm_shuffle_epi32(gain, _MM_SHUFFLE(3, 2, 3, 2)));
+  const __m128d v0 = _mm_mul_pd(_mm_cvtepi32_pd(x), g0);
+  const __m128d v1 = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, _MM_SHUFFLE(3, 2, 3, 2))), g1);
+  return _mm_unpacklo_epi64(RoundToS32x2(v0), RoundToS32x2(v1));
+}
+
+inline __m128i AddS32x4(__m128i a, __m128i b) {
+  const __m128d s0 = _mm_add_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b));
+  const __m128d s1 = _mm_add_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(a, _MM_SHUFFLE(3, 2, 3, 2))),
+                                _mm_cvtepi32_pd(_mm_shuffle_epi32(b, _MM_SHUFFLE(3, 2, 3, 2))));
+  return _mm_unpacklo_epi64(RoundToS32x2(s0), RoundToS32x2(s1));
+}
+
+inline __m128 ScaleFltx4(__m128 x, __m128i gain) {
+  const __m128 g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(gain, 16)), _mm_set1_ps(1.0f / 16384.0f));
+  return _mm_mul_ps(x, g);
+}
+
+void ScaleS16Sse2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  __m128i gain_lo = GainLanes(start, step);
+  __m128i gain_hi = GainLanes(GainAt(start, step, 4), step);
+  const __m128i inc = _mm_set1_epi32(GainAt(0, step, 8));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), ScaleS16x8(x, gain_lo, gain_hi));
+    gain_lo = _mm_add_epi32(gain_lo, inc);
+    gain_hi = _mm_add_epi32(gain_hi, inc);
+  }
+  ScaleS16Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void MixS16Sse2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  __m128i gain_lo = GainLanes(start, step);
+  __m128i gain_hi = GainLanes(GainAt(start, step, 4), step);
+  const __m128i inc = _mm_set1_epi32(GainAt(0, step, 8));
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_adds_epi16(d, ScaleS16x8(x, gain_lo, gain_hi)));
+    gain_lo = _mm_add_epi32(gain_lo, inc);
+    gain_hi = _mm_add_epi32(gain_hi, inc);
+  }
+  MixS16Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void ScaleS32Sse2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  __m128i gain = GainLanes(start, step);
+  const __m128i inc = _mm_set1_epi32(GainAt(0, step, 4));
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), ScaleS32x4(x, gain));
+    gain = _mm_add_epi32(gain, inc);
+  }
+  ScaleS32Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void MixS32Sse2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  __m128i gain = GainLanes(start, step);
+  const __m128i inc = _mm_set1_epi32(GainAt(0, step, 4));
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), AddS32x4(d, ScaleS32x4(x, gain)));
+    gain = _mm_add_epi32(gain, inc);
+  }
+  MixS32Scalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void ScaleFltSse2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  float* out = static_cast<float*>(dst);
+  const float* in = static_cast<const float*>(src);
+  __m128i gain = GainLanes(start, step);
+  const __m128i inc = _mm_set1_epi32(GainAt(0, step, 4));
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(out + i, ScaleFltx4(_mm_loadu_ps(in + i), gain));
+    gain = _mm_add_epi32(gain, inc);
+  }
+  ScaleFltScalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void MixFltSse2(void* dst, const void* src, size_t count, gain_t start, gain_t step) {
+  float* out = static_cast<float*>(dst);
+  const float* in = static_cast<const float*>(src);
+  __m128i gain = GainLanes(start, step);
+  const __m128i inc = _mm_set1_epi32(GainAt(0, step, 4));
+  const __m128 min = _mm_set1_ps(-1.0f);
+  const __m128 max = _mm_set1_ps(1.0f);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128 val = _mm_add_ps(_mm_loadu_ps(out + i), ScaleFltx4(_mm_loadu_ps(in + i), gain));
+    _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(val, min), max));
+    gain = _mm_add_epi32(gain, inc);
+  }
+  MixFltScalar(out + i, in + i, count - i, GainAt(start, step, i), step);
+}
+
+void S16ToFltSse2(void* dst, const void* src, size_t count) {
+  float* out = static_cast<float*>(dst);
+  const int16_t* in = static_cast<const int16_t*>(src);
+  const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+  }
+  S16ToFltScalar(out + i, in + i, count - i);
+}
+
+void FltToS16Sse2(void* dst, const void* src, size_t count) {
+  int16_t* out = static_cast<int16_t*>(dst);
+  const float* in = static_cast<const float*>(src);
+  const __m128 scale = _mm_set1_ps(32768.0f);
+  const __m128 min = _mm_set1_ps(-32768.0f);
+  const __m128 max = _mm_set1_ps(32767.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128 v0 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), min), max);
+    const __m128 v1 = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), min), max);
+    const __m128i r = _mm_packs_epi32(_mm_cvtps_epi32(v0), _mm_cvtps_epi32(v1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), r);
+  }
+  FltToS16Scalar(out + i, in + i, count - i);
+}
+
+void S32ToFltSse2(void* dst, const void* src, size_t count) {
+  float* out = static_cast<float*>(dst);
+  const int32_t* in = static_cast<const int32_t*>(src);
+  const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+  }
+  S32ToFltScalar(out + i, in + i, count - i);
+}
+
+void FltToS32Sse2(void* dst, const void* src, size_t count) {
+  int32_t* out = static_cast<int32_t*>(dst);
+  const float* in = static_cast<const float*>(src);
+  const __m128 scale = _mm_set1_ps(2147483648.0f);
+  const __m128 min = _mm_set1_ps(-2147483648.0f);
+  const __m128 max = _mm_set1_ps(2147483520.0f);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128 val = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), min), max);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvtps_epi32(val));
+  }
+  FltToS32Scalar(out + i, in + i, count - i);
+}
+
+const Kernels sse2_kernels = {{ScaleS16Sse2, ScaleS32Sse2, ScaleFltSse2},
+                              {MixS16Sse2, MixS32Sse2, MixFltSse2},
+                              S16ToFltSse2,
+                              FltToS16Sse2,
+                              S32ToFltSse2,
+                              FltToS32Sse2};
+
+}  // namespace
+
+const Kernels* GetSse2Kernels() {
+  return &sse2_kernels;
+}
+
+}  // namespace dsp
+}  // namespace media
+}  // namespace fastoplayer
+#endif
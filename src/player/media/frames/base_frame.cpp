@@ -22,7 +22,7 @@ namespace fastoplayer {
 namespace media {
 namespace frames {
 
-BaseFrame::BaseFrame() : frame(av_frame_alloc()), pts(0), duration(0), pos(0) {}
+BaseFrame::BaseFrame() : frame(av_frame_alloc()), pts(0), duration(0), pos(0), serial(0) {}
 
 BaseFrame::~BaseFrame() {
   ClearFrame();
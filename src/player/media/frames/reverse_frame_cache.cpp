@@ -0,0 +1,268 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/frames/reverse_frame_cache.h>
+
+#include <algorithm>
+
+#include <player/media/frames/video_frame.h>
+
+namespace fastoplayer {
+namespace media {
+namespace frames {
+
+namespace {
+size_t GetFrameBytes(const AVFrame* frame) {
+  size_t size = 0;
+  for (size_t i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; ++i) {
+    size += frame->buf[i]->size;
+  }
+  for (int i = 0; i < frame->nb_extended_buf; ++i) {
+    size += frame->extended_buf[i]->size;
+  }
+  return size;
+}
+}  // namespace
+
+ReverseFrameCache::ReverseFrameCache(size_t budget_bytes)
+    : budget_(budget_bytes),
+      mutex_(),
+      cond_(),
+      pool_(),
+      showing_(),
+      filling_(),
+      shown_(nullptr),
+      filling_state_(SEGMENT_NONE),
+      filling_start_(invalid_clock()),
+      filling_end_(invalid_clock()),
+      next_end_(invalid_clock()),
+      size_(0),
+      stoped_(false),
+      release_notify_() {}
+
+ReverseFrameCache::~ReverseFrameCache() {
+  Clear(invalid_clock());
+  if (shown_) {
+    ReturnToPool(shown_);
+    shown_ = nullptr;
+  }
+  for (VideoFrame* frame : pool_) {
+    delete frame;
+  }
+}
+
+bool ReverseFrameCache::CanBeginSegment() const {
+  lock_t lock(mutex_);
+  return !stoped_ && filling_state_ == SEGMENT_NONE;
+}
+
+void ReverseFrameCache::BeginSegment(clock64_t start, clock64_t end) {
+  lock_t lock(mutex_);
+  for (VideoFrame* frame : filling_) {
+    ReturnToPool(frame);
+  }
+  filling_.clear();
+  filling_state_ = SEGMENT_OPEN;
+  filling_start_ = start;
+  filling_end_ = end;
+}
+
+clock64_t ReverseFrameCache::GetNextEnd() const {
+  lock_t lock(mutex_);
+  return next_end_;
+}
+
+bool ReverseFrameCache::IsEmpty() const {
+  lock_t lock(mutex_);
+  return showing_.empty() && filling_state_ == SEGMENT_NONE;
+}
+
+void ReverseFrameCache::Put(AVFrame* frame, clock64_t pts, clock64_t duration, int64_t pos) {
+  lock_t lock(mutex_);
+  if (!Accepts(pts)) {
+    av_frame_unref(frame);
+    return;
+  }
+
+  const size_t frame_size = GetFrameBytes(frame);
+  cond_.wait(lock, [this, frame_size]() { return HasRoom(frame_size); });
+  if (stoped_ || filling_state_ != SEGMENT_OPEN) {
+    av_frame_unref(frame);
+    return;
+  }
+
+  Store(frame, frame_size, pts, duration, pos);
+}
+
+bool ReverseFrameCache::TryPut(AVFrame* frame, clock64_t pts, clock64_t duration, int64_t pos) {
+  lock_t lock(mutex_);
+  const size_t frame_size = GetFrameBytes(frame);
+  if (!Accepts(pts) || stoped_) {
+    av_frame_unref(frame);
+    return true;
+  }
+  if (!HasRoom(frame_size)) {
+    return false;
+  }
+
+  Store(frame, frame_size, pts, duration, pos);
+  return true;
+}
+
+void ReverseFrameCache::SetReleaseNotify(notify_t notify) {
+  lock_t lock(mutex_);
+  release_notify_ = notify;
+}
+
+void ReverseFrameCache::EndSegment() {
+  lock_t lock(mutex_);
+  if (filling_state_ != SEGMENT_OPEN) {
+    return;
+  }
+
+  filling_state_ = SEGMENT_READY;
+  next_end_ = filling_start_;
+  if (showing_.empty()) {
+    SwapSegments();
+  }
+}
+
+VideoFrame* ReverseFrameCache::Peek() {
+  lock_t lock(mutex_);
+  if (showing_.empty()) {
+    SwapSegments();
+  }
+  return showing_.empty() ? nullptr : showing_.back();
+}
+
+VideoFrame* ReverseFrameCache::PeekLast() const {
+  lock_t lock(mutex_);
+  return shown_;
+}
+
+VideoFrame* ReverseFrameCache::Pop() {
+  lock_t lock(mutex_);
+  if (showing_.empty()) {
+    return nullptr;
+  }
+
+  if (shown_) {
+    ReturnToPool(shown_);
+  }
+  shown_ = showing_.back();
+  showing_.pop_back();
+  NotifyRelease();
+  return shown_;
+}
+
+void ReverseFrameCache::Clear(clock64_t next_end) {
+  lock_t lock(mutex_);
+  for (VideoFrame* frame : showing_) {
+    ReturnToPool(frame);
+  }
+  showing_.clear();
+  for (VideoFrame* frame : filling_) {
+    ReturnToPool(frame);
+  }
+  filling_.clear();
+  filling_state_ = SEGMENT_NONE;
+  next_end_ = next_end;
+  NotifyRelease();
+}
+
+void ReverseFrameCache::Stop() {
+  lock_t lock(mutex_);
+  stoped_ = true;
+  NotifyRelease();
+}
+
+size_t ReverseFrameCache::GetBudget() const {
+  return budget_;
+}
+
+size_t ReverseFrameCache::GetSize() const {
+  lock_t lock(mutex_);
+  return size_;
+}
+
+bool ReverseFrameCache::HasRoom(size_t frame_size) const {
+  /* the shown segment releases memory as it plays, without one only the earliest frames of this one can go */
+  return stoped_ || filling_state_ != SEGMENT_OPEN || size_ + frame_size <= budget_ || showing_.empty();
+}
+
+bool ReverseFrameCache::Accepts(clock64_t pts) const {
+  return filling_state_ == SEGMENT_OPEN && IsValidClock(pts) && pts >= filling_start_ && pts < filling_end_;
+}
+
+void ReverseFrameCache::Store(AVFrame* frame, size_t frame_size, clock64_t pts, clock64_t duration, int64_t pos) {
+  VideoFrame* vp = TakeFromPool();
+  vp->width = frame->width;
+  vp->height = frame->height;
+  vp->format = static_cast<AVPixelFormat>(frame->format);
+  vp->sar = frame->sample_aspect_ratio;
+  vp->pts = pts;
+  vp->duration = duration;
+  vp->pos = pos;
+  av_frame_move_ref(vp->frame, frame);
+  size_ += frame_size;
+
+  auto it = std::upper_bound(filling_.begin(), filling_.end(), pts,
+                             [](clock64_t value, const VideoFrame* fr) { return value < fr->pts; });
+  filling_.insert(it, vp);
+  while (size_ > budget_ && filling_.size() > 1) {
+    ReturnToPool(filling_.front());
+    filling_.pop_front();
+    filling_start_ = filling_.front()->pts;  // the next segment decodes the dropped frames again
+  }
+}
+
+void ReverseFrameCache::NotifyRelease() {
+  cond_.notify_all();
+  if (release_notify_) {
+    release_notify_();
+  }
+}
+
+VideoFrame* ReverseFrameCache::TakeFromPool() {
+  if (pool_.empty()) {
+    return new VideoFrame;
+  }
+
+  VideoFrame* frame = pool_.back();
+  pool_.pop_back();
+  return frame;
+}
+
+void ReverseFrameCache::ReturnToPool(VideoFrame* frame) {
+  size_ -= GetFrameBytes(frame->frame);
+  frame->ClearFrame();
+  pool_.push_back(frame);
+}
+
+void ReverseFrameCache::SwapSegments() {
+  if (filling_state_ != SEGMENT_READY) {
+    return;
+  }
+
+  showing_.swap(filling_);
+  filling_state_ = SEGMENT_NONE;
+}
+
+}  // namespace frames
+}  // namespace media
+}  // namespace fastoplayer
@@ -0,0 +1,337 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/gop_keeper.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <common/logger.h>
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+#include <player/media/av_utils.h>          // for ffmpeg_errno_to_string
+#include <player/media/teardown_service.h>  // for TeardownService
+#include <player/media/types.h>             // for make_url
+
+/* longest wait of a zap for the reader to finish its packet, a stalled input is dropped instead and the stream
+ * opens the channel itself */
+#define GOP_KEEPER_TAKE_WAIT_MSEC 100
+/* pause after a read error that is not the end, live inputs recover */
+#define GOP_KEEPER_RETRY_MSEC 10
+
+namespace fastoplayer {
+namespace media {
+
+class GopKeeper::Channel {
+ public:
+  Channel(const common::uri::GURL& uri, const AVDictionary* format_opts, size_t max_bytes)
+      : uri_(uri),
+        format_opts_(nullptr),
+        max_bytes_(max_bytes),
+        tid_(),
+        stop_(false),
+        mutex_(),
+        cond_(),
+        ready_(false),
+        ended_(false),
+        take_req_(false),
+        taken_(false),
+        ic_(nullptr),
+        gop_(),
+        gop_bytes_(0) {
+    av_dict_copy(&format_opts_, format_opts, 0);
+  }
+
+  ~Channel() {
+    Stop();
+    avformat_close_input(&ic_);
+    DropPackets();
+    av_dict_free(&format_opts_);
+  }
+
+  const common::uri::GURL& GetUri() const { return uri_; }
+
+  size_t GetHeldBytes() const { return gop_bytes_; }
+
+  void RequestStop() { stop_ = true; }  // the reader is interrupted, joined on delete
+
+  bool Start() {
+    tid_ = THREAD_MANAGER()->CreateThread(&Channel::Exec, this);
+    if (!tid_->Start()) {
+      tid_.reset();
+      return false;
+    }
+    return true;
+  }
+
+  bool Take(AVFormatContext** ic, packets_t* gop) {
+    bool taken = false;
+    {
+      lock_t lock(mutex_);
+      if (ready_ && !ended_) {
+        take_req_ = true;
+        cond_.wait_for(lock, std::chrono::milliseconds(GOP_KEEPER_TAKE_WAIT_MSEC),
+                       [this]() { return taken_ || ended_; });
+      }
+      if (taken_) {
+        *ic = ic_;
+        ic_ = nullptr;
+        gop->swap(gop_);
+        gop_bytes_ = 0;
+        taken = true;
+      }
+    }
+    return taken;
+  }
+
+ private:
+  typedef std::unique_lock<std::mutex> lock_t;
+
+  static int interrupt_callback(void* user_data) {
+    Channel* channel = static_cast<Channel*>(user_data);
+    return channel->stop_;
+  }
+
+  void Stop() {
+    stop_ = true;
+    if (tid_) {
+      tid_->Join();
+      tid_.reset();
+    }
+  }
+
+  int Exec() {
+    AVFormatContext* ic = avformat_alloc_context();
+    if (!ic) {
+      SetEnded();
+      return ERROR_RESULT_VALUE;
+    }
+
+    const std::string uri_str = make_url(uri_);
+    ic->interrupt_callback.callback = interrupt_callback;
+    ic->interrupt_callback.opaque = this;
+    AVDictionary* opts = nullptr;
+    av_dict_copy(&opts, format_opts_, 0);
+    av_dict_set(&opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
+    int ret = avformat_open_input(&ic, uri_str.c_str(), nullptr, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+      WARNING_LOG() << "Standby channel " << uri_.spec() << " can't be opened: " << ffmpeg_errno_to_string(ret);
+      SetEnded();
+      return ERROR_RESULT_VALUE;
+    }
+
+    ret = avformat_find_stream_info(ic, nullptr);
+    const int video_index = ret < 0 ? ret : av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (video_index < 0) {  // without keyframes to start from the channel opens as fast as any
+      WARNING_LOG() << "Standby channel " << uri_.spec() << " is not kept: " << ffmpeg_errno_to_string(video_index);
+      avformat_close_input(&ic);
+      SetEnded();
+      return ERROR_RESULT_VALUE;
+    }
+
+    {
+      lock_t lock(mutex_);
+      ready_ = true;
+    }
+
+    AVPacket pkt1, *pkt = &pkt1;
+    while (!stop_) {
+      {
+        lock_t lock(mutex_);
+        if (take_req_) {  // handed over between two packets, the stream goes on from where the keeper stopped
+          ic->interrupt_callback.callback = nullptr;  // this channel is deleted once taken
+          ic->interrupt_callback.opaque = nullptr;
+          ic_ = ic;
+          taken_ = true;
+          cond_.notify_all();
+          return SUCCESS_RESULT_VALUE;
+        }
+      }
+
+      ret = av_read_frame(ic, pkt);
+      if (ret < 0) {
+        if (ret == AVERROR_EOF || avio_feof(ic->pb) || (ic->pb && ic->pb->error)) {
+          break;
+        }
+        lock_t lock(mutex_);
+        cond_.wait_for(lock, std::chrono::milliseconds(GOP_KEEPER_RETRY_MSEC));
+        continue;
+      }
+
+      lock_t lock(mutex_);
+      KeepPacket(pkt, video_index);
+    }
+
+    avformat_close_input(&ic);
+    SetEnded();
+    return SUCCESS_RESULT_VALUE;
+  }
+
+  // under the mutex
+  void KeepPacket(AVPacket* pkt, int video_index) {
+    const bool keyframe = pkt->stream_index == video_index && (pkt->flags & AV_PKT_FLAG_KEY);
+    if (keyframe) {
+      DropPackets();
+    }
+    if (gop_.empty() && !keyframe) {
+      av_packet_unref(pkt);
+      return;
+    }
+    if (gop_bytes_ + pkt->size > max_bytes_) {  // the next keyframe starts over
+      DEBUG_LOG() << "Standby channel " << uri_.spec() << " GOP is over " << max_bytes_ / 1024 << " KB.";
+      DropPackets();
+      av_packet_unref(pkt);
+      return;
+    }
+
+    gop_.push_back(*pkt);
+    gop_bytes_ += pkt->size;
+  }
+
+  void DropPackets() {
+    for (AVPacket& pkt : gop_) {
+      av_packet_unref(&pkt);
+    }
+    gop_.clear();
+    gop_bytes_ = 0;
+  }
+
+  void SetEnded() {
+    lock_t lock(mutex_);
+    ended_ = true;
+    DropPackets();
+    cond_.notify_all();
+  }
+
+  const common::uri::GURL uri_;
+  AVDictionary* format_opts_;
+  const size_t max_bytes_;
+
+  std::shared_ptr<common::threads::Thread<int>> tid_;
+  std::atomic<bool> stop_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool ready_;
+  bool ended_;
+  bool take_req_;
+  bool taken_;
+  AVFormatContext* ic_;  // the input handed over
+  packets_t gop_;
+  std::atomic<size_t> gop_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(Channel);
+};
+
+GopKeeper::GopKeeper(size_t channel_max_bytes, TeardownService* teardown)
+    : channel_max_bytes_(channel_max_bytes), teardown_(teardown), channels_() {}
+
+GopKeeper::~GopKeeper() {
+  Clear();
+}
+
+void GopKeeper::SetChannels(const std::vector<common::uri::GURL>& uris, const AVDictionary* format_opts) {
+  std::vector<Channel*> channels;
+  for (const common::uri::GURL& uri : uris) {
+    Channel* channel = nullptr;
+    for (auto it = channels_.begin(); it != channels_.end(); ++it) {
+      if ((*it)->GetUri().spec() == uri.spec()) {
+        channel = *it;
+        channels_.erase(it);
+        break;
+      }
+    }
+    if (!channel) {
+      bool listed = false;
+      for (Channel* kept : channels) {
+        listed = listed || kept->GetUri().spec() == uri.spec();
+      }
+      if (listed || !uri.is_valid()) {
+        continue;
+      }
+
+      channel = new Channel(uri, format_opts, channel_max_bytes_);
+      if (!channel->Start()) {
+        delete channel;
+        continue;
+      }
+    }
+    channels.push_back(channel);
+  }
+
+  for (Channel* channel : channels_) {  // the channels not listed any more
+    Dispose(channel);
+  }
+  channels_.swap(channels);
+}
+
+bool GopKeeper::Take(const common::uri::GURL& uri, AVFormatContext** ic, packets_t* gop) {
+  if (!ic || !gop) {
+    return false;
+  }
+
+  for (auto it = channels_.begin(); it != channels_.end(); ++it) {
+    Channel* channel = *it;
+    if (channel->GetUri().spec() != uri.spec()) {
+      continue;
+    }
+
+    channels_.erase(it);
+    const bool taken = channel->Take(ic, gop);
+    Dispose(channel);
+    return taken;
+  }
+  return false;
+}
+
+void GopKeeper::Clear() {
+  for (Channel* channel : channels_) {
+    Dispose(channel);
+  }
+  channels_.clear();
+}
+
+size_t GopKeeper::GetChannelsCount() const {
+  return channels_.size();
+}
+
+void GopKeeper::Dispose(Channel* channel) {
+  channel->RequestStop();
+  if (!teardown_) {
+    delete channel;
+    return;
+  }
+
+  teardown_->Post([channel]() { delete channel; }, channel->GetHeldBytes());
+}
+
+size_t GopKeeper::GetHeldBytes() const {
+  size_t bytes = 0;
+  for (const Channel* channel : channels_) {
+    bytes += channel->GetHeldBytes();
+  }
+  return bytes;
+}
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -18,10 +18,13 @@
 
 #include <player/media/packet_queue.h>
 
+#define DRAIN_PACKET_POS -2
+
 namespace fastoplayer {
 namespace media {
 
-PacketQueue::PacketQueue() : queue_(), size_(0), duration_(0), abort_request_(true), cond_(), mutex_() {}
+PacketQueue::PacketQueue()
+    : queue_(), size_(0), duration_(0), serial_(0), abort_request_(true), notify_(), cond_(), mutex_() {}
 
 int PacketQueue::PutNullpacket(int stream_index) {
   AVPacket pkt1, *pkt = &pkt1;
@@ -29,7 +32,44 @@ int PacketQueue::PutNullpacket(int stream_index) {
   pkt->data = nullptr;
   pkt->size = 0;
   pkt->stream_index = stream_index;
-  return PushFront(pkt);
+
+  lock_t lock(mutex_);
+  if (abort_request_) {
+    return -1;
+  }
+
+  /* queued packets are superseded now, not when the decoder reaches the flush packet, so packets pushed right
+   * after this one survive */
+  ClearInner();
+  pkt->pos = ++serial_;
+  queue_.push_back(*pkt);
+  cond_.notify_one();
+  if (notify_) {
+    notify_();
+  }
+  return 0;
+}
+
+int PacketQueue::GetSerial() const {
+  return serial_;
+}
+
+int PacketQueue::GetFlushSerial(const AVPacket& pkt) {
+  return static_cast<int>(pkt.pos);
+}
+
+int PacketQueue::PutDrainPacket(int stream_index) {
+  AVPacket pkt1, *pkt = &pkt1;
+  av_init_packet(pkt);
+  pkt->data = nullptr;
+  pkt->size = 0;
+  pkt->pos = DRAIN_PACKET_POS;
+  pkt->stream_index = stream_index;
+  return PushBack(pkt);
+}
+
+bool PacketQueue::IsDrainPacket(const AVPacket& pkt) {
+  return pkt.data == nullptr && pkt.pos == DRAIN_PACKET_POS;
 }
 
 bool PacketQueue::Get(AVPacket* pkt) {
@@ -52,6 +92,31 @@ bool PacketQueue::Get(AVPacket* pkt) {
   return true;
 }
 
+int PacketQueue::TryGet(AVPacket* pkt) {
+  if (!pkt) {
+    return -1;
+  }
+
+  lock_t lock(mutex_);
+  if (abort_request_) {
+    return -1;
+  }
+  if (queue_.empty()) {
+    return 0;
+  }
+
+  *pkt = queue_[0];
+  queue_.pop_front();
+  size_ -= pkt->size;
+  duration_ -= pkt->duration;
+  return 1;
+}
+
+void PacketQueue::SetNotify(notify_t notify) {
+  lock_t lock(mutex_);
+  notify_ = notify;
+}
+
 bool PacketQueue::IsAborted() {
   lock_t lock(mutex_);
   return abort_request_;
@@ -80,20 +145,6 @@ int PacketQueue::Put(AVPacket* pkt) {
   return PushBack(pkt);
 }
 
-int PacketQueue::PushFront(AVPacket* pkt) {
-  lock_t lock(mutex_);
-  if (abort_request_) {
-    av_packet_unref(pkt);
-    return -1;
-  }
-
-  queue_.push_front(*pkt);
-  size_ += pkt->size;
-  duration_ += pkt->duration;
-  cond_.notify_one();
-  return 0;
-}
-
 int PacketQueue::PushBack(AVPacket* pkt) {
   lock_t lock(mutex_);
   if (abort_request_) {
@@ -105,11 +156,18 @@ int PacketQueue::PushBack(AVPacket* pkt) {
   size_ += pkt->size;
   duration_ += pkt->duration;
   cond_.notify_one();
+  if (notify_) {
+    notify_();
+  }
   return 0;
 }
 
 void PacketQueue::Flush() {
   lock_t lock(mutex_);
+  ClearInner();
+}
+
+void PacketQueue::ClearInner() {
   for (auto it = queue_.begin(); it != queue_.end(); ++it) {
     AVPacket pkt = *it;
     av_packet_unref(&pkt);
@@ -123,6 +181,9 @@ void PacketQueue::Abort() {
   lock_t lock(mutex_);
   abort_request_ = true;
   cond_.notify_one();
+  if (notify_) {
+    notify_();
+  }
 }
 
 PacketQueue::~PacketQueue() {
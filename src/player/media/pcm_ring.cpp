@@ -0,0 +1,229 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/media/pcm_ring.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+/* the consumer wakes the producer without the mutex, a wakeup racing with the producer going to sleep is lost and
+ * the producer looks again after this if no read repeats it */
+#define PCM_RING_WAIT_MSEC 10
+
+namespace fastoplayer {
+namespace media {
+
+PcmRing::PcmRing(size_t capacity)
+    : data_(new uint8_t[capacity]),
+      capacity_(capacity),
+      write_pos_(0),
+      read_pos_(0),
+      mark_seq_(0),
+      mark_pos_(0),
+      mark_clock_(invalid_clock()),
+      mark_serial_(0),
+      mark_serial_pos_(0),
+      write_serial_(0),
+      write_serial_pos_(0),
+      drop_serial_(-1),
+      drop_pos_(0),
+      wait_size_(0),
+      notifying_(false),
+      notify_(),
+      stopped_(false),
+      cond_(),
+      mutex_() {}
+
+PcmRing::~PcmRing() {
+  delete[] data_;
+}
+
+size_t PcmRing::GetCapacity() const {
+  return capacity_;
+}
+
+size_t PcmRing::GetReadable() const {
+  const uint64_t rpos = read_pos_.load();  // first, it never passes the write position loaded after it
+  return write_pos_.load() - rpos;
+}
+
+size_t PcmRing::GetWritable() const {
+  return capacity_ - GetReadable();
+}
+
+bool PcmRing::IsEmpty() const {
+  return GetReadable() == 0;
+}
+
+bool PcmRing::WaitWritable(size_t size) {
+  if (size > capacity_) {
+    return false;
+  }
+
+  lock_t lock(mutex_);
+  while (!stopped_ && GetWritable() < size) {
+    wait_size_.store(size);
+    if (GetWritable() >= size) {  // read before the size was seen
+      break;
+    }
+    cond_.wait_for(lock, std::chrono::milliseconds(PCM_RING_WAIT_MSEC));
+  }
+  wait_size_.store(0);
+  return !stopped_;
+}
+
+bool PcmRing::ArmWritable(size_t size) {
+  if (stopped_ || GetWritable() >= size) {
+    wait_size_.store(0);
+    return true;
+  }
+
+  wait_size_.store(size);
+  if (GetWritable() < size) {
+    return false;
+  }
+
+  wait_size_.store(0);  // the room was made meanwhile, a notify from it just runs the producer once more
+  return true;
+}
+
+void PcmRing::SetNotify(notify_t notify) {
+  lock_t lock(mutex_);
+  while (notifying_) {
+    std::this_thread::yield();
+  }
+  notify_ = notify;
+}
+
+bool PcmRing::Write(const uint8_t* data, size_t size, clock64_t end_clock, int serial) {
+  const uint64_t wpos = write_pos_.load(std::memory_order_relaxed);
+  if (GetWritable() < size) {
+    return false;
+  }
+
+  const size_t offset = wpos % capacity_;
+  const size_t first = std::min(size, capacity_ - offset);
+  memcpy(data_ + offset, data, first);
+  memcpy(data_, data + first, size - first);
+
+  if (serial != write_serial_) {
+    write_serial_ = serial;
+    write_serial_pos_ = wpos;
+  }
+  /* the consumer reads up to the mark, which never gets ahead of write_pos_ */
+  write_pos_.store(wpos + size);
+  mark_seq_.fetch_add(1);
+  mark_pos_.store(wpos + size);
+  mark_clock_.store(end_clock);
+  mark_serial_.store(write_serial_);
+  mark_serial_pos_.store(write_serial_pos_);
+  mark_seq_.fetch_add(1);
+  return true;
+}
+
+void PcmRing::Stop() {
+  lock_t lock(mutex_);
+  stopped_ = true;
+  cond_.notify_all();
+}
+
+bool PcmRing::IsStopped() const {
+  return stopped_;
+}
+
+size_t PcmRing::Read(uint8_t* out, size_t size) {
+  const WriteMark mark = LoadMark();
+  uint64_t rpos = read_pos_.load(std::memory_order_relaxed);
+  if (drop_serial_ != -1 && mark.serial != drop_serial_) {  // written before the producer saw the flush
+    rpos = std::max(rpos, mark.pos);
+  } else {
+    rpos = std::max(rpos, mark.serial_pos);
+  }
+
+  size = std::min(size, static_cast<size_t>(std::max(mark.pos, rpos) - rpos));
+  if (size) {
+    const size_t offset = rpos % capacity_;
+    const size_t first = std::min(size, capacity_ - offset);
+    memcpy(out, data_ + offset, first);
+    memcpy(out + first, data_, size - first);
+  }
+  if (rpos + size != read_pos_.load(std::memory_order_relaxed)) {
+    read_pos_.store(rpos + size);
+    NotifyProducer();
+  }
+  return size;
+}
+
+void PcmRing::Drop(int serial) {
+  const WriteMark mark = LoadMark();
+  drop_serial_ = serial;
+  drop_pos_ = mark.pos;
+  if (mark.pos > read_pos_.load(std::memory_order_relaxed)) {
+    read_pos_.store(mark.pos);
+    NotifyProducer();
+  }
+}
+
+clock64_t PcmRing::GetReadClock(int bytes_per_sec) const {
+  const WriteMark mark = LoadMark();
+  if (!IsValidClock(mark.clock) || bytes_per_sec <= 0 || mark.pos <= drop_pos_) {
+    return invalid_clock();
+  }
+  if (drop_serial_ != -1 && mark.serial != drop_serial_) {
+    return invalid_clock();
+  }
+
+  const uint64_t rpos = std::max(read_pos_.load(std::memory_order_relaxed), mark.serial_pos);
+  const int64_t ahead = static_cast<int64_t>(mark.pos - rpos);
+  return mark.clock - ahead * 1000 / bytes_per_sec;
+}
+
+PcmRing::WriteMark PcmRing::LoadMark() const {
+  WriteMark mark;
+  uint32_t seq = 0;
+  do {
+    seq = mark_seq_.load();
+    mark.pos = mark_pos_.load();
+    mark.clock = mark_clock_.load();
+    mark.serial = mark_serial_.load();
+    mark.serial_pos = mark_serial_pos_.load();
+  } while ((seq & 1) || seq != mark_seq_.load());
+  return mark;
+}
+
+void PcmRing::NotifyProducer() {
+  /* every read repeats it until the producer takes the room, a lost wakeup is made up by the next period */
+  const size_t size = wait_size_.load();
+  if (!size || GetWritable() < size) {
+    return;
+  }
+
+  cond_.notify_one();
+  notifying_ = true;
+  if (!stopped_ && notify_) {
+    notify_();
+  }
+  notifying_ = false;
+}
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -116,6 +116,14 @@ void Stream::SetPaused(bool pause) {
   start_ts_ = 0;
 }
 
+void Stream::SetClockSpeed(double speed) {
+  clock_->SetSpeed(speed);
+}
+
+double Stream::GetClockSpeed() const {
+  return clock_->GetSpeed();
+}
+
 clock64_t Stream::LastUpdatedClock() const {
   return clock_->LastUpdated();
 }
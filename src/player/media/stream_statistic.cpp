@@ -42,6 +42,12 @@ Stats::Stats()
       video_bandwidth(0),
       audio_bandwidth(0),
       active_hwaccel(HWDEVICE_TYPE_NONE),
+      audio_underruns(0),
+      audio_underrun_msec(0),
+      audio_latency_msec(0),
+      audio_path(AUDIO_PATH_NONE),
+      audio_convert_load(0),
+      cpu_load(0),
       start_ts_(common::time::current_utc_mstime()) {}
 
 clock64_t Stats::GetDiffStreams() const {
@@ -78,5 +84,18 @@ std::string ConvertStreamFormatToString(stream_format_t fmt) {
   return UNKNOWN_STREAM_TEXT;
 }
 
+std::string ConvertAudioPathToString(AudioPath path) {
+  switch (path) {
+    case AUDIO_PATH_DIRECT:
+      return "direct";
+    case AUDIO_PATH_INTERLEAVE:
+      return "interleave";
+    case AUDIO_PATH_RESAMPLE:
+      return "resample";
+    default:
+      return "none";
+  }
+}
+
 }  // namespace media
 }  // namespace fastoplayer
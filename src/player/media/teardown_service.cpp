@@ -0,0 +1,146 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/teardown_service.h>
+
+#include <algorithm>
+
+#include <common/logger.h>
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+namespace fastoplayer {
+namespace media {
+
+TeardownService::TeardownService(size_t threads_count)
+    : threads_count_(std::max<size_t>(threads_count, 1)),
+      workers_(),
+      mutex_(),
+      cond_(),
+      queue_(),
+      pending_(0),
+      held_bytes_(0),
+      peak_held_bytes_(0),
+      stop_(true) {}
+
+TeardownService::~TeardownService() {
+  Stop();
+}
+
+bool TeardownService::Start() {
+  if (!workers_.empty()) {
+    return true;
+  }
+
+  {
+    lock_t lock(mutex_);
+    stop_ = false;
+  }
+  for (size_t i = 0; i < threads_count_; ++i) {
+    auto tid = THREAD_MANAGER()->CreateThread(&TeardownService::WorkerRoutine, this);
+    if (!tid->Start()) {
+      Stop();
+      return false;
+    }
+    workers_.push_back(tid);
+  }
+  return true;
+}
+
+void TeardownService::Stop() {
+  {
+    lock_t lock(mutex_);
+    stop_ = true;
+    cond_.notify_all();
+  }
+  const bool started = !workers_.empty();
+  for (const auto& tid : workers_) {
+    tid->Join();
+  }
+  workers_.clear();
+
+  /* left by workers that never started */
+  lock_t lock(mutex_);
+  while (!queue_.empty()) {
+    RunNext(&lock);
+  }
+
+  if (started && peak_held_bytes_) {
+    INFO_LOG() << "Stream teardowns done, peak memory held by closing streams: " << peak_held_bytes_ / 1024 << " KB";
+  }
+}
+
+void TeardownService::Post(teardown_t teardown, size_t held_bytes) {
+  if (!teardown) {
+    DNOTREACHED();
+    return;
+  }
+
+  {
+    lock_t lock(mutex_);
+    if (!stop_) {
+      queue_.push_back({teardown, held_bytes});
+      pending_++;
+      held_bytes_ += held_bytes;
+      peak_held_bytes_ = std::max(peak_held_bytes_, held_bytes_);
+      cond_.notify_one();
+      return;
+    }
+  }
+  teardown();
+}
+
+size_t TeardownService::GetPendingCount() const {
+  lock_t lock(mutex_);
+  return pending_;
+}
+
+size_t TeardownService::GetHeldBytes() const {
+  lock_t lock(mutex_);
+  return held_bytes_;
+}
+
+size_t TeardownService::GetPeakHeldBytes() const {
+  lock_t lock(mutex_);
+  return peak_held_bytes_;
+}
+
+int TeardownService::WorkerRoutine() {
+  lock_t lock(mutex_);
+  while (true) {
+    cond_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {  // stopped with nothing left to wait for
+      break;
+    }
+
+    RunNext(&lock);
+  }
+  return 0;
+}
+
+void TeardownService::RunNext(lock_t* lock) {
+  Teardown teardown = queue_.front();
+  queue_.pop_front();
+  lock->unlock();
+  teardown.teardown();
+  lock->lock();
+  pending_--;
+  held_bytes_ -= teardown.held_bytes;
+}
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -0,0 +1,276 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/thumbnail_cache.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <common/logger.h>
+#include <common/sprintf.h>
+
+/* thumbnails per sprite sheet row */
+#define SPRITE_COLUMNS 10
+#define SPRITE_MAGIC "# fastoplayer thumbnails"
+/* a missing slot shows a generated neighbour this many slots away at most */
+#define FIND_NEIGHBOUR_SLOTS 2
+
+namespace fastoplayer {
+namespace media {
+
+namespace {
+bool ReadLine(FILE* file, std::string* line) {
+  line->clear();
+  int c;
+  while ((c = getc(file)) != EOF && c != '\n') {
+    line->push_back(static_cast<char>(c));
+  }
+  return c == '\n';
+}
+}  // namespace
+
+Thumbnail::Thumbnail(clock64_t pts, int width, int height)
+    : pts(pts), width(width), height(height), rgb(static_cast<size_t>(width) * height * 3) {}
+
+ThumbnailCache::ThumbnailCache(clock64_t start, clock64_t duration, clock64_t interval, size_t max_count)
+    : start_(start), interval_(interval), max_count_(max_count), mutex_(), slots_(), focus_(0), count_(0) {
+  CHECK(interval_ > 0);
+  const size_t slots_count = duration > 0 ? static_cast<size_t>((duration + interval_ - 1) / interval_) : 1;
+  slots_.resize(slots_count, {SLOT_MISSING, nullptr});
+}
+
+size_t ThumbnailCache::GetSlotsCount() const {
+  return slots_.size();
+}
+
+clock64_t ThumbnailCache::GetSlotPts(size_t slot) const {
+  return start_ + static_cast<clock64_t>(slot) * interval_;
+}
+
+size_t ThumbnailCache::GetSlot(clock64_t pos) const {
+  if (pos <= start_) {
+    return 0;
+  }
+
+  const size_t slot = static_cast<size_t>((pos - start_) / interval_);
+  return slot < slots_.size() ? slot : slots_.size() - 1;
+}
+
+void ThumbnailCache::SetFocus(clock64_t pos) {
+  lock_t lock(mutex_);
+  focus_ = GetSlot(pos);
+}
+
+bool ThumbnailCache::TakeNextMissing(size_t* slot) {
+  if (!slot) {
+    return false;
+  }
+
+  lock_t lock(mutex_);
+  size_t farthest = 0;
+  if (count_ >= max_count_) {
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      if (slots_[i].state == SLOT_READY) {
+        farthest = std::max(farthest, GetDistance(i));
+      }
+    }
+  }
+
+  /* outward from the focus, ahead first */
+  for (size_t distance = 0; distance < slots_.size(); ++distance) {
+    if (count_ >= max_count_ && distance >= farthest) {
+      return false;
+    }
+
+    const size_t candidates[] = {focus_ + distance, focus_ - distance};
+    for (size_t i = 0; i < (distance ? 2 : 1); ++i) {
+      const size_t candidate = candidates[i];
+      if (candidate < slots_.size() && slots_[candidate].state == SLOT_MISSING) {  // wraps below 0
+        slots_[candidate].state = SLOT_PENDING;
+        *slot = candidate;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void ThumbnailCache::Put(size_t slot, thumbnail_t thumbnail) {
+  lock_t lock(mutex_);
+  if (slot >= slots_.size()) {
+    return;
+  }
+
+  Slot& sl = slots_[slot];
+  if (sl.state == SLOT_READY) {
+    count_--;
+  }
+  sl.thumbnail = thumbnail;
+  sl.state = thumbnail ? SLOT_READY : SLOT_EMPTY;
+  if (thumbnail) {
+    count_++;
+  }
+  while (count_ > max_count_) {
+    EvictFarthest();
+  }
+}
+
+thumbnail_t ThumbnailCache::Find(clock64_t pos) const {
+  lock_t lock(mutex_);
+  const size_t slot = GetSlot(pos);
+  for (size_t distance = 0; distance <= FIND_NEIGHBOUR_SLOTS; ++distance) {
+    const size_t candidates[] = {slot - distance, slot + distance};
+    for (size_t candidate : candidates) {
+      if (candidate < slots_.size() && slots_[candidate].state == SLOT_READY) {
+        return slots_[candidate].thumbnail;
+      }
+    }
+  }
+  return nullptr;
+}
+
+size_t ThumbnailCache::GetCount() const {
+  lock_t lock(mutex_);
+  return count_;
+}
+
+bool ThumbnailCache::SaveSpriteSheet(const std::string& path) const {
+  lock_t lock(mutex_);
+  int width = 0;
+  int height = 0;
+  for (const Slot& sl : slots_) {
+    if (sl.state == SLOT_READY) {
+      width = sl.thumbnail->width;
+      height = sl.thumbnail->height;
+      break;
+    }
+  }
+  if (!width || !height) {
+    return false;
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    WARNING_LOG() << "Can't write thumbnails sprite sheet " << path;
+    return false;
+  }
+
+  const size_t columns = std::min<size_t>(SPRITE_COLUMNS, slots_.size());
+  const size_t rows = (slots_.size() + columns - 1) / columns;
+  std::string ready(slots_.size(), '0');
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    const Slot& sl = slots_[i];
+    if (sl.state == SLOT_READY && sl.thumbnail->width == width && sl.thumbnail->height == height) {
+      ready[i] = '1';
+    }
+  }
+  fprintf(file, "P6\n" SPRITE_MAGIC " %" PRId64 " %" PRId64 " %zu\n# %s\n%zu %zu\n255\n", start_, interval_,
+          slots_.size(), ready.c_str(), columns * width, rows * height);
+
+  const size_t tile_line = static_cast<size_t>(width) * 3;
+  std::vector<uint8_t> line(columns * tile_line);
+  bool ok = true;
+  for (size_t row = 0; row < rows && ok; ++row) {
+    for (int y = 0; y < height && ok; ++y) {
+      for (size_t column = 0; column < columns; ++column) {
+        const size_t slot = row * columns + column;
+        uint8_t* dst = line.data() + column * tile_line;
+        if (slot < slots_.size() && ready[slot] == '1') {
+          memcpy(dst, slots_[slot].thumbnail->rgb.data() + y * tile_line, tile_line);
+        } else {
+          memset(dst, 0, tile_line);
+        }
+      }
+      ok = fwrite(line.data(), 1, line.size(), file) == line.size();
+    }
+  }
+  fclose(file);
+  return ok;
+}
+
+bool ThumbnailCache::LoadSpriteSheet(const std::string& path, int width, int height) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+
+  /* the grid must be the one of this input and these thumbnail sizes */
+  lock_t lock(mutex_);
+  const size_t columns = std::min<size_t>(SPRITE_COLUMNS, slots_.size());
+  const size_t rows = (slots_.size() + columns - 1) / columns;
+  const std::string header =
+      common::MemSPrintf(SPRITE_MAGIC " %" PRId64 " %" PRId64 " %zu", start_, interval_, slots_.size());
+  const std::string size = common::MemSPrintf("%zu %zu", columns * width, rows * height);
+  std::string magic, grid, ready, dimensions, maxval;
+  if (!ReadLine(file, &magic) || !ReadLine(file, &grid) || !ReadLine(file, &ready) || !ReadLine(file, &dimensions) ||
+      !ReadLine(file, &maxval) || magic != "P6" || grid != header || ready.size() != slots_.size() + 2 ||
+      dimensions != size || maxval != "255") {
+    fclose(file);
+    WARNING_LOG() << "Thumbnails sprite sheet " << path << " does not match the input, ignored";
+    return false;
+  }
+
+  const size_t tile_line = static_cast<size_t>(width) * 3;
+  std::vector<uint8_t> tiles(columns * tile_line * height);
+  for (size_t row = 0; row < rows; ++row) {
+    if (fread(tiles.data(), 1, tiles.size(), file) != tiles.size()) {
+      break;
+    }
+
+    for (size_t column = 0; column < columns && count_ < max_count_; ++column) {
+      const size_t slot = row * columns + column;
+      if (slot >= slots_.size() || ready[slot + 2] != '1' || slots_[slot].state != SLOT_MISSING) {
+        continue;
+      }
+
+      std::shared_ptr<Thumbnail> thumbnail = std::make_shared<Thumbnail>(GetSlotPts(slot), width, height);
+      for (int y = 0; y < height; ++y) {
+        memcpy(thumbnail->rgb.data() + y * tile_line, tiles.data() + (y * columns + column) * tile_line, tile_line);
+      }
+      slots_[slot] = {SLOT_READY, thumbnail};
+      count_++;
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+size_t ThumbnailCache::GetDistance(size_t slot) const {
+  return slot > focus_ ? slot - focus_ : focus_ - slot;
+}
+
+void ThumbnailCache::EvictFarthest() {
+  size_t farthest = slots_.size();
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].state == SLOT_READY && (farthest == slots_.size() || GetDistance(i) > GetDistance(farthest))) {
+      farthest = i;
+    }
+  }
+  if (farthest == slots_.size()) {
+    return;
+  }
+
+  slots_[farthest] = {SLOT_MISSING, nullptr};
+  count_--;
+}
+
+}  // namespace media
+}  // namespace fastoplayer
@@ -0,0 +1,321 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/thumbnail_service.h>
+
+#include <algorithm>
+#include <chrono>
+
+extern "C" {
+#if CONFIG_SWSCALE
+#include <libswscale/swscale.h>  // for sws_getCachedContext, sws_scale
+#endif
+}
+
+#include <common/logger.h>
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+#include <player/media/av_utils.h>  // for ffmpeg_errno_to_string, is_realtime, q2d_diff
+
+/* packets read per thumbnail looking for a keyframe */
+#define THUMBNAIL_MAX_PACKETS 1024
+
+namespace fastoplayer {
+namespace media {
+
+ThumbnailOptions::ThumbnailOptions()
+    : thumbnail_width(width),
+      thumbnail_height(height),
+      interval(interval_msec),
+      cpu_share_percent(cpu_share),
+      memory_budget_mb(memory_mb),
+      sprite_path() {}
+
+ThumbnailService::ThumbnailService(const common::uri::GURL& uri, const ThumbnailOptions& opt)
+    : uri_(uri),
+      opt_(opt),
+      tid_(),
+      stop_(false),
+      avctx_(nullptr),
+      stream_index_(-1),
+      sws_ctx_(nullptr),
+      mutex_(),
+      cond_(),
+      cache_(nullptr),
+      focus_(0),
+      focus_changed_(false) {
+  opt_.cpu_share_percent = std::max(1, std::min(opt_.cpu_share_percent, 100));
+}
+
+ThumbnailService::~ThumbnailService() {
+  Stop();
+  destroy(&cache_);
+}
+
+bool ThumbnailService::Start() {
+#if CONFIG_SWSCALE
+  if (tid_) {
+    return true;
+  }
+
+  stop_ = false;
+  tid_ = THREAD_MANAGER()->CreateThread(&ThumbnailService::Exec, this);
+  if (!tid_->Start()) {
+    tid_.reset();
+    return false;
+  }
+  return true;
+#else
+  WARNING_LOG() << "Thumbnails need libswscale.";
+  return false;
+#endif
+}
+
+void ThumbnailService::Stop() {
+  if (!tid_) {
+    return;
+  }
+
+  {
+    lock_t lock(mutex_);
+    stop_ = true;
+    cond_.notify_all();
+  }
+  tid_->Join();
+  tid_.reset();
+}
+
+void ThumbnailService::SetFocus(clock64_t pos) {
+  if (!IsValidClock(pos)) {
+    return;
+  }
+
+  lock_t lock(mutex_);
+  if (pos == focus_) {
+    return;
+  }
+
+  focus_ = pos;
+  focus_changed_ = true;
+  cond_.notify_all();
+}
+
+thumbnail_t ThumbnailService::GetThumbnail(clock64_t pos) const {
+  lock_t lock(mutex_);
+  return cache_ ? cache_->Find(pos) : nullptr;
+}
+
+int ThumbnailService::decode_interrupt_callback(void* user_data) {
+  ThumbnailService* service = static_cast<ThumbnailService*>(user_data);
+  return service->stop_;
+}
+
+int ThumbnailService::Exec() {
+  AVFormatContext* ic = avformat_alloc_context();
+  if (!ic) {
+    return ERROR_RESULT_VALUE;
+  }
+
+  const std::string uri_str = make_url(uri_);
+  ic->interrupt_callback.callback = decode_interrupt_callback;
+  ic->interrupt_callback.opaque = this;
+  int ret = avformat_open_input(&ic, uri_str.c_str(), nullptr, nullptr);
+  if (ret < 0) {
+    WARNING_LOG() << "Thumbnails can't open the input: " << ffmpeg_errno_to_string(ret);
+    return ERROR_RESULT_VALUE;
+  }
+
+  ThumbnailCache* cache = OpenInput(ic);
+  if (!cache) {
+    avcodec_free_context(&avctx_);
+    avformat_close_input(&ic);
+    return ERROR_RESULT_VALUE;
+  }
+
+  if (!opt_.sprite_path.empty() && cache->LoadSpriteSheet(opt_.sprite_path, opt_.thumbnail_width,
+                                                          opt_.thumbnail_height)) {
+    INFO_LOG() << "Thumbnails loaded: " << cache->GetCount();
+  }
+  {
+    lock_t lock(mutex_);
+    cache_ = cache;
+    focus_changed_ = true;
+  }
+
+  AVFrame* frame = av_frame_alloc();
+  while (frame && !stop_) {
+    size_t slot = 0;
+    {
+      lock_t lock(mutex_);
+      if (focus_changed_) {
+        cache->SetFocus(focus_);
+        focus_changed_ = false;
+      }
+    }
+    if (!cache->TakeNextMissing(&slot)) {  // done around the focus, wait for it to move
+      lock_t lock(mutex_);
+      cond_.wait(lock, [this]() { return stop_ || focus_changed_; });
+      continue;
+    }
+
+    const clock64_t started = GetRealClockTime();
+    cache->Put(slot, Generate(ic, cache->GetSlotPts(slot), frame));
+    /* the share is enforced in time: the generator sleeps in proportion to what it worked */
+    const clock64_t work = GetRealClockTime() - started;
+    const clock64_t rest = work * (100 - opt_.cpu_share_percent) / opt_.cpu_share_percent;
+    lock_t lock(mutex_);
+    cond_.wait_for(lock, std::chrono::milliseconds(rest), [this]() { return stop_.load(); });
+  }
+
+  if (!opt_.sprite_path.empty()) {
+    cache->SaveSpriteSheet(opt_.sprite_path);
+  }
+  av_frame_free(&frame);
+#if CONFIG_SWSCALE
+  sws_freeContext(sws_ctx_);
+  sws_ctx_ = nullptr;
+#endif
+  avcodec_free_context(&avctx_);
+  avformat_close_input(&ic);
+  return SUCCESS_RESULT_VALUE;
+}
+
+ThumbnailCache* ThumbnailService::OpenInput(AVFormatContext* ic) {
+  int ret = avformat_find_stream_info(ic, nullptr);
+  if (ret < 0) {
+    WARNING_LOG() << "Thumbnails can't read the input: " << ffmpeg_errno_to_string(ret);
+    return nullptr;
+  }
+  if (is_realtime(ic) || ic->duration == AV_NOPTS_VALUE || (ic->pb && !(ic->pb->seekable & AVIO_SEEKABLE_NORMAL))) {
+    INFO_LOG() << "Thumbnails need a seekable input with a known duration.";
+    return nullptr;
+  }
+
+  stream_index_ = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+  if (stream_index_ < 0) {
+    return nullptr;
+  }
+
+  for (unsigned int i = 0; i < ic->nb_streams; ++i) {  // the demuxer skips what is not a video keyframe
+    ic->streams[i]->discard = static_cast<int>(i) == stream_index_ ? AVDISCARD_NONKEY : AVDISCARD_ALL;
+  }
+
+  AVStream* stream = ic->streams[stream_index_];
+  const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
+  if (!codec) {
+    return nullptr;
+  }
+
+  avctx_ = avcodec_alloc_context3(codec);
+  if (!avctx_ || avcodec_parameters_to_context(avctx_, stream->codecpar) < 0) {
+    return nullptr;
+  }
+
+  /* lowest resolution still above the thumbnail size */
+  int lowres = 0;
+  while (lowres < codec->max_lowres && (avctx_->width >> (lowres + 1)) >= opt_.thumbnail_width &&
+         (avctx_->height >> (lowres + 1)) >= opt_.thumbnail_height) {
+    lowres++;
+  }
+  avctx_->pkt_timebase = stream->time_base;
+  avctx_->lowres = lowres;
+  avctx_->skip_frame = AVDISCARD_NONKEY;
+  avctx_->flags2 |= AV_CODEC_FLAG2_FAST;
+  avctx_->thread_count = 1;
+  AVDictionary* opts = nullptr;
+  if (lowres) {
+    av_dict_set_int(&opts, "lowres", lowres, 0);
+  }
+  ret = avcodec_open2(avctx_, codec, &opts);
+  av_dict_free(&opts);
+  if (ret < 0) {
+    WARNING_LOG() << "Thumbnails can't open the decoder: " << ffmpeg_errno_to_string(ret);
+    return nullptr;
+  }
+
+  const clock64_t start = ic->start_time != AV_NOPTS_VALUE ? ic->start_time / (AV_TIME_BASE / 1000) : 0;
+  const clock64_t duration = ic->duration / (AV_TIME_BASE / 1000);
+  const size_t thumbnail_size = static_cast<size_t>(opt_.thumbnail_width) * opt_.thumbnail_height * 3;
+  const size_t max_count = static_cast<size_t>(opt_.memory_budget_mb) * 1024 * 1024 / thumbnail_size;
+  return new ThumbnailCache(start, duration, opt_.interval, max_count);
+}
+
+thumbnail_t ThumbnailService::Generate(AVFormatContext* ic, clock64_t pts, AVFrame* frame) {
+  /* the keyframe at or before the slot, the slot is shown by the last scene change before it */
+  const int64_t ts = pts * (AV_TIME_BASE / 1000);
+  int ret = avformat_seek_file(ic, -1, INT64_MIN, ts, ts + opt_.interval * (AV_TIME_BASE / 1000), 0);
+  if (ret < 0) {
+    return nullptr;
+  }
+
+  AVPacket pkt1, *pkt = &pkt1;
+  for (int i = 0; i < THUMBNAIL_MAX_PACKETS && !stop_; ++i) {
+    if (av_read_frame(ic, pkt) < 0) {
+      return nullptr;
+    }
+    if (pkt->stream_index != stream_index_ || !(pkt->flags & AV_PKT_FLAG_KEY)) {
+      av_packet_unref(pkt);
+      continue;
+    }
+
+    /* drained at once: the keyframe comes out without waiting for the frames it would be reordered with */
+    ret = avcodec_send_packet(avctx_, pkt);
+    av_packet_unref(pkt);
+    if (ret >= 0) {
+      avcodec_send_packet(avctx_, nullptr);
+      ret = avcodec_receive_frame(avctx_, frame);
+    }
+    avcodec_flush_buffers(avctx_);
+    if (ret < 0) {
+      continue;
+    }
+
+    const int64_t frame_pts = frame->best_effort_timestamp;
+    const AVRational tb = ic->streams[stream_index_]->time_base;
+    const clock64_t shown = IsValidPts(frame_pts) ? static_cast<clock64_t>(frame_pts * q2d_diff(tb)) : pts;
+    thumbnail_t thumbnail = Scale(frame, shown);
+    av_frame_unref(frame);
+    return thumbnail;
+  }
+  return nullptr;
+}
+
+thumbnail_t ThumbnailService::Scale(AVFrame* frame, clock64_t pts) {
+#if CONFIG_SWSCALE
+  const int width = opt_.thumbnail_width;
+  const int height = opt_.thumbnail_height;
+  sws_ctx_ = sws_getCachedContext(sws_ctx_, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                  width, height, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+  if (!sws_ctx_) {
+    return nullptr;
+  }
+
+  std::shared_ptr<Thumbnail> thumbnail = std::make_shared<Thumbnail>(pts, width, height);
+  uint8_t* dst[4] = {thumbnail->rgb.data(), nullptr, nullptr, nullptr};
+  int dst_linesize[4] = {width * 3, 0, 0, 0};
+  sws_scale(sws_ctx_, frame->data, frame->linesize, 0, frame->height, dst, dst_linesize);
+  return thumbnail;
+#else
+  UNUSED(frame);
+  UNUSED(pts);
+  return nullptr;
+#endif
+}
+
+}  // namespace media
+}  // namespace fastoplayer
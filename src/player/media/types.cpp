@@ -18,6 +18,17 @@
 
 #include <player/media/types.h>
 
+#if defined(OS_WIN)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#if defined(OS_LINUX)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include <algorithm>
 
 extern "C" {
@@ -29,6 +40,9 @@ extern "C" {
 
 #include <player/media/ffmpeg_internal.h>
 
+/* nice value of the threads with a lower priority, a stream on screen keeps most of a busy cpu */
+#define LOW_PRIORITY_THREAD_NICE 10
+
 namespace fastoplayer {
 namespace media {
 
@@ -55,6 +69,34 @@ clock64_t GetRealClockTime() {
   return GetCurrentMsec();
 }
 
+int64_t GetThreadCpuUsec() {
+#if defined(OS_WIN)
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+  const uint64_t kernel_100ns = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+  const uint64_t user_100ns = (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+  return static_cast<int64_t>((kernel_100ns + user_100ns) / 10);
+#else
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return 0;
+  }
+  return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+bool LowerThreadPriority() {
+#if defined(OS_LINUX)
+  /* per thread on linux, unprivileged threads can't raise it back */
+  const id_t tid = static_cast<id_t>(syscall(SYS_gettid));
+  return setpriority(PRIO_PROCESS, tid, LOW_PRIORITY_THREAD_NICE) == 0;
+#else
+  return false;
+#endif
+}
+
 msec_t ClockToMsec(clock64_t clock) {
   return clock;
 }
@@ -18,6 +18,11 @@
 
 #include <player/media/video_state.h>
 
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
 extern "C" {
 #include <libavcodec/avcodec.h>        // for AVCodecContext, AVCode...
 #include <libavcodec/version.h>        // for FF_API_EMU_EDGE
@@ -28,6 +33,7 @@ extern "C" {
 #include <libavutil/channel_layout.h>  // for av_get_channel_layout_...
 #include <libavutil/dict.h>            // for av_dict_free, av_dict_get
 #include <libavutil/error.h>           // for AVERROR, AVERROR_EOF
+#include <libavutil/imgutils.h>        // for av_image_get_buffer_size
 #include <libavutil/mathematics.h>     // for av_compare_ts, av_resc...
 #include <libavutil/mem.h>             // for av_freep, av_fast_malloc
 #include <libavutil/opt.h>             // for AV_OPT_SEARCH_CHILDREN
@@ -53,15 +59,18 @@ extern "C" {
 #include <player/media/app_options.h>  // for ComplexOptions, AppOpt...
 #include <player/media/av_utils.h>
 #include <player/media/decoder.h>  // for VideoDecoder, AudioDec...
+#include <player/media/dsp/audio_dsp.h>
 #include <player/media/hwaccels/ffmpeg_hw.h>
 #include <player/media/packet_queue.h>  // for PacketQueue
+#include <player/media/pcm_ring.h>
 #include <player/media/stream.h>        // for AudioStream, VideoStream
 #include <player/media/types.h>         // for clock64_t, IsValidClock
 #include <player/media/video_state_handler.h>
+#include <player/media/wakeup_counters.h>
 
-#include <player/media/frames/audio_frame.h>  // for AudioFrame
-#include <player/media/frames/frame_queue.h>  // for VideoDecoder, AudioDec...
-#include <player/media/frames/video_frame.h>  // for VideoFrame
+#include <player/media/frames/frame_queue.h>          // for VideoDecoder, AudioDec...
+#include <player/media/frames/reverse_frame_cache.h>  // for ReverseFrameCache
+#include <player/media/frames/video_frame.h>          // for VideoFrame
 
 /* no AV sync correction is done if below the minimum AV sync threshold */
 #define AV_SYNC_THRESHOLD_MIN_MSEC 40
@@ -83,17 +92,49 @@ extern "C" {
 /* TODO: We assume that a decoded and resampled frame fits into this buffer */
 #define MAX_QUEUE_SIZE (15 * 1024 * 1024)
 
+/* amount of converted audio buffered between the audio thread and the device callback */
+#define AUDIO_PCM_RING_MSEC 200
+/* consecutive frames without conversion or sync compensation before the resampler is released */
+#define AUDIO_SWR_RELEASE_FRAMES 16
+/* volume changes are ramped over this duration to avoid zipper noise */
+#define AUDIO_GAIN_RAMP_MSEC 20
+
+/* playback rate range, audio tempo filter range per instance */
+#define PLAYBACK_SPEED_MIN 0.25
+#define PLAYBACK_SPEED_MAX 4.0
+#define ATEMPO_MIN 0.5
+#define ATEMPO_MAX 2.0
+/* above this rate only reference frames are decoded */
+#define VIDEO_SKIP_NONREF_SPEED 1.5
+
+/* keyframe scan: steps per second and packets read per step looking for a keyframe, bound the work per second */
+#define TRICK_PLAY_MAX_RATE 32
+#define TRICK_PLAY_STEPS_PER_SEC 4
+#define TRICK_PLAY_MAX_PACKETS 1024
+#define TRICK_PLAY_POLL_MSEC 10
+
+/* backward playback: a coarse demuxer index can return a keyframe after the wanted one, retry further back */
+#define REVERSE_SEEK_ATTEMPTS 4
+#define REVERSE_SEEK_BACKOFF_MSEC 1000
+#define REVERSE_MAX_PACKETS 4096  // per GOP
+#define REVERSE_POLL_MSEC 10
+
+/* accurate seek: this far before the target non-reference frames are not decoded */
+#define ACCURATE_SEEK_NONREF_MSEC 1000
+
+/* seeks requested closer than this to the previous one are scrubbing: they add up from the last target and show
+ * the keyframe found first at once, packets read per preview looking for it */
+#define SEEK_SCRUB_WINDOW_MSEC 1000
+#define SEEK_PREVIEW_MAX_PACKETS 1024
+
+/* cpu load statistic averaged over this window */
+#define CPU_LOAD_WINDOW_MSEC 1000
+/* the decode budget is checked per window, the skip level changes once per window */
+#define DECODE_BUDGET_WINDOW_MSEC 500
+
 #define EXIT_LOOKUP_IF_HWACCEL_FAILED 0
 
 namespace {
-std::string ffmpeg_errno_to_string(int err) {
-  char errbuf[128];
-  if (av_strerror(err, errbuf, sizeof(errbuf)) < 0) {
-    return strerror(AVUNERROR(err));
-  }
-  return errbuf;
-}
-
 bool cmp_audio_fmts(enum AVSampleFormat fmt1,
                     int64_t channel_count1,
                     enum AVSampleFormat fmt2,
@@ -105,6 +146,16 @@ bool cmp_audio_fmts(enum AVSampleFormat fmt1,
 
   return channel_count1 != channel_count2 || fmt1 != fmt2;
 }
+
+std::string make_atempo_filters(double speed) {
+  std::string result;
+  while (speed > ATEMPO_MAX || speed < ATEMPO_MIN) {  // chain instances for the rates one can't do
+    const double step = speed > ATEMPO_MAX ? ATEMPO_MAX : ATEMPO_MIN;
+    result += common::MemSPrintf("atempo=%f,", step);
+    speed /= step;
+  }
+  return result + common::MemSPrintf("atempo=%f", speed);
+}
 }  // namespace
 
 namespace fastoplayer {
@@ -203,6 +254,47 @@ int get_buffer(AVCodecContext* s, AVFrame* frame, int flags) {
 }
 }  // namespace
 
+/* decoder loop state, on the stack of a decoder thread or kept between the steps of a pool job */
+struct VideoDecodeContext {
+  AVFrame* frame;
+#if CONFIG_AVFILTER
+  AVFilterGraph* graph;
+  AVFilterContext* filt_out;
+  AVFilterContext* filt_in;
+  int last_w;
+  int last_h;
+  enum AVPixelFormat last_format;
+#else
+  bool pending;  // decoded frame not queued yet
+#endif
+  AVRational tb;
+  AVRational frame_rate;
+  AVDiscard skip_frame;
+  AVDiscard budget_skip;
+  clock64_t budget_start;  // window of the decode budget
+  int64_t budget_cpu;
+  bool budget_capped;  // the window was used up
+  size_t drain_count;
+  size_t flush_count;
+  clock64_t seek_target;
+  clock64_t seek_skipped_pts;
+  bool preview;
+  bool reverse_held;  // frame left for want of room in the reverse cache, pool jobs only
+  clock64_t reverse_pts;
+  clock64_t reverse_duration;
+  bool ended;
+};
+
+struct AudioDecodeContext {
+  AVFrame* frame;
+#if !CONFIG_AVFILTER
+  bool pending;
+#endif
+  size_t flush_count;
+  clock64_t seek_target;
+  bool ended;
+};
+
 VideoState::VideoState(stream_id id, const common::uri::GURL& uri, const AppOptions& opt, const ComplexOptions& copt)
     : id_(id),
       uri_(uri),
@@ -217,25 +309,40 @@ VideoState::VideoState(stream_id id, const common::uri::GURL& uri, const AppOpti
       viddec_(nullptr),
       auddec_(nullptr),
       video_frame_queue_(nullptr),
-      audio_frame_queue_(nullptr),
+      reverse_cache_(nullptr),
+      audio_ring_(nullptr),
       audio_clock_(0),
       audio_diff_cum_(0),
       audio_diff_avg_coef_(0),
       audio_diff_threshold_(0),
       audio_diff_avg_count_(0),
       audio_hw_buf_size_(0),
-      audio_buf_(nullptr),
       audio_buf1_(nullptr),
-      audio_buf_size_(0),
       audio_buf1_size_(0),
-      audio_buf_index_(0),
-      audio_write_buf_size_(0),
+      audio_mix_buf_(nullptr),
+      audio_mix_buf_size_(0),
+      audio_gain_(nullptr),
+      audio_volume_(100),
+      audio_flush_req_(false),
+      audio_last_pos_(-1),
+      audio_underruns_(0),
+      audio_underrun_bytes_(0),
+      audio_output_delay_bytes_(0),
       audio_src_(),
 #if CONFIG_AVFILTER
       audio_filter_src_(),
 #endif
       audio_tgt_(),
+      speed_(1.0),
+      audio_filter_speed_(1.0),
+      audio_ring_speed_(1.0),
+      audio_tempo_start_(invalid_clock()),
+      audio_flush_count_(0),
       swr_ctx_(nullptr),
+      swr_idle_frames_(0),
+      audio_path_(AUDIO_PATH_NONE),
+      audio_convert_usec_(0),
+      audio_converted_usec_(0),
       frame_timer_(0),
       frame_last_returned_time_(0),
       frame_last_filter_delay_(0),
@@ -252,17 +359,57 @@ VideoState::VideoState(stream_id id, const common::uri::GURL& uri, const AppOpti
       last_audio_stream_(invalid_stream_index),
       vdecoder_tid_(THREAD_MANAGER()->CreateThread(&VideoState::VideoThread, this)),
       adecoder_tid_(THREAD_MANAGER()->CreateThread(&VideoState::AudioThread, this)),
+      worker_pool_(),
+      task_priority_(TASK_PRIORITY_NORMAL),
+      video_job_(nullptr),
+      audio_job_(nullptr),
+      video_decode_(nullptr),
+      audio_decode_(nullptr),
+      decoder_cache_(),
+      video_cache_key_(),
+      audio_cache_key_(),
+      video_decoder_reused_(false),
+      exec_start_time_(0),
+      first_picture_queued_(false),
+      demux_source_(),
+      demux_consumer_(nullptr),
+      standby_ic_(nullptr),
+      standby_gop_(),
       paused_(false),
       last_paused_(false),
       eof_(false),
       abort_request_(false),
       stats_(new Stats),
+      cpu_usec_(0),
+      cpu_sample_usec_(0),
+      cpu_sample_time_(0),
+      decode_budget_(0),
+      video_frame_bytes_(0),
       handler_(nullptr),
       input_st_(static_cast<InputStream*>(calloc(1, sizeof(InputStream)))),
+      video_suspend_req_(false),
+      video_suspended_(false),
+      video_wait_keyframe_(false),
+      trick_rate_req_(0),
+      trick_rate_(0),
+      trick_pos_(invalid_clock()),
+      trick_next_step_(0),
+      reverse_req_(false),
+      reverse_(false),
+      reverse_at_start_(false),
+      reverse_pos_(invalid_clock()),
       seek_req_(false),
       seek_pos_(0),
       seek_rel_(0),
       seek_flags_(0),
+      seek_preview_req_(false),
+      seek_scrub_target_(invalid_clock()),
+      seek_scrub_time_(0),
+      seek_mutex_(),
+      video_preview_req_(false),
+      seek_preview_(false),
+      video_seek_target_(invalid_clock()),
+      audio_seek_target_(invalid_clock()),
       read_thread_cond_(),
       read_thread_mutex_() {
   CHECK(id_ != invalid_stream_id);
@@ -282,6 +429,11 @@ VideoState::VideoState(stream_id id, const common::uri::GURL& uri, const AppOpti
 }
 
 VideoState::~VideoState() {
+  destroy(&demux_consumer_);  // leaves the source before it can go
+  avformat_close_input(&standby_ic_);  // never run
+  for (AVPacket& pkt : standby_gop_) {
+    av_packet_unref(&pkt);
+  }
   destroy(&astream_);
   destroy(&vstream_);
 
@@ -294,6 +446,38 @@ void VideoState::SetHandler(VideoStateHandler* handler) {
   handler_ = handler;
 }
 
+void VideoState::SetWorkerPool(std::shared_ptr<WorkerPool> pool) {
+  worker_pool_ = pool;
+}
+
+void VideoState::SetTaskPriority(TaskPriority priority) {
+  task_priority_ = priority;
+}
+
+void VideoState::SetDecodeBudget(int cpu_percent) {
+  decode_budget_ = std::max(cpu_percent, 0);
+}
+
+void VideoState::SetDecoderCache(std::shared_ptr<DecoderCache> cache) {
+  decoder_cache_ = cache;
+}
+
+void VideoState::SetDemuxSource(std::shared_ptr<DemuxSource> source, int program) {
+  destroy(&demux_consumer_);
+  demux_source_ = source;
+  if (demux_source_) {
+    demux_consumer_ = demux_source_->Subscribe(program);
+  }
+}
+
+void VideoState::SetStandbyInput(AVFormatContext* ic, GopKeeper::packets_t* gop) {
+  avformat_close_input(&standby_ic_);
+  standby_ic_ = ic;
+  if (gop) {
+    standby_gop_.swap(*gop);
+  }
+}
+
 int VideoState::StreamComponentOpen(int stream_index) {
   if (stream_index == invalid_stream_index || static_cast<unsigned int>(stream_index) >= ic_->nb_streams) {
     return AVERROR(EINVAL);
@@ -324,89 +508,54 @@ int VideoState::StreamComponentOpen(int stream_index) {
     return AVERROR(EINVAL);
   }
 
-  AVCodecContext* avctx = avcodec_alloc_context3(codec);
-  if (!avctx) {
-    return AVERROR(ENOMEM);
-  }
-
-  int ret = avcodec_parameters_to_context(avctx, par);
-  if (ret < 0) {
-    avcodec_free_context(&avctx);
-    return ret;
-  }
-
-  AVRational tb = stream->time_base;
-  avctx->pkt_timebase = tb;
-
   int stream_lowres = opt_.lowres;
-  avctx->codec_id = codec->id;
   if (stream_lowres > codec->max_lowres) {
     WARNING_LOG() << "The maximum value for lowres supported by the decoder is " << codec->max_lowres;
     stream_lowres = codec->max_lowres;
   }
-  avctx->lowres = stream_lowres;
-
-#if FF_API_EMU_EDGE
-  if (stream_lowres) {
-    avctx->flags |= CODEC_FLAG_EMU_EDGE;
-  }
-#endif
-  if (opt_.fast) {
-    avctx->flags2 |= AV_CODEC_FLAG2_FAST;
-  }
-#if FF_API_EMU_EDGE
-  if (codec->capabilities & AV_CODEC_CAP_DR1) {
-    avctx->flags |= CODEC_FLAG_EMU_EDGE;
-  }
-#endif
-
-  if (avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
-    avctx->opaque = input_st_;
-    avctx->get_format = get_format;
-    avctx->get_buffer2 = get_buffer;
-    avctx->thread_safe_callbacks = 1;
-  }
 
-  AVDictionary* opts = filter_codec_opts(copt_.codec_opts, avctx->codec_id, ic_, stream, codec);
+  AVDictionary* opts = filter_codec_opts(copt_.codec_opts, codec->id, ic_, stream, codec);
   if (!av_dict_get(opts, "threads", nullptr, 0)) {
     av_dict_set(&opts, "threads", "auto", 0);
   }
   if (stream_lowres) {
     av_dict_set_int(&opts, "lowres", stream_lowres, 0);
   }
-  if (avctx->codec_type == AVMEDIA_TYPE_VIDEO || avctx->codec_type == AVMEDIA_TYPE_AUDIO) {
+  if (par->codec_type == AVMEDIA_TYPE_VIDEO || par->codec_type == AVMEDIA_TYPE_AUDIO) {
     av_dict_set(&opts, "refcounted_frames", "1", 0);
   }
 
-  if (avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
-    ret = hw_device_setup_for_decode(avctx, const_cast<AVCodec*>(codec));
+  /* a decoder left by the previous channel with the same parameters is only flushed, not opened again */
+  DecoderCache::Key cache_key;
+  if (decoder_cache_ && (par->codec_type != AVMEDIA_TYPE_VIDEO || input_st_->hwaccel_id == HWACCEL_NONE)) {
+    cache_key = DecoderCache::Key(codec, par, opts, opt_.fast ? AV_CODEC_FLAG2_FAST : 0);
+  }
+  const clock64_t open_start = GetRealClockTime();
+  AVCodecContext* avctx = decoder_cache_ ? decoder_cache_->Take(cache_key) : nullptr;
+  const bool reused = avctx != nullptr;
+  int ret = 0;
+  if (reused) {
+    avctx->pkt_timebase = stream->time_base;
+    if (avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+      avctx->opaque = input_st_;
+    }
+  } else {
+    ret = OpenCodecContext(codec, stream, stream_lowres, &opts, &avctx);
     if (ret < 0) {
-#if EXIT_LOOKUP_IF_HWACCEL_FAILED
-      avcodec_free_context(&avctx);
       av_dict_free(&opts);
       return ret;
-#else
-      input_st_->hwaccel_id = HWACCEL_NONE;
-#endif
     }
   }
-
-  ret = avcodec_open2(avctx, codec, &opts);
-  if (ret < 0) {
-    avcodec_free_context(&avctx);
-    av_dict_free(&opts);
-    return ret;
-  }
-
-  AVDictionaryEntry* t = av_dict_get(opts, "", nullptr, AV_DICT_IGNORE_SUFFIX);
-  if (t) {
-    ERROR_LOG() << "Option " << t->key << " not found.";
-    avcodec_free_context(&avctx);
-    av_dict_free(&opts);
-    return AVERROR_OPTION_NOT_FOUND;
+  const clock64_t open_msec = GetRealClockTime() - open_start;
+  DEBUG_LOG() << "Decoder " << codec->name << (reused ? " reused in " : " opened in ") << open_msec << " msec";
+  if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+    video_cache_key_ = cache_key;
+    video_decoder_reused_ = reused;
+  } else if (par->codec_type == AVMEDIA_TYPE_AUDIO) {
+    audio_cache_key_ = cache_key;
   }
 
-  int sample_rate, nb_channels;
+  int sample_rate, nb_channels, sample_fmt;
   int64_t channel_layout = 0;
   eof_ = false;
   stream->discard = AVDISCARD_DEFAULT;
@@ -416,11 +565,23 @@ int VideoState::StreamComponentOpen(int stream_index) {
     UNUSED(opened);
     PacketQueue* packet_queue = vstream_->GetQueue();
     video_frame_queue_ = new video_frame_queue_t;
+    reverse_cache_ = new frames::ReverseFrameCache(static_cast<size_t>(opt_.reverse_cache_mb) * 1024 * 1024);
     viddec_ = new VideoDecoder(avctx, packet_queue);
     viddec_->Start();
-    if (!vdecoder_tid_->Start()) {
-      destroy(&viddec_);
-      goto out;
+    if (worker_pool_) {
+      ret = StartVideoJob();
+      if (ret < 0) {
+        destroy(&viddec_);
+        goto out;
+      }
+    } else {
+      if (!vdecoder_tid_) {  // joined by a close before
+        vdecoder_tid_ = THREAD_MANAGER()->CreateThread(&VideoState::VideoThread, this);
+      }
+      if (!vdecoder_tid_->Start()) {
+        destroy(&viddec_);
+        goto out;
+      }
     }
   } else if (avctx->codec_type == AVMEDIA_TYPE_AUDIO) {
 #if CONFIG_AVFILTER
@@ -439,11 +600,13 @@ int VideoState::StreamComponentOpen(int stream_index) {
       sample_rate = av_buffersink_get_sample_rate(sink);
       nb_channels = av_buffersink_get_channels(sink);
       channel_layout = av_buffersink_get_channel_layout(sink);
+      sample_fmt = av_buffersink_get_format(sink);
     }
 #else
     sample_rate = avctx->sample_rate;
     nb_channels = avctx->channels;
     channel_layout = avctx->channel_layout;
+    sample_fmt = avctx->sample_fmt;
 #endif
 
     int audio_buff_size = 0;
@@ -454,7 +617,9 @@ int VideoState::StreamComponentOpen(int stream_index) {
     }
 
     common::Error err =
-        handler_->HandleRequestAudio(this, channel_layout, nb_channels, sample_rate, &audio_tgt_, &audio_buff_size);
+        handler_->HandleRequestAudio(this, channel_layout, nb_channels, sample_rate,
+                                     av_get_packed_sample_fmt(static_cast<AVSampleFormat>(sample_fmt)), &audio_tgt_,
+                                     &audio_buff_size);
     if (err) {
       avcodec_free_context(&avctx);
       av_dict_free(&opts);
@@ -463,8 +628,6 @@ int VideoState::StreamComponentOpen(int stream_index) {
 
     audio_hw_buf_size_ = audio_buff_size;
     audio_src_ = audio_tgt_;
-    audio_buf_size_ = 0;
-    audio_buf_index_ = 0;
 
     /* init averaging filter */
     audio_diff_avg_coef_ = exp(log(0.01) / AUDIO_DIFF_AVG_NB);
@@ -477,16 +640,33 @@ int VideoState::StreamComponentOpen(int stream_index) {
     bool opened = astream_->Open(stream_index, stream);
     UNUSED(opened);
     PacketQueue* packet_queue = astream_->GetQueue();
-    audio_frame_queue_ = new audio_frame_queue_t;
+    size_t ring_size = static_cast<size_t>(audio_tgt_.bytes_per_sec) * AUDIO_PCM_RING_MSEC / 1000;
+    ring_size = std::max(ring_size, static_cast<size_t>(audio_hw_buf_size_) * 4);
+    ring_size = ring_size / audio_tgt_.frame_size * audio_tgt_.frame_size;
+    audio_ring_ = new PcmRing(ring_size);
+    const size_t ramp_samples =
+        static_cast<size_t>(audio_tgt_.freq) * audio_tgt_.channels * AUDIO_GAIN_RAMP_MSEC / 1000;
+    audio_gain_ = new dsp::GainRamp(ramp_samples, dsp::VolumeToGain(audio_volume_.load(std::memory_order_relaxed)));
     auddec_ = new AudioDecoder(avctx, packet_queue);
     if ((ic_->iformat->flags & (AVFMT_NOBINSEARCH | AVFMT_NOGENSEARCH | AVFMT_NO_BYTE_SEEK)) &&
         !ic_->iformat->read_seek) {
       auddec_->SetStartPts(stream->start_time, stream->time_base);
     }
     auddec_->Start();
-    if (!adecoder_tid_->Start()) {
-      destroy(&auddec_);
-      goto out;
+    if (worker_pool_) {
+      ret = StartAudioJob();
+      if (ret < 0) {
+        destroy(&auddec_);
+        goto out;
+      }
+    } else {
+      if (!adecoder_tid_) {
+        adecoder_tid_ = THREAD_MANAGER()->CreateThread(&VideoState::AudioThread, this);
+      }
+      if (!adecoder_tid_->Start()) {
+        destroy(&auddec_);
+        goto out;
+      }
     }
   }
 out:
@@ -494,6 +674,77 @@ out:
   return ret;
 }
 
+int VideoState::OpenCodecContext(const AVCodec* codec,
+                                 AVStream* stream,
+                                 int lowres,
+                                 AVDictionary** opts,
+                                 AVCodecContext** out) {
+  AVCodecContext* avctx = avcodec_alloc_context3(codec);
+  if (!avctx) {
+    return AVERROR(ENOMEM);
+  }
+
+  int ret = avcodec_parameters_to_context(avctx, stream->codecpar);
+  if (ret < 0) {
+    avcodec_free_context(&avctx);
+    return ret;
+  }
+
+  AVRational tb = stream->time_base;
+  avctx->pkt_timebase = tb;
+  avctx->codec_id = codec->id;
+  avctx->lowres = lowres;
+
+#if FF_API_EMU_EDGE
+  if (lowres) {
+    avctx->flags |= CODEC_FLAG_EMU_EDGE;
+  }
+#endif
+  if (opt_.fast) {
+    avctx->flags2 |= AV_CODEC_FLAG2_FAST;
+  }
+#if FF_API_EMU_EDGE
+  if (codec->capabilities & AV_CODEC_CAP_DR1) {
+    avctx->flags |= CODEC_FLAG_EMU_EDGE;
+  }
+#endif
+
+  if (avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+    avctx->opaque = input_st_;
+    avctx->get_format = get_format;
+    avctx->get_buffer2 = get_buffer;
+    avctx->thread_safe_callbacks = 1;
+  }
+
+  if (avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+    ret = hw_device_setup_for_decode(avctx, const_cast<AVCodec*>(codec));
+    if (ret < 0) {
+#if EXIT_LOOKUP_IF_HWACCEL_FAILED
+      avcodec_free_context(&avctx);
+      return ret;
+#else
+      input_st_->hwaccel_id = HWACCEL_NONE;
+#endif
+    }
+  }
+
+  ret = avcodec_open2(avctx, codec, opts);
+  if (ret < 0) {
+    avcodec_free_context(&avctx);
+    return ret;
+  }
+
+  AVDictionaryEntry* t = av_dict_get(*opts, "", nullptr, AV_DICT_IGNORE_SUFFIX);
+  if (t) {
+    ERROR_LOG() << "Option " << t->key << " not found.";
+    avcodec_free_context(&avctx);
+    return AVERROR_OPTION_NOT_FOUND;
+  }
+
+  *out = avctx;
+  return 0;
+}
+
 void VideoState::StreamComponentClose(int stream_index) {
   if (stream_index < 0 || static_cast<unsigned int>(stream_index) >= ic_->nb_streams) {
     return;
@@ -505,10 +756,21 @@ void VideoState::StreamComponentClose(int stream_index) {
     if (video_frame_queue_) {
       video_frame_queue_->Stop();
     }
+    if (reverse_cache_) {
+      reverse_cache_->Stop();
+    }
     if (viddec_) {
       viddec_->Abort();
     }
-    if (vdecoder_tid_) {
+    if (video_job_) {
+      video_job_->Cancel();
+      vstream_->GetQueue()->SetNotify(nullptr);
+      video_frame_queue_->SetReleaseNotify(nullptr);
+      reverse_cache_->SetReleaseNotify(nullptr);
+      destroy(&video_job_);
+      FreeVideoDecode(video_decode_);
+      destroy(&video_decode_);
+    } else if (vdecoder_tid_) {
       vdecoder_tid_->Join();
       vdecoder_tid_ = nullptr;
     }
@@ -516,142 +778,531 @@ void VideoState::StreamComponentClose(int stream_index) {
       input_st_->hwaccel_uninit(viddec_->GetAvCtx());
       input_st_->hwaccel_uninit = nullptr;
     }
+    if (viddec_ && decoder_cache_) {
+      decoder_cache_->Put(video_cache_key_, viddec_->ReleaseAvCtx());
+    }
     destroy(&viddec_);
     destroy(&video_frame_queue_);
+    destroy(&reverse_cache_);
   } else if (codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-    if (audio_frame_queue_) {
-      audio_frame_queue_->Stop();
+    if (audio_ring_) {
+      audio_ring_->Stop();
     }
     auddec_->Abort();
-    if (adecoder_tid_) {
+    if (audio_job_) {
+      audio_job_->Cancel();
+      astream_->GetQueue()->SetNotify(nullptr);
+      audio_ring_->SetNotify(nullptr);
+      destroy(&audio_job_);
+      FreeAudioDecode(audio_decode_);
+      destroy(&audio_decode_);
+    } else if (adecoder_tid_) {
       adecoder_tid_->Join();
       adecoder_tid_ = nullptr;
     }
+    if (decoder_cache_) {
+      decoder_cache_->Put(audio_cache_key_, auddec_->ReleaseAvCtx());
+    }
     destroy(&auddec_);
-    destroy(&audio_frame_queue_);
+    destroy(&audio_ring_);
+    destroy(&audio_gain_);
     swr_free(&swr_ctx_);
+    swr_idle_frames_ = 0;
+    audio_path_ = AUDIO_PATH_NONE;
     av_freep(&audio_buf1_);
     audio_buf1_size_ = 0;
-    audio_buf_ = nullptr;
+    av_freep(&audio_mix_buf_);
+    audio_mix_buf_size_ = 0;
   }
   avs->discard = AVDISCARD_ALL;
 }
 
-void VideoState::StepToNextFrame() {
-  /* if the stream is paused unpause it, then step */
-  if (paused_) {
-    StreamTogglePause();
+void VideoState::SetVideoSuspended(bool suspended) {
+  if (video_suspend_req_.exchange(suspended) == suspended) {
+    return;
   }
-  step_ = true;
+
+  WakeupReadThread();
 }
 
-void VideoState::SeekNextChunk() {
-  clock64_t incr = 0;
-  if (ic_->nb_chapters <= 1) {
-    incr = 60000;
-  }
-  SeekChapter(1);
-  Seek(incr);
+bool VideoState::IsVideoSuspended() const {
+  return video_suspend_req_;
 }
 
-void VideoState::SeekPrevChunk() {
-  clock64_t incr = 0;
-  if (ic_->nb_chapters <= 1) {
-    incr = -60000;
+void VideoState::SetSpeed(double speed) {
+  speed = stable_value_in_range(speed, PLAYBACK_SPEED_MIN, PLAYBACK_SPEED_MAX);
+  if (realtime_ && speed != 1.0) {
+    WARNING_LOG() << "Playback speed can't be changed for live streams.";
+    return;
   }
-  SeekChapter(-1);
-  Seek(incr);
-}
 
-void VideoState::SeekChapter(int incr) {
-  if (!ic_->nb_chapters) {
+  if (speed_.exchange(speed) == speed) {
     return;
   }
 
-  const AVRational tb = {1, AV_TIME_BASE};  // AV_TIME_BASE_Q
-  const clock64_t pos = GetMasterClock() * AV_TIME_BASE * 1000;
-  int i;
-  /* find the current chapter */
-  for (i = 0; i < ic_->nb_chapters; i++) {
-    AVChapter* ch = ic_->chapters[i];
-    if (av_compare_ts(pos, tb, ch->start, ch->time_base) < 0) {
-      i--;
-      break;
-    }
+  /* each clock takes the speed on the thread updating it: the video one on display, the audio one on the device */
+  INFO_LOG() << "Playback speed: " << speed;
+}
+
+double VideoState::GetSpeed() const {
+  return speed_;
+}
+
+void VideoState::SetTrickPlay(int rate) {
+  rate = stable_value_in_range(rate, -TRICK_PLAY_MAX_RATE, TRICK_PLAY_MAX_RATE);
+  if (rate && (realtime_ || !vstream_->IsOpened() || video_suspend_req_ || reverse_req_)) {
+    WARNING_LOG() << "Scan needs a seekable video stream.";
+    return;
   }
 
-  i += incr;
-  unsigned int chapter = FFMAX(i, 0);
-  if (chapter >= ic_->nb_chapters) {
+  if (trick_rate_req_.exchange(rate) == rate) {
     return;
   }
 
-  DEBUG_LOG() << "Seeking to chapter " << chapter << ".";
-  int64_t poss = av_rescale_q(ic_->chapters[chapter]->start, ic_->chapters[chapter]->time_base, tb);
-  StreamSeek(poss, 0, false);
+  INFO_LOG() << "Scan rate: " << rate;
+  WakeupReadThread();
 }
 
-void VideoState::StreamSeek(int64_t pos, int64_t rel, bool seek_by_bytes) {
-  if (seek_req_) {
+int VideoState::GetTrickPlay() const {
+  return trick_rate_req_;
+}
+
+void VideoState::SetAudioDiscard(bool discard) {
+  if (!astream_->IsOpened()) {
     return;
   }
 
-  seek_pos_ = pos;
-  seek_rel_ = rel;
-  seek_flags_ &= ~AVSEEK_FLAG_BYTE;
-  if (seek_by_bytes) {
-    seek_flags_ |= AVSEEK_FLAG_BYTE;
+  AVStream* audio_st = ic_->streams[astream_->Index()];
+  if (!discard) {
+    audio_st->discard = AVDISCARD_DEFAULT;
+    return;
   }
-  seek_req_ = true;
-  read_thread_cond_.notify_one();
+
+  audio_st->discard = AVDISCARD_ALL;
+  astream_->GetQueue()->PutNullpacket(astream_->Index());
+  audio_flush_req_ = true;
 }
 
-void VideoState::Seek(clock64_t msec) {
-  if (opt_.seek_by_bytes == SEEK_BY_BYTES_ON) {
-    int64_t pos = -1;
-    if (pos < 0 && vstream_->IsOpened()) {
-      pos = video_frame_queue_->GetLastPos();
-    }
-    if (pos < 0 && astream_->IsOpened()) {
-      pos = audio_frame_queue_->GetLastPos();
-    }
-    if (pos < 0) {
-      pos = avio_tell(ic_->pb);
+void VideoState::ApplyTrickPlay(int rate) {
+  if (rate && !trick_rate_) {
+    trick_pos_ = vstream_->GetPts();
+    if (!IsValidClock(trick_pos_)) {
+      trick_pos_ = ic_->start_time != AV_NOPTS_VALUE ? ic_->start_time / 1000 : 0;
     }
+    trick_next_step_ = 0;
+    SetAudioDiscard(true);
+    vstream_->GetQueue()->PutNullpacket(vstream_->Index());
+  } else if (!rate && trick_rate_) {  // continue from the last shown keyframe
+    SetAudioDiscard(false);
+    StreamSeek(trick_pos_ * (AV_TIME_BASE / 1000), 0, false);
+  }
+  trick_rate_ = rate;
+}
 
-    int64_t incr_in_bytes = 0;
-    if (ic_->bit_rate) {
-      incr_in_bytes = (msec / 1000) * ic_->bit_rate / 8.0;
-    } else {
-      incr_in_bytes = (msec / 1000) * 180000.0;
-    }
-    pos += incr_in_bytes;
-    StreamSeek(pos, incr_in_bytes, true);
+void VideoState::TrickPlayStep() {
+  VideoStream* video_stream = vstream_;
+  PacketQueue* video_packet_queue = video_stream->GetQueue();
+  const clock64_t now = GetRealClockTime();
+  /* one step at a time: wait for the step time and for the previous keyframe to be shown */
+  if (now < trick_next_step_ || video_packet_queue->GetNbPackets() || !video_frame_queue_->IsEmpty()) {
+    const clock64_t wait = now < trick_next_step_ ? trick_next_step_ - now : TRICK_PLAY_POLL_MSEC;
+    lock_t lock(read_thread_mutex_);
+    read_thread_cond_.wait_for(lock, std::chrono::milliseconds(wait));
     return;
   }
 
-  SeekMsec(msec);
-}
+  trick_next_step_ = now + 1000 / TRICK_PLAY_STEPS_PER_SEC;
+  const clock64_t target = trick_pos_ + static_cast<clock64_t>(trick_rate_) * 1000 / TRICK_PLAY_STEPS_PER_SEC;
+  const clock64_t start = ic_->start_time != AV_NOPTS_VALUE ? ic_->start_time / 1000 : 0;
+  const bool past_end = ic_->duration != AV_NOPTS_VALUE && target > start + ic_->duration / 1000;
+  if (target < start || past_end) {
+    INFO_LOG() << "Scan reached the stream boundary.";
+    trick_rate_req_ = 0;
+    return;
+  }
 
-void VideoState::SeekMsec(clock64_t clock) {
-  clock64_t pos = GetMasterClock();
-  if (!IsValidClock(pos)) {
-    pos = seek_pos_ / AV_TIME_BASE * 1000;
+  /* the demuxer seeks on its keyframe index when it has one, the range makes every step move */
+  const int64_t ts = target * (AV_TIME_BASE / 1000);
+  const int64_t last = trick_pos_ * (AV_TIME_BASE / 1000);
+  int ret = trick_rate_ > 0 ? avformat_seek_file(ic_, -1, last + 1, ts, INT64_MAX, 0)
+                            : avformat_seek_file(ic_, -1, INT64_MIN, ts, last - 1, 0);
+  if (ret < 0) {
+    WARNING_LOG() << "Scan seek failed: " << ffmpeg_errno_to_string(ret);
+    trick_rate_req_ = 0;
+    return;
   }
-  pos += clock;
-  if (ic_->start_time != AV_NOPTS_VALUE) {  // if selected out of range move to start
-    clock64_t st = ic_->start_time / AV_TIME_BASE * 1000;
-    if (pos < st) {
-      pos = st;
+
+  AVPacket pkt1, *pkt = &pkt1;
+  for (int i = 0; i < TRICK_PLAY_MAX_PACKETS; ++i) {
+    ret = av_read_frame(ic_, pkt);
+    if (ret < 0) {
+      WARNING_LOG() << "Scan read failed: " << ffmpeg_errno_to_string(ret);
+      trick_rate_req_ = 0;
+      return;
+    }
+
+    if (pkt->stream_index == video_stream->Index() && (pkt->flags & AV_PKT_FLAG_KEY)) {
+      const int64_t pts = IsValidPts(pkt->pts) ? pkt->pts : pkt->dts;
+      trick_pos_ = IsValidPts(pts) ? pts * q2d_diff(video_stream->GetTimeBase()) : target;
+      video_stream->RegisterPacket(pkt);
+      video_packet_queue->Put(pkt);
+      video_packet_queue->PutDrainPacket(video_stream->Index());
+      return;
     }
+    av_packet_unref(pkt);
   }
 
-  int64_t pos_seek = pos * AV_TIME_BASE / 1000;
-  int64_t incr_seek = clock * AV_TIME_BASE / 1000;
-  StreamSeek(pos_seek, incr_seek, false);
+  WARNING_LOG() << "Scan found no keyframe near " << target << " msec.";
+  trick_pos_ = target;
+}
+
+void VideoState::SetReverse(bool reverse) {
+  if (reverse && (realtime_ || !vstream_->IsOpened() || video_suspend_req_ || trick_rate_req_ ||
+                  opt_.seek_by_bytes == SEEK_BY_BYTES_ON)) {
+    WARNING_LOG() << "Reverse playback needs a seekable video stream.";
+    return;
+  }
+
+  if (reverse_req_.exchange(reverse) == reverse) {
+    return;
+  }
+
+  INFO_LOG() << (reverse ? "Reverse playback." : "Forward playback.");
+  WakeupReadThread();
+}
+
+bool VideoState::IsReverse() const {
+  return reverse_req_;
+}
+
+void VideoState::StepToPrevFrame() {
+  SetReverse(true);
+  if (!reverse_req_) {
+    return;
+  }
+
+  /* like the forward step: play until one frame is shown */
+  if (paused_) {
+    StreamTogglePause();
+  }
+  step_ = true;
+}
+
+void VideoState::ApplyReverse(bool reverse) {
+  reverse_ = reverse;
+  reverse_at_start_ = false;
+  if (!reverse) {  // continue forward from the last shown frame
+    reverse_cache_->Clear(invalid_clock());
+    SetAudioDiscard(false);
+    StreamSeek(reverse_pos_ * (AV_TIME_BASE / 1000), 0, false);
+    return;
+  }
+
+  clock64_t pos = vstream_->GetPts();
+  if (!IsValidClock(pos)) {
+    pos = ic_->start_time != AV_NOPTS_VALUE ? ic_->start_time / 1000 : 0;
+  }
+  reverse_pos_ = pos;
+  reverse_cache_->Clear(pos);  // the frame before the shown one comes first
+  SetAudioDiscard(true);
+  vstream_->GetQueue()->PutNullpacket(vstream_->Index());
+}
+
+void VideoState::ReverseStep() {
+  /* one GOP ahead of the shown one, the cache says when it was handed over */
+  if (!reverse_cache_->CanBeginSegment() || reverse_at_start_) {
+    if (reverse_at_start_ && reverse_cache_->IsEmpty()) {
+      INFO_LOG() << "Reverse playback reached the start.";
+      reverse_req_ = false;
+      if (!paused_) {
+        StreamTogglePause();
+      }
+      return;
+    }
+    lock_t lock(read_thread_mutex_);
+    read_thread_cond_.wait_for(lock, std::chrono::milliseconds(REVERSE_POLL_MSEC));
+    return;
+  }
+
+  VideoStream* video_stream = vstream_;
+  PacketQueue* video_packet_queue = video_stream->GetQueue();
+  const double tb = q2d_diff(video_stream->GetTimeBase());
+  const clock64_t end = reverse_cache_->GetNextEnd();
+  AVPacket pkt1, *pkt = &pkt1;
+  clock64_t start = invalid_clock();
+  for (int i = 0; i < REVERSE_SEEK_ATTEMPTS && IsValidClock(end) && !IsValidClock(start); ++i) {
+    /* the keyframe before the cached frames on the demuxer index, the range makes every segment move back */
+    const int64_t ts = (end - 1 - i * REVERSE_SEEK_BACKOFF_MSEC) * (AV_TIME_BASE / 1000);
+    int ret = avformat_seek_file(ic_, -1, INT64_MIN, ts, ts, 0);
+    if (ret < 0) {
+      break;
+    }
+
+    for (int j = 0; j < REVERSE_MAX_PACKETS; ++j) {
+      ret = av_read_frame(ic_, pkt);
+      if (ret < 0) {
+        break;
+      }
+
+      if (pkt->stream_index == video_stream->Index() && (pkt->flags & AV_PKT_FLAG_KEY)) {
+        const int64_t pts = IsValidPts(pkt->pts) ? pkt->pts : pkt->dts;
+        if (IsValidPts(pts) && pts * tb < end) {
+          start = pts * tb;
+        } else {
+          av_packet_unref(pkt);
+        }
+        break;
+      }
+      av_packet_unref(pkt);
+    }
+  }
+
+  if (!IsValidClock(start)) {
+    reverse_at_start_ = true;
+    return;
+  }
+
+  reverse_cache_->BeginSegment(start, end);
+  video_stream->RegisterPacket(pkt);
+  video_packet_queue->Put(pkt);
+  bool boundary = false;
+  for (int i = 0; i < REVERSE_MAX_PACKETS; ++i) {
+    if (av_read_frame(ic_, pkt) < 0) {  // the segment ends with the stream
+      break;
+    }
+    if (pkt->stream_index != video_stream->Index()) {
+      av_packet_unref(pkt);
+      continue;
+    }
+
+    /* frames shown before the next keyframe can follow it in decode order (open GOP), the decoder needs it */
+    const int64_t pts = IsValidPts(pkt->pts) ? pkt->pts : pkt->dts;
+    const bool past_end = !IsValidPts(pts) || pts * tb >= end;
+    if (boundary && past_end) {
+      av_packet_unref(pkt);
+      break;
+    }
+    if ((pkt->flags & AV_PKT_FLAG_KEY) && past_end) {
+      boundary = true;
+    }
+    video_stream->RegisterPacket(pkt);
+    video_packet_queue->Put(pkt);
+  }
+  video_packet_queue->PutDrainPacket(video_stream->Index());
+}
+
+void VideoState::SeekPreview() {
+  /* the keyframe goes twice: alone with a drain so the decoder returns it at once, then again as the reference
+   * for the packets after it, the drain dropped the decoder state */
+  VideoStream* video_stream = vstream_;
+  PacketQueue* video_packet_queue = video_stream->GetQueue();
+  AVPacket pkt1, *pkt = &pkt1;
+  for (int i = 0; i < SEEK_PREVIEW_MAX_PACKETS && !seek_req_; ++i) {
+    int ret = av_read_frame(ic_, pkt);
+    if (ret < 0) {  // the read loop handles the end of the stream
+      return;
+    }
+
+    if (pkt->stream_index == astream_->Index()) {
+      astream_->RegisterPacket(pkt);
+      astream_->GetQueue()->Put(pkt);
+      continue;
+    }
+    if (pkt->stream_index != video_stream->Index()) {
+      av_packet_unref(pkt);
+      continue;
+    }
+
+    if (pkt->flags & AV_PKT_FLAG_KEY) {
+      AVPacket preview1, *preview = &preview1;
+      av_init_packet(preview);
+      if (av_packet_ref(preview, pkt) == 0) {
+        video_packet_queue->Put(preview);
+        video_packet_queue->PutDrainPacket(video_stream->Index());
+      }
+      video_stream->RegisterPacket(pkt);
+      video_packet_queue->Put(pkt);
+      return;
+    }
+    video_stream->RegisterPacket(pkt);
+    video_packet_queue->Put(pkt);
+  }
+}
+
+void VideoState::ApplyVideoSuspend(bool suspend) {
+  video_suspended_ = suspend;
+  const int video_index = vstream_->Index();
+  AVStream* video_st = ic_->streams[video_index];
+  if (suspend) {
+    INFO_LOG() << "Video decode suspended, audio only.";
+    video_st->discard = AVDISCARD_ALL;
+    vstream_->GetQueue()->PutNullpacket(video_index);  // drops queued packets and flushes the decoder
+    return;
+  }
+
+  INFO_LOG() << "Video decode resumed.";
+  video_st->discard = AVDISCARD_DEFAULT;
+  video_wait_keyframe_ = true;
+  if (!realtime_ && opt_.seek_by_bytes != SEEK_BY_BYTES_ON) {
+    SeekMsec(0);  // the read position is ahead of the audio clock by the queues, restart video from the clock
+  }
+}
+
+void VideoState::StepToNextFrame() {
+  /* if the stream is paused unpause it, then step */
+  if (paused_) {
+    StreamTogglePause();
+  }
+  step_ = true;
+}
+
+void VideoState::SeekNextChunk() {
+  clock64_t incr = 0;
+  if (ic_->nb_chapters <= 1) {
+    incr = 60000;
+  }
+  SeekChapter(1);
+  Seek(incr);
+}
+
+void VideoState::SeekPrevChunk() {
+  clock64_t incr = 0;
+  if (ic_->nb_chapters <= 1) {
+    incr = -60000;
+  }
+  SeekChapter(-1);
+  Seek(incr);
+}
+
+void VideoState::SeekChapter(int incr) {
+  if (!ic_->nb_chapters) {
+    return;
+  }
+
+  const AVRational tb = {1, AV_TIME_BASE};  // AV_TIME_BASE_Q
+  const clock64_t pos = GetMasterClock() * AV_TIME_BASE * 1000;
+  int i;
+  /* find the current chapter */
+  for (i = 0; i < ic_->nb_chapters; i++) {
+    AVChapter* ch = ic_->chapters[i];
+    if (av_compare_ts(pos, tb, ch->start, ch->time_base) < 0) {
+      i--;
+      break;
+    }
+  }
+
+  i += incr;
+  unsigned int chapter = FFMAX(i, 0);
+  if (chapter >= ic_->nb_chapters) {
+    return;
+  }
+
+  DEBUG_LOG() << "Seeking to chapter " << chapter << ".";
+  int64_t poss = av_rescale_q(ic_->chapters[chapter]->start, ic_->chapters[chapter]->time_base, tb);
+  StreamSeek(poss, 0, false);
+}
+
+void VideoState::StreamSeek(int64_t pos, int64_t rel, bool seek_by_bytes) {
+  if (demux_consumer_) {  // the other programs of the mux go on
+    return;
+  }
+
+  {
+    lock_t lock(seek_mutex_);
+    const clock64_t now = GetRealClockTime();
+    if (seek_req_) {
+      DEBUG_LOG() << "Seek request replaces a pending one.";
+    }
+    seek_pos_ = pos;
+    seek_rel_ = rel;
+    seek_flags_ &= ~AVSEEK_FLAG_BYTE;
+    if (seek_by_bytes) {
+      seek_flags_ |= AVSEEK_FLAG_BYTE;
+    }
+    seek_preview_req_ = now - seek_scrub_time_ < SEEK_SCRUB_WINDOW_MSEC;
+    seek_scrub_target_ = seek_by_bytes ? invalid_clock() : pos / (AV_TIME_BASE / 1000);
+    seek_scrub_time_ = now;
+    seek_req_ = true;
+  }
+  WakeupReadThread();
+}
+
+void VideoState::Seek(clock64_t msec) {
+  if (demux_consumer_) {
+    return;
+  }
+
+  if (opt_.seek_by_bytes == SEEK_BY_BYTES_ON) {
+    int64_t pos = -1;
+    if (pos < 0 && vstream_->IsOpened()) {
+      pos = video_frame_queue_->GetLastPos();
+    }
+    if (pos < 0 && astream_->IsOpened()) {
+      pos = audio_last_pos_;
+    }
+    if (pos < 0) {
+      pos = avio_tell(ic_->pb);
+    }
+
+    int64_t incr_in_bytes = 0;
+    if (ic_->bit_rate) {
+      incr_in_bytes = (msec / 1000) * ic_->bit_rate / 8.0;
+    } else {
+      incr_in_bytes = (msec / 1000) * 180000.0;
+    }
+    pos += incr_in_bytes;
+    StreamSeek(pos, incr_in_bytes, true);
+    return;
+  }
+
+  SeekMsec(msec);
+}
+
+clock64_t VideoState::GetScrubPosition() const {
+  lock_t lock(seek_mutex_);
+  if (GetRealClockTime() - seek_scrub_time_ < SEEK_SCRUB_WINDOW_MSEC) {
+    return seek_scrub_target_;
+  }
+  return invalid_clock();
+}
+
+void VideoState::SeekMsec(clock64_t clock) {
+  /* while scrubbing the clock lags behind the targets not reached yet */
+  clock64_t pos = invalid_clock();
+  clock64_t last_pos = 0;
+  {
+    lock_t lock(seek_mutex_);
+    if (GetRealClockTime() - seek_scrub_time_ < SEEK_SCRUB_WINDOW_MSEC) {
+      pos = seek_scrub_target_;
+    }
+    last_pos = seek_pos_ / AV_TIME_BASE * 1000;
+  }
+  if (!IsValidClock(pos)) {
+    pos = GetMasterClock();
+  }
+  if (!IsValidClock(pos)) {
+    pos = last_pos;
+  }
+  pos += clock;
+  if (ic_->start_time != AV_NOPTS_VALUE) {  // if selected out of range move to start
+    clock64_t st = ic_->start_time / AV_TIME_BASE * 1000;
+    if (pos < st) {
+      pos = st;
+    }
+  }
+
+  int64_t pos_seek = pos * AV_TIME_BASE / 1000;
+  int64_t incr_seek = clock * AV_TIME_BASE / 1000;
+  StreamSeek(pos_seek, incr_seek, false);
 }
 
 AvSyncType VideoState::GetMasterSyncType() const {
+  if (trick_rate_req_ || reverse_req_) {  // audio is off while scanning or playing backward
+    return AV_SYNC_VIDEO_MASTER;
+  }
+  if (video_suspend_req_ && astream_->IsOpened()) {  // no video frames to follow
+    return AV_SYNC_AUDIO_MASTER;
+  }
   return opt_.av_sync_type;
 }
 
@@ -700,14 +1351,37 @@ clock64_t VideoState::GetMasterClock() const {
 }
 
 int VideoState::Exec() {
+  exec_start_time_ = GetRealClockTime();
   int res = ReadRoutine();
   Close();
-  avformat_close_input(&ic_);
+  if (demux_consumer_) {  // the streams copy, the input belongs to the source
+    avformat_free_context(ic_);
+    ic_ = nullptr;
+  } else {
+    avformat_close_input(&ic_);
+  }
   return res;
 }
 
 void VideoState::Abort() {
   abort_request_ = true;
+  /* a dying stream does not keep its packets until the read thread gets to close the components */
+  PacketQueue* video_packet_queue = vstream_->GetQueue();
+  video_packet_queue->Abort();
+  video_packet_queue->Flush();
+  PacketQueue* audio_packet_queue = astream_->GetQueue();
+  audio_packet_queue->Abort();
+  audio_packet_queue->Flush();
+  if (demux_consumer_) {
+    demux_consumer_->Abort();
+  }
+  WakeupReadThread();
+}
+
+void VideoState::WakeupReadThread() {
+  // the reader checks its wait condition under this mutex, so the notify can't be lost
+  lock_t lock(read_thread_mutex_);
+  read_thread_cond_.notify_one();
 }
 
 bool VideoState::IsVideoThread() const {
@@ -749,6 +1423,7 @@ void VideoState::StreamTogglePause() {
   paused_ = !paused_;
   vstream_->SetPaused(paused_);
   astream_->SetPaused(paused_);
+  WakeupReadThread();
 }
 
 void VideoState::RefreshRequest() {
@@ -768,6 +1443,12 @@ void VideoState::ResetStats() {
   stats_.reset(new Stats);
 }
 
+void VideoState::AccountThreadCpu(int64_t* last_cpu_usec) {
+  const int64_t cpu = GetThreadCpuUsec();
+  cpu_usec_.fetch_add(cpu - *last_cpu_usec, std::memory_order_relaxed);
+  *last_cpu_usec = cpu;
+}
+
 void VideoState::Close() {
   /* close each stream */
   if (vstream_->IsOpened()) {
@@ -851,6 +1532,23 @@ the_end:
   StreamComponentOpen(stream_index);
 }
 
+void VideoState::ReopenVideoDecoder(int threads) {
+  if (!vstream_->IsOpened()) {
+    return;
+  }
+
+  const int index = vstream_->Index();
+  if (threads > 0) {
+    av_dict_set_int(&copt_.codec_opts, "threads", threads, 0);
+  } else {
+    av_dict_set(&copt_.codec_opts, "threads", "auto", 0);
+  }
+  DEBUG_LOG() << "Reopen video decoder of " << id_ << " with " << (threads > 0 ? std::to_string(threads) : "auto")
+              << " threads";
+  StreamComponentClose(index);
+  StreamComponentOpen(index);
+}
+
 common::Error VideoState::RequestVideo(int width, int height, int av_pixel_format, AVRational aspect_ratio) {
   if (!handler_) {
     return common::Error();
@@ -893,62 +1591,66 @@ int VideoState::SynchronizeAudio(int nb_samples) {
   return wanted_nb_samples;
 }
 
-int VideoState::AudioDecodeFrame() {
-  if (paused_) {
-    return ERROR_RESULT_VALUE;
-  }
-
-  if (!IsAudioReady()) {
-    return ERROR_RESULT_VALUE;
+int VideoState::QueueAudioFrame(AVFrame* frame, clock64_t pts) {
+  const AVSampleFormat sample_fmt = static_cast<AVSampleFormat>(frame->format);
+  int data_size = av_samples_get_buffer_size(nullptr, frame->channels, frame->nb_samples, sample_fmt, 1);
+  int64_t dec_channel_layout =
+      (frame->channel_layout && frame->channels == av_get_channel_layout_nb_channels(frame->channel_layout))
+          ? frame->channel_layout
+          : av_get_default_channel_layout(frame->channels);
+  int wanted_nb_samples = SynchronizeAudio(frame->nb_samples);
+  const bool compensate = wanted_nb_samples != frame->nb_samples;
+  dsp::SampleFormat dsp_fmt = dsp::SAMPLE_FMT_S16;
+  const bool native = av_get_packed_sample_fmt(sample_fmt) == audio_tgt_.fmt &&
+                      dec_channel_layout == audio_tgt_.channel_layout && frame->sample_rate == audio_tgt_.freq &&
+                      convert_to_dsp_format(audio_tgt_.fmt, &dsp_fmt);
+
+  if (frame->format != audio_src_.fmt || dec_channel_layout != audio_src_.channel_layout ||
+      frame->sample_rate != audio_src_.freq) {
+    swr_free(&swr_ctx_);
+    audio_src_.channel_layout = dec_channel_layout;
+    audio_src_.channels = frame->channels;
+    audio_src_.freq = frame->sample_rate;
+    audio_src_.fmt = sample_fmt;
   }
 
-  frames::AudioFrame* af = audio_frame_queue_->GetPeekReadable();
-  if (!af) {
-    return ERROR_RESULT_VALUE;
+  /* resample only for real conversions or sync compensation, drop the resampler once it is not needed anymore */
+  bool release_swr = false;
+  if (swr_ctx_ && native && !compensate) {
+    release_swr = ++swr_idle_frames_ >= AUDIO_SWR_RELEASE_FRAMES;
+  } else {
+    swr_idle_frames_ = 0;
   }
-  audio_frame_queue_->Pop();
-
-  const AVSampleFormat sample_fmt = static_cast<AVSampleFormat>(af->frame->format);
-  int data_size = av_samples_get_buffer_size(nullptr, af->frame->channels, af->frame->nb_samples, sample_fmt, 1);
-  int64_t dec_channel_layout =
-      (af->frame->channel_layout && af->frame->channels == av_get_channel_layout_nb_channels(af->frame->channel_layout))
-          ? af->frame->channel_layout
-          : av_get_default_channel_layout(af->frame->channels);
-  int wanted_nb_samples = SynchronizeAudio(af->frame->nb_samples);
 
-  if (af->frame->format != audio_src_.fmt || dec_channel_layout != audio_src_.channel_layout ||
-      af->frame->sample_rate != audio_src_.freq || (wanted_nb_samples != af->frame->nb_samples && !swr_ctx_)) {
-    swr_free(&swr_ctx_);
+  if (!swr_ctx_ && (!native || compensate)) {
     swr_ctx_ = swr_alloc_set_opts(nullptr, audio_tgt_.channel_layout, audio_tgt_.fmt, audio_tgt_.freq,
-                                  dec_channel_layout, sample_fmt, af->frame->sample_rate, 0, nullptr);
+                                  dec_channel_layout, sample_fmt, frame->sample_rate, 0, nullptr);
     if (!swr_ctx_ || swr_init(swr_ctx_) < 0) {
-      ERROR_LOG() << "Cannot create sample rate converter for conversion of " << af->frame->sample_rate << " Hz "
-                  << av_get_sample_fmt_name(sample_fmt) << " " << af->frame->channels << " channels to "
+      ERROR_LOG() << "Cannot create sample rate converter for conversion of " << frame->sample_rate << " Hz "
+                  << av_get_sample_fmt_name(sample_fmt) << " " << frame->channels << " channels to "
                   << audio_tgt_.freq << " Hz " << av_get_sample_fmt_name(audio_tgt_.fmt) << " " << audio_tgt_.channels
                   << " channels!";
       swr_free(&swr_ctx_);
       return ERROR_RESULT_VALUE;
     }
-    audio_src_.channel_layout = dec_channel_layout;
-    audio_src_.channels = af->frame->channels;
-    audio_src_.freq = af->frame->sample_rate;
-    audio_src_.fmt = sample_fmt;
   }
 
+  const auto convert_start = std::chrono::steady_clock::now();
+  const uint8_t* audio_buf = nullptr;
   int resampled_data_size = 0;
+  AudioPath path = AUDIO_PATH_DIRECT;
   if (swr_ctx_) {
-    const uint8_t** in = const_cast<const uint8_t**>(af->frame->extended_data);
+    const uint8_t** in = const_cast<const uint8_t**>(frame->extended_data);
     uint8_t** out = &audio_buf1_;
-    int out_count = wanted_nb_samples * audio_tgt_.freq / af->frame->sample_rate + 256;
+    int out_count = wanted_nb_samples * audio_tgt_.freq / frame->sample_rate + 256;
     int out_size = av_samples_get_buffer_size(nullptr, audio_tgt_.channels, out_count, audio_tgt_.fmt, 0);
     if (out_size < 0) {
       ERROR_LOG() << "av_samples_get_buffer_size() failed";
       return ERROR_RESULT_VALUE;
     }
-    if (wanted_nb_samples != af->frame->nb_samples) {
-      if (swr_set_compensation(swr_ctx_,
-                               (wanted_nb_samples - af->frame->nb_samples) * audio_tgt_.freq / af->frame->sample_rate,
-                               wanted_nb_samples * audio_tgt_.freq / af->frame->sample_rate) < 0) {
+    if (compensate) {
+      if (swr_set_compensation(swr_ctx_, (wanted_nb_samples - frame->nb_samples) * audio_tgt_.freq / frame->sample_rate,
+                               wanted_nb_samples * audio_tgt_.freq / frame->sample_rate) < 0) {
         ERROR_LOG() << "swr_set_compensation() failed";
         return ERROR_RESULT_VALUE;
       }
@@ -957,36 +1659,106 @@ int VideoState::AudioDecodeFrame() {
     if (!audio_buf1_) {
       return AVERROR(ENOMEM);
     }
-    int len2 = swr_convert(swr_ctx_, out, out_count, in, af->frame->nb_samples);
+    int len2 = swr_convert(swr_ctx_, out, out_count, in, frame->nb_samples);
     if (len2 < 0) {
       ERROR_LOG() << "swr_convert() failed";
-      return -1;
+      return ERROR_RESULT_VALUE;
     }
     if (len2 == out_count) {
       WARNING_LOG() << "audio buffer is probably too small";
       if (swr_init(swr_ctx_) < 0) {
         swr_free(&swr_ctx_);
       }
+    } else if (release_swr) {
+      /* drain the samples kept by the resampler, so the next frame continues without a gap */
+      uint8_t* tail = audio_buf1_ + len2 * audio_tgt_.frame_size;
+      const int drained = swr_convert(swr_ctx_, &tail, out_count - len2, nullptr, 0);
+      if (drained > 0) {
+        len2 += drained;
+      }
+      swr_free(&swr_ctx_);
+      swr_idle_frames_ = 0;
     }
-    audio_buf_ = audio_buf1_;
+    audio_buf = audio_buf1_;
     resampled_data_size = len2 * audio_tgt_.channels * av_get_bytes_per_sample(audio_tgt_.fmt);
+    path = AUDIO_PATH_RESAMPLE;
+  } else if (av_sample_fmt_is_planar(sample_fmt) && frame->channels > 1) {
+    av_fast_malloc(&audio_buf1_, &audio_buf1_size_, data_size);
+    if (!audio_buf1_) {
+      return AVERROR(ENOMEM);
+    }
+    dsp::Interleave(dsp_fmt, audio_buf1_, frame->extended_data, frame->channels, frame->nb_samples);
+    audio_buf = audio_buf1_;
+    resampled_data_size = data_size;
+    path = AUDIO_PATH_INTERLEAVE;
   } else {
-    audio_buf_ = af->frame->data[0];
+    audio_buf = frame->data[0];
     resampled_data_size = data_size;
   }
 
+  const int64_t convert_usec =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - convert_start).count();
+  if (audio_path_.exchange(path) != path) {
+    audio_convert_usec_ = 0;
+    audio_converted_usec_ = 0;
+  }
+  audio_convert_usec_ += convert_usec;
+  audio_converted_usec_ += static_cast<int64_t>(frame->nb_samples) * 1000000 / frame->sample_rate;
+
+  const int audio_volume = audio_volume_.load(std::memory_order_relaxed);
+  if (audio_volume != 0) {  // mute is applied by the callback, without latency
+    audio_gain_->SetTarget(dsp::VolumeToGain(audio_volume));
+  }
+  if (!audio_gain_->IsUnity() && convert_to_dsp_format(audio_tgt_.fmt, &dsp_fmt)) {
+    av_fast_malloc(&audio_mix_buf_, &audio_mix_buf_size_, resampled_data_size);
+    if (!audio_mix_buf_) {
+      return AVERROR(ENOMEM);
+    }
+    const size_t nb_samples = resampled_data_size / dsp::GetBytesPerSample(dsp_fmt);
+    audio_gain_->Scale(dsp_fmt, audio_mix_buf_, audio_buf, nb_samples);
+    audio_buf = audio_mix_buf_;
+  }
+
   /* update the audio clock with the pts */
-  if (IsValidClock(af->pts)) {
-    const double div = static_cast<double>(af->frame->nb_samples) / af->frame->sample_rate;
-    const clock64_t dur = div * 1000;
-    audio_clock_ = af->pts + dur;
+  if (IsValidClock(pts)) {
+    const double div = static_cast<double>(frame->nb_samples) / frame->sample_rate;
+    const clock64_t dur = div * 1000 * audio_filter_speed_;
+    audio_clock_ = pts + dur;
   } else {
     audio_clock_ = invalid_clock();
   }
+
+  /* write in chunks, a frame may be larger than the ring */
+  const size_t max_chunk = audio_ring_->GetCapacity() / 2 / audio_tgt_.frame_size * audio_tgt_.frame_size;
+  size_t left = resampled_data_size;
+  while (left) {
+    const size_t chunk = std::min(left, max_chunk);
+    if (!audio_ring_->WaitWritable(chunk)) {
+      return ERROR_RESULT_VALUE;
+    }
+
+    left -= chunk;
+    clock64_t end_clock = audio_clock_;
+    if (IsValidClock(end_clock) && left) {
+      end_clock -= static_cast<clock64_t>(left * 1000 * audio_filter_speed_ / audio_tgt_.bytes_per_sec);
+    }
+    audio_ring_->Write(audio_buf, chunk, end_clock, auddec_->GetSerial());
+    audio_buf += chunk;
+  }
+  audio_last_pos_ = frame->pkt_pos;
   return resampled_data_size;
 }
 
 frames::VideoFrame* VideoState::GetVideoFrame() {
+  const double speed_req = speed_;
+  if (vstream_->GetClockSpeed() != speed_req) {
+    vstream_->SetClockSpeed(speed_req);
+  }
+
+  if (reverse_req_) {
+    return GetReverseVideoFrame();
+  }
+
 retry:
   if (video_frame_queue_->IsEmpty()) {
     return nullptr;
@@ -1004,8 +1776,37 @@ retry:
     return SelectVideoFrame();
   }
 
-  /* compute nominal last_duration */
-  clock64_t last_duration = CalcDurationBetweenVideoFrames(lastvp, firstvp, max_frame_duration_);
+  if (firstvp->serial != vstream_->GetQueue()->GetSerial()) {  // decoded for a position left since
+    video_frame_queue_->Pop();
+    goto retry;
+  }
+
+  if (seek_preview_.exchange(false)) {  // the scrubbing preview is shown at once, the clock restarts from it
+    frame_timer_ = GetRealClockTime();
+    if (IsValidClock(firstvp->pts)) {
+      vstream_->SetClockAt(firstvp->pts, frame_timer_);
+    }
+    video_frame_queue_->Pop();
+    force_refresh_ = true;
+    if (step_ && !paused_) {
+      StreamTogglePause();
+    }
+    return SelectVideoFrame();
+  }
+
+  if (trick_rate_req_) {  // scan frames are paced by the read thread, show each one as it comes
+    frame_timer_ = GetRealClockTime();
+    if (IsValidClock(firstvp->pts)) {
+      vstream_->SetClockAt(firstvp->pts, frame_timer_);
+    }
+    video_frame_queue_->Pop();
+    force_refresh_ = true;
+    return SelectVideoFrame();
+  }
+
+  /* compute nominal last_duration, in real time at the current speed */
+  const double speed = speed_;
+  clock64_t last_duration = CalcDurationBetweenVideoFrames(lastvp, firstvp, max_frame_duration_) / speed;
   clock64_t delay = ComputeTargetDelay(last_duration);
   clock64_t time = GetRealClockTime();
   clock64_t next_frame_ts = frame_timer_ + delay;
@@ -1028,7 +1829,7 @@ retry:
 
   frames::VideoFrame* nextvp = video_frame_queue_->PeekNextOrNull();
   if (nextvp) {
-    clock64_t duration = CalcDurationBetweenVideoFrames(firstvp, nextvp, max_frame_duration_);
+    clock64_t duration = CalcDurationBetweenVideoFrames(firstvp, nextvp, max_frame_duration_) / speed;
     if ((opt_.framedrop == FRAME_DROP_AUTO ||
          (opt_.framedrop == FRAME_DROP_ON || (GetMasterSyncType() != AV_SYNC_VIDEO_MASTER)))) {
       clock64_t next_next_frame_ts = frame_timer_ + duration;
@@ -1049,6 +1850,50 @@ retry:
   return SelectVideoFrame();
 }
 
+frames::VideoFrame* VideoState::GetReverseVideoFrame() {
+  while (!video_frame_queue_->IsEmpty()) {  // forward frames decoded before the switch
+    video_frame_queue_->Pop();
+  }
+
+  if (paused_) {
+    return force_refresh_ ? reverse_cache_->PeekLast() : nullptr;
+  }
+
+  frames::VideoFrame* vp = reverse_cache_->Peek();
+  if (!vp) {
+    return nullptr;
+  }
+
+  /* the shown frame lasts until its pts from the pts of the previous one */
+  const clock64_t time = GetRealClockTime();
+  frames::VideoFrame* lastvp = reverse_cache_->PeekLast();
+  if (lastvp && frame_timer_) {
+    const clock64_t duration = CalcDurationBetweenVideoFrames(vp, lastvp, max_frame_duration_) / speed_;
+    const clock64_t next_frame_ts = frame_timer_ + duration;
+    if (time < next_frame_ts) {
+      return nullptr;
+    }
+    frame_timer_ = time - next_frame_ts > AV_SYNC_THRESHOLD_MAX_MSEC ? time : next_frame_ts;
+  } else {
+    frame_timer_ = time;
+  }
+
+  vp = reverse_cache_->Pop();
+  if (!vp) {
+    return nullptr;
+  }
+
+  if (IsValidClock(vp->pts)) {
+    vstream_->SetClockAt(vp->pts, time);
+    reverse_pos_ = vp->pts;
+  }
+  if (step_ && !paused_) {
+    StreamTogglePause();
+  }
+  stats_->frame_processed++;
+  return vp;
+}
+
 frames::VideoFrame* VideoState::SelectVideoFrame() const {
   if (force_refresh_ && video_frame_queue_->RindexShown()) {
     frames::VideoFrame* vp = video_frame_queue_->PeekLast();
@@ -1093,6 +1938,25 @@ frames::VideoFrame* VideoState::TryToGetVideoFrame() {
   stats_->audio_bandwidth = audio_bandwidth;
   stats_->video_bandwidth = video_bandwidth;
   stats_->active_hwaccel = static_cast<HWDeviceType>(input_st_->active_hwaccel_id);
+  stats_->audio_underruns = audio_underruns_;
+  stats_->audio_path = static_cast<AudioPath>(audio_path_.load());
+  const int64_t converted_usec = audio_converted_usec_;
+  stats_->audio_convert_load = converted_usec ? audio_convert_usec_ * 100.0 / converted_usec : 0;
+  const clock64_t now = GetRealClockTime();
+  if (now - cpu_sample_time_ >= CPU_LOAD_WINDOW_MSEC) {
+    const int64_t cpu = cpu_usec_.load(std::memory_order_relaxed);
+    if (cpu_sample_time_) {  // usec per msec of wall time is 1000 for a whole core
+      stats_->cpu_load = (cpu - cpu_sample_usec_) / 10.0 / (now - cpu_sample_time_);
+    }
+    cpu_sample_usec_ = cpu;
+    cpu_sample_time_ = now;
+  }
+  if (audio_tgt_.bytes_per_sec) {
+    stats_->audio_underrun_msec = static_cast<clock64_t>(audio_underrun_bytes_) * 1000 / audio_tgt_.bytes_per_sec;
+    stats_->audio_latency_msec =
+        static_cast<clock64_t>(audio_output_delay_bytes_.load(std::memory_order_relaxed)) * 1000 /
+        audio_tgt_.bytes_per_sec;
+  }
 
   if (fmt & HAVE_VIDEO_STREAM && video_frame_queue_) {
     frames::VideoFrame* fr = GetVideoFrame();
@@ -1111,53 +1975,57 @@ AVRational VideoState::GetFrameRate() const {
   return vstream_->GetFrameRate();
 }
 
-void VideoState::UpdateAudioBuffer(uint8_t* stream, int len, int audio_volume) {
-  if (!IsStreamReady()) {
+size_t VideoState::GetMemoryUsage() const {
+  const size_t packets = vstream_->GetQueue()->GetSize() + astream_->GetQueue()->GetSize();
+  return packets + video_frame_bytes_ * VIDEO_PICTURE_QUEUE_SIZE;
+}
+
+void VideoState::UpdateAudioBuffer(uint8_t* stream, int len, int audio_volume, int output_delay_bytes) {
+  audio_volume_.store(audio_volume, std::memory_order_relaxed);
+  if (!IsStreamReady() || !audio_ring_) {
+    memset(stream, 0, len);
     return;
   }
 
   const clock64_t audio_callback_time = GetRealClockTime();
-  while (len > 0) {
-    if (audio_buf_index_ >= audio_buf_size_) {
-      int audio_size = AudioDecodeFrame();
-      if (audio_size < 0) {
-        /* if error, just output silence */
-        audio_buf_ = nullptr;
-        audio_buf_size_ = AUDIO_MIN_BUFFER_SIZE / audio_tgt_.frame_size * audio_tgt_.frame_size;
-      } else {
-        audio_buf_size_ = audio_size;
-      }
-      audio_buf_index_ = 0;
-    }
-    int len1 = audio_buf_size_ - audio_buf_index_;
-    if (len1 > len) {
-      len1 = len;
-    }
-    if (audio_buf_ && audio_volume == 100) {
-      memcpy(stream, audio_buf_ + audio_buf_index_, len1);
-    } else {
-      memset(stream, 0, len1);
-      if (audio_buf_) {
-        if (handler_) {
-          handler_->HanleAudioMix(stream, audio_buf_ + audio_buf_index_, len1, audio_volume);
-        }
-      }
+  if (audio_flush_req_.exchange(false)) {
+    audio_ring_->Drop(astream_->GetQueue()->GetSerial());
+  }
+
+  size_t copied = 0;
+  if (!paused_) {
+    copied = audio_ring_->Read(stream, len);
+  }
+  if (audio_volume == 0) {
+    memset(stream, 0, copied);
+  }
+
+  /* stretched audio: one byte plays for speed times its stream duration */
+  const double speed = audio_ring_speed_.load(std::memory_order_relaxed);
+  const int stream_bytes_per_sec = static_cast<int>(audio_tgt_.bytes_per_sec / speed);
+  const clock64_t read_clock = audio_ring_->GetReadClock(stream_bytes_per_sec);
+  if (copied < static_cast<size_t>(len)) {
+    memset(stream + copied, 0, len - copied);
+    /* the ring has no clock from a flush until the first write after it; at the end it just runs dry */
+    const bool expected = eof_ || audio_flush_req_ || !IsValidClock(read_clock);
+    if (!paused_ && !trick_rate_req_ && !reverse_req_ && !expected) {
+      audio_underruns_++;
+      audio_underrun_bytes_ += len - copied;
     }
-    len -= len1;
-    stream += len1;
-    audio_buf_index_ += len1;
   }
-  audio_write_buf_size_ = audio_buf_size_ - audio_buf_index_;
-  /* Let's assume the audio driver that is used by SDL has two periods. */
-  if (IsValidClock(audio_clock_)) {
-    double clc = static_cast<double>(2 * audio_hw_buf_size_ + audio_write_buf_size_) /
-                 static_cast<double>(audio_tgt_.bytes_per_sec) * 1000;
-    const clock64_t pts = audio_clock_ - clc;
+
+  audio_output_delay_bytes_.store(output_delay_bytes, std::memory_order_relaxed);
+  if (astream_->GetClockSpeed() != speed) {  // the rate of the samples played, not the requested one
+    astream_->SetClockSpeed(speed);
+  }
+  if (IsValidClock(read_clock)) {
+    double clc = static_cast<double>(output_delay_bytes) / static_cast<double>(stream_bytes_per_sec) * 1000;
+    const clock64_t pts = read_clock - clc;
     astream_->SetClockAt(pts, audio_callback_time);
   }
 }
 
-int VideoState::QueuePicture(AVFrame* src_frame, clock64_t pts, clock64_t duration, int64_t pos) {
+int VideoState::QueuePicture(AVFrame* src_frame, clock64_t pts, clock64_t duration, int64_t pos, int serial) {
   frames::VideoFrame* vp = video_frame_queue_->GetPeekWritable();
   if (!vp) {
     return ERROR_RESULT_VALUE;
@@ -1170,6 +2038,8 @@ int VideoState::QueuePicture(AVFrame* src_frame, clock64_t pts, clock64_t durati
     vp->width = src_frame->width;
     vp->height = src_frame->height;
     vp->format = static_cast<AVPixelFormat>(src_frame->format);
+    const int bytes = av_image_get_buffer_size(vp->format, vp->width, vp->height, 1);  // < 0 for hardware frames
+    video_frame_bytes_ = bytes > 0 ? bytes : 0;
     if (handler_) {
       handler_->HandleFrameResize(this, vp->width, vp->height, vp->format, vp->sar);
     }
@@ -1179,9 +2049,15 @@ int VideoState::QueuePicture(AVFrame* src_frame, clock64_t pts, clock64_t durati
   vp->pts = pts;
   vp->duration = duration;
   vp->pos = pos;
+  vp->serial = serial;
 
   av_frame_move_ref(vp->frame, src_frame);
   video_frame_queue_->Push();
+  if (!first_picture_queued_) {  // time to first frame, what a reused decoder saves on a zap
+    first_picture_queued_ = true;
+    INFO_LOG() << "First picture decoded " << GetRealClockTime() - exec_start_time_ << " msec after open, "
+               << (video_decoder_reused_ ? "reused" : "new") << " decoder";
+  }
   return SUCCESS_RESULT_VALUE;
 }
 
@@ -1194,7 +2070,9 @@ int VideoState::GetVideoFrame(AVFrame* frame) {
   if (got_picture) {
     frame->sample_aspect_ratio = vstream_->StableAspectRatio(frame);
 
-    if (opt_.framedrop == FRAME_DROP_AUTO || (opt_.framedrop || GetMasterSyncType() != AV_SYNC_VIDEO_MASTER)) {
+    /* backward every frame of the GOP is shown, a scrubbing preview is shown whatever the clock says */
+    if (!reverse_req_ && !seek_preview_ &&
+        (opt_.framedrop == FRAME_DROP_AUTO || (opt_.framedrop || GetMasterSyncType() != AV_SYNC_VIDEO_MASTER))) {
       if (IsValidPts(frame->pts)) {
         clock64_t dpts = vstream_->q2d() * frame->pts;
         clock64_t diff = dpts - GetMasterClock();
@@ -1212,8 +2090,7 @@ int VideoState::GetVideoFrame(AVFrame* frame) {
   return got_picture;
 }
 
-/* this thread gets the stream from the disk or the network */
-int VideoState::ReadRoutine() {
+int VideoState::OpenInput() {
   AVFormatContext* ic = avformat_alloc_context();
   if (!ic) {
     const int av_errno = AVERROR(ENOMEM);
@@ -1221,7 +2098,7 @@ int VideoState::ReadRoutine() {
     if (handler_) {
       handler_->HandleQuitStream(this, av_errno, common::make_error_from_errno(err));
     }
-    return ERROR_RESULT_VALUE;
+    return av_errno;
   }
 
   bool scan_all_pmts_set = false;
@@ -1231,7 +2108,7 @@ int VideoState::ReadRoutine() {
     if (handler_) {
       handler_->HandleQuitStream(this, EINVAL, err);
     }
-    return ERROR_RESULT_VALUE;
+    return AVERROR(EINVAL);
   }
 
   const char* in_filename = uri_str.c_str();
@@ -1242,22 +2119,113 @@ int VideoState::ReadRoutine() {
     scan_all_pmts_set = true;
   }
 
-  int open_result = avformat_open_input(&ic, in_filename, nullptr, &copt_.format_opts);  // autodetect format
-  if (open_result < 0) {
-    std::string err_str = ffmpeg_errno_to_string(open_result);
-    common::Error err = common::make_error(err_str);
-    avformat_close_input(&ic);
-    if (handler_) {
-      handler_->HandleQuitStream(this, open_result, err);
+  int open_result = avformat_open_input(&ic, in_filename, nullptr, &copt_.format_opts);  // autodetect format
+  if (open_result < 0) {
+    std::string err_str = ffmpeg_errno_to_string(open_result);
+    common::Error err = common::make_error(err_str);
+    avformat_close_input(&ic);
+    if (handler_) {
+      handler_->HandleQuitStream(this, open_result, err);
+    }
+    return open_result;
+  }
+  if (scan_all_pmts_set) {
+    av_dict_set(&copt_.format_opts, "scan_all_pmts", nullptr, AV_DICT_MATCH_CASE);
+  }
+
+  ic_ = ic;
+
+  if (opt_.genpts) {
+    ic->flags |= AVFMT_FLAG_GENPTS;
+  }
+
+  av_format_inject_global_side_data(ic);
+
+  AVDictionary** opts = setup_find_stream_info_opts(ic, copt_.codec_opts);
+  unsigned int orig_nb_streams = ic->nb_streams;
+
+  int find_stream_info_result = avformat_find_stream_info(ic, opts);
+
+  for (unsigned int i = 0; i < orig_nb_streams; i++) {
+    av_dict_free(&opts[i]);
+  }
+  av_freep(&opts);
+
+  if (find_stream_info_result < 0) {
+    std::string err_str = ffmpeg_errno_to_string(find_stream_info_result);
+    common::Error err = common::make_error(err_str);
+    if (handler_) {
+      handler_->HandleQuitStream(this, -1, err);
+    }
+    return find_stream_info_result;
+  }
+  return 0;
+}
+
+int VideoState::OpenSharedInput() {
+  AVFormatContext* ic = nullptr;
+  int open_result = demux_consumer_->Open(&ic);
+  if (open_result < 0) {
+    std::string err_str = ffmpeg_errno_to_string(open_result);
+    common::Error err = common::make_error(err_str);
+    if (handler_) {
+      handler_->HandleQuitStream(this, open_result, err);
+    }
+    return open_result;
+  }
+
+  ic_ = ic;
+  return 0;
+}
+
+int VideoState::OpenStandbyInput() {
+  /* opened and probed by the keeper, the reads go on from its last packet */
+  AVFormatContext* ic = standby_ic_;
+  standby_ic_ = nullptr;
+  ic->interrupt_callback.callback = decode_interrupt_callback;
+  ic->interrupt_callback.opaque = this;
+  if (opt_.genpts) {
+    ic->flags |= AVFMT_FLAG_GENPTS;
+  }
+
+  ic_ = ic;
+  return 0;
+}
+
+void VideoState::QueueStandbyPackets() {
+  /* the GOP the keeper held goes first, the decoder starts from its keyframe instead of waiting for the next one */
+  VideoStream* video_stream = vstream_;
+  AudioStream* audio_stream = astream_;
+  const size_t count = standby_gop_.size();
+  size_t bytes = 0;
+  for (AVPacket& pkt : standby_gop_) {
+    bytes += pkt.size;
+    if (pkt.stream_index == audio_stream->Index()) {
+      audio_stream->RegisterPacket(&pkt);
+      audio_stream->GetQueue()->Put(&pkt);
+    } else if (pkt.stream_index == video_stream->Index() && !video_stream->HaveDispositionPicture() &&
+               !video_suspended_) {
+      video_stream->RegisterPacket(&pkt);
+      video_stream->GetQueue()->Put(&pkt);
+    } else {
+      av_packet_unref(&pkt);
     }
-    return ERROR_RESULT_VALUE;
   }
-  if (scan_all_pmts_set) {
-    av_dict_set(&copt_.format_opts, "scan_all_pmts", nullptr, AV_DICT_MATCH_CASE);
+  standby_gop_.clear();
+  if (count) {
+    INFO_LOG() << "Zapped to a standby channel, queued " << count << " packets (" << bytes / 1024
+               << " KB) since its keyframe.";
   }
+}
 
-  ic_ = ic;
+/* this thread gets the stream from the disk or the network */
+int VideoState::ReadRoutine() {
+  int open_result = demux_consumer_ ? OpenSharedInput() : standby_ic_ ? OpenStandbyInput() : OpenInput();
+  if (open_result < 0) {
+    return ERROR_RESULT_VALUE;
+  }
 
+  AVFormatContext* ic = ic_;
   VideoStream* video_stream = vstream_;
   AudioStream* audio_stream = astream_;
   PacketQueue* video_packet_queue = video_stream->GetQueue();
@@ -1265,31 +2233,7 @@ int VideoState::ReadRoutine() {
   int st_index[AVMEDIA_TYPE_NB];
   memset(st_index, -1, sizeof(st_index));
 
-  if (opt_.genpts) {
-    ic->flags |= AVFMT_FLAG_GENPTS;
-  }
-
-  av_format_inject_global_side_data(ic);
-
-  AVDictionary** opts = setup_find_stream_info_opts(ic, copt_.codec_opts);
-  unsigned int orig_nb_streams = ic->nb_streams;
-
-  int find_stream_info_result = avformat_find_stream_info(ic, opts);
-
-  for (unsigned int i = 0; i < orig_nb_streams; i++) {
-    av_dict_free(&opts[i]);
-  }
-  av_freep(&opts);
-
   AVPacket pkt1, *pkt = &pkt1;
-  if (find_stream_info_result < 0) {
-    std::string err_str = ffmpeg_errno_to_string(find_stream_info_result);
-    common::Error err = common::make_error(err_str);
-    if (handler_) {
-      handler_->HandleQuitStream(this, -1, err);
-    }
-    return ERROR_RESULT_VALUE;
-  }
 
   if (ic->pb) {
     ic->pb->eof_reached = 0;  // FIXME hack, ffplay maybe should not use
@@ -1303,7 +2247,7 @@ int VideoState::ReadRoutine() {
     opt_.seek_by_bytes = seek ? SEEK_BY_BYTES_ON : SEEK_BY_BYTES_OFF;
   }
 
-  realtime_ = is_realtime(ic);
+  realtime_ = demux_consumer_ || is_realtime(ic);  // a shared mux is never sought
 
   av_dump_format(ic, 0, id_.c_str(), 0);
 
@@ -1382,38 +2326,77 @@ int VideoState::ReadRoutine() {
     opt_.infinite_buffer = 1;
   }
 
+  QueueStandbyPackets();
   ResetStats();
+  int64_t cpu_usec = GetThreadCpuUsec();
   while (!IsAborted()) {
+    RegisterWakeup(READ_THREAD_WAKEUP);
+    AccountThreadCpu(&cpu_usec);
+    const bool suspend_video = video_suspend_req_ && audio_stream->IsOpened();
+    if (suspend_video != video_suspended_ && video_stream->IsOpened()) {
+      ApplyVideoSuspend(suspend_video);
+    }
     if (paused_ != last_paused_) {
       last_paused_ = paused_;
       if (paused_) {
-        read_pause_return_ = av_read_pause(ic);
+        read_pause_return_ = demux_consumer_ ? AVERROR(ENOSYS) : av_read_pause(ic);
       } else {
-        av_read_play(ic);
+        if (!demux_consumer_) {  // the mux is not ours to pause, the consumer drops up to a keyframe instead
+          av_read_play(ic);
+        }
         ResetStats();
       }
     }
 
     if (seek_req_) {
-      int64_t seek_target = seek_pos_;
-      int64_t seek_min = seek_rel_ > 0 ? seek_target - seek_rel_ + 2 : INT64_MIN;
-      int64_t seek_max = seek_rel_ < 0 ? seek_target - seek_rel_ - 2 : INT64_MAX;
+      int64_t seek_target = 0;
+      int64_t seek_rel = 0;
+      int seek_flags = 0;
+      bool preview = false;
+      {
+        /* requests made while seeking are taken by the next iteration, only the latest of them is served */
+        lock_t lock(seek_mutex_);
+        seek_target = seek_pos_;
+        seek_rel = seek_rel_;
+        seek_flags = seek_flags_;
+        preview = seek_preview_req_;
+        seek_req_ = false;
+      }
+      int64_t seek_min = seek_rel > 0 ? seek_target - seek_rel + 2 : INT64_MIN;
+      int64_t seek_max = seek_rel < 0 ? seek_target - seek_rel - 2 : INT64_MAX;
       // FIXME the +-2 is due to rounding being not done in the correct
       // direction in generation
       //      of the seek_pos/seek_rel variables
 
-      int ret = avformat_seek_file(ic, -1, seek_min, seek_target, seek_max, seek_flags_);
+      int ret = avformat_seek_file(ic, -1, seek_min, seek_target, seek_max, seek_flags);
       if (ret < 0) {
         ERROR_LOG() << "Seeking " << id_ << "failed error: " << ffmpeg_errno_to_string(ret);
       } else {
+        /* scan and reverse steps are keyframes or segments before the position by design */
+        if (opt_.accurate_seek && !(seek_flags & AVSEEK_FLAG_BYTE) && !trick_rate_ && !reverse_) {
+          const clock64_t target = seek_target / (AV_TIME_BASE / 1000);
+          video_seek_target_ = target;
+          audio_seek_target_ = target;
+        }
+        preview = preview && video_stream->IsOpened() && !video_suspended_ && !trick_rate_ && !reverse_;
         if (video_stream->IsOpened()) {
+          video_preview_req_ = preview;
+          /* packets and frames of a superseded target are dropped by serial, not decoded or shown */
           video_packet_queue->PutNullpacket(video_stream->Index());
+          seek_preview_ = preview;
         }
         if (audio_stream->IsOpened()) {
           audio_packet_queue->PutNullpacket(audio_stream->Index());
+          audio_flush_req_ = true;  // don't play converted samples from before the seek
+        }
+        if (reverse_) {  // continue backward from the new position
+          reverse_cache_->Clear(seek_target / (AV_TIME_BASE / 1000));
+          reverse_at_start_ = false;
+        }
+        if (preview) {
+          SeekPreview();
         }
       }
-      seek_req_ = false;
       eof_ = false;
       if (paused_) {
         StepToNextFrame();
@@ -1421,20 +2404,54 @@ int VideoState::ReadRoutine() {
       ResetStats();
     }
 
+    const int trick_rate = trick_rate_req_;
+    if (trick_rate != trick_rate_) {
+      ApplyTrickPlay(trick_rate);
+      continue;
+    }
+    if (trick_rate_) {
+      if (paused_) {
+        lock_t lock(read_thread_mutex_);
+        read_thread_cond_.wait(lock, [this]() { return !paused_ || trick_rate_req_ != trick_rate_ || IsAborted(); });
+        continue;
+      }
+      TrickPlayStep();
+      continue;
+    }
+
+    const bool reverse = reverse_req_;
+    if (reverse != reverse_) {
+      ApplyReverse(reverse);
+      continue;
+    }
+    if (reverse_) {  // keeps decoding while paused, the cache budget bounds it
+      ReverseStep();
+      continue;
+    }
+
     /* if the queue are full, no need to read more */
     if (opt_.infinite_buffer < 1 && (video_packet_queue->GetSize() + audio_packet_queue->GetSize() > MAX_QUEUE_SIZE ||
                                      (astream_->HasEnoughPackets() && vstream_->HasEnoughPackets()))) {
-      std::unique_lock<std::mutex> lock(read_thread_mutex_);
+      lock_t lock(read_thread_mutex_);
+      if (paused_) {  // nothing is consumed until resume, sleep without polling
+        read_thread_cond_.wait(lock, [this]() { return !paused_ || seek_req_ || IsAborted(); });
+        continue;
+      }
       std::cv_status interrupt_status = read_thread_cond_.wait_for(lock, std::chrono::milliseconds(10));
       if (interrupt_status == std::cv_status::no_timeout) {  // if notify
       }
       continue;
     }
+    if (paused_ && eof_) {
+      lock_t lock(read_thread_mutex_);
+      read_thread_cond_.wait(lock, [this]() { return !paused_ || seek_req_ || IsAborted(); });
+      continue;
+    }
     if (!paused_ && eof_) {
-      bool is_audio_dec_ready = auddec_ && audio_frame_queue_;
+      bool is_audio_dec_ready = auddec_ && audio_ring_;
       bool is_audio_not_finished_but_empty = false;
       if (is_audio_dec_ready) {
-        is_audio_not_finished_but_empty = !auddec_->IsFinished() && audio_frame_queue_->IsEmpty();
+        is_audio_not_finished_but_empty = !auddec_->IsFinished() && audio_ring_->IsEmpty();
       }
       bool is_video_dec_ready = viddec_ && video_frame_queue_;
       bool is_video_not_finished_but_empty = false;
@@ -1454,14 +2471,17 @@ int VideoState::ReadRoutine() {
         return ERROR_RESULT_VALUE;
       }
     }
-    int ret = av_read_frame(ic, pkt);
+    int ret = demux_consumer_ ? demux_consumer_->Read(pkt) : av_read_frame(ic, pkt);
+    if (ret == AVERROR(EAGAIN)) {  // nothing from the shared mux for a while, the requests are checked again
+      continue;
+    }
     if (ret < 0) {
       WARNING_LOG() << "Read input stream error: " << ffmpeg_errno_to_string(ret);
       bool is_eof = ret == AVERROR_EOF;
       bool is_feof = avio_feof(ic->pb);
       if ((is_eof || is_feof) && !eof_) {
-        if (video_stream->IsOpened()) {
-          video_packet_queue->PutNullpacket(video_stream->Index());
+        if (video_stream->IsOpened()) {  // the frames held back for reordering are shown, not flushed
+          video_packet_queue->PutDrainPacket(video_stream->Index());
         }
         if (audio_stream->IsOpened()) {
           audio_packet_queue->PutNullpacket(audio_stream->Index());
@@ -1480,9 +2500,11 @@ int VideoState::ReadRoutine() {
       audio_stream->RegisterPacket(pkt);
       audio_packet_queue->Put(pkt);
     } else if (pkt->stream_index == video_stream->Index()) {
-      if (video_stream->HaveDispositionPicture()) {
+      if (video_stream->HaveDispositionPicture() || video_suspended_ ||
+          (video_wait_keyframe_ && !(pkt->flags & AV_PKT_FLAG_KEY))) {
         av_packet_unref(pkt);
       } else {
+        video_wait_keyframe_ = false;
         video_stream->RegisterPacket(pkt);
         video_packet_queue->Put(pkt);
       }
@@ -1515,207 +2537,545 @@ int VideoState::decode_interrupt_callback(void* user_data) {
 }
 
 int VideoState::AudioThread() {
-  frames::AudioFrame* af = nullptr;
-  int ret = 0;
-
-  AVFrame* frame = av_frame_alloc();
-  if (!frame) {
-    return AVERROR(ENOMEM);
+  AudioDecodeContext ctx;
+  int ret = InitAudioDecode(&ctx);
+  if (ret < 0) {
+    return ret;
   }
 
-  do {
-    int got_frame = auddec_->DecodeFrame(frame);
-    if (got_frame < 0) {
+  int64_t cpu_usec = GetThreadCpuUsec();
+  while (true) {
+    RegisterWakeup(AUDIO_DECODER_WAKEUP);
+    AccountThreadCpu(&cpu_usec);
+    ret = DecodeAudio(&ctx);
+    if (ret < 0) {
       break;
     }
+    if (!ret) {
+      continue;
+    }
 
-    if (got_frame) {
-      AVRational tb = {1, frame->sample_rate};
+    while ((ret = OutputAudioFrame(&ctx)) > 0) {
+    }
+    if (ret < 0) {
+      break;
+    }
+  }
 
-#if CONFIG_AVFILTER
-      int64_t dec_channel_layout = get_valid_channel_layout(frame->channel_layout, frame->channels);
-
-      bool reconfigure = cmp_audio_fmts(audio_filter_src_.fmt, audio_filter_src_.channels,
-                                        static_cast<AVSampleFormat>(frame->format), frame->channels) ||
-                         audio_filter_src_.channel_layout != dec_channel_layout ||
-                         audio_filter_src_.freq != frame->sample_rate;
-
-      if (reconfigure) {
-        char buf1[1024], buf2[1024];
-        av_get_channel_layout_string(buf1, SIZEOFMASS(buf1), -1, audio_filter_src_.channel_layout);
-        av_get_channel_layout_string(buf2, SIZEOFMASS(buf2), -1, dec_channel_layout);
-        const std::string mess = common::MemSPrintf(
-            "Audio frame changed from rate:%d ch:%d fmt:%s layout:%s serial:%d "
-            "to rate:%d ch:%d "
-            "fmt:%s layout:%s serial:%d\n",
-            audio_filter_src_.freq, audio_filter_src_.channels, av_get_sample_fmt_name(audio_filter_src_.fmt), buf1, 0,
-            frame->sample_rate, frame->channels, av_get_sample_fmt_name(static_cast<AVSampleFormat>(frame->format)),
-            buf2, 0);
-        DEBUG_LOG() << mess;
-
-        audio_filter_src_.fmt = static_cast<AVSampleFormat>(frame->format);
-        audio_filter_src_.channels = frame->channels;
-        audio_filter_src_.channel_layout = dec_channel_layout;
-        audio_filter_src_.freq = frame->sample_rate;
-
-        if ((ret = ConfigureAudioFilters(opt_.afilters, 1)) < 0) {
-          break;
-        }
-      }
+  FreeAudioDecode(&ctx);
+  return ret;
+}
 
-      ret = av_buffersrc_add_frame(in_audio_filter_, frame);
-      if (ret < 0) {
-        break;
-      }
+int VideoState::InitAudioDecode(AudioDecodeContext* ctx) {
+  ctx->frame = av_frame_alloc();
+  if (!ctx->frame) {
+    return AVERROR(ENOMEM);
+  }
 
-      while ((ret = av_buffersink_get_frame_flags(out_audio_filter_, frame, 0)) >= 0) {
-        tb = out_audio_filter_->inputs[0]->time_base;
+#if !CONFIG_AVFILTER
+  ctx->pending = false;
 #endif
-        af = audio_frame_queue_->GetPeekWritable();
-        if (!af) {  // if stoped
+  ctx->flush_count = auddec_->GetFlushCount();
+  ctx->seek_target = invalid_clock();
+  ctx->ended = false;
+  return 0;
+}
+
+void VideoState::FreeAudioDecode(AudioDecodeContext* ctx) {
 #if CONFIG_AVFILTER
-          avfilter_graph_free(&agraph_);
+  avfilter_graph_free(&agraph_);
 #endif
-          av_frame_free(&frame);
-          return ret;
-        }
+  av_frame_free(&ctx->frame);
+}
 
-        af->pts = IsValidPts(frame->pts) ? frame->pts * q2d_diff(tb) : invalid_clock();
-        af->pos = frame->pkt_pos;
-        af->format = static_cast<AVSampleFormat>(frame->format);
-        AVRational tmp = {frame->nb_samples, frame->sample_rate};
-        af->duration = q2d_diff(tmp);
+int VideoState::DecodeAudio(AudioDecodeContext* ctx) {
+  AVFrame* frame = ctx->frame;
+  int got_frame = auddec_->DecodeFrame(frame);
+  if (got_frame < 0) {
+    return got_frame;
+  }
+  if (ctx->flush_count != auddec_->GetFlushCount()) {
+    ctx->flush_count = auddec_->GetFlushCount();
+    ctx->seek_target = audio_seek_target_.exchange(invalid_clock());
+  }
+  if (!got_frame) {
+    return 0;
+  }
+  if (auddec_->GetSerial() != astream_->GetQueue()->GetSerial()) {  // a newer seek superseded it
+    av_frame_unref(frame);
+    return 0;
+  }
 
-        av_frame_move_ref(af->frame, frame);
-        audio_frame_queue_->Push();
+  if (IsValidClock(ctx->seek_target)) {  // ends before the seek target, not filtered or converted
+    const clock64_t end =
+        IsValidPts(frame->pts) ? (frame->pts + frame->nb_samples) * 1000 / frame->sample_rate : invalid_clock();
+    if (IsValidClock(end) && end <= ctx->seek_target) {
+      av_frame_unref(frame);
+      return 0;
+    }
+    ctx->seek_target = invalid_clock();
+  }
 
 #if CONFIG_AVFILTER
-      }
-      if (ret == AVERROR_EOF) {
-        auddec_->SetFinished(true);
-      }
-#endif
+  int64_t dec_channel_layout = get_valid_channel_layout(frame->channel_layout, frame->channels);
+
+  const double speed = speed_;
+  const bool speed_changed = speed != audio_filter_speed_;
+  /* atempo stamps output from its first input, restart it after a seek */
+  const bool tempo_restart = audio_flush_count_ != auddec_->GetFlushCount() && audio_filter_speed_ != 1.0;
+  audio_flush_count_ = auddec_->GetFlushCount();
+  bool reconfigure = cmp_audio_fmts(audio_filter_src_.fmt, audio_filter_src_.channels,
+                                    static_cast<AVSampleFormat>(frame->format), frame->channels) ||
+                     audio_filter_src_.channel_layout != dec_channel_layout ||
+                     audio_filter_src_.freq != frame->sample_rate || speed_changed || tempo_restart;
+
+  if (reconfigure) {
+    char buf1[1024], buf2[1024];
+    av_get_channel_layout_string(buf1, SIZEOFMASS(buf1), -1, audio_filter_src_.channel_layout);
+    av_get_channel_layout_string(buf2, SIZEOFMASS(buf2), -1, dec_channel_layout);
+    const std::string mess = common::MemSPrintf(
+        "Audio frame changed from rate:%d ch:%d fmt:%s layout:%s serial:%d "
+        "to rate:%d ch:%d "
+        "fmt:%s layout:%s serial:%d\n",
+        audio_filter_src_.freq, audio_filter_src_.channels, av_get_sample_fmt_name(audio_filter_src_.fmt), buf1, 0,
+        frame->sample_rate, frame->channels, av_get_sample_fmt_name(static_cast<AVSampleFormat>(frame->format)), buf2,
+        0);
+    DEBUG_LOG() << mess;
+
+    audio_filter_src_.fmt = static_cast<AVSampleFormat>(frame->format);
+    audio_filter_src_.channels = frame->channels;
+    audio_filter_src_.channel_layout = dec_channel_layout;
+    audio_filter_src_.freq = frame->sample_rate;
+    audio_filter_speed_ = speed;
+    audio_tempo_start_ = invalid_clock();
+
+    int ret = ConfigureAudioFilters(opt_.afilters, 1);
+    if (ret < 0) {
+      return ret;
+    }
+    if (speed_changed) {  // the ring clock assumes one rate for all of its content
+      audio_ring_speed_ = speed;
+      audio_flush_req_ = true;
     }
-  } while (ret >= 0 || ret == AVERROR(EAGAIN) || ret == AVERROR_EOF);
+  }
+
+  int ret = av_buffersrc_add_frame(in_audio_filter_, frame);
+  return ret < 0 ? ret : 1;
+#else
+  ctx->pending = true;
+  return 1;
+#endif
+}
 
+int VideoState::OutputAudioFrame(AudioDecodeContext* ctx) {
+  AVFrame* frame = ctx->frame;
 #if CONFIG_AVFILTER
-  avfilter_graph_free(&agraph_);
+  if (!out_audio_filter_) {
+    return 0;
+  }
+
+  int ret = av_buffersink_get_frame_flags(out_audio_filter_, frame, 0);
+  if (ret < 0) {
+    if (ret == AVERROR_EOF) {
+      auddec_->SetFinished(true);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+  }
+  AVRational tb = out_audio_filter_->inputs[0]->time_base;
+#else
+  if (!ctx->pending) {
+    return 0;
+  }
+  ctx->pending = false;
+  AVRational tb = {1, frame->sample_rate};
 #endif
-  av_frame_free(&frame);
-  return ret;
+
+  clock64_t pts = IsValidPts(frame->pts) ? frame->pts * q2d_diff(tb) : invalid_clock();
+  if (audio_filter_speed_ != 1.0 && IsValidClock(pts)) {
+    /* atempo output is stamped on the played timeline, map it back to the stream one */
+    if (!IsValidClock(audio_tempo_start_)) {
+      audio_tempo_start_ = pts;
+    }
+    pts = audio_tempo_start_ + (pts - audio_tempo_start_) * audio_filter_speed_;
+  }
+  int queued = QueueAudioFrame(frame, pts);
+  av_frame_unref(frame);
+  if (queued < 0 && audio_ring_->IsStopped()) {
+    return ERROR_RESULT_VALUE;
+  }
+  return 1;
 }
 
 int VideoState::VideoThread() {
-  AVFrame* frame = av_frame_alloc();
-  if (!frame) {
-    return AVERROR(ENOMEM);
+  if (task_priority_ == TASK_PRIORITY_LOW && !LowerThreadPriority()) {
+    DEBUG_LOG() << "Video decoder of " << id_ << " keeps its thread priority";
   }
 
-#if CONFIG_AVFILTER
-  AVFilterGraph* graph = avfilter_graph_alloc();
-  AVFilterContext *filt_out = nullptr, *filt_in = nullptr;
-  int last_w = 0;
-  int last_h = 0;
-  enum AVPixelFormat last_format = AV_PIX_FMT_NONE;  // -2
-  if (!graph) {
-    av_frame_free(&frame);
-    return AVERROR(ENOMEM);
+  VideoDecodeContext ctx;
+  int ret = InitVideoDecode(&ctx);
+  if (ret < 0) {
+    return ret;
   }
-#endif
 
-  AVRational tb = vstream_->GetTimeBase();
-  AVRational frame_rate = vstream_->GetFrameRate();
+  int64_t cpu_usec = GetThreadCpuUsec();
   while (true) {
-    int ret = GetVideoFrame(frame);
+    RegisterWakeup(VIDEO_DECODER_WAKEUP);
+    AccountThreadCpu(&cpu_usec);
+    ret = DecodeVideo(&ctx);
     if (ret < 0) {
-      goto the_end;
+      break;
     }
     if (!ret) {
       continue;
     }
 
-    if (input_st_->hwaccel_retrieve_data && frame->format == input_st_->hwaccel_pix_fmt) {
-      int err = input_st_->hwaccel_retrieve_data(viddec_->GetAvCtx(), frame);
-      if (err < 0) {
-        continue;
-      }
-    }
-    input_st_->hwaccel_retrieved_pix_fmt = static_cast<AVPixelFormat>(frame->format);
-
-#if CONFIG_AVFILTER
-    if (last_w != frame->width || last_h != frame->height || last_format != frame->format) {  // -vf option
-      const std::string mess = common::MemSPrintf(
-          "Video frame changed from size:%dx%d format:%s serial:%d to "
-          "size:%dx%d format:%s "
-          "serial:%d",
-          last_w, last_h, static_cast<const char*>(av_x_if_null(av_get_pix_fmt_name(last_format), "none")), 0,
-          frame->width, frame->height,
-          static_cast<const char*>(
-              av_x_if_null(av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format)), "none")),
-          0);
-      DEBUG_LOG() << mess;
-      avfilter_graph_free(&graph);
-      graph = avfilter_graph_alloc();
-      const std::string vfilters = opt_.vfilters;
-      int ret = ConfigureVideoFilters(graph, vfilters, frame);
-      if (ret < 0) {
-        ERROR_LOG() << "Internal video error!";
-        goto the_end;
-      }
-      filt_in = in_video_filter_;
-      filt_out = out_video_filter_;
-      last_w = frame->width;
-      last_h = frame->height;
-      last_format = static_cast<AVPixelFormat>(frame->format);
-      frame_rate = filt_out->inputs[0]->frame_rate;
+    while ((ret = OutputVideoFrame(&ctx)) > 0) {
     }
-
-    ret = av_buffersrc_add_frame(filt_in, frame);
     if (ret < 0) {
-      goto the_end;
+      break;
     }
+  }
 
-    while (ret >= 0) {
-      frame_last_returned_time_ = GetRealClockTime();
+  FreeVideoDecode(&ctx);
+  return 0;
+}
 
-      ret = av_buffersink_get_frame_flags(filt_out, frame, 0);
-      if (ret < 0) {
-        if (ret == AVERROR_EOF) {
-          viddec_->SetFinished(true);
-        }
-        ret = 0;
-        break;
-      }
+int VideoState::InitVideoDecode(VideoDecodeContext* ctx) {
+  ctx->frame = av_frame_alloc();
+  if (!ctx->frame) {
+    return AVERROR(ENOMEM);
+  }
 
-      frame_last_filter_delay_ = GetRealClockTime() - frame_last_returned_time_;
-      if (std::abs(frame_last_filter_delay_) > AV_NOSYNC_THRESHOLD_MSEC) {
-        frame_last_filter_delay_ = 0;
-      }
-      if (filt_out) {
-        tb = filt_out->inputs[0]->time_base;
-      }
+#if CONFIG_AVFILTER
+  ctx->graph = avfilter_graph_alloc();
+  ctx->filt_out = nullptr;
+  ctx->filt_in = nullptr;
+  ctx->last_w = 0;
+  ctx->last_h = 0;
+  ctx->last_format = AV_PIX_FMT_NONE;  // -2
+  if (!ctx->graph) {
+    av_frame_free(&ctx->frame);
+    return AVERROR(ENOMEM);
+  }
+#else
+  ctx->pending = false;
 #endif
-      AVRational fr = {frame_rate.den, frame_rate.num};
-      clock64_t duration = (frame_rate.num && frame_rate.den ? q2d_diff(fr) : 0);
-      clock64_t pts = IsValidPts(frame->pts) ? frame->pts * q2d_diff(tb) : invalid_clock();
-      ret = QueuePicture(frame, pts, duration, frame->pkt_pos);
-      av_frame_unref(frame);
+
+  ctx->tb = vstream_->GetTimeBase();
+  ctx->frame_rate = vstream_->GetFrameRate();
+  ctx->skip_frame = viddec_->GetAvCtx()->skip_frame;
+  ctx->budget_skip = AVDISCARD_DEFAULT;
+  ctx->budget_start = 0;
+  ctx->budget_cpu = 0;
+  ctx->budget_capped = false;
+  ctx->drain_count = viddec_->GetDrainCount();
+  ctx->flush_count = viddec_->GetFlushCount();
+  ctx->seek_target = invalid_clock();
+  ctx->seek_skipped_pts = invalid_clock();
+  ctx->preview = false;
+  ctx->reverse_held = false;
+  ctx->reverse_pts = invalid_clock();
+  ctx->reverse_duration = 0;
+  ctx->ended = false;
+  return 0;
+}
+
+void VideoState::FreeVideoDecode(VideoDecodeContext* ctx) {
 #if CONFIG_AVFILTER
-    }
+  avfilter_graph_free(&ctx->graph);
 #endif
+  av_frame_free(&ctx->frame);
+}
+
+int VideoState::DecodeVideo(VideoDecodeContext* ctx) {
+  AVFrame* frame = ctx->frame;
+  AVCodecContext* video_ctx = viddec_->GetAvCtx();
+  /* decode cost must not scale with the speed */
+  if (trick_rate_req_) {  // intra frames only
+    video_ctx->skip_frame = AVDISCARD_NONKEY;
+  } else if (IsValidClock(ctx->seek_skipped_pts) &&
+             ctx->seek_skipped_pts < ctx->seek_target - ACCURATE_SEEK_NONREF_MSEC) {
+    /* far before the seek target only the reference chain is needed */
+    video_ctx->skip_frame = FFMAX(ctx->skip_frame, AVDISCARD_NONREF);
+  } else {
+    video_ctx->skip_frame =
+        speed_ > VIDEO_SKIP_NONREF_SPEED ? FFMAX(ctx->skip_frame, AVDISCARD_NONREF) : ctx->skip_frame;
+  }
+  const AVDiscard budget_skip = UpdateDecodeBudget(ctx);
+  video_ctx->skip_frame = FFMAX(video_ctx->skip_frame, budget_skip);
+  int ret = GetVideoFrame(frame);
+  if (ret < 0) {
+    return ret;
+  }
+  if (ctx->drain_count != viddec_->GetDrainCount()) {  // every frame of the reverse segment is out
+    ctx->drain_count = viddec_->GetDrainCount();
+    reverse_cache_->EndSegment();
+  }
+  if (ctx->flush_count != viddec_->GetFlushCount()) {
+    ctx->flush_count = viddec_->GetFlushCount();
+    ctx->seek_target = video_seek_target_.exchange(invalid_clock());
+    ctx->seek_skipped_pts = invalid_clock();
+    ctx->preview = video_preview_req_.exchange(false);
+  }
+  if (!ret) {
+    return 0;
+  }
+  if (viddec_->GetSerial() != vstream_->GetQueue()->GetSerial()) {  // a newer seek superseded it
+    av_frame_unref(frame);
+    return 0;
+  }
+
+  if (ctx->preview) {  // the scrubbing preview keyframe, shown whatever the seek target
+    ctx->preview = false;
+  } else if (IsValidClock(ctx->seek_target)) {  // before the seek target: not downloaded, filtered or queued
+    const clock64_t pts = IsValidPts(frame->pts) ? vstream_->q2d() * frame->pts : invalid_clock();
+    AVRational fr = {ctx->frame_rate.den, ctx->frame_rate.num};
+    clock64_t duration = (ctx->frame_rate.num && ctx->frame_rate.den ? q2d_diff(fr) : 0);
+    if (IsValidClock(pts) && pts + duration <= ctx->seek_target) {
+      ctx->seek_skipped_pts = pts;
+      av_frame_unref(frame);
+      return 0;
+    }
+    ctx->seek_target = invalid_clock();
+    ctx->seek_skipped_pts = invalid_clock();
+  }
+
+  if (input_st_->hwaccel_retrieve_data && frame->format == input_st_->hwaccel_pix_fmt) {
+    int err = input_st_->hwaccel_retrieve_data(viddec_->GetAvCtx(), frame);
+    if (err < 0) {
+      return 0;
+    }
+  }
+  input_st_->hwaccel_retrieved_pix_fmt = static_cast<AVPixelFormat>(frame->format);
 
+#if CONFIG_AVFILTER
+  if (ctx->last_w != frame->width || ctx->last_h != frame->height || ctx->last_format != frame->format) {  // -vf
+    const std::string mess = common::MemSPrintf(
+        "Video frame changed from size:%dx%d format:%s serial:%d to "
+        "size:%dx%d format:%s "
+        "serial:%d",
+        ctx->last_w, ctx->last_h, static_cast<const char*>(av_x_if_null(av_get_pix_fmt_name(ctx->last_format), "none")),
+        0, frame->width, frame->height,
+        static_cast<const char*>(av_x_if_null(av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format)), "none")),
+        0);
+    DEBUG_LOG() << mess;
+    avfilter_graph_free(&ctx->graph);
+    ctx->graph = avfilter_graph_alloc();
+    const std::string vfilters = opt_.vfilters;
+    ret = ConfigureVideoFilters(ctx->graph, vfilters, frame);
     if (ret < 0) {
-      goto the_end;
+      ERROR_LOG() << "Internal video error!";
+      return ret;
     }
+    ctx->filt_in = in_video_filter_;
+    ctx->filt_out = out_video_filter_;
+    ctx->last_w = frame->width;
+    ctx->last_h = frame->height;
+    ctx->last_format = static_cast<AVPixelFormat>(frame->format);
+    ctx->frame_rate = ctx->filt_out->inputs[0]->frame_rate;
   }
-the_end:
+
+  ret = av_buffersrc_add_frame(ctx->filt_in, frame);
+  return ret < 0 ? ret : 1;
+#else
+  ctx->pending = true;
+  return 1;
+#endif
+}
+
+AVDiscard VideoState::UpdateDecodeBudget(VideoDecodeContext* ctx) {
+  const int budget = decode_budget_;
+  if (!budget) {
+    ctx->budget_skip = AVDISCARD_DEFAULT;
+    ctx->budget_start = 0;
+    return AVDISCARD_DEFAULT;
+  }
+
+  const clock64_t now = GetRealClockTime();
+  const int64_t cpu = cpu_usec_.load(std::memory_order_relaxed);
+  if (!ctx->budget_start) {
+    ctx->budget_start = now;
+    ctx->budget_cpu = cpu;
+    ctx->budget_capped = false;
+  }
+
+  /* usec per msec of wall time is 1000 for a whole core */
+  const int64_t spent = cpu - ctx->budget_cpu;
+  const clock64_t elapsed = now - ctx->budget_start;
+  if (elapsed < DECODE_BUDGET_WINDOW_MSEC) {
+    if (spent > static_cast<int64_t>(budget) * 10 * DECODE_BUDGET_WINDOW_MSEC) {
+      ctx->budget_capped = true;
+    }
+    return ctx->budget_capped ? AVDISCARD_ALL : ctx->budget_skip;
+  }
+
+  const double load = spent / 10.0 / elapsed;
+  const AVDiscard skip = ctx->budget_skip;
+  if (ctx->budget_capped) {  // references were lost, the decoder starts over at a keyframe
+    ctx->budget_skip = AVDISCARD_NONKEY;
+  } else if (load > budget) {
+    ctx->budget_skip = skip == AVDISCARD_DEFAULT ? AVDISCARD_NONREF : AVDISCARD_NONKEY;
+  } else if (load < budget / 2.0) {  // the lighter level costs about twice as much
+    ctx->budget_skip = skip == AVDISCARD_NONKEY ? AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+  }
+  if (ctx->budget_skip != skip) {
+    DEBUG_LOG() << "Decode budget " << budget << "%, load " << load << "%, skip level " << skip << " -> "
+                << ctx->budget_skip;
+  }
+  ctx->budget_start = now;
+  ctx->budget_cpu = cpu;
+  ctx->budget_capped = false;
+  return ctx->budget_skip;
+}
+
+int VideoState::OutputVideoFrame(VideoDecodeContext* ctx) {
+  AVFrame* frame = ctx->frame;
 #if CONFIG_AVFILTER
-  avfilter_graph_free(&graph);
+  if (!ctx->filt_out) {  // nothing decoded yet
+    return 0;
+  }
+
+  frame_last_returned_time_ = GetRealClockTime();
+  int ret = av_buffersink_get_frame_flags(ctx->filt_out, frame, 0);
+  if (ret < 0) {
+    if (ret == AVERROR_EOF) {
+      viddec_->SetFinished(true);
+    }
+    return 0;
+  }
+
+  frame_last_filter_delay_ = GetRealClockTime() - frame_last_returned_time_;
+  if (std::abs(frame_last_filter_delay_) > AV_NOSYNC_THRESHOLD_MSEC) {
+    frame_last_filter_delay_ = 0;
+  }
+  ctx->tb = ctx->filt_out->inputs[0]->time_base;
+#else
+  if (!ctx->pending) {
+    return 0;
+  }
+  ctx->pending = false;
+  int ret = 0;
 #endif
-  av_frame_free(&frame);
+
+  AVRational fr = {ctx->frame_rate.den, ctx->frame_rate.num};
+  clock64_t duration = (ctx->frame_rate.num && ctx->frame_rate.den ? q2d_diff(fr) : 0);
+  clock64_t pts = IsValidPts(frame->pts) ? frame->pts * q2d_diff(ctx->tb) : invalid_clock();
+  if (reverse_req_ && video_job_) {  // a pool job doesn't wait for the cache, the step sleeps with the frame
+    ctx->reverse_held = true;
+    ctx->reverse_pts = pts;
+    ctx->reverse_duration = duration;
+    PutHeldReverseFrame(ctx);
+    return 1;
+  } else if (reverse_req_) {  // shown backward from the cache once the segment is complete
+    reverse_cache_->Put(frame, pts, duration, frame->pkt_pos);
+  } else {
+    ret = QueuePicture(frame, pts, duration, frame->pkt_pos, viddec_->GetSerial());
+  }
+  av_frame_unref(frame);
+  return ret < 0 ? ret : 1;
+}
+
+bool VideoState::PutHeldReverseFrame(VideoDecodeContext* ctx) {
+  if (!ctx->reverse_held) {
+    return true;
+  }
+
+  AVFrame* frame = ctx->frame;
+  if (reverse_req_ &&
+      !reverse_cache_->TryPut(frame, ctx->reverse_pts, ctx->reverse_duration, frame->pkt_pos)) {
+    return false;
+  }
+  av_frame_unref(frame);
+  ctx->reverse_held = false;
+  return true;
+}
+
+int VideoState::StartVideoJob() {
+  video_decode_ = new VideoDecodeContext;
+  int ret = InitVideoDecode(video_decode_);
+  if (ret < 0) {
+    destroy(&video_decode_);
+    return ret;
+  }
+
+  SerialJob* job = new SerialJob(worker_pool_, [this]() { return VideoStep(); }, task_priority_);
+  video_job_ = job;
+  viddec_->SetNonBlocking(true);
+  vstream_->GetQueue()->SetNotify([job]() { job->Signal(); });
+  video_frame_queue_->SetReleaseNotify([job]() { job->Signal(); });
+  reverse_cache_->SetReleaseNotify([job]() { job->Signal(); });
+  job->Signal();
+  return 0;
+}
+
+int VideoState::StartAudioJob() {
+  audio_decode_ = new AudioDecodeContext;
+  int ret = InitAudioDecode(audio_decode_);
+  if (ret < 0) {
+    destroy(&audio_decode_);
+    return ret;
+  }
+
+  SerialJob* job = new SerialJob(worker_pool_, [this]() { return AudioStep(); }, task_priority_);
+  audio_job_ = job;
+  auddec_->SetNonBlocking(true);
+  astream_->GetQueue()->SetNotify([job]() { job->Signal(); });
+  audio_ring_->SetNotify([job]() { job->Wake(); });  // from the device callback
+  job->Signal();
   return 0;
 }
 
+bool VideoState::VideoStep() {
+  VideoDecodeContext* ctx = video_decode_;
+  if (ctx->ended) {
+    return false;
+  }
+
+  RegisterWakeup(VIDEO_DECODER_WAKEUP);
+  int64_t cpu_usec = GetThreadCpuUsec();
+  video_job_->SetPriority(task_priority_);
+  bool more = false;
+  /* one frame per step, only while there is room for it: the display wakes the job when it releases a picture
+   * or a backward frame */
+  if (PutHeldReverseFrame(ctx) && (reverse_req_ || !video_frame_queue_->IsFull())) {
+    int ret = OutputVideoFrame(ctx);
+    if (!ret) {
+      ret = DecodeVideo(ctx);
+      more = ret > 0 || !viddec_->IsStarved();
+    } else {
+      more = ret > 0;
+    }
+    ctx->ended = ret < 0;
+  }
+  AccountThreadCpu(&cpu_usec);
+  return more && !ctx->ended;
+}
+
+bool VideoState::AudioStep() {
+  AudioDecodeContext* ctx = audio_decode_;
+  if (ctx->ended) {
+    return false;
+  }
+
+  RegisterWakeup(AUDIO_DECODER_WAKEUP);
+  int64_t cpu_usec = GetThreadCpuUsec();
+  audio_job_->SetPriority(task_priority_);
+  bool more = false;
+  /* a frame is converted and written at once, the device callback wakes the job when half of the ring is free */
+  if (audio_ring_->ArmWritable(audio_ring_->GetCapacity() / 2)) {
+    int ret = OutputAudioFrame(ctx);
+    if (!ret) {
+      ret = DecodeAudio(ctx);
+      more = ret > 0 || !auddec_->IsStarved();
+    } else {
+      more = ret > 0;
+    }
+    ctx->ended = ret < 0;
+  }
+  AccountThreadCpu(&cpu_usec);
+  return more && !ctx->ended;
+}
+
 #if CONFIG_AVFILTER
 int VideoState::ConfigureVideoFilters(AVFilterGraph* graph, const std::string& vfilters, AVFrame* frame) {
   static const enum AVPixelFormat pix_fmts[] = {AV_PIX_FMT_YUV420P, AV_PIX_FMT_BGRA, AV_PIX_FMT_NONE};
@@ -1818,7 +3178,14 @@ int VideoState::ConfigureVideoFilters(AVFilterGraph* graph, const std::string& v
 }
 
 int VideoState::ConfigureAudioFilters(const std::string& afilters, int force_output_format) {
-  static const enum AVSampleFormat sample_fmts[] = {AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE};
+  /* formats the output can take without swresample, planar ones are interleaved by QueueAudioFrame */
+  enum AVSampleFormat sample_fmts[] = {AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16P,
+                                       AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P, AV_SAMPLE_FMT_NONE};
+  if (force_output_format) {
+    sample_fmts[0] = audio_tgt_.fmt;
+    sample_fmts[1] = av_get_planar_sample_fmt(audio_tgt_.fmt);
+    sample_fmts[2] = AV_SAMPLE_FMT_NONE;
+  }
   avfilter_graph_free(&agraph_);
   agraph_ = avfilter_graph_alloc();
   if (!agraph_) {
@@ -1900,7 +3267,12 @@ int VideoState::ConfigureAudioFilters(const std::string& afilters, int force_out
     }
   }
 
-  const char* afilters_ptr = afilters.empty() ? nullptr : afilters.c_str();
+  std::string filters = afilters;
+  if (audio_filter_speed_ != 1.0) {
+    const std::string tempo = make_atempo_filters(audio_filter_speed_);
+    filters = filters.empty() ? tempo : filters + "," + tempo;
+  }
+  const char* afilters_ptr = filters.empty() ? nullptr : filters.c_str();
   ret = configure_filtergraph(agraph_, afilters_ptr, filt_asrc, filt_asink);
   if (ret < 0) {
     avfilter_graph_free(&agraph_);
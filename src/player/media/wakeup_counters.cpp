@@ -0,0 +1,149 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/media/wakeup_counters.h>
+
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <common/macros.h>
+
+namespace fastoplayer {
+namespace media {
+
+namespace {
+
+const char* wakeup_source_names[] = {"main", "read", "video decoder", "audio decoder", "audio callback"};
+static_assert(SIZEOFMASS(wakeup_source_names) == WAKEUP_SOURCES_COUNT, "wakeup_source_names should match sources");
+
+// counts of one thread, written only by it
+struct WakeupSlot {
+  WakeupSlot();
+  ~WakeupSlot();
+
+  std::atomic<uint64_t> counts[WAKEUP_SOURCES_COUNT];
+};
+
+class WakeupSlots {
+ public:
+  typedef std::unique_lock<std::mutex> lock_t;
+
+  // never destroyed, threads still can exit while static objects are torn down
+  static WakeupSlots* GetInstance() {
+    static WakeupSlots* slots = new WakeupSlots;
+    return slots;
+  }
+
+  void Register(WakeupSlot* slot) {
+    lock_t lock(mutex_);
+    slots_.push_back(slot);
+  }
+
+  // the counts of a finished thread are kept
+  void Unregister(WakeupSlot* slot) {
+    lock_t lock(mutex_);
+    for (size_t i = 0; i < WAKEUP_SOURCES_COUNT; ++i) {
+      finished_counts_[i] += slot->counts[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      if (slots_[i] == slot) {
+        slots_.erase(slots_.begin() + i);
+        break;
+      }
+    }
+  }
+
+  uint64_t GetCount(WakeupSource source) const {
+    lock_t lock(mutex_);
+    uint64_t count = finished_counts_[source];
+    for (const WakeupSlot* slot : slots_) {
+      count += slot->counts[source].load(std::memory_order_relaxed);
+    }
+    return count;
+  }
+
+ private:
+  WakeupSlots() : mutex_(), slots_(), finished_counts_() {}
+
+  mutable std::mutex mutex_;
+  std::vector<WakeupSlot*> slots_;
+  uint64_t finished_counts_[WAKEUP_SOURCES_COUNT];
+
+  DISALLOW_COPY_AND_ASSIGN(WakeupSlots);
+};
+
+WakeupSlot::WakeupSlot() {
+  for (size_t i = 0; i < WAKEUP_SOURCES_COUNT; ++i) {
+    counts[i].store(0, std::memory_order_relaxed);
+  }
+  WakeupSlots::GetInstance()->Register(this);
+}
+
+WakeupSlot::~WakeupSlot() {
+  WakeupSlots::GetInstance()->Unregister(this);
+}
+
+thread_local WakeupSlot wakeup_slot;
+
+}  // namespace
+
+WakeupsSnapshot::WakeupsSnapshot() : counts() {}
+
+void RegisterWakeup(WakeupSource source) {
+  DCHECK(source < WAKEUP_SOURCES_COUNT);
+  // no other thread writes the slot, so the loops of different threads never share a counter
+  std::atomic<uint64_t>& count = wakeup_slot.counts[source];
+  count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+uint64_t GetWakeupsCount(WakeupSource source) {
+  DCHECK(source < WAKEUP_SOURCES_COUNT);
+  return WakeupSlots::GetInstance()->GetCount(source);
+}
+
+const char* WakeupSourceToString(WakeupSource source) {
+  DCHECK(source < WAKEUP_SOURCES_COUNT);
+  return wakeup_source_names[source];
+}
+
+WakeupsSnapshot GetWakeupsSnapshot() {
+  WakeupsSnapshot snapshot;
+  for (size_t i = 0; i < WAKEUP_SOURCES_COUNT; ++i) {
+    snapshot.counts[i] = GetWakeupsCount(static_cast<WakeupSource>(i));
+  }
+  return snapshot;
+}
+
+std::string WakeupsSinceToString(const WakeupsSnapshot& snapshot) {
+  std::stringstream wr;
+  for (size_t i = 0; i < WAKEUP_SOURCES_COUNT; ++i) {
+    const WakeupSource source = static_cast<WakeupSource>(i);
+    if (i != 0) {
+      wr << ", ";
+    }
+    wr << WakeupSourceToString(source) << ": " << GetWakeupsCount(source) - snapshot.counts[i];
+  }
+  return wr.str();
+}
+
+}  // namespace media
+}  // namespace fastoplayer
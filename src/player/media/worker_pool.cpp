@@ -0,0 +1,334 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <player/media/worker_pool.h>
+
+#include <algorithm>
+#include <deque>
+#include <thread>
+
+#include <common/logger.h>
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+namespace fastoplayer {
+namespace media {
+
+namespace {
+/* worker running on the calling thread, posting from it keeps the task on that worker */
+thread_local const WorkerPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+}  // namespace
+
+class WorkerPool::Worker {
+ public:
+  Worker(WorkerPool* pool, size_t index) : mutex(), queues(), tid(), pool_(pool), index_(index) {}
+
+  int Exec() { return pool_->WorkerRoutine(index_); }
+
+  std::mutex mutex;
+  std::deque<task_t> queues[TASK_PRIORITIES_COUNT];
+  std::shared_ptr<common::threads::Thread<int>> tid;
+
+ private:
+  WorkerPool* const pool_;
+  const size_t index_;
+
+  DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+WorkerPool::WorkerPool(size_t threads_count)
+    : threads_count_(threads_count ? threads_count : std::max(std::thread::hardware_concurrency(), 1u)),
+      workers_(),
+      next_worker_(0),
+      pending_(0),
+      stolen_(0),
+      mutex_(),
+      cond_(),
+      stop_(false),
+      woken_(false),
+      jobs_mutex_(),
+      jobs_() {
+  for (size_t i = 0; i < threads_count_; ++i) {
+    workers_.push_back(new Worker(this, i));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  Stop();
+  for (Worker* worker : workers_) {
+    delete worker;
+  }
+}
+
+bool WorkerPool::Start() {
+  {
+    lock_t lock(mutex_);
+    stop_ = false;
+  }
+  for (Worker* worker : workers_) {
+    if (worker->tid) {
+      continue;
+    }
+
+    worker->tid = THREAD_MANAGER()->CreateThread(&Worker::Exec, worker);
+    if (!worker->tid->Start()) {
+      worker->tid.reset();
+      Stop();
+      return false;
+    }
+  }
+  return true;
+}
+
+void WorkerPool::Stop() {
+  {
+    lock_t lock(mutex_);
+    stop_ = true;
+    cond_.notify_all();
+  }
+  /* the workers take tasks for as long as there are any, so they exit once the running ones are done */
+  DropTasks();
+  for (Worker* worker : workers_) {
+    if (!worker->tid) {
+      continue;
+    }
+
+    worker->tid->Join();
+    worker->tid.reset();
+  }
+  DropTasks();
+}
+
+size_t WorkerPool::GetThreadsCount() const {
+  return threads_count_;
+}
+
+size_t WorkerPool::GetStolenCount() const {
+  return stolen_;
+}
+
+void WorkerPool::Post(task_t task, TaskPriority priority) {
+  if (!task || priority < TASK_PRIORITY_HIGH || priority >= TASK_PRIORITIES_COUNT) {
+    DNOTREACHED();
+    return;
+  }
+
+  size_t index = GetCurrentWorker();
+  if (index == threads_count_) {
+    index = next_worker_.fetch_add(1) % threads_count_;
+  }
+
+  Worker* worker = workers_[index];
+  {
+    lock_t lock(worker->mutex);
+    worker->queues[priority].push_back(std::move(task));
+  }
+  pending_++;
+  /* the workers check pending_ under this mutex before they sleep, so the notify can't be lost */
+  lock_t lock(mutex_);
+  cond_.notify_one();
+}
+
+int WorkerPool::WorkerRoutine(size_t index) {
+  current_pool = this;
+  current_worker = index;
+  while (true) {
+    if (woken_.exchange(false)) {
+      SignalWokenJobs();
+    }
+
+    task_t task;
+    if (TakeTask(index, &task)) {
+      task();
+      continue;
+    }
+
+    lock_t lock(mutex_);
+    cond_.wait(lock, [this]() { return stop_ || pending_ > 0 || woken_; });
+    if (stop_) {
+      break;
+    }
+  }
+  current_pool = nullptr;
+  return 0;
+}
+
+bool WorkerPool::TakeTask(size_t index, task_t* task) {
+  for (size_t priority = 0; priority < TASK_PRIORITIES_COUNT; ++priority) {
+    for (size_t i = 0; i < threads_count_; ++i) {  // own queue first, then the next workers
+      Worker* worker = workers_[(index + i) % threads_count_];
+      lock_t lock(worker->mutex);
+      std::deque<task_t>& queue = worker->queues[priority];
+      if (queue.empty()) {
+        continue;
+      }
+
+      *task = std::move(queue.front());
+      queue.pop_front();
+      pending_--;
+      if (i) {
+        stolen_++;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkerPool::DropTasks() {
+  for (Worker* worker : workers_) {
+    lock_t lock(worker->mutex);
+    for (std::deque<task_t>& queue : worker->queues) {
+      pending_ -= queue.size();
+      queue.clear();
+    }
+  }
+}
+
+size_t WorkerPool::GetCurrentWorker() const {
+  return current_pool == this ? current_worker : threads_count_;
+}
+
+void WorkerPool::AddJob(SerialJob* job) {
+  lock_t lock(jobs_mutex_);
+  jobs_.push_back(job);
+}
+
+void WorkerPool::RemoveJob(SerialJob* job) {
+  lock_t lock(jobs_mutex_);
+  jobs_.erase(std::remove(jobs_.begin(), jobs_.end(), job), jobs_.end());
+}
+
+void WorkerPool::Wake() {
+  woken_ = true;
+  /* holding the mutex no worker is between its look at woken_ and its sleep, so the notify can't be lost; it is
+   * never waited for here, a notify lost without it is made up by the next wake */
+  const bool locked = mutex_.try_lock();
+  cond_.notify_one();
+  if (locked) {
+    mutex_.unlock();
+  }
+}
+
+void WorkerPool::SignalWokenJobs() {
+  lock_t lock(jobs_mutex_);
+  for (SerialJob* job : jobs_) {
+    if (job->woken_.exchange(false)) {
+      job->Signal();
+    }
+  }
+}
+
+struct SerialJob::State {
+  enum Status { IDLE, QUEUED, RUNNING, RUNNING_SIGNALED };
+
+  State(WorkerPool* pool, step_t step, TaskPriority priority)
+      : pool(pool), step(step), priority(priority), mutex(), cond(), status(IDLE), cancelled(false), runner() {}
+
+  WorkerPool* const pool;  // alive while the job is, queued tasks are dropped by the pool when it stops
+  const step_t step;
+  TaskPriority priority;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  Status status;
+  bool cancelled;
+  std::thread::id runner;
+};
+
+SerialJob::SerialJob(std::shared_ptr<WorkerPool> pool, step_t step, TaskPriority priority)
+    : pool_(pool), state_(std::make_shared<State>(pool.get(), step, priority)), woken_(false) {
+  CHECK(pool_);
+  pool_->AddJob(this);
+}
+
+SerialJob::~SerialJob() {
+  pool_->RemoveJob(this);
+  Cancel();
+}
+
+void SerialJob::Signal() {
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  if (state_->cancelled) {
+    return;
+  }
+
+  if (state_->status == State::IDLE) {
+    Schedule(state_);
+  } else if (state_->status == State::RUNNING) {
+    state_->status = State::RUNNING_SIGNALED;
+  }
+}
+
+void SerialJob::Wake() {
+  woken_ = true;
+  pool_->Wake();
+}
+
+void SerialJob::SetPriority(TaskPriority priority) {
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  state_->priority = priority;
+}
+
+void SerialJob::Cancel() {
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  state_->cancelled = true;
+  if (state_->runner == std::this_thread::get_id()) {
+    return;
+  }
+
+  state_->cond.wait(lock, [this]() {
+    return state_->status != State::RUNNING && state_->status != State::RUNNING_SIGNALED;
+  });
+}
+
+void SerialJob::Run(std::shared_ptr<State> state) {
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    if (state->cancelled) {
+      state->status = State::IDLE;
+      return;
+    }
+    state->status = State::RUNNING;
+    state->runner = std::this_thread::get_id();
+  }
+
+  const bool more = state->step();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->runner = std::thread::id();
+  if (state->cancelled) {
+    state->status = State::IDLE;
+    state->cond.notify_all();
+    return;
+  }
+
+  if (more || state->status == State::RUNNING_SIGNALED) {
+    Schedule(state);
+  } else {
+    state->status = State::IDLE;
+  }
+}
+
+void SerialJob::Schedule(const std::shared_ptr<State>& state) {
+  state->status = State::QUEUED;
+  state->pool->Post([state]() { Run(state); }, state->priority);
+}
+
+}  // namespace media
+}  // namespace fastoplayer
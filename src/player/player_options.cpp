@@ -25,6 +25,14 @@ PlayerOptions::PlayerOptions()
       default_size(width, height),
       screen_size(),
       audio_volume(volume),
+      low_latency_audio(false),
+      thumbnails(false),
+      thumbnails_cpu_share(thumbnails_cpu),
+      mosaic(mosaic_side),
+      worker_pool_threads(worker_pool),
+      standby_channels(standby),
+      pip_cpu_share(pip_cpu),
+      duck_volume(duck),
       last_showed_channel_id(media::invalid_stream_id) {}
 
 }  // namespace fastoplayer
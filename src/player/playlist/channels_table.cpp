@@ -0,0 +1,107 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/playlist/channels_table.h>
+
+namespace fastoplayer {
+namespace playlist {
+
+ChannelEntry::ChannelEntry() : name(), url(), tvg_id(), tvg_name(), logo(), group(), duration(-1) {}
+
+ChannelsTable::ChannelsTable() : arena_(), entries_() {}
+
+void ChannelsTable::Clear() {
+  arena_.Clear();
+  entries_.clear();
+}
+
+void ChannelsTable::ShrinkToFit() {
+  arena_.ShrinkToFit();
+  entries_.shrink_to_fit();
+}
+
+size_t ChannelsTable::GetCount() const {
+  return entries_.size();
+}
+
+const ChannelEntry& ChannelsTable::GetEntry(size_t index) const {
+  DCHECK(index < entries_.size());
+  return entries_[index];
+}
+
+std::string ChannelsTable::GetName(size_t index) const {
+  return arena_.GetString(GetEntry(index).name);
+}
+
+std::string ChannelsTable::GetUrl(size_t index) const {
+  return arena_.GetString(GetEntry(index).url);
+}
+
+std::string ChannelsTable::GetTvgId(size_t index) const {
+  return arena_.GetString(GetEntry(index).tvg_id);
+}
+
+std::string ChannelsTable::GetTvgName(size_t index) const {
+  return arena_.GetString(GetEntry(index).tvg_name);
+}
+
+std::string ChannelsTable::GetLogo(size_t index) const {
+  return arena_.GetString(GetEntry(index).logo);
+}
+
+std::string ChannelsTable::GetGroup(size_t index) const {
+  return arena_.GetString(GetEntry(index).group);
+}
+
+std::string ChannelsTable::GetStreamId(size_t index) const {
+  const ChannelEntry& entry = GetEntry(index);
+  return arena_.GetString(entry.tvg_id.IsEmpty() ? entry.url : entry.tvg_id);
+}
+
+bool ChannelsTable::FindByStreamId(const std::string& sid, size_t* index) const {
+  if (!index || sid.empty()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const ChannelEntry& entry = entries_[i];
+    const StringRef& id = entry.tvg_id.IsEmpty() ? entry.url : entry.tvg_id;
+    if (arena_.IsEqual(id, sid.data(), sid.size())) {
+      *index = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+size_t ChannelsTable::GetMemoryUsage() const {
+  return arena_.GetMemoryUsage() + entries_.capacity() * sizeof(ChannelEntry);
+}
+
+StringArena* ChannelsTable::GetArena() {
+  return &arena_;
+}
+
+void ChannelsTable::AddChannel(const ChannelEntry& entry) {
+  entries_.push_back(entry);
+}
+
+}  // namespace playlist
+}  // namespace fastoplayer
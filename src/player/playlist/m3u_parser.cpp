@@ -0,0 +1,220 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/playlist/m3u_parser.h>
+
+#include <string.h>
+
+#include <common/sprintf.h>
+
+#include <player/playlist/mapped_file.h>
+
+#define EXTINF_TAG "#EXTINF:"
+#define EXTGRP_TAG "#EXTGRP:"
+#define UTF8_BOM "\xEF\xBB\xBF"
+
+namespace fastoplayer {
+namespace playlist {
+
+namespace {
+
+struct Slice {
+  Slice() : data(nullptr), size(0) {}
+  Slice(const char* data, size_t size) : data(data), size(size) {}
+
+  bool StartsWith(const char* prefix, size_t prefix_size) const {
+    return size >= prefix_size && memcmp(data, prefix, prefix_size) == 0;
+  }
+
+  bool IsEqual(const char* str, size_t str_size) const { return size == str_size && memcmp(data, str, size) == 0; }
+
+  const char* data;
+  size_t size;
+};
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+Slice Trim(Slice slice) {
+  while (slice.size && IsSpace(slice.data[0])) {
+    slice.data++;
+    slice.size--;
+  }
+  while (slice.size && IsSpace(slice.data[slice.size - 1])) {
+    slice.size--;
+  }
+  return slice;
+}
+
+int32_t ParseDuration(Slice* line) {
+  bool negative = false;
+  int32_t result = 0;
+  size_t pos = 0;
+  if (pos < line->size && line->data[pos] == '-') {
+    negative = true;
+    pos++;
+  }
+  while (pos < line->size && line->data[pos] >= '0' && line->data[pos] <= '9') {
+    result = result * 10 + (line->data[pos] - '0');
+    pos++;
+  }
+  line->data += pos;
+  line->size -= pos;
+  return negative ? -result : result;
+}
+
+#define ATTRIBUTE_IS(slice, name) (slice).IsEqual(name, sizeof(name) - 1)
+
+// parses attributes and title of #EXTINF line, tag already skipped
+void ParseExtInf(Slice line, StringArena* arena, ChannelEntry* entry) {
+  entry->duration = ParseDuration(&line);
+  size_t pos = 0;
+  while (pos < line.size) {
+    const char c = line.data[pos];
+    if (c == ',') {
+      pos++;
+      break;
+    }
+
+    if (IsSpace(c)) {
+      pos++;
+      continue;
+    }
+
+    // key=value or key="value"
+    const size_t key_start = pos;
+    while (pos < line.size && line.data[pos] != '=' && line.data[pos] != ',' && !IsSpace(line.data[pos])) {
+      pos++;
+    }
+    const Slice key(line.data + key_start, pos - key_start);
+    if (pos >= line.size || line.data[pos] != '=') {
+      continue;
+    }
+
+    pos++;  // =
+    Slice value;
+    if (pos < line.size && line.data[pos] == '"') {
+      const char* start = line.data + pos + 1;
+      const char* end = static_cast<const char*>(memchr(start, '"', line.size - pos - 1));
+      if (!end) {  // broken line, take the rest
+        end = line.data + line.size;
+      }
+      value = Slice(start, end - start);
+      pos = end - line.data + 1;
+    } else {
+      const size_t value_start = pos;
+      while (pos < line.size && line.data[pos] != ',' && !IsSpace(line.data[pos])) {
+        pos++;
+      }
+      value = Slice(line.data + value_start, pos - value_start);
+    }
+
+    if (ATTRIBUTE_IS(key, "tvg-id")) {
+      entry->tvg_id = arena->Append(value.data, value.size);
+    } else if (ATTRIBUTE_IS(key, "tvg-name")) {
+      entry->tvg_name = arena->Append(value.data, value.size);
+    } else if (ATTRIBUTE_IS(key, "tvg-logo")) {
+      entry->logo = arena->Intern(value.data, value.size);
+    } else if (ATTRIBUTE_IS(key, "group-title")) {
+      entry->group = arena->Intern(value.data, value.size);
+    }
+  }
+
+  if (pos < line.size) {
+    const Slice title = Trim(Slice(line.data + pos, line.size - pos));
+    entry->name = arena->Append(title.data, title.size);
+  }
+}
+
+}  // namespace
+
+common::Error ParseM3uFile(const std::string& path, ChannelsTable* table) {
+  if (!table) {
+    return common::make_error_inval();
+  }
+
+  MappedFile file;
+  common::ErrnoError errn = file.Open(path);
+  if (errn) {
+    return common::make_error(common::MemSPrintf("Can't open playlist %s: %s", path, errn->GetDescription()));
+  }
+
+  return ParseM3u(file.GetData(), file.GetSize(), table);
+}
+
+common::Error ParseM3u(const char* data, size_t size, ChannelsTable* table) {
+  if (!table || (!data && size)) {
+    return common::make_error_inval();
+  }
+
+  table->Clear();
+  StringArena* arena = table->GetArena();
+  const char* cur = data;
+  const char* end = data + size;
+  if (size >= sizeof(UTF8_BOM) - 1 && memcmp(cur, UTF8_BOM, sizeof(UTF8_BOM) - 1) == 0) {
+    cur += sizeof(UTF8_BOM) - 1;
+  }
+
+  ChannelEntry pending;
+  bool has_pending = false;
+  while (cur < end) {
+    const char* eol = static_cast<const char*>(memchr(cur, '\n', end - cur));
+    if (!eol) {
+      eol = end;
+    }
+
+    const Slice line = Trim(Slice(cur, eol - cur));
+    cur = eol + 1;
+    if (line.size == 0) {
+      continue;
+    }
+
+    if (line.data[0] == '#') {
+      if (line.StartsWith(EXTINF_TAG, sizeof(EXTINF_TAG) - 1)) {
+        pending = ChannelEntry();
+        has_pending = true;
+        const size_t tag_size = sizeof(EXTINF_TAG) - 1;
+        ParseExtInf(Slice(line.data + tag_size, line.size - tag_size), arena, &pending);
+      } else if (has_pending && pending.group.IsEmpty() && line.StartsWith(EXTGRP_TAG, sizeof(EXTGRP_TAG) - 1)) {
+        const size_t tag_size = sizeof(EXTGRP_TAG) - 1;
+        const Slice group = Trim(Slice(line.data + tag_size, line.size - tag_size));
+        pending.group = arena->Intern(group.data, group.size);
+      }
+      continue;
+    }
+
+    // url line closes entry
+    if (!has_pending) {
+      pending = ChannelEntry();
+    }
+    pending.url = arena->Append(line.data, line.size);
+    if (pending.name.IsEmpty()) {
+      pending.name = pending.url;
+    }
+    table->AddChannel(pending);
+    has_pending = false;
+  }
+
+  table->ShrinkToFit();
+  return common::Error();
+}
+
+}  // namespace playlist
+}  // namespace fastoplayer
@@ -0,0 +1,144 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/playlist/mapped_file.h>
+
+#include <errno.h>
+#include <sys/stat.h>
+
+#if defined(OS_WIN)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace fastoplayer {
+namespace playlist {
+
+MappedFile::MappedFile()
+    : data_(nullptr),
+      size_(0),
+      mtime_(0)
+#if defined(OS_WIN)
+      ,
+      file_(INVALID_HANDLE_VALUE),
+      mapping_(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+common::ErrnoError MappedFile::Open(const std::string& path) {
+  if (path.empty()) {
+    return common::make_errno_error_inval();
+  }
+
+  Close();
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return common::make_errno_error(errno);
+  }
+
+  mtime_ = st.st_mtime;
+  if (st.st_size == 0) {  // nothing to map, empty file is valid
+    return common::ErrnoError();
+  }
+
+#if defined(OS_WIN)
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return common::make_errno_error(EACCES);
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping) {
+    CloseHandle(file);
+    return common::make_errno_error(ENOMEM);
+  }
+
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return common::make_errno_error(ENOMEM);
+  }
+
+  file_ = file;
+  mapping_ = mapping;
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return common::make_errno_error(errno);
+  }
+
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int err = errno;
+  close(fd);
+  if (data == MAP_FAILED) {
+    return common::make_errno_error(err);
+  }
+#endif
+
+  data_ = static_cast<const char*>(data);
+  size_ = st.st_size;
+  return common::ErrnoError();
+}
+
+void MappedFile::Close() {
+  if (data_) {
+#if defined(OS_WIN)
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    munmap(const_cast<char*>(data_), size_);
+#endif
+  }
+
+  data_ = nullptr;
+  size_ = 0;
+  mtime_ = 0;
+}
+
+bool MappedFile::IsOpened() const {
+  return data_ != nullptr;
+}
+
+const char* MappedFile::GetData() const {
+  return data_;
+}
+
+size_t MappedFile::GetSize() const {
+  return size_;
+}
+
+int64_t MappedFile::GetModificationTime() const {
+  return mtime_;
+}
+
+}  // namespace playlist
+}  // namespace fastoplayer
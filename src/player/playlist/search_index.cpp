@@ -0,0 +1,282 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/playlist/search_index.h>
+
+#include <algorithm>
+
+namespace fastoplayer {
+namespace playlist {
+
+namespace {
+
+bool IsWordSeparator(char c) {
+  return !((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (static_cast<unsigned char>(c) & 0x80));
+}
+
+size_t CalcRank(const std::string& name, const std::string& query) {
+  const size_t pos = name.find(query);
+  if (pos == std::string::npos) {
+    return std::string::npos;
+  }
+
+  if (pos == 0) {
+    return 0;
+  }
+
+  // the search is repeated from the found position to catch later word prefixes
+  for (size_t cur = pos; cur != std::string::npos; cur = name.find(query, cur + 1)) {
+    if (IsWordSeparator(name[cur - 1])) {
+      return 1;
+    }
+  }
+  return 2;
+}
+
+}  // namespace
+
+SearchIndex::SearchIndex()
+    : names_(),
+      folded_(),
+      grams_(),
+      last_query_(),
+      last_mode_(NO_MATCH),
+      results_(),
+      candidates_(),
+      ranked_(),
+      scores_() {}
+
+void SearchIndex::Reserve(size_t count) {
+  names_.reserve(count);
+  folded_.reserve(count);
+}
+
+SearchIndex::entry_id_t SearchIndex::Add(const std::string& name) {
+  const entry_id_t id = static_cast<entry_id_t>(names_.size());
+  names_.push_back(name);
+  folded_.push_back(Fold(name));
+
+  const std::string& folded = folded_.back();
+  for (size_t i = 0; i + gram_size <= folded.size(); ++i) {
+    results_t& postings = grams_[MakeGram(folded.data() + i)];
+    if (postings.empty() || postings.back() != id) {  // ids are added in order, so postings stay sorted
+      postings.push_back(id);
+    }
+  }
+
+  ResetSearch();
+  return id;
+}
+
+void SearchIndex::Clear() {
+  names_.clear();
+  folded_.clear();
+  grams_.clear();
+  scores_.clear();
+  ResetSearch();
+}
+
+size_t SearchIndex::GetCount() const {
+  return names_.size();
+}
+
+const std::string& SearchIndex::GetName(entry_id_t id) const {
+  DCHECK(id < names_.size());
+  return names_[id];
+}
+
+const SearchIndex::results_t& SearchIndex::Search(const std::string& query) {
+  const std::string folded = Fold(query);
+  if (folded == last_query_ && last_mode_ != NO_MATCH) {
+    return results_;
+  }
+
+  const bool can_narrow = last_mode_ == SUBSTRING_MATCH && !last_query_.empty() &&
+                          folded.size() > last_query_.size() && folded.compare(0, last_query_.size(), last_query_) == 0;
+  if (folded.empty()) {
+    SearchAll(folded);
+  } else if (can_narrow) {
+    SearchNarrow(folded);
+  } else if (folded.size() < gram_size) {
+    SearchAll(folded);
+  } else {
+    SearchGrams(folded);
+  }
+
+  last_mode_ = results_.empty() ? NO_MATCH : SUBSTRING_MATCH;
+  if (last_mode_ == NO_MATCH && folded.size() >= gram_size) {
+    SearchFuzzy(folded);
+    if (!results_.empty()) {
+      last_mode_ = FUZZY_MATCH;
+    }
+  }
+
+  last_query_ = folded;
+  return results_;
+}
+
+const SearchIndex::results_t& SearchIndex::GetResults() const {
+  return results_;
+}
+
+SearchIndex::MatchMode SearchIndex::GetMatchMode() const {
+  return last_mode_;
+}
+
+void SearchIndex::ResetSearch() {
+  last_query_.clear();
+  last_mode_ = NO_MATCH;
+  results_.clear();
+}
+
+std::string SearchIndex::Fold(const std::string& text) {
+  std::string result(text);
+  for (size_t i = 0; i < result.size(); ++i) {
+    const char c = result[i];
+    if (c >= 'A' && c <= 'Z') {
+      result[i] = c - 'A' + 'a';
+    }
+  }
+  return result;
+}
+
+SearchIndex::gram_t SearchIndex::MakeGram(const char* data) {
+  return static_cast<gram_t>(static_cast<unsigned char>(data[0])) << 16 |
+         static_cast<gram_t>(static_cast<unsigned char>(data[1])) << 8 |
+         static_cast<gram_t>(static_cast<unsigned char>(data[2]));
+}
+
+void SearchIndex::SearchAll(const std::string& folded) {
+  candidates_.clear();
+  for (size_t i = 0; i < folded_.size(); ++i) {
+    candidates_.push_back(static_cast<entry_id_t>(i));
+  }
+  RankAndStore(folded, candidates_);
+}
+
+void SearchIndex::SearchNarrow(const std::string& folded) {
+  candidates_ = results_;
+  std::sort(candidates_.begin(), candidates_.end());
+  RankAndStore(folded, candidates_);
+}
+
+void SearchIndex::SearchGrams(const std::string& folded) {
+  std::vector<const results_t*> lists;
+  for (size_t i = 0; i + gram_size <= folded.size(); ++i) {
+    grams_t::const_iterator it = grams_.find(MakeGram(folded.data() + i));
+    if (it == grams_.end()) {
+      results_.clear();
+      return;
+    }
+    lists.push_back(&it->second);
+  }
+
+  std::sort(lists.begin(), lists.end(),
+            [](const results_t* lhs, const results_t* rhs) { return lhs->size() < rhs->size(); });
+  candidates_ = *lists[0];
+  for (size_t i = 1; i < lists.size() && !candidates_.empty(); ++i) {
+    const results_t& postings = *lists[i];
+    size_t stored = 0;
+    size_t pos = 0;
+    for (size_t j = 0; j < candidates_.size(); ++j) {
+      const entry_id_t id = candidates_[j];
+      pos = std::lower_bound(postings.begin() + pos, postings.end(), id) - postings.begin();
+      if (pos == postings.size()) {
+        break;
+      }
+      if (postings[pos] == id) {
+        candidates_[stored++] = id;
+      }
+    }
+    candidates_.resize(stored);
+  }
+
+  // grams are only a filter, the exact substring is verified in ranking
+  RankAndStore(folded, candidates_);
+}
+
+void SearchIndex::SearchFuzzy(const std::string& folded) {
+  if (scores_.size() < folded_.size()) {
+    scores_.resize(folded_.size(), 0);
+  }
+
+  size_t grams_count = 0;
+  candidates_.clear();
+  for (size_t i = 0; i + gram_size <= folded.size(); ++i) {
+    grams_count++;
+    grams_t::const_iterator it = grams_.find(MakeGram(folded.data() + i));
+    if (it == grams_.end()) {
+      continue;
+    }
+
+    for (entry_id_t id : it->second) {
+      if (scores_[id] == 0) {
+        candidates_.push_back(id);
+      }
+      if (scores_[id] != UINT16_MAX) {
+        scores_[id]++;
+      }
+    }
+  }
+
+  // a typo breaks up to gram_size grams of the query, a transposition one more, so allow for two of them
+  const size_t max_broken = 2 * gram_size;
+  const size_t min_score = grams_count > max_broken ? grams_count - max_broken : 1;
+  results_.clear();
+  for (entry_id_t id : candidates_) {
+    if (scores_[id] >= min_score) {
+      results_.push_back(id);
+    }
+  }
+
+  std::sort(results_.begin(), results_.end(), [this](entry_id_t lhs, entry_id_t rhs) {
+    if (scores_[lhs] != scores_[rhs]) {
+      return scores_[lhs] > scores_[rhs];
+    }
+    return lhs < rhs;
+  });
+  if (results_.size() > max_fuzzy_results) {
+    results_.resize(max_fuzzy_results);
+  }
+
+  for (entry_id_t id : candidates_) {
+    scores_[id] = 0;
+  }
+}
+
+void SearchIndex::RankAndStore(const std::string& folded, const results_t& candidates) {
+  for (size_t i = 0; i < SIZEOFMASS(ranked_); ++i) {
+    ranked_[i].clear();
+  }
+
+  for (entry_id_t id : candidates) {
+    const size_t rank = folded.empty() ? 0 : CalcRank(folded_[id], folded);
+    if (rank != std::string::npos) {
+      ranked_[rank].push_back(id);
+    }
+  }
+
+  results_.clear();
+  for (size_t i = 0; i < SIZEOFMASS(ranked_); ++i) {
+    results_.insert(results_.end(), ranked_[i].begin(), ranked_[i].end());
+  }
+}
+
+}  // namespace playlist
+}  // namespace fastoplayer
@@ -0,0 +1,125 @@
+/*  Copyright (C) 2014-2022 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <player/playlist/string_arena.h>
+
+#include <string.h>
+
+namespace fastoplayer {
+namespace playlist {
+
+StringRef::StringRef() : offset(0), size(0) {}
+
+StringRef::StringRef(uint32_t offset, uint32_t size) : offset(offset), size(size) {}
+
+bool StringRef::IsEmpty() const {
+  return size == 0;
+}
+
+StringArena::StringArena() : buffer_(), interned_() {}
+
+void StringArena::Reserve(size_t bytes) {
+  buffer_.reserve(bytes);
+}
+
+void StringArena::Clear() {
+  buffer_.clear();
+  interned_.clear();
+}
+
+void StringArena::ShrinkToFit() {
+  buffer_.shrink_to_fit();
+}
+
+StringRef StringArena::Append(const char* data, size_t size) {
+  if (!data || size == 0) {
+    return StringRef();
+  }
+
+  const StringRef ref(static_cast<uint32_t>(buffer_.size()), static_cast<uint32_t>(size));
+  buffer_.insert(buffer_.end(), data, data + size);
+  return ref;
+}
+
+StringRef StringArena::Intern(const char* data, size_t size) {
+  if (!data || size == 0) {
+    return StringRef();
+  }
+
+  const uint64_t hash = Hash(data, size);
+  auto it = interned_.find(hash);
+  if (it != interned_.end()) {
+    if (IsEqual(it->second, data, size)) {
+      return it->second;
+    }
+    return Append(data, size);  // hash collision, keep the first owner interned
+  }
+
+  const StringRef ref = Append(data, size);
+  interned_[hash] = ref;
+  return ref;
+}
+
+std::string StringArena::GetString(const StringRef& ref) const {
+  if (ref.IsEmpty()) {
+    return std::string();
+  }
+
+  return std::string(GetData(ref), ref.size);
+}
+
+const char* StringArena::GetData(const StringRef& ref) const {
+  DCHECK(ref.offset + ref.size <= buffer_.size());
+  return buffer_.data() + ref.offset;
+}
+
+bool StringArena::IsEqual(const StringRef& ref, const char* data, size_t size) const {
+  if (ref.size != size) {
+    return false;
+  }
+
+  return size == 0 || memcmp(GetData(ref), data, size) == 0;
+}
+
+size_t StringArena::GetSize() const {
+  return buffer_.size();
+}
+
+size_t StringArena::GetMemoryUsage() const {
+  // unordered_map node: key + value + next pointer + cached hash
+  const size_t node_size = sizeof(uint64_t) + sizeof(StringRef) + 2 * sizeof(void*);
+  return buffer_.capacity() + interned_.size() * node_size + interned_.bucket_count() * sizeof(void*);
+}
+
+size_t StringArena::GetInternedCount() const {
+  return interned_.size();
+}
+
+uint64_t StringArena::Hash(const char* data, size_t size) {
+  // FNV-1a
+  uint64_t hash = UINT64_C(14695981039346656037);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= UINT64_C(1099511628211);
+  }
+  return hash;
+}
+
+}  // namespace playlist
+}  // namespace fastoplayer
@@ -31,8 +31,41 @@ extern "C" {
  * callbacks */
 #define SDL_AUDIO_MAX_CALLBACKS_PER_SEC 30
 #define SDL_AUDIO_MIN_BUFFER_SIZE 512
+/* Low latency mode: ~5 msec periods, the output delay is measured instead of assumed */
+#define SDL_AUDIO_LOW_LATENCY_CALLBACKS_PER_SEC 200
+#define SDL_AUDIO_LOW_LATENCY_MIN_BUFFER_SIZE 128
 
 namespace fastoplayer {
+namespace {
+
+SDL_AudioFormat ConvertToSDLAudioFormat(AVSampleFormat fmt) {
+  switch (av_get_packed_sample_fmt(fmt)) {
+    case AV_SAMPLE_FMT_S32:
+      return AUDIO_S32SYS;
+    case AV_SAMPLE_FMT_FLT:
+    case AV_SAMPLE_FMT_DBL:
+      return AUDIO_F32SYS;
+    default:
+      return AUDIO_S16SYS;
+  }
+}
+
+bool ConvertFromSDLAudioFormat(SDL_AudioFormat fmt, AVSampleFormat* out) {
+  if (fmt == AUDIO_S16SYS) {
+    *out = AV_SAMPLE_FMT_S16;
+    return true;
+  } else if (fmt == AUDIO_S32SYS) {
+    *out = AV_SAMPLE_FMT_S32;
+    return true;
+  } else if (fmt == AUDIO_F32SYS) {
+    *out = AV_SAMPLE_FMT_FLT;
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace
 
 int ConvertToSDLVolume(int val) {
   val = stable_value_in_range(val, 0, 100);
@@ -41,13 +74,17 @@ int ConvertToSDLVolume(int val) {
   return sdl_val;
 }
 
-bool init_audio_params(int64_t wanted_channel_layout, int freq, int channels, media::AudioParams* audio_hw_params) {
+bool init_audio_params(int64_t wanted_channel_layout,
+                       int freq,
+                       int channels,
+                       AVSampleFormat fmt,
+                       media::AudioParams* audio_hw_params) {
   if (!audio_hw_params) {
     return false;
   }
 
   media::AudioParams laudio_hw_params;
-  laudio_hw_params.fmt = AV_SAMPLE_FMT_S16;
+  laudio_hw_params.fmt = fmt;
   laudio_hw_params.freq = freq;
   laudio_hw_params.channel_layout = wanted_channel_layout;
   laudio_hw_params.channels = channels;
@@ -67,6 +104,8 @@ bool audio_open(void* opaque,
                 int64_t wanted_channel_layout,
                 int wanted_nb_channels,
                 int wanted_sample_rate,
+                AVSampleFormat wanted_sample_fmt,
+                bool low_latency,
                 SDL_AudioCallback cb,
                 media::AudioParams* audio_hw_params,
                 int* audio_buff_size,
@@ -99,16 +138,24 @@ bool audio_open(void* opaque,
   while (next_sample_rate_idx && next_sample_rates[next_sample_rate_idx] >= wanted_spec.freq) {
     next_sample_rate_idx--;
   }
-  wanted_spec.format = AUDIO_S16SYS;
-  const double samples_per_call = static_cast<double>(wanted_spec.freq) / SDL_AUDIO_MAX_CALLBACKS_PER_SEC;
-  const Uint16 audio_buff_size_calc = 2 << av_log2(samples_per_call);
-  const Uint16 abuff_size = FFMAX(SDL_AUDIO_MIN_BUFFER_SIZE, audio_buff_size_calc);
-  wanted_spec.samples = FFMAX(AUDIO_MIN_BUFFER_SIZE, abuff_size);  // Audio buffer size in samples
+  wanted_spec.format = ConvertToSDLAudioFormat(wanted_sample_fmt);
+  if (low_latency) {
+    const double samples_per_call = static_cast<double>(wanted_spec.freq) / SDL_AUDIO_LOW_LATENCY_CALLBACKS_PER_SEC;
+    const Uint16 audio_buff_size_calc = 2 << av_log2(samples_per_call);
+    wanted_spec.samples = FFMAX(SDL_AUDIO_LOW_LATENCY_MIN_BUFFER_SIZE, audio_buff_size_calc);
+  } else {
+    const double samples_per_call = static_cast<double>(wanted_spec.freq) / SDL_AUDIO_MAX_CALLBACKS_PER_SEC;
+    const Uint16 audio_buff_size_calc = 2 << av_log2(samples_per_call);
+    const Uint16 abuff_size = FFMAX(SDL_AUDIO_MIN_BUFFER_SIZE, audio_buff_size_calc);
+    wanted_spec.samples = FFMAX(AUDIO_MIN_BUFFER_SIZE, abuff_size);  // Audio buffer size in samples
+  }
   wanted_spec.callback = cb;
   wanted_spec.userdata = opaque;
+  /* take the device native format if it is one we can feed directly, SDL converts otherwise */
+  int allowed_changes =
+      SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE;
   SDL_AudioDeviceID laudio_dev;
-  while (!(laudio_dev = SDL_OpenAudioDevice(nullptr, 0, &wanted_spec, &spec,
-                                            SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_CHANNELS_CHANGE))) {
+  while (!(laudio_dev = SDL_OpenAudioDevice(nullptr, 0, &wanted_spec, &spec, allowed_changes))) {
     WARNING_LOG() << "SDL_OpenAudio (" << static_cast<int>(wanted_spec.channels) << " channels, " << wanted_spec.freq
                   << " Hz): " << SDL_GetError();
     wanted_spec.channels = next_nb_channels[FFMIN(7, wanted_spec.channels)];
@@ -122,9 +169,17 @@ bool audio_open(void* opaque,
     }
     wanted_channel_layout = av_get_default_channel_layout(wanted_spec.channels);
   }
-  if (spec.format != AUDIO_S16SYS) {
-    ERROR_LOG() << "SDL advised audio format " << spec.format << " is not supported!";
-    return false;
+  AVSampleFormat sample_fmt;
+  if (!ConvertFromSDLAudioFormat(spec.format, &sample_fmt)) {
+    WARNING_LOG() << "SDL advised audio format " << spec.format << " is not supported, reopen with conversion";
+    SDL_CloseAudioDevice(laudio_dev);
+    allowed_changes &= ~SDL_AUDIO_ALLOW_FORMAT_CHANGE;
+    laudio_dev = SDL_OpenAudioDevice(nullptr, 0, &wanted_spec, &spec, allowed_changes);
+    if (!laudio_dev || !ConvertFromSDLAudioFormat(spec.format, &sample_fmt)) {
+      ERROR_LOG() << "SDL_OpenAudio (" << static_cast<int>(wanted_spec.channels) << " channels, " << wanted_spec.freq
+                  << " Hz): " << SDL_GetError();
+      return false;
+    }
   }
   if (spec.channels != wanted_spec.channels) {
     wanted_channel_layout = av_get_default_channel_layout(spec.channels);
@@ -135,7 +190,7 @@ bool audio_open(void* opaque,
   }
 
   media::AudioParams laudio_hw_params;
-  if (!init_audio_params(wanted_channel_layout, spec.freq, spec.channels, &laudio_hw_params)) {
+  if (!init_audio_params(wanted_channel_layout, spec.freq, spec.channels, sample_fmt, &laudio_hw_params)) {
     ERROR_LOG() << "Failed to init audio parametrs";
     return false;
   }
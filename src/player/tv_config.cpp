@@ -21,7 +21,12 @@
 namespace fastoplayer {
 
 TVConfig::TVConfig()
-    : power_off_on_exit(false), loglevel(common::logging::LOG_LEVEL_INFO), app_options(), player_options() {}
+    : power_off_on_exit(false),
+      loglevel(common::logging::LOG_LEVEL_INFO),
+      playlist_path(),
+      epg_path(),
+      app_options(),
+      player_options() {}
 
 TVConfig::~TVConfig() {}
 
@@ -26,7 +26,9 @@ extern "C" {
 #include <common/file_system/file_system.h>  // for File, create_directory
 #include <common/file_system/string_path_utils.h>
 
+#include <player/epg/epg_index.h>
 #include <player/ffmpeg_application.h>
+#include <player/playlist/m3u_parser.h>
 
 #include "cmdutils.h"  // for DictionaryOptions, show_...
 #include "load_config.h"
@@ -48,6 +50,7 @@ void init_ffmpeg() {
 int main_simple_player_application(int argc,
                                    char** argv,
                                    const common::uri::Url& stream_url,
+                                   const std::string& playlist_path,
                                    const std::string& app_directory_absolute_path) {
   int res = fastoplayer::prepare_to_start(app_directory_absolute_path);
   if (res == EXIT_FAILURE) {
@@ -74,6 +77,35 @@ int main_simple_player_application(int argc,
   INIT_LOGGER(PROJECT_NAME_TITLE, main_options.loglevel);
 #endif
 
+  /* the command line playlist is for this run only, the config keeps its own */
+  const std::string playlist = playlist_path.empty() ? main_options.playlist_path : playlist_path;
+  fastoplayer::playlist::ChannelsTable channels;
+  if (!playlist.empty()) {
+    common::Error perr = fastoplayer::playlist::ParseM3uFile(playlist, &channels);
+    if (perr) {
+      WARNING_LOG() << perr->GetDescription();
+    } else {
+      INFO_LOG() << "Loaded " << channels.GetCount() << " channels from playlist: " << playlist;
+    }
+  }
+
+  fastoplayer::epg::EpgIndex epg;
+  if (!main_options.epg_path.empty() && channels.GetCount()) {
+    const std::string epg_cache_path = common::file_system::make_path(app_directory_absolute_path, std::string("epg.idx"));
+    common::Error eerr = epg.Load(main_options.epg_path, epg_cache_path, 0);
+    if (eerr) {
+      WARNING_LOG() << eerr->GetDescription();
+    } else {
+      INFO_LOG() << "Loaded epg for " << epg.GetChannelsCount() << " channels"
+                 << (epg.IsLoadedFromCache() ? " from cache" : "");
+    }
+  }
+
+  if (!stream_url.IsValid() && channels.GetCount() == 0) {
+    show_help_player(std::string());
+    return EXIT_SUCCESS;
+  }
+
   fastoplayer::FFmpegApplication app(argc, argv);
 
   AVDictionary* sws_dict = nullptr;
@@ -83,9 +115,33 @@ int main_simple_player_application(int argc,
   av_dict_set(&sws_dict, "flags", "bicubic", 0);
 
   fastoplayer::media::ComplexOptions copt(swr_opts, sws_dict, format_opts, codec_opts);
-  auto player = new fastoplayer::SimplePlayer(main_options.player_options);
-  player->SetUrlLocation("0", stream_url, main_options.app_options, copt);
+  /* scaled channel logos, so the next start skips decoding the full size ones */
+  std::string icons_cache_dir = common::file_system::make_path(app_directory_absolute_path, std::string("icons"));
+  if (!common::file_system::is_directory_exist(icons_cache_dir)) {
+    common::ErrnoError ierr = common::file_system::create_directory(icons_cache_dir, true);
+    if (ierr) {
+      WARNING_LOG() << "Can't create icons cache directory: " << ierr->GetDescription();
+      icons_cache_dir.clear();
+    }
+  }
+  auto player = new fastoplayer::SimplePlayer(main_options.player_options, icons_cache_dir);
+  if (stream_url.IsValid()) {
+    player->SetUrlLocation("0", stream_url, main_options.app_options, copt);
+  } else {
+    size_t channel_index = 0;
+    if (!channels.FindByStreamId(main_options.player_options.last_showed_channel_id, &channel_index)) {
+      channel_index = 0;
+    }
+    player->SetChannels(&channels);
+    if (epg.IsLoaded()) {
+      player->SetEpg(&epg);
+    }
+    player->PlayChannel(channel_index, main_options.app_options, copt);
+  }
   res = app.Exec();
+  if (!stream_url.IsValid()) {  // remember channel for the next start
+    main_options.player_options.last_showed_channel_id = player->GetOptions().last_showed_channel_id;
+  }
   destroy(&player);
 
   av_dict_free(&swr_opts);
@@ -103,6 +159,7 @@ int main(int argc, char** argv) {
   init_ffmpeg();
 
   common::uri::Url url;
+  std::string playlist_path;
 
   for (int i = 1; i < argc; ++i) {
     const bool lastarg = i == argc - 1;
@@ -169,6 +226,8 @@ int main(int argc, char** argv) {
       return EXIT_SUCCESS;
     } else if (strcmp(argv[i], "-i") == 0 && !lastarg) {
       url = common::uri::Url(argv[++i]);
+    } else if (strcmp(argv[i], "-playlist") == 0 && !lastarg) {
+      playlist_path = argv[++i];
     }
 #if CONFIG_AVDEVICE
     else if (strcmp(argv[i], "-sources") == 0) {
@@ -193,16 +252,11 @@ int main(int argc, char** argv) {
     }
   }
 
-  if (!url.IsValid()) {
-    show_help_player(std::string());
-    return EXIT_SUCCESS;
-  }
-
   const std::string app_directory_path = APPLICATION_DIR;
   const std::string app_directory_absolute_path =
       common::file_system::is_absolute_path(app_directory_path)
           ? app_directory_path
           : common::file_system::absolute_path_from_relative(app_directory_path);
 
-  return main_simple_player_application(argc, argv, url, app_directory_absolute_path);
+  return main_simple_player_application(argc, argv, url, playlist_path, app_directory_absolute_path);
 }
@@ -18,10 +18,17 @@
 
 #include "simple_player.h"
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include <common/file_system/string_path_utils.h>
 
+#include <common/time.h>
+
+#include <player/epg/epg_index.h>
+#include <player/playlist/channels_table.h>
+
 namespace fastoplayer {
 
 namespace {
@@ -30,11 +37,30 @@ ISimplePlayer::file_string_path_t MakeFontPath() {
       common::file_system::absolute_path_from_relative(RELATIVE_FONT_DIR));
   return font_dir.MakeFileStringPath("FreeSans.ttf");
 }
+
+// the image cache loads files, a logo at an url gets no icon
+std::string GetLocalLogo(const std::string& logo) {
+  return logo.find("://") == std::string::npos ? logo : std::string();
+}
 }  // namespace
 
-SimplePlayer::SimplePlayer(const PlayerOptions& options) : ISimplePlayer(options, MakeFontPath()), stream_url_() {}
+SimplePlayer::SimplePlayer(const PlayerOptions& options, const std::string& icons_cache_dir)
+    : ISimplePlayer(options, MakeFontPath(), icons_cache_dir),
+      stream_url_(),
+      channel_name_(),
+      app_options_(),
+      complex_options_(),
+      channels_(nullptr),
+      current_channel_(0),
+      pip_channel_(0),
+      epg_(nullptr) {}
 
 std::string SimplePlayer::GetCurrentUrlName() const {
+  if (!channel_name_.empty()) {
+    const std::string name = IsMosaic() ? channels_->GetName(GetFocusedChannel()) : channel_name_;
+    const std::string programme = GetCurrentProgrammeTitle();
+    return programme.empty() ? name : name + " - " + programme;
+  }
   return stream_url_.GetUrl();
 }
 
@@ -43,7 +69,160 @@ void SimplePlayer::SetUrlLocation(media::stream_id sid,
                                   media::AppOptions opt,
                                   media::ComplexOptions copt) {
   stream_url_ = uri;
+  channel_name_.clear();
+  app_options_ = opt;
+  complex_options_ = copt;
   ISimplePlayer::SetUrlLocation(sid, uri, opt, copt);
+  SetStandbyLocations(std::vector<common::uri::GURL>(), copt);
+}
+
+void SimplePlayer::SetChannels(const playlist::ChannelsTable* channels) {
+  channels_ = channels;
+  current_channel_ = 0;
+}
+
+void SimplePlayer::PlayChannel(size_t index, media::AppOptions opt, media::ComplexOptions copt) {
+  if (!channels_ || index >= channels_->GetCount()) {
+    return;
+  }
+
+  current_channel_ = index;
+  stream_url_ = common::uri::Url(channels_->GetUrl(index));
+  channel_name_ = channels_->GetName(index);
+  app_options_ = opt;
+  complex_options_ = copt;
+  const size_t page_size = GetPageSize();
+  if (page_size > 1) {  // the page starts at the channel, wrapping around the playlist
+    std::vector<StreamLocation> locations;
+    for (size_t i = 0; i < page_size; ++i) {
+      const size_t channel = (index + i) % channels_->GetCount();
+      locations.push_back({channels_->GetStreamId(channel), common::uri::GURL(channels_->GetUrl(channel))});
+    }
+    SetMosaicLocations(locations, opt, copt);
+    SetStandbyLocations(std::vector<common::uri::GURL>(), copt);
+    return;
+  }
+
+  /* the stream takes over the channel if it was kept, then the keeper moves to the new neighbours */
+  ShowBanner(channel_name_, GetLocalLogo(channels_->GetLogo(index)));
+  ISimplePlayer::SetUrlLocation(channels_->GetStreamId(index), stream_url_, opt, copt);
+  SetStandbyNeighbours(index);
+}
+
+bool SimplePlayer::SwapPip() {
+  if (!channels_ || !HasPip() || pip_channel_ >= channels_->GetCount()) {
+    return ISimplePlayer::SwapPip();
+  }
+
+  /* the title is taken while swapping */
+  const size_t primary = current_channel_;
+  current_channel_ = pip_channel_;
+  channel_name_ = channels_->GetName(current_channel_);
+  if (!ISimplePlayer::SwapPip()) {
+    current_channel_ = primary;
+    channel_name_ = channels_->GetName(current_channel_);
+    return false;
+  }
+
+  pip_channel_ = primary;
+  stream_url_ = common::uri::Url(channels_->GetUrl(current_channel_));
+  ShowBanner(channel_name_, GetLocalLogo(channels_->GetLogo(current_channel_)));
+  SetStandbyNeighbours(current_channel_);
+  return true;
+}
+
+void SimplePlayer::SetEpg(const epg::EpgIndex* epg) {
+  epg_ = epg;
+}
+
+void SimplePlayer::HandleKeyPressEvent(gui::events::KeyPressEvent* event) {
+  const gui::events::KeyPressInfo inf = event->GetInfo();
+  const SDL_Scancode scan_code = inf.ks.scancode;
+  if (channels_ && scan_code == SDL_SCANCODE_PAGEUP) {
+    SwitchChannel(true);
+    return;
+  } else if (channels_ && scan_code == SDL_SCANCODE_PAGEDOWN) {
+    SwitchChannel(false);
+    return;
+  } else if (channels_ && scan_code == SDL_SCANCODE_P) {
+    TogglePip();
+    return;
+  }
+
+  ISimplePlayer::HandleKeyPressEvent(event);
+}
+
+void SimplePlayer::SwitchChannel(bool next) {
+  const size_t count = channels_->GetCount();
+  if (count == 0) {
+    return;
+  }
+
+  const size_t step = GetPageSize() % count;
+  const size_t index = next ? (current_channel_ + step) % count : (current_channel_ + count - step) % count;
+  PlayChannel(index, app_options_, complex_options_);
+}
+
+void SimplePlayer::TogglePip() {
+  if (HasPip()) {
+    ClosePip();
+    return;
+  }
+
+  const size_t count = channels_->GetCount();
+  if (count < 2 || IsMosaic()) {
+    return;
+  }
+
+  pip_channel_ = (current_channel_ + 1) % count;
+  SetPipLocation(channels_->GetStreamId(pip_channel_), common::uri::GURL(channels_->GetUrl(pip_channel_)),
+                 app_options_, complex_options_);
+}
+
+void SimplePlayer::SetStandbyNeighbours(size_t index) {
+  const size_t count = channels_->GetCount();
+  const size_t standby = std::min<size_t>(GetOptions().standby_channels, count - 1);  // both sides wrap around
+  std::vector<common::uri::GURL> neighbours;
+  for (size_t i = 1; i <= standby; ++i) {
+    neighbours.push_back(common::uri::GURL(channels_->GetUrl((index + i) % count)));
+    neighbours.push_back(common::uri::GURL(channels_->GetUrl((index + count - i) % count)));
+  }
+  SetStandbyLocations(neighbours, complex_options_);
+}
+
+size_t SimplePlayer::GetPageSize() const {
+  if (!channels_) {
+    return 1;
+  }
+
+  const size_t side = static_cast<size_t>(GetOptions().mosaic);
+  return std::max<size_t>(std::min(side * side, channels_->GetCount()), 1);
+}
+
+size_t SimplePlayer::GetFocusedChannel() const {
+  if (!channels_ || !IsMosaic()) {
+    return current_channel_;
+  }
+  return (current_channel_ + GetMosaicFocus()) % channels_->GetCount();
+}
+
+std::string SimplePlayer::GetCurrentProgrammeTitle() const {
+  if (!epg_ || !channels_ || GetFocusedChannel() >= channels_->GetCount()) {
+    return std::string();
+  }
+
+  epg::EpgIndex::channel_index_t channel;
+  if (!epg_->FindChannel(channels_->GetTvgId(GetFocusedChannel()), &channel)) {
+    return std::string();
+  }
+
+  epg::EpgIndex::programme_index_t now, next;
+  std::string title;
+  if (!epg_->FindNowNext(channel, common::time::current_utc_mstime(), &now, &next) ||
+      !epg_->GetProgrammeTitle(now, &title)) {
+    return std::string();
+  }
+  return title;
 }
 
 }  // namespace fastoplayer
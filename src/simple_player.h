@@ -22,11 +22,20 @@
 
 #include <player/isimple_player.h>
 
+namespace fastoplayer {
+namespace epg {
+class EpgIndex;
+}
+namespace playlist {
+class ChannelsTable;
+}
+}  // namespace fastoplayer
+
 namespace fastoplayer {
 
 class SimplePlayer : public ISimplePlayer {
  public:
-  explicit SimplePlayer(const PlayerOptions& options);
+  SimplePlayer(const PlayerOptions& options, const std::string& icons_cache_dir);  // empty for no logo thumbnails
 
   std::string GetCurrentUrlName() const override;
 
@@ -35,8 +44,33 @@ class SimplePlayer : public ISimplePlayer {
                       media::AppOptions opt,
                       media::ComplexOptions copt) override;
 
+  // playlist mode, page up/down switch channels
+  void SetChannels(const playlist::ChannelsTable* channels);
+  void PlayChannel(size_t index, media::AppOptions opt, media::ComplexOptions copt);
+  void SetEpg(const epg::EpgIndex* epg);  // current programme shown in title
+
+  bool SwapPip() override;  // the playlist channels trade places too
+
+ protected:
+  void HandleKeyPressEvent(gui::events::KeyPressEvent* event) override;
+
  private:
+  void SwitchChannel(bool next);
+  void TogglePip();  // P: the next playlist channel in picture-in-picture
+  void SetStandbyNeighbours(size_t index);
+  size_t GetPageSize() const;        // channels shown at once, a mosaic page or one
+  size_t GetFocusedChannel() const;  // the heard one in a mosaic
+  std::string GetCurrentProgrammeTitle() const;
+
   common::uri::Url stream_url_;
+  std::string channel_name_;
+  media::AppOptions app_options_;
+  media::ComplexOptions complex_options_;
+
+  const playlist::ChannelsTable* channels_;
+  size_t current_channel_;
+  size_t pip_channel_;
+  const epg::EpgIndex* epg_;
 };
 
 }  // namespace fastoplayer
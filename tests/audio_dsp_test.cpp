@@ -0,0 +1,329 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <player/media/dsp/audio_dsp_kernels.h>
+
+#define BENCH_SAMPLES (48000 * 2)  // 1 second of 48kHz stereo
+#define BENCH_ROUNDS 200
+
+using namespace fastoplayer::media::dsp;
+
+namespace {
+
+uint32_t g_seed = 12345;
+
+uint32_t Random() {
+  g_seed = g_seed * 1664525 + 1013904223;
+  return g_seed;
+}
+
+void FillRandom(SampleFormat fmt, std::vector<uint8_t>* buffer, size_t count) {
+  buffer->resize(count * GetBytesPerSample(fmt) + 64);
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t rnd = Random();
+    if (fmt == SAMPLE_FMT_S16) {
+      int16_t val = static_cast<int16_t>(rnd >> 16);
+      if (i % 13 == 0) {
+        val = (rnd & 1) ? INT16_MAX : INT16_MIN;
+      }
+      memcpy(buffer->data() + i * sizeof(val), &val, sizeof(val));
+    } else if (fmt == SAMPLE_FMT_S32) {
+      int32_t val = static_cast<int32_t>(rnd);
+      if (i % 13 == 0) {
+        val = (rnd & 1) ? INT32_MAX : INT32_MIN;
+      }
+      memcpy(buffer->data() + i * sizeof(val), &val, sizeof(val));
+    } else {
+      // mostly in range, some values overflowing and some special ones
+      float val = (static_cast<float>(rnd >> 8) / 8388608.0f - 1.0f) * 1.25f;
+      if (i % 97 == 0) {
+        val = std::numeric_limits<float>::quiet_NaN();
+      } else if (i % 89 == 0) {
+        val = (rnd & 1) ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+      } else if (i % 83 == 0) {
+        val = 0.5f / 32768.0f;  // exact tie for the s16 rounding
+      }
+      memcpy(buffer->data() + i * sizeof(val), &val, sizeof(val));
+    }
+  }
+}
+
+struct GainCase {
+  gain_t start;
+  gain_t step;
+};
+
+bool CheckGainKernels(const Kernels* ref, const Kernels* kernels, const char* isa_name) {
+  static const size_t sizes[] = {0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 255, 1000, 4099};
+  static const size_t offsets[] = {0, 1};
+  static const SampleFormat formats[] = {SAMPLE_FMT_S16, SAMPLE_FMT_S32, SAMPLE_FMT_FLT};
+  for (SampleFormat fmt : formats) {
+    const size_t bps = GetBytesPerSample(fmt);
+    for (size_t size : sizes) {
+      const GainCase cases[] = {{unity_gain, 0},
+                                {unity_gain / 2, 0},
+                                {0, 0},
+                                {INT32_MAX, 0},
+                                {0, static_cast<gain_t>(INT32_MAX / (size + 1))},
+                                {unity_gain, -static_cast<gain_t>(unity_gain / (size + 1))},
+                                {12345, 777}};
+      for (size_t offset : offsets) {
+        for (const GainCase& gc : cases) {
+          std::vector<uint8_t> src, dst;
+          FillRandom(fmt, &src, size + offset);
+          FillRandom(fmt, &dst, size + offset);
+          std::vector<uint8_t> ref_out = dst, out = dst;
+          const uint8_t* in = src.data() + offset * bps;
+
+          ref->scale[fmt](ref_out.data() + offset * bps, in, size, gc.start, gc.step);
+          kernels->scale[fmt](out.data() + offset * bps, in, size, gc.start, gc.step);
+          if (memcmp(ref_out.data(), out.data(), out.size()) != 0) {
+            std::cout << isa_name << " scale mismatch, format " << fmt << " size " << size << " gain " << gc.start
+                      << "/" << gc.step << std::endl;
+            return false;
+          }
+
+          ref_out = dst;
+          out = dst;
+          ref->mix[fmt](ref_out.data() + offset * bps, in, size, gc.start, gc.step);
+          kernels->mix[fmt](out.data() + offset * bps, in, size, gc.start, gc.step);
+          if (memcmp(ref_out.data(), out.data(), out.size()) != 0) {
+            std::cout << isa_name << " mix mismatch, format " << fmt << " size " << size << " gain " << gc.start
+                      << "/" << gc.step << std::endl;
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+bool CheckConvert(convert_kernel_t ref,
+                  convert_kernel_t kernel,
+                  SampleFormat in_fmt,
+                  SampleFormat out_fmt,
+                  const char* name) {
+  static const size_t sizes[] = {0, 1, 7, 8, 9, 17, 1000, 4099};
+  for (size_t size : sizes) {
+    std::vector<uint8_t> src, ref_out, out;
+    FillRandom(in_fmt, &src, size);
+    FillRandom(out_fmt, &ref_out, size);
+    out = ref_out;
+    ref(ref_out.data(), src.data(), size);
+    kernel(out.data(), src.data(), size);
+    if (memcmp(ref_out.data(), out.data(), out.size()) != 0) {
+      std::cout << name << " mismatch, size " << size << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CheckRampChunks() {
+  const size_t count = 4800;
+  GainRamp whole(1000, 0);
+  GainRamp chunked(1000, 0);
+  whole.SetTarget(unity_gain);
+  chunked.SetTarget(unity_gain);
+
+  std::vector<uint8_t> src;
+  FillRandom(SAMPLE_FMT_S16, &src, count);
+  std::vector<int16_t> ref_out(count), out(count);
+  whole.Scale(SAMPLE_FMT_S16, ref_out.data(), src.data(), count);
+  size_t done = 0;
+  while (done < count) {
+    const size_t chunk = std::min<size_t>(count - done, Random() % 300 + 1);
+    chunked.Scale(SAMPLE_FMT_S16, out.data() + done, src.data() + done * sizeof(int16_t), chunk);
+    done += chunk;
+  }
+  if (ref_out != out) {
+    std::cout << "Gain ramp depends on chunk sizes" << std::endl;
+    return false;
+  }
+  if (!whole.IsUnity() || !chunked.IsUnity()) {
+    std::cout << "Gain ramp did not reach its target" << std::endl;
+    return false;
+  }
+
+  // fade in never amplifies
+  const int16_t* in = reinterpret_cast<const int16_t*>(src.data());
+  for (size_t i = 0; i < count; ++i) {
+    if (abs(out[i]) > abs(in[i])) {
+      std::cout << "Gain ramp overshoots at " << i << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// sources keep their ramps between buffers, a source left out is forgotten and nothing added is silence
+bool CheckMixBus() {
+  const size_t count = 960;
+  const gain_t half = unity_gain / 2;
+  std::vector<uint8_t> first, second;
+  FillRandom(SAMPLE_FMT_S16, &first, count * 2);
+  FillRandom(SAMPLE_FMT_S16, &second, count * 2);
+  const uint8_t* first_next = first.data() + count * sizeof(int16_t);
+  const uint8_t* second_next = second.data() + count * sizeof(int16_t);
+
+  MixBus bus(SAMPLE_FMT_S16, count / 2, 2);
+  GainRamp first_ramp(count / 2, unity_gain);
+  GainRamp second_ramp(count / 2, half);
+  std::vector<int16_t> ref_out(count), out(count);
+  bus.Begin(out.data(), count);
+  bus.Add(&first, first.data(), unity_gain);
+  bus.Add(&second, second.data(), half);
+  bus.End();
+  first_ramp.Scale(SAMPLE_FMT_S16, ref_out.data(), first.data(), count);
+  second_ramp.Mix(SAMPLE_FMT_S16, ref_out.data(), second.data(), count);
+  if (ref_out != out) {
+    std::cout << "Mix bus differs from its sources mixed one by one" << std::endl;
+    return false;
+  }
+
+  // the focus moves: the first source is ducked and the second one raised, both fading
+  bus.Begin(out.data(), count);
+  bus.Add(&first, first_next, half);
+  bus.Add(&second, second_next, unity_gain);
+  bus.End();
+  first_ramp.SetTarget(half);
+  second_ramp.SetTarget(unity_gain);
+  first_ramp.Scale(SAMPLE_FMT_S16, ref_out.data(), first_next, count);
+  second_ramp.Mix(SAMPLE_FMT_S16, ref_out.data(), second_next, count);
+  if (ref_out != out) {
+    std::cout << "Mix bus gain changes are not ramped" << std::endl;
+    return false;
+  }
+
+  bus.Begin(out.data(), count);
+  bus.Add(&second, second.data(), unity_gain);
+  bus.End();
+  if (bus.GetSourcesCount() != 1) {
+    std::cout << "Mix bus keeps " << bus.GetSourcesCount() << " sources instead of 1" << std::endl;
+    return false;
+  }
+
+  // a removed source starts over at its gain, a source past the slots is not heard
+  bus.Remove(&second);
+  bus.Begin(out.data(), count);
+  const bool added = bus.Add(&second, second.data(), half) && bus.Add(&first, first.data(), half);
+  const bool refused = !bus.Add(&ref_out, first.data(), unity_gain);
+  bus.End();
+  GainRamp second_restart(count / 2, half);
+  GainRamp first_restart(count / 2, half);
+  second_restart.Scale(SAMPLE_FMT_S16, ref_out.data(), second.data(), count);
+  first_restart.Mix(SAMPLE_FMT_S16, ref_out.data(), first.data(), count);
+  if (!added || !refused || ref_out != out) {
+    std::cout << "Mix bus slots are not reset or not limited" << std::endl;
+    return false;
+  }
+
+  bus.Begin(out.data(), count);
+  bus.End();
+  if (bus.GetSourcesCount() || std::count(out.begin(), out.end(), 0) != static_cast<ptrdiff_t>(count)) {
+    std::cout << "Mix bus without sources is not silent" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool CheckInterleave() {
+  static const size_t channels_counts[] = {1, 2, 6};
+  const size_t nb_frames = 1001;
+  for (size_t channels : channels_counts) {
+    std::vector<std::vector<float>> planes(channels, std::vector<float>(nb_frames));
+    std::vector<const uint8_t*> planes_ptr;
+    for (size_t ch = 0; ch < channels; ++ch) {
+      for (size_t i = 0; i < nb_frames; ++i) {
+        planes[ch][i] = static_cast<float>(i * channels + ch);
+      }
+      planes_ptr.push_back(reinterpret_cast<const uint8_t*>(planes[ch].data()));
+    }
+
+    std::vector<float> out(nb_frames * channels);
+    Interleave(SAMPLE_FMT_FLT, out.data(), planes_ptr.data(), channels, nb_frames);
+    for (size_t i = 0; i < out.size(); ++i) {
+      if (out[i] != static_cast<float>(i)) {
+        std::cout << "Interleave mismatch, channels " << channels << " sample " << i << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <typename F>
+double Measure(F func) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_ROUNDS; ++i) {
+    func();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return static_cast<double>(BENCH_SAMPLES) * BENCH_ROUNDS / elapsed.count() / 1000000.0;
+}
+
+void Benchmark(Isa isa, const Kernels* kernels) {
+  static const char* names[] = {"s16", "s32", "flt"};
+  std::vector<uint8_t> src, dst;
+  for (int fmt = 0; fmt < SAMPLE_FMT_COUNT; ++fmt) {
+    FillRandom(static_cast<SampleFormat>(fmt), &src, BENCH_SAMPLES);
+    FillRandom(static_cast<SampleFormat>(fmt), &dst, BENCH_SAMPLES);
+    const double scale = Measure([&]() {
+      kernels->scale[fmt](dst.data(), src.data(), BENCH_SAMPLES, unity_gain / 3, 7);
+    });
+    const double mix = Measure([&]() {
+      kernels->mix[fmt](dst.data(), src.data(), BENCH_SAMPLES, unity_gain / 3, 7);
+    });
+    std::cout << IsaToString(isa) << " " << names[fmt] << " scale: " << scale << " Msamples/s, mix: " << mix
+              << " Msamples/s" << std::endl;
+  }
+
+  FillRandom(SAMPLE_FMT_FLT, &src, BENCH_SAMPLES);
+  const double to_s16 = Measure([&]() { kernels->flt_to_s16(dst.data(), src.data(), BENCH_SAMPLES); });
+  FillRandom(SAMPLE_FMT_S16, &src, BENCH_SAMPLES);
+  dst.resize(BENCH_SAMPLES * sizeof(float));
+  const double to_flt = Measure([&]() { kernels->s16_to_flt(dst.data(), src.data(), BENCH_SAMPLES); });
+  std::cout << IsaToString(isa) << " flt->s16: " << to_s16 << " Msamples/s, s16->flt: " << to_flt << " Msamples/s"
+            << std::endl;
+}
+
+}  // namespace
+
+int main() {
+  const Kernels* ref = GetKernels(ISA_SCALAR);
+  for (int i = 0; i < ISA_COUNT; ++i) {
+    const Isa isa = static_cast<Isa>(i);
+    const Kernels* kernels = GetKernels(isa);
+    if (!kernels) {
+      std::cout << IsaToString(isa) << " not supported" << std::endl;
+      continue;
+    }
+
+    const char* name = IsaToString(isa);
+    if (!CheckGainKernels(ref, kernels, name) ||
+        !CheckConvert(ref->s16_to_flt, kernels->s16_to_flt, SAMPLE_FMT_S16, SAMPLE_FMT_FLT, "s16->flt") ||
+        !CheckConvert(ref->flt_to_s16, kernels->flt_to_s16, SAMPLE_FMT_FLT, SAMPLE_FMT_S16, "flt->s16") ||
+        !CheckConvert(ref->s32_to_flt, kernels->s32_to_flt, SAMPLE_FMT_S32, SAMPLE_FMT_FLT, "s32->flt") ||
+        !CheckConvert(ref->flt_to_s32, kernels->flt_to_s32, SAMPLE_FMT_FLT, SAMPLE_FMT_S32, "flt->s32")) {
+      std::cout << name << " is not bit-exact with the scalar reference" << std::endl;
+      return EXIT_FAILURE;
+    }
+    Benchmark(isa, kernels);
+  }
+
+  if (!CheckRampChunks() || !CheckMixBus() || !CheckInterleave()) {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Best isa: " << IsaToString(GetBestIsa()) << std::endl;
+  return EXIT_SUCCESS;
+}
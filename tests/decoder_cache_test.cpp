@@ -0,0 +1,106 @@
+#include <stdlib.h>
+
+#include <iostream>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <player/media/decoder_cache.h>
+
+#define FRAME_WIDTH 64
+#define FRAME_HEIGHT 48
+#define CACHE_SIZE 2
+
+using fastoplayer::media::DecoderCache;
+
+namespace {
+AVCodecParameters* AllocParameters(int width) {
+  AVCodecParameters* par = avcodec_parameters_alloc();
+  par->codec_type = AVMEDIA_TYPE_VIDEO;
+  par->codec_id = AV_CODEC_ID_RAWVIDEO;
+  par->width = width;
+  par->height = FRAME_HEIGHT;
+  par->format = AV_PIX_FMT_YUV420P;
+  return par;
+}
+
+AVCodecContext* OpenDecoder(const AVCodec* codec, const AVCodecParameters* par) {
+  AVCodecContext* avctx = avcodec_alloc_context3(codec);
+  if (avcodec_parameters_to_context(avctx, par) < 0 || avcodec_open2(avctx, codec, nullptr) < 0) {
+    avcodec_free_context(&avctx);
+  }
+  return avctx;
+}
+}  // namespace
+
+int main() {
+  const AVCodec* codec = avcodec_find_decoder(AV_CODEC_ID_RAWVIDEO);
+  if (!codec) {
+    std::cout << "No rawvideo decoder" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  AVCodecParameters* par = AllocParameters(FRAME_WIDTH);
+  AVCodecParameters* wide_par = AllocParameters(FRAME_WIDTH * 2);
+  AVDictionary* opts = nullptr;
+  av_dict_set(&opts, "threads", "auto", 0);
+  const DecoderCache::Key key(codec, par, opts, 0);
+  const DecoderCache::Key wide_key(codec, wide_par, opts, 0);
+  av_dict_set(&opts, "threads", "1", 0);
+  const DecoderCache::Key single_thread_key(codec, par, opts, 0);
+  av_dict_free(&opts);
+
+  DecoderCache cache(CACHE_SIZE);
+  AVCodecContext* avctx = OpenDecoder(codec, par);
+  if (!avctx) {
+    return EXIT_FAILURE;
+  }
+
+  /* only the same parameters and options get the context back, once */
+  cache.Put(key, avctx);
+  if (cache.Take(wide_key) || cache.Take(single_thread_key) || cache.Take(DecoderCache::Key())) {
+    std::cout << "Decoder reused for other parameters" << std::endl;
+    return EXIT_FAILURE;
+  }
+  AVCodecContext* reused = cache.Take(key);
+  if (reused != avctx || cache.Take(key)) {
+    std::cout << "Decoder not reused" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (cache.GetHits() != 1 || cache.GetMisses() != 3) {
+    std::cout << "Hits " << cache.GetHits() << ", misses " << cache.GetMisses() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /* what a stream lowered while playing is back to the values at open */
+  reused->skip_frame = AVDISCARD_NONKEY;
+  reused->skip_idct = AVDISCARD_ALL;
+  reused->skip_loop_filter = AVDISCARD_NONREF;
+  cache.Put(key, reused);
+  reused = cache.Take(key);
+  if (!reused || reused->skip_frame != AVDISCARD_DEFAULT || reused->skip_idct != AVDISCARD_DEFAULT ||
+      reused->skip_loop_filter != AVDISCARD_DEFAULT) {
+    std::cout << "Decoder reused with its skip options" << std::endl;
+    return EXIT_FAILURE;
+  }
+  avcodec_free_context(&reused);
+
+  /* past the capacity the oldest is freed */
+  for (int i = 0; i < CACHE_SIZE + 1; ++i) {
+    cache.Put(i ? key : wide_key, OpenDecoder(codec, i ? par : wide_par));
+  }
+  if (cache.GetCount() != CACHE_SIZE || cache.Take(wide_key)) {
+    std::cout << "Decoders kept: " << cache.GetCount() << std::endl;
+    return EXIT_FAILURE;
+  }
+  cache.Clear();
+  if (cache.GetCount()) {
+    return EXIT_FAILURE;
+  }
+
+  avcodec_parameters_free(&wide_par);
+  avcodec_parameters_free(&par);
+  std::cout << "Decoder cache: ok" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,258 @@
+#include <stdlib.h>
+
+#include <iostream>
+
+#include <player/media/demux_source.h>
+
+#define CONSUMER_MAX_BYTES (8 * 1024 * 1024)  // DEMUX_CONSUMER_MAX_BYTES of the source
+#define BIG_PACKET_SIZE (1024 * 1024)
+#define PACKET_SIZE 188
+
+// the mux: program 1 has a video and an audio stream, program 2 a video one
+#define PROGRAM_1 1
+#define PROGRAM_2 2
+#define VIDEO_1 0
+#define AUDIO_1 1
+#define VIDEO_2 2
+
+using fastoplayer::media::DemuxConsumer;
+using fastoplayer::media::DemuxSource;
+using fastoplayer::media::SplitProgramUrl;
+
+namespace fastoplayer {
+namespace media {
+
+// plays the reader thread of the source without an input
+class DemuxSourcePeer {
+ public:
+  static void Open(DemuxSource* source, AVFormatContext* streams) {
+    {
+      DemuxSource::lock_t lock(source->mutex_);
+      source->streams_ = streams;
+    }
+    source->SetState(DemuxSource::READY, 0);
+  }
+
+  static void End(DemuxSource* source) { source->SetState(DemuxSource::ENDED, AVERROR_EOF); }
+
+  static void Route(DemuxSource* source, AVPacket* pkt) { source->Route(pkt); }
+
+  static bool CanRead(DemuxSource* source) {
+    DemuxSource::lock_t lock(source->mutex_);
+    return source->CanRead();
+  }
+};
+
+}  // namespace media
+}  // namespace fastoplayer
+
+using fastoplayer::media::DemuxSourcePeer;
+
+namespace {
+AVFormatContext* MakeMux() {
+  AVFormatContext* ic = avformat_alloc_context();
+  const AVMediaType types[] = {AVMEDIA_TYPE_VIDEO, AVMEDIA_TYPE_AUDIO, AVMEDIA_TYPE_VIDEO};
+  for (AVMediaType type : types) {
+    AVStream* stream = avformat_new_stream(ic, nullptr);
+    stream->codecpar->codec_type = type;
+    stream->time_base = {1, 90000};
+  }
+  av_new_program(ic, PROGRAM_1);
+  av_program_add_stream_index(ic, PROGRAM_1, VIDEO_1);
+  av_program_add_stream_index(ic, PROGRAM_1, AUDIO_1);
+  av_new_program(ic, PROGRAM_2);
+  av_program_add_stream_index(ic, PROGRAM_2, VIDEO_2);
+  return ic;
+}
+
+void RoutePacket(DemuxSource* source, int stream_index, bool keyframe, int size, int64_t pts) {
+  AVPacket pkt1, *pkt = &pkt1;
+  av_init_packet(pkt);
+  if (av_new_packet(pkt, size) < 0) {
+    return;
+  }
+  pkt->stream_index = stream_index;
+  pkt->flags = keyframe ? AV_PKT_FLAG_KEY : 0;
+  pkt->pts = pts;
+  DemuxSourcePeer::Route(source, pkt);
+}
+
+bool OpenConsumer(DemuxConsumer* consumer) {
+  AVFormatContext* ic = nullptr;
+  if (consumer->Open(&ic) < 0) {
+    return false;
+  }
+  avformat_free_context(ic);
+  return true;
+}
+
+// a packet with the pts or -1 for an empty queue
+int64_t ReadPts(DemuxConsumer* consumer, int* stream_index) {
+  AVPacket pkt;
+  if (consumer->Read(&pkt) < 0) {
+    return -1;
+  }
+  const int64_t pts = pkt.pts;
+  *stream_index = pkt.stream_index;
+  av_packet_unref(&pkt);
+  return pts;
+}
+
+// every consumer gets the packets of its program with its own stream indexes, video from a keyframe on
+bool CheckRouting() {
+  DemuxSource source(common::uri::GURL("udp://239.0.0.1:1234"), nullptr);
+  DemuxConsumer* first = source.Subscribe(PROGRAM_1);
+  DemuxConsumer* second = source.Subscribe(PROGRAM_2);
+  DemuxSourcePeer::Open(&source, MakeMux());
+  bool ok = OpenConsumer(first) && OpenConsumer(second);
+
+  RoutePacket(&source, VIDEO_1, false, PACKET_SIZE, 1);  // before the first keyframe
+  RoutePacket(&source, AUDIO_1, false, PACKET_SIZE, 2);
+  RoutePacket(&source, VIDEO_1, true, PACKET_SIZE, 3);
+  RoutePacket(&source, VIDEO_2, true, PACKET_SIZE, 4);
+
+  int index = -1;
+  ok = ok && ReadPts(first, &index) == 2 && index == 1;
+  ok = ok && ReadPts(first, &index) == 3 && index == 0;
+  ok = ok && ReadPts(first, &index) == -1 && first->GetDroppedCount() == 1;
+  ok = ok && ReadPts(second, &index) == 4 && index == 0;
+  ok = ok && ReadPts(second, &index) == -1 && second->GetDroppedCount() == 0;
+  if (!ok) {
+    std::cout << "Packets were not routed to their programs" << std::endl;
+  }
+
+  delete first;
+  delete second;
+  return ok;
+}
+
+// the reader waits only when every consumer is full, a full one loses its packets up to the next keyframe
+bool CheckBackpressure() {
+  DemuxSource source(common::uri::GURL("udp://239.0.0.1:1234"), nullptr);
+  DemuxConsumer* slow = source.Subscribe(PROGRAM_1);
+  DemuxConsumer* other = source.Subscribe(PROGRAM_2);
+  DemuxSourcePeer::Open(&source, MakeMux());
+  bool ok = OpenConsumer(slow) && OpenConsumer(other);
+
+  int64_t pts = 0;
+  RoutePacket(&source, VIDEO_1, true, BIG_PACKET_SIZE, pts++);
+  for (int i = 1; i < CONSUMER_MAX_BYTES / BIG_PACKET_SIZE; ++i) {
+    RoutePacket(&source, VIDEO_1, false, BIG_PACKET_SIZE, pts++);
+  }
+  if (!ok || !DemuxSourcePeer::CanRead(&source)) {
+    std::cout << "A full consumer stalled the others" << std::endl;
+    ok = false;
+  }
+
+  other->Abort();
+  if (DemuxSourcePeer::CanRead(&source)) {
+    std::cout << "Reader goes on with every consumer full or aborted" << std::endl;
+    ok = false;
+  }
+
+  const int64_t dropped_pts = pts;
+  RoutePacket(&source, VIDEO_1, false, PACKET_SIZE, pts++);  // no room
+  int index = -1;
+  ReadPts(slow, &index);
+  RoutePacket(&source, VIDEO_1, false, PACKET_SIZE, pts++);  // room, but the decoder lost a reference
+  RoutePacket(&source, AUDIO_1, false, PACKET_SIZE, pts++);
+  const int64_t keyframe_pts = pts;
+  RoutePacket(&source, VIDEO_1, true, PACKET_SIZE, pts++);
+  if (slow->GetDroppedCount() != 2) {
+    std::cout << "Slow consumer dropped " << slow->GetDroppedCount() << " packets" << std::endl;
+    ok = false;
+  }
+
+  int64_t last = -1;
+  int64_t read = 0;
+  while ((read = ReadPts(slow, &index)) >= 0) {
+    if (read == dropped_pts || read == dropped_pts + 1) {
+      std::cout << "Packet " << read << " was not dropped" << std::endl;
+      ok = false;
+    }
+    last = read;
+  }
+  if (last != keyframe_pts) {
+    std::cout << "Keyframe " << keyframe_pts << " was not queued, last " << last << std::endl;
+    ok = false;
+  }
+
+  delete slow;
+  delete other;
+  return ok;
+}
+
+// an aborted consumer returns at once, one that left gets nothing, the end of the mux is seen once drained
+bool CheckAbortAndEnd() {
+  DemuxSource source(common::uri::GURL("udp://239.0.0.1:1234"), nullptr);
+  DemuxConsumer* aborted = source.Subscribe(PROGRAM_1);
+  aborted->Abort();
+  AVFormatContext* ic = nullptr;
+  bool ok = aborted->Open(&ic) == AVERROR_EXIT;
+
+  DemuxConsumer* left = source.Subscribe(PROGRAM_1);
+  DemuxConsumer* ending = source.Subscribe(PROGRAM_2);
+  DemuxSourcePeer::Open(&source, MakeMux());
+  ok = ok && OpenConsumer(left) && OpenConsumer(ending);
+  delete left;
+
+  RoutePacket(&source, VIDEO_1, true, PACKET_SIZE, 1);
+  RoutePacket(&source, VIDEO_2, true, PACKET_SIZE, 2);
+  AVPacket pkt;
+  ok = ok && aborted->Read(&pkt) == AVERROR_EXIT;
+
+  DemuxSourcePeer::End(&source);
+  int index = -1;
+  ok = ok && ReadPts(ending, &index) == 2;
+  ok = ok && ending->Read(&pkt) == AVERROR_EOF;
+  if (!ok) {
+    std::cout << "Abort or end of the mux was not reported" << std::endl;
+  }
+
+  delete aborted;
+  delete ending;
+  return ok;
+}
+
+bool CheckProgramUrls() {
+  struct {
+    const char* url;
+    bool valid;
+    const char* source;
+    int program;
+  } cases[] = {
+      {"udp://239.0.0.1:1234#program=3", true, "udp://239.0.0.1:1234", 3},
+      {"http://host/mux.ts#program=0", true, "http://host/mux.ts", 0},
+      {"udp://239.0.0.1:1234", false, nullptr, 0},
+      {"udp://239.0.0.1:1234#program=", false, nullptr, 0},
+      {"udp://239.0.0.1:1234#program=-1", false, nullptr, 0},
+      {"udp://239.0.0.1:1234#program=3x", false, nullptr, 0},
+      {"udp://239.0.0.1:1234#program=99999999999", false, nullptr, 0},
+  };
+
+  bool ok = true;
+  for (const auto& test : cases) {
+    common::uri::GURL source;
+    int program = -1;
+    const bool valid = SplitProgramUrl(common::uri::GURL(test.url), &source, &program);
+    if (valid != test.valid || (valid && (source.spec() != common::uri::GURL(test.source).spec() ||
+                                          program != test.program))) {
+      std::cout << "Wrong split of " << test.url << std::endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  UNUSED(argc);
+  UNUSED(argv);
+
+  if (!CheckRouting() || !CheckBackpressure() || !CheckAbortAndEnd() || !CheckProgramUrls()) {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Demux source: ok" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <player/epg/epg_index.h>
+
+#define CHANNELS_COUNT 500
+#define DAYS_COUNT 3
+#define PROGRAMME_SEC 1800
+#define START_UTC_SEC 1640995200  // 2022-01-01 00:00:00
+#define NOW_NEXT_BUDGET_USEC 1000
+
+namespace {
+bool GenerateXmltv(const std::string& path, size_t* file_size) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+
+  fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<tv generator-info-name=\"test\">\n", file);
+  for (size_t i = 0; i < CHANNELS_COUNT; ++i) {
+    fprintf(file, "  <channel id=\"channel%zu.tv\">\n    <display-name lang=\"en\">Channel %zu</display-name>\n  </channel>\n",
+            i, i);
+  }
+
+  const size_t per_channel = DAYS_COUNT * 86400 / PROGRAMME_SEC;
+  for (size_t i = 0; i < CHANNELS_COUNT; ++i) {
+    for (size_t j = 0; j < per_channel; ++j) {
+      // +0100 zone: local time is one hour ahead of utc
+      const time_t start = START_UTC_SEC + j * PROGRAMME_SEC + 3600;
+      const time_t stop = start + PROGRAMME_SEC;
+      struct tm start_tm, stop_tm;
+      gmtime_r(&start, &start_tm);
+      gmtime_r(&stop, &stop_tm);
+      char start_str[32], stop_str[32];
+      strftime(start_str, sizeof(start_str), "%Y%m%d%H%M%S +0100", &start_tm);
+      strftime(stop_str, sizeof(stop_str), "%Y%m%d%H%M%S +0100", &stop_tm);
+      fprintf(file,
+              "  <programme start=\"%s\" stop=\"%s\" channel=\"channel%zu.tv\">\n"
+              "    <title lang=\"en\">Show %zu &amp; friends</title>\n"
+              "    <desc lang=\"en\">Episode %zu of the long running show, with a description long enough to look "
+              "like real guide data.</desc>\n"
+              "    <category lang=\"en\">Entertainment</category>\n"
+              "  </programme>\n",
+              start_str, stop_str, i, j, j);
+    }
+  }
+  fputs("</tv>\n", file);
+  *file_size = ftell(file);
+  fclose(file);
+  return true;
+}
+
+// keeps the first half of the file, as a crash while saving it would
+bool TruncateFile(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  std::string data;
+  char buffer[4096];
+  size_t read = 0;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.append(buffer, read);
+  }
+  fclose(file);
+
+  file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  const bool ok = fwrite(data.data(), data.size() / 2, 1, file) == 1;
+  return fclose(file) == 0 && ok;
+}
+
+long NowNextForAll(const fastoplayer::epg::EpgIndex& index, common::time64_t now_msec, size_t* found) {
+  using namespace fastoplayer::epg;
+  const auto start = std::chrono::steady_clock::now();
+  *found = 0;
+  for (EpgIndex::channel_index_t i = 0; i < index.GetChannelsCount(); ++i) {
+    EpgIndex::programme_index_t now, next;
+    std::string now_title, next_title;
+    if (index.FindNowNext(i, now_msec, &now, &next) && index.GetProgrammeTitle(now, &now_title) &&
+        index.GetProgrammeTitle(next, &next_title)) {
+      (*found)++;
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  UNUSED(argc);
+  UNUSED(argv);
+  using namespace fastoplayer;
+
+  const std::string path = "epg_index_test.xml";
+  const std::string cache_path = "epg_index_test.idx";
+  size_t file_size = 0;
+  remove(cache_path.c_str());
+  if (!GenerateXmltv(path, &file_size)) {
+    std::cout << "can't generate xmltv" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int result = EXIT_SUCCESS;
+  for (int pass = 0; pass < 2; ++pass) {
+    epg::EpgIndex index;
+    const auto start = std::chrono::steady_clock::now();
+    common::Error err = index.Load(path, cache_path, 0);
+    const auto end = std::chrono::steady_clock::now();
+    if (err) {
+      std::cout << "load failed: " << err->GetDescription() << std::endl;
+      result = EXIT_FAILURE;
+      break;
+    }
+
+    std::cout << (index.IsLoadedFromCache() ? "cache" : "parse") << " " << file_size / 1024 << " KB: "
+              << index.GetChannelsCount() << " channels, " << index.GetProgrammesCount() << " programmes in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " msec, index memory "
+              << index.GetMemoryUsage() / 1024 << " KB" << std::endl;
+    if (index.IsLoadedFromCache() != (pass == 1) || index.GetChannelsCount() != CHANNELS_COUNT) {
+      result = EXIT_FAILURE;
+    }
+
+    // one day and a quarter of programme later
+    const common::time64_t now_msec = (START_UTC_SEC + 86400 + PROGRAMME_SEC / 4) * 1000LL;
+    size_t found = 0;
+    // first lookup pays for page faults of the fresh mapping
+    const long cold_usec = NowNextForAll(index, now_msec, &found);
+    const long usec = NowNextForAll(index, now_msec, &found);
+    std::cout << "now/next for " << found << " channels: " << usec << " usec (cold " << cold_usec << " usec)"
+              << std::endl;
+    if (found != CHANNELS_COUNT || usec > NOW_NEXT_BUDGET_USEC) {
+      result = EXIT_FAILURE;
+    }
+
+    epg::EpgIndex::channel_index_t channel;
+    epg::EpgIndex::programme_index_t now, next;
+    epg::ProgrammeInfo info;
+    const size_t expected = 86400 / PROGRAMME_SEC;
+    if (!index.FindChannel("channel42.tv", &channel) || !index.FindNowNext(channel, now_msec, &now, &next) ||
+        !index.GetProgramme(now, &info) || info.title != "Show " + std::to_string(expected) + " & friends" ||
+        info.start != (START_UTC_SEC + 86400) * 1000LL || index.GetChannelDisplayName(channel) != "Channel 42") {
+      std::cout << "wrong programme: " << info.title << std::endl;
+      result = EXIT_FAILURE;
+    }
+  }
+
+  // a truncated cache is parsed again instead of being trusted
+  if (result == EXIT_SUCCESS && TruncateFile(cache_path)) {
+    epg::EpgIndex index;
+    common::Error err = index.Load(path, cache_path, 0);
+    if (err || index.IsLoadedFromCache() || index.GetChannelsCount() != CHANNELS_COUNT) {
+      std::cout << "truncated cache was not rejected" << std::endl;
+      result = EXIT_FAILURE;
+    }
+  }
+
+  remove(path.c_str());
+  remove(cache_path.c_str());
+  return result;
+}
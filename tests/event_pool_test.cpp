@@ -0,0 +1,93 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <thread>
+
+#include <player/gui/event_pool.h>
+
+#define ROUNDS 1000
+#define EVENTS_PER_ROUND 64  // EventPool::max_cached
+
+using fastoplayer::gui::events::EventPool;
+
+namespace {
+std::atomic<size_t> heap_allocations(0);
+
+// same operators as the gui events
+struct TestEvent {
+  static void* operator new(size_t size) { return EventPool<TestEvent>::Allocate(size); }
+  static void operator delete(void* ptr, size_t size) { EventPool<TestEvent>::Free(ptr, size); }
+
+  int64_t info[4];
+};
+
+struct BigTestEvent : public TestEvent {
+  int64_t extra[8];
+};
+}  // namespace
+
+// counts the heap allocations, the default delete frees with free
+void* operator new(size_t size) {
+  heap_allocations++;
+  void* ptr = malloc(size ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+// events are created on one thread and freed on another like the posted ones, once the pool is warm the heap is
+// not touched
+int main(int argc, char** argv) {
+  UNUSED(argc);
+  UNUSED(argv);
+
+  TestEvent* events[EVENTS_PER_ROUND];
+  std::atomic<int> created(0);
+  std::atomic<int> freed(0);
+  std::thread releaser([&events, &created, &freed]() {
+    for (int round = 1; round <= ROUNDS; ++round) {
+      while (created.load() < round) {
+        std::this_thread::yield();
+      }
+      for (TestEvent* event : events) {
+        delete event;
+      }
+      freed.store(round);
+    }
+  });
+
+  size_t warm_allocations = 0;
+  for (int round = 1; round <= ROUNDS; ++round) {
+    for (TestEvent*& event : events) {
+      event = new TestEvent;
+    }
+    created.store(round);
+    while (freed.load() < round) {
+      std::this_thread::yield();
+    }
+    if (round == 1) {
+      warm_allocations = heap_allocations.load();
+    }
+  }
+  releaser.join();
+
+  const size_t allocations = heap_allocations.load() - warm_allocations;
+  if (allocations) {
+    std::cout << "Warm pool made " << allocations << " heap allocations" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // other sizes are not pooled
+  delete new BigTestEvent;
+  if (heap_allocations.load() - warm_allocations != 1) {
+    std::cout << "Event of another size was not allocated on the heap" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Event pool: ok" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,200 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include <player/draw/image_cache.h>
+
+#define ICON_SIZE 16
+#define ICON_BYTES (ICON_SIZE * ICON_SIZE * 4)
+#define SOURCE_SIZE 64
+#define WAIT_MSEC 5000
+#define THUMBNAILS_DIR "image_cache_test_thumbnails"
+
+#define RED_COLOR 0xFFFF0000
+#define BLUE_COLOR 0xFF0000FF
+
+using fastoplayer::draw::ImageCache;
+
+namespace {
+bool WriteImage(const std::string& path, int size, Uint32 color) {
+  SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (!surface) {
+    return false;
+  }
+
+  SDL_FillRect(surface, nullptr, color);
+  const bool saved = SDL_SaveBMP(surface, path.c_str()) == 0;
+  SDL_FreeSurface(surface);
+  return saved;
+}
+
+// uploads until nothing is decoding, the textures are then ready or failed
+bool WaitDecoded(ImageCache* cache, SDL_Renderer* renderer) {
+  const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(WAIT_MSEC);
+  while (cache->GetPendingCount()) {
+    if (std::chrono::steady_clock::now() > end) {
+      return false;
+    }
+    cache->UploadPending(renderer, ImageCache::default_uploads_per_frame);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+SDL_Texture* Load(ImageCache* cache, SDL_Renderer* renderer, const std::string& path) {
+  const common::draw::Size size(ICON_SIZE, ICON_SIZE);
+  SDL_Texture* texture = cache->GetTexture(renderer, path, size);
+  if (texture || !WaitDecoded(cache, renderer)) {
+    return texture;
+  }
+  return cache->GetTexture(renderer, path, size);
+}
+
+Uint32 ReadPixel(SDL_Renderer* renderer, SDL_Texture* texture) {
+  SDL_Rect rect = {0, 0, 1, 1};
+  Uint32 pixel = 0;
+  SDL_RenderClear(renderer);
+  SDL_RenderCopy(renderer, texture, nullptr, &rect);
+  SDL_RenderReadPixels(renderer, &rect, SDL_PIXELFORMAT_ARGB8888, &pixel, sizeof(pixel));
+  return pixel;
+}
+
+std::vector<std::string> ListThumbnails() {
+  std::vector<std::string> names;
+  DIR* dir = opendir(THUMBNAILS_DIR);
+  if (!dir) {
+    return names;
+  }
+
+  while (struct dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".bmp") == 0) {
+      names.push_back(std::string(THUMBNAILS_DIR) + "/" + name);
+    }
+  }
+  closedir(dir);
+  return names;
+}
+
+// the least recently drawn texture goes first once the budget is exceeded
+bool CheckBudget(SDL_Renderer* renderer, const std::vector<std::string>& paths) {
+  ImageCache cache(1, ICON_BYTES * 2, std::string());
+  SDL_Texture* first = Load(&cache, renderer, paths[0]);
+  SDL_Texture* second = Load(&cache, renderer, paths[1]);
+  if (!first || !second || cache.GetTextureBytes() != ICON_BYTES * 2) {
+    std::cout << "Icons were not loaded, " << cache.GetTextureBytes() << " bytes" << std::endl;
+    return false;
+  }
+
+  Load(&cache, renderer, paths[0]);
+  SDL_Texture* third = Load(&cache, renderer, paths[2]);
+  if (!third || cache.GetTexturesCount() != 2 || cache.GetTextureBytes() > ICON_BYTES * 2) {
+    std::cout << "Cache holds " << cache.GetTexturesCount() << " textures, " << cache.GetTextureBytes() << " bytes"
+              << std::endl;
+    return false;
+  }
+
+  const common::draw::Size size(ICON_SIZE, ICON_SIZE);
+  if (!cache.GetTexture(renderer, paths[0], size) || cache.GetTexture(renderer, paths[1], size)) {
+    std::cout << "Recently drawn icon was evicted" << std::endl;
+    return false;
+  }
+
+  // a missing file fails without a texture or any bytes
+  if (Load(&cache, renderer, "image_cache_test_missing.bmp") || cache.GetPendingCount()) {
+    std::cout << "Missing image was loaded" << std::endl;
+    return false;
+  }
+  return WaitDecoded(&cache, renderer);
+}
+
+// the scaled icon is written once and read back by the next cache instead of the source
+bool CheckThumbnails(SDL_Renderer* renderer, const std::string& path) {
+  {
+    ImageCache cache(1, ImageCache::default_texture_budget, THUMBNAILS_DIR);
+    SDL_Texture* texture = Load(&cache, renderer, path);
+    if (!texture || ReadPixel(renderer, texture) != RED_COLOR) {
+      std::cout << "Source image was not loaded" << std::endl;
+      return false;
+    }
+  }
+
+  const std::vector<std::string> thumbnails = ListThumbnails();
+  if (thumbnails.size() != 1) {
+    std::cout << "Expected one thumbnail, found " << thumbnails.size() << std::endl;
+    return false;
+  }
+
+  SDL_Surface* thumbnail = SDL_LoadBMP(thumbnails[0].c_str());
+  const bool scaled = thumbnail && thumbnail->w == ICON_SIZE && thumbnail->h == ICON_SIZE;
+  SDL_FreeSurface(thumbnail);
+  if (!scaled || !WriteImage(thumbnails[0], ICON_SIZE, BLUE_COLOR)) {
+    std::cout << "Thumbnail was not scaled to the icon size" << std::endl;
+    return false;
+  }
+
+  ImageCache cache(1, ImageCache::default_texture_budget, THUMBNAILS_DIR);
+  SDL_Texture* texture = Load(&cache, renderer, path);
+  if (!texture || ReadPixel(renderer, texture) != BLUE_COLOR) {
+    std::cout << "Thumbnail was not used" << std::endl;
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  UNUSED(argc);
+  UNUSED(argv);
+
+  if (SDL_Init(0) != 0) {
+    std::cout << "Can't init SDL: " << SDL_GetError() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, ICON_SIZE, ICON_SIZE, 32, SDL_PIXELFORMAT_ARGB8888);
+  SDL_Renderer* renderer = target ? SDL_CreateSoftwareRenderer(target) : nullptr;
+  if (!renderer) {
+    std::cout << "Can't create renderer: " << SDL_GetError() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> paths;
+  for (int i = 0; i < 3; ++i) {
+    paths.push_back("image_cache_test_" + std::to_string(i) + ".bmp");
+    WriteImage(paths.back(), SOURCE_SIZE, RED_COLOR);
+  }
+  mkdir(THUMBNAILS_DIR, 0755);
+  for (const std::string& thumbnail : ListThumbnails()) {
+    remove(thumbnail.c_str());
+  }
+
+  int result = EXIT_SUCCESS;
+  if (!CheckBudget(renderer, paths) || !CheckThumbnails(renderer, paths[0])) {
+    result = EXIT_FAILURE;
+  }
+
+  for (const std::string& thumbnail : ListThumbnails()) {
+    remove(thumbnail.c_str());
+  }
+  rmdir(THUMBNAILS_DIR);
+  for (const std::string& path : paths) {
+    remove(path.c_str());
+  }
+  SDL_DestroyRenderer(renderer);
+  SDL_FreeSurface(target);
+  SDL_Quit();
+  if (result == EXIT_SUCCESS) {
+    std::cout << "Image cache: ok" << std::endl;
+  }
+  return result;
+}
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <player/playlist/m3u_parser.h>
+
+#define ENTRIES_COUNT 100000
+#define GROUPS_COUNT 64
+#define LOAD_BUDGET_MSEC 500
+
+namespace {
+bool GeneratePlaylist(const std::string& path, size_t* file_size) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+
+  fputs("#EXTM3U x-tvg-url=\"http://example.com/epg.xml.gz\"\n", file);
+  for (size_t i = 0; i < ENTRIES_COUNT; ++i) {
+    const size_t group = i % GROUPS_COUNT;
+    fprintf(file,
+            "#EXTINF:-1 tvg-id=\"channel%zu.tv\" tvg-name=\"Channel %zu\" "
+            "tvg-logo=\"http://logos.example.com/group%zu/logo.png\" group-title=\"Group %zu\",Channel %zu HD\r\n"
+            "http://streams.example.com:8080/live/user/password/%zu.ts\r\n",
+            i, i, group, group, i, i);
+  }
+  *file_size = ftell(file);
+  fclose(file);
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  UNUSED(argc);
+  UNUSED(argv);
+  using namespace fastoplayer;
+
+  const std::string path = "m3u_parser_test.m3u";
+  size_t file_size = 0;
+  if (!GeneratePlaylist(path, &file_size)) {
+    std::cout << "can't generate playlist" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  playlist::ChannelsTable table;
+  const auto start = std::chrono::steady_clock::now();
+  common::Error err = playlist::ParseM3uFile(path, &table);
+  const auto end = std::chrono::steady_clock::now();
+  remove(path.c_str());
+  if (err) {
+    std::cout << "parse failed: " << err->GetDescription() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const long msec = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+  std::cout << "playlist " << file_size / 1024 << " KB, " << table.GetCount() << " channels, loaded in " << msec
+            << " msec, table memory " << table.GetMemoryUsage() / 1024 << " KB" << std::endl;
+
+  int result = EXIT_SUCCESS;
+  if (table.GetCount() != ENTRIES_COUNT || msec > LOAD_BUDGET_MSEC) {
+    result = EXIT_FAILURE;
+  }
+
+  // memory must stay below the playlist size, groups and logos interned once
+  if (table.GetMemoryUsage() > file_size) {
+    std::cout << "table is bigger than playlist" << std::endl;
+    result = EXIT_FAILURE;
+  }
+
+  const size_t last = ENTRIES_COUNT - 1;
+  size_t found = 0;
+  if (!table.FindByStreamId("channel99999.tv", &found) || found != last ||
+      table.GetName(last) != "Channel 99999 HD" || table.GetGroup(last) != "Group 31" ||
+      table.GetUrl(last) != "http://streams.example.com:8080/live/user/password/99999.ts" ||
+      table.GetLogo(last) != "http://logos.example.com/group31/logo.png") {
+    std::cout << "wrong channel entry" << std::endl;
+    result = EXIT_FAILURE;
+  }
+  return result;
+}
@@ -0,0 +1,103 @@
+#include <stdlib.h>
+
+#include <iostream>
+#include <thread>
+
+#include <player/media/packet_queue.h>
+
+#define SEEK_COUNT 2000
+#define PACKETS_PER_SEEK 8
+#define STREAM_INDEX 0
+
+using fastoplayer::media::PacketQueue;
+
+namespace {
+void PutTagged(PacketQueue* queue, int tag) {
+  AVPacket pkt1, *pkt = &pkt1;
+  av_init_packet(pkt);
+  if (av_new_packet(pkt, 16) < 0) {
+    return;
+  }
+  pkt->pts = tag;
+  pkt->stream_index = STREAM_INDEX;
+  queue->Put(pkt);
+}
+
+bool CheckFlushDropsQueued() {
+  PacketQueue queue;
+  queue.Start();
+  for (int i = 0; i < 3; ++i) {
+    PutTagged(&queue, 0);
+  }
+  queue.PutNullpacket(STREAM_INDEX);
+  PutTagged(&queue, 1);
+  if (queue.GetNbPackets() != 2 || queue.GetSerial() != 1) {
+    std::cout << "Flush kept " << queue.GetNbPackets() << " packets, serial " << queue.GetSerial() << std::endl;
+    return false;
+  }
+
+  AVPacket pkt;
+  if (!queue.Get(&pkt) || pkt.data || PacketQueue::IsDrainPacket(pkt) || PacketQueue::GetFlushSerial(pkt) != 1) {
+    std::cout << "Flush packet expected first" << std::endl;
+    return false;
+  }
+  if (!queue.Get(&pkt) || pkt.pts != 1) {
+    std::cout << "Packet pushed after the flush was lost" << std::endl;
+    return false;
+  }
+  av_packet_unref(&pkt);
+  return true;
+}
+
+// every seek is a flush and the packets read after it, the consumer must never see a packet of an older seek
+bool CheckSeekBurst() {
+  PacketQueue queue;
+  queue.Start();
+  bool ok = true;
+  int last_tag = -1;
+  std::thread decoder([&queue, &ok, &last_tag]() {
+    int serial = 0;
+    AVPacket pkt;
+    while (queue.Get(&pkt)) {
+      if (!pkt.data) {
+        serial = PacketQueue::GetFlushSerial(pkt);
+        continue;
+      }
+      if (pkt.pts != serial) {
+        std::cout << "Packet of seek " << pkt.pts << " decoded after flush " << serial << std::endl;
+        ok = false;
+      }
+      last_tag = pkt.pts;
+      av_packet_unref(&pkt);
+    }
+  });
+
+  for (int seek = 1; seek <= SEEK_COUNT; ++seek) {
+    queue.PutNullpacket(STREAM_INDEX);
+    for (int i = 0; i < PACKETS_PER_SEEK; ++i) {
+      PutTagged(&queue, queue.GetSerial());
+    }
+  }
+  while (queue.GetNbPackets()) {
+    std::this_thread::yield();
+  }
+  queue.Abort();
+  decoder.join();
+  queue.Flush();
+
+  if (ok && last_tag != SEEK_COUNT) {
+    std::cout << "Latest seek ended at " << last_tag << std::endl;
+    ok = false;
+  }
+  return ok;
+}
+}  // namespace
+
+int main() {
+  if (!CheckFlushDropsQueued() || !CheckSeekBurst()) {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Packet queue: ok" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <player/media/pcm_ring.h>
+
+#define RING_SIZE 7680  // 40 msec of 48kHz stereo s16
+#define BYTES_PER_SEC 192000
+#define TOTAL_BYTES (64 * 1024 * 1024)
+#define WRITE_CHUNK 4096
+#define READ_CHUNK 1024
+
+namespace {
+uint8_t PatternByte(uint64_t pos) {
+  return static_cast<uint8_t>(pos * 31 + (pos >> 8));
+}
+}  // namespace
+
+int main() {
+  fastoplayer::media::PcmRing ring(RING_SIZE);
+
+  std::thread producer([&ring]() {
+    std::vector<uint8_t> chunk(WRITE_CHUNK);
+    uint64_t written = 0;
+    while (written < TOTAL_BYTES) {
+      const size_t size = std::min<uint64_t>(WRITE_CHUNK, TOTAL_BYTES - written);
+      for (size_t i = 0; i < size; ++i) {
+        chunk[i] = PatternByte(written + i);
+      }
+      if (!ring.WaitWritable(size)) {
+        return;
+      }
+      // clock of the end of data equals its byte offset in msec
+      ring.Write(chunk.data(), size, (written + size) * 1000 / BYTES_PER_SEC);
+      written += size;
+    }
+  });
+
+  uint8_t out[READ_CHUNK];
+  uint64_t read = 0;
+  size_t empty_reads = 0;
+  while (read < TOTAL_BYTES) {
+    const size_t got = ring.Read(out, READ_CHUNK);
+    if (!got) {
+      empty_reads++;
+      continue;
+    }
+
+    for (size_t i = 0; i < got; ++i) {
+      if (out[i] != PatternByte(read + i)) {
+        std::cout << "Data mismatch at byte " << read + i << std::endl;
+        ring.Stop();
+        producer.join();
+        return EXIT_FAILURE;
+      }
+    }
+    read += got;
+
+    const fastoplayer::media::clock64_t clock = ring.GetReadClock(BYTES_PER_SEC);
+    const fastoplayer::media::clock64_t expected = read * 1000 / BYTES_PER_SEC;
+    if (clock < expected - 1 || clock > expected + 1) {
+      std::cout << "Read clock " << clock << " expected " << expected << std::endl;
+      ring.Stop();
+      producer.join();
+      return EXIT_FAILURE;
+    }
+  }
+  producer.join();
+
+  ring.Drop();
+  if (!ring.IsEmpty()) {
+    std::cout << "Ring is not empty after drop" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // a producer that can't wait is notified from the read that frees the armed room until it takes the room
+  std::vector<uint8_t> full(RING_SIZE);
+  size_t notified = 0;
+  ring.SetNotify([&notified]() { notified++; });
+  ring.Write(full.data(), full.size(), 0);
+  const bool armed = !ring.ArmWritable(RING_SIZE / 2);
+  ring.Read(out, READ_CHUNK);
+  const size_t early = notified;
+  while (ring.Read(out, READ_CHUNK)) {
+  }
+  const bool taken = ring.ArmWritable(RING_SIZE / 2);
+  const size_t before_write = notified;
+  ring.Write(full.data(), READ_CHUNK, 0);
+  ring.Read(out, READ_CHUNK);
+  if (!armed || early || !before_write || !taken || notified != before_write) {
+    std::cout << "Armed producer notified " << early << " times early, " << notified << " in total" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // after a flush the samples of the old serial are never read, even those written after it, and there is no
+  // clock until the new serial is written
+  while (ring.Read(out, READ_CHUNK)) {
+  }
+  ring.Write(full.data(), READ_CHUNK, 1000, 1);
+  ring.Drop(2);
+  ring.Write(full.data(), READ_CHUNK, 2000, 1);
+  const bool stale = ring.Read(out, READ_CHUNK) || fastoplayer::media::IsValidClock(ring.GetReadClock(BYTES_PER_SEC));
+  ring.Write(full.data(), READ_CHUNK, 3000, 2);
+  const size_t fresh = ring.Read(out, READ_CHUNK * 2);
+  if (stale || fresh != READ_CHUNK || ring.GetReadClock(BYTES_PER_SEC) != 3000) {
+    std::cout << "Old serial read after drop, new serial read " << fresh << " bytes" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Transferred " << read << " bytes, empty reads: " << empty_reads << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <player/media/frames/reverse_frame_cache.h>
+#include <player/media/frames/video_frame.h>
+
+#define FRAME_WIDTH 64
+#define FRAME_HEIGHT 48
+#define FRAME_MSEC 40
+#define GOP_SIZE 12
+#define GOP_COUNT 10
+
+using fastoplayer::media::clock64_t;
+using fastoplayer::media::frames::ReverseFrameCache;
+using fastoplayer::media::frames::VideoFrame;
+
+namespace {
+AVFrame* AllocFrame() {
+  AVFrame* frame = av_frame_alloc();
+  frame->width = FRAME_WIDTH;
+  frame->height = FRAME_HEIGHT;
+  frame->format = AV_PIX_FMT_YUV420P;
+  if (av_frame_get_buffer(frame, 0) < 0) {
+    av_frame_free(&frame);
+  }
+  return frame;
+}
+
+size_t GetFrameBytes() {
+  AVFrame* frame = AllocFrame();
+  size_t size = 0;
+  for (size_t i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; ++i) {
+    size += frame->buf[i]->size;
+  }
+  av_frame_free(&frame);
+  return size;
+}
+
+// read thread and decoder: every segment starts at a keyframe and is decoded up to the next one
+void Decode(ReverseFrameCache* cache) {
+  const clock64_t gop_msec = GOP_SIZE * FRAME_MSEC;
+  AVFrame* frame = AllocFrame();
+  while (true) {
+    if (!cache->CanBeginSegment()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    const clock64_t end = cache->GetNextEnd();
+    if (end <= 0) {
+      break;
+    }
+
+    const clock64_t start = (end - 1) / gop_msec * gop_msec;
+    cache->BeginSegment(start, end);
+    for (clock64_t pts = start; pts < start + gop_msec + FRAME_MSEC; pts += FRAME_MSEC) {
+      AVFrame* ref = av_frame_clone(frame);
+      cache->Put(ref, pts, FRAME_MSEC, -1);
+      av_frame_free(&ref);
+    }
+    cache->EndSegment();
+  }
+  av_frame_free(&frame);
+}
+
+bool CheckBackward(size_t budget_frames) {
+  const size_t budget = GetFrameBytes() * budget_frames;
+  const clock64_t total = GOP_COUNT * GOP_SIZE * FRAME_MSEC;
+  ReverseFrameCache cache(budget);
+  cache.Clear(total);
+  std::thread decoder(Decode, &cache);
+
+  clock64_t expected = total - FRAME_MSEC;
+  while (expected >= 0) {
+    if (!cache.Peek()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    VideoFrame* vp = cache.Pop();
+    if (!vp || vp->pts != expected || !vp->frame->data[0]) {
+      std::cout << "Budget " << budget_frames << " frames: expected pts " << expected << " got "
+                << (vp ? vp->pts : -1) << std::endl;
+      cache.Stop();
+      decoder.join();
+      return false;
+    }
+    if (cache.GetSize() > budget) {
+      std::cout << "Budget " << budget_frames << " frames: " << cache.GetSize() << " bytes held" << std::endl;
+      cache.Stop();
+      decoder.join();
+      return false;
+    }
+    expected -= FRAME_MSEC;
+  }
+
+  decoder.join();
+  if (!cache.IsEmpty()) {
+    std::cout << "Budget " << budget_frames << " frames: cache is not empty at the start" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// a decoder that can't wait keeps its frame while the budget is full and is notified when frames are shown
+bool CheckTryPut() {
+  ReverseFrameCache cache(GetFrameBytes() * 2);
+  size_t released = 0;
+  cache.SetReleaseNotify([&released]() { released++; });
+  cache.BeginSegment(0, 2 * FRAME_MSEC);
+  AVFrame* frame = AllocFrame();
+  bool stored = true;
+  for (clock64_t pts = 0; pts < 2 * FRAME_MSEC; pts += FRAME_MSEC) {
+    AVFrame* ref = av_frame_clone(frame);
+    stored = cache.TryPut(ref, pts, FRAME_MSEC, -1) && stored;
+    av_frame_free(&ref);
+  }
+  cache.EndSegment();
+
+  cache.BeginSegment(2 * FRAME_MSEC, 3 * FRAME_MSEC);
+  AVFrame* ref = av_frame_clone(frame);
+  const bool kept = !cache.TryPut(ref, 2 * FRAME_MSEC, FRAME_MSEC, -1) && ref->buf[0];
+  cache.Pop();
+  cache.Pop();
+  const bool put = released == 2 && cache.TryPut(ref, 2 * FRAME_MSEC, FRAME_MSEC, -1) && !ref->buf[0];
+  av_frame_free(&ref);
+  av_frame_free(&frame);
+  cache.SetReleaseNotify(nullptr);
+  if (!stored || !kept || !put) {
+    std::cout << "Non blocking put: stored " << stored << ", kept " << kept << ", put after release " << put
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+int main() {
+  // two GOPs fit, a GOP that does not fit is decoded again for its earlier frames
+  if (!CheckBackward(GOP_SIZE * 2 + 1) || !CheckBackward(GOP_SIZE / 2) || !CheckBackward(2) || !CheckTryPut()) {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Reverse frame cache: ok" << std::endl;
+  return EXIT_SUCCESS;
+}
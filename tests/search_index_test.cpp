@@ -0,0 +1,98 @@
+#include <stdlib.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <player/playlist/search_index.h>
+
+#define ENTRIES_COUNT 50000
+#define FRAME_BUDGET_USEC 16666
+
+namespace {
+const char* kWords[] = {"news",  "sport", "movie", "kids",   "music", "discovery", "history", "nature", "travel",
+                        "food",  "comedy", "drama", "cinema", "world", "euro",      "premier", "family", "action",
+                        "retro", "jazz",  "rock",  "classic", "local", "business", "science", "weather"};
+const char* kSuffixes[] = {"HD", "FHD", "SD", "4K", "+1", ""};
+
+std::string GenerateName(std::mt19937* gen) {
+  std::uniform_int_distribution<size_t> word(0, SIZEOFMASS(kWords) - 1);
+  std::uniform_int_distribution<size_t> suffix(0, SIZEOFMASS(kSuffixes) - 1);
+  std::uniform_int_distribution<int> number(1, 999);
+  std::string name = kWords[word(*gen)];
+  name[0] = name[0] - 'a' + 'A';
+  name += " ";
+  name += kWords[word(*gen)];
+  name += " " + std::to_string(number(*gen)) + " " + kSuffixes[suffix(*gen)];
+  return name;
+}
+
+// types query symbol by symbol, returns worst keystroke latency
+long TypeQuery(fastoplayer::playlist::SearchIndex* index, const std::string& query, size_t* found) {
+  long worst = 0;
+  for (size_t i = 0; i <= query.size(); ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    *found = index->Search(query.substr(0, i)).size();
+    const auto end = std::chrono::steady_clock::now();
+    const long usec = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    if (usec > worst) {
+      worst = usec;
+    }
+  }
+  return worst;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  UNUSED(argc);
+  UNUSED(argv);
+  using namespace fastoplayer;
+
+  std::mt19937 gen(42);
+  playlist::SearchIndex index;
+  index.Reserve(ENTRIES_COUNT);
+  const auto build_start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < ENTRIES_COUNT; ++i) {
+    index.Add(GenerateName(&gen));
+  }
+  index.Add("Discovery Science 777 HD");
+  const auto build_end = std::chrono::steady_clock::now();
+  std::cout << "build " << index.GetCount() << " entries: "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(build_end - build_start).count() << " msec"
+            << std::endl;
+
+  const std::string queries[] = {"discovery science 777", "sport", "777 hd", "kids +1", "s", "xyz"};
+  int result = EXIT_SUCCESS;
+  for (const std::string& query : queries) {
+    index.ResetSearch();
+    size_t found = 0;
+    const long worst = TypeQuery(&index, query, &found);
+    std::cout << "query \"" << query << "\": " << found << " results, worst keystroke " << worst << " usec"
+              << std::endl;
+    if (worst > FRAME_BUDGET_USEC) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  index.ResetSearch();
+  const playlist::SearchIndex::results_t& exact = index.Search("discovery science 777 hd");
+  if (exact.empty() || index.GetName(exact[0]) != "Discovery Science 777 HD") {
+    std::cout << "exact match failed" << std::endl;
+    result = EXIT_FAILURE;
+  }
+
+  index.ResetSearch();
+  const auto fuzzy_start = std::chrono::steady_clock::now();
+  const playlist::SearchIndex::results_t& fuzzy = index.Search("discovrey science 777");
+  const auto fuzzy_end = std::chrono::steady_clock::now();
+  std::cout << "fuzzy: " << fuzzy.size() << " results, "
+            << std::chrono::duration_cast<std::chrono::microseconds>(fuzzy_end - fuzzy_start).count() << " usec"
+            << std::endl;
+  if (index.GetMatchMode() != playlist::SearchIndex::FUZZY_MATCH || fuzzy.empty() ||
+      index.GetName(fuzzy[0]) != "Discovery Science 777 HD") {
+    std::cout << "fuzzy match failed" << std::endl;
+    result = EXIT_FAILURE;
+  }
+  return result;
+}
@@ -0,0 +1,71 @@
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <player/media/teardown_service.h>
+
+#define THREADS_COUNT 2
+#define TEARDOWNS_COUNT 16
+#define HELD_BYTES 1024
+#define TEARDOWN_MSEC 5
+
+using fastoplayer::media::TeardownService;
+
+int main() {
+  TeardownService service(THREADS_COUNT);
+  if (!service.Start()) {
+    std::cout << "Can't start the teardown threads" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::atomic<int> running(0);
+  std::atomic<int> max_running(0);
+  std::atomic<int> done(0);
+  for (int i = 0; i < TEARDOWNS_COUNT; ++i) {
+    service.Post(
+        [&]() {
+          const int now = ++running;
+          int seen = max_running;
+          while (now > seen && !max_running.compare_exchange_weak(seen, now)) {
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(TEARDOWN_MSEC));
+          running--;
+          done++;
+        },
+        HELD_BYTES);
+  }
+  /* a burst is queued, not run on a thread each */
+  if (service.GetPendingCount() == 0 || service.GetHeldBytes() == 0) {
+    std::cout << "Teardowns are not tracked" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  service.Stop();
+  if (done != TEARDOWNS_COUNT || service.GetPendingCount() || service.GetHeldBytes()) {
+    std::cout << "Stop left " << TEARDOWNS_COUNT - done << " teardowns" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (max_running > THREADS_COUNT || max_running == 0) {
+    std::cout << "Teardowns run at once: " << max_running << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (service.GetPeakHeldBytes() < HELD_BYTES * (TEARDOWNS_COUNT - THREADS_COUNT)) {
+    std::cout << "Peak held memory: " << service.GetPeakHeldBytes() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /* stopped, the teardown runs on the caller */
+  bool ran = false;
+  service.Post([&ran]() { ran = true; }, HELD_BYTES);
+  if (!ran) {
+    std::cout << "Teardown posted after stop did not run" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Teardown service: ok" << std::endl;
+  return EXIT_SUCCESS;
+}
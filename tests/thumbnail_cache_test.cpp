@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <player/media/thumbnail_cache.h>
+
+#define THUMB_WIDTH 16
+#define THUMB_HEIGHT 9
+#define INTERVAL_MSEC 10000
+#define SLOTS_COUNT 25
+#define MAX_COUNT 6
+
+using fastoplayer::media::clock64_t;
+using fastoplayer::media::Thumbnail;
+using fastoplayer::media::ThumbnailCache;
+using fastoplayer::media::thumbnail_t;
+
+namespace {
+thumbnail_t MakeThumbnail(clock64_t pts, uint8_t fill) {
+  std::shared_ptr<Thumbnail> thumbnail = std::make_shared<Thumbnail>(pts, THUMB_WIDTH, THUMB_HEIGHT);
+  for (size_t i = 0; i < thumbnail->rgb.size(); ++i) {
+    thumbnail->rgb[i] = static_cast<uint8_t>(fill + i);
+  }
+  return thumbnail;
+}
+
+// nearest to the focus first, never more than the budget, and no endless regeneration once it is full
+bool CheckFocusOrder() {
+  ThumbnailCache cache(0, SLOTS_COUNT * INTERVAL_MSEC, INTERVAL_MSEC, MAX_COUNT);
+  cache.SetFocus(12 * INTERVAL_MSEC + 500);
+  const size_t expected[] = {12, 13, 11, 14, 10, 15};
+  for (size_t want : expected) {
+    size_t slot = 0;
+    if (!cache.TakeNextMissing(&slot) || slot != want) {
+      std::cout << "Expected slot " << want << " got " << slot << std::endl;
+      return false;
+    }
+    cache.Put(slot, MakeThumbnail(cache.GetSlotPts(slot), static_cast<uint8_t>(slot)));
+  }
+
+  size_t slot = 0;
+  if (cache.TakeNextMissing(&slot)) {
+    std::cout << "Full cache still generates slot " << slot << std::endl;
+    return false;
+  }
+
+  // scrubbing away drops the farthest thumbnails for the ones around the new position
+  cache.SetFocus(0);
+  for (int i = 0; i < MAX_COUNT * 2; ++i) {
+    if (!cache.TakeNextMissing(&slot)) {
+      break;
+    }
+    cache.Put(slot, MakeThumbnail(cache.GetSlotPts(slot), static_cast<uint8_t>(slot)));
+    if (cache.GetCount() > MAX_COUNT) {
+      std::cout << "Cache holds " << cache.GetCount() << " thumbnails" << std::endl;
+      return false;
+    }
+  }
+  if (!cache.Find(0) || cache.Find(0)->pts != 0 || cache.Find(20 * INTERVAL_MSEC)) {
+    std::cout << "Thumbnails are not around the new focus" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool CheckSpriteSheet() {
+  const std::string path = "thumbnail_cache_test.ppm";
+  ThumbnailCache cache(1000, SLOTS_COUNT * INTERVAL_MSEC, INTERVAL_MSEC, SLOTS_COUNT);
+  for (size_t slot = 0; slot < cache.GetSlotsCount(); slot += 3) {
+    cache.Put(slot, MakeThumbnail(cache.GetSlotPts(slot), static_cast<uint8_t>(slot)));
+  }
+  if (!cache.SaveSpriteSheet(path)) {
+    std::cout << "Can't save the sprite sheet" << std::endl;
+    return false;
+  }
+
+  ThumbnailCache loaded(1000, SLOTS_COUNT * INTERVAL_MSEC, INTERVAL_MSEC, SLOTS_COUNT);
+  ThumbnailCache other_grid(0, SLOTS_COUNT * INTERVAL_MSEC, INTERVAL_MSEC, SLOTS_COUNT);
+  const bool ok = loaded.LoadSpriteSheet(path, THUMB_WIDTH, THUMB_HEIGHT) &&
+                  !other_grid.LoadSpriteSheet(path, THUMB_WIDTH, THUMB_HEIGHT);
+  remove(path.c_str());
+  if (!ok || loaded.GetCount() != cache.GetCount()) {
+    std::cout << "Sprite sheet loaded " << loaded.GetCount() << " of " << cache.GetCount() << std::endl;
+    return false;
+  }
+
+  for (size_t slot = 0; slot < cache.GetSlotsCount(); slot += 3) {
+    const clock64_t pts = cache.GetSlotPts(slot);
+    if (loaded.Find(pts)->rgb != cache.Find(pts)->rgb) {
+      std::cout << "Sprite sheet tile " << slot << " differs" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+int main() {
+  if (!CheckFocusOrder() || !CheckSpriteSheet()) {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Thumbnail cache: ok" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -1,6 +1,13 @@
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include <common/application/application.h>
+#include <common/convert2string.h>
 
 extern "C" {
 #include <libavdevice/avdevice.h>  // for avdevice_register_all
@@ -10,6 +17,7 @@ extern "C" {
 
 #include <player/media/video_state.h>
 #include <player/media/video_state_handler.h>
+#include <player/media/worker_pool.h>
 #include <player/sdl_utils.h>
 
 using namespace fastoplayer;
@@ -46,16 +54,18 @@ class FakeHandler : public VideoStateHandler {
                                            int64_t wanted_channel_layout,
                                            int wanted_nb_channels,
                                            int wanted_sample_rate,
+                                           int wanted_sample_format,
                                            media::AudioParams* audio_hw_params,
                                            int* audio_buff_size) override {
     UNUSED(stream);
     UNUSED(wanted_channel_layout);
     UNUSED(wanted_nb_channels);
     UNUSED(wanted_sample_rate);
+    UNUSED(wanted_sample_format);
     UNUSED(audio_buff_size);
 
     media::AudioParams laudio_hw_params;
-    if (!init_audio_params(3, 48000, 2, &laudio_hw_params)) {
+    if (!init_audio_params(3, 48000, 2, AV_SAMPLE_FMT_S16, &laudio_hw_params)) {
       return common::make_error("Failed to init audio.");
     }
 
@@ -121,7 +131,11 @@ void init_ffmpeg() {
 
 class FakeApplication : public common::application::IApplication {
  public:
-  FakeApplication(int argc, char** argv) : common::application::IApplication(argc, argv), stop_(false) {}
+  FakeApplication(int argc, char** argv)
+      : common::application::IApplication(argc, argv),
+        streams_count_(argc > 1 ? std::max(atoi(argv[1]), 1) : 1),
+        pool_threads_(argc > 2 ? std::max(atoi(argv[2]), 0) : 0),
+        stop_(false) {}
 
   virtual int PreExecImpl() override { /* register all codecs, demux and protocols */
     init_ffmpeg();
@@ -129,21 +143,39 @@ class FakeApplication : public common::application::IApplication {
   }
 
   virtual int ExecImpl() override {
-    const stream_id id = "unique";
     // wget http://download.blender.org/peach/bigbuckbunny_movies/big_buck_bunny_1080p_h264.mov
     const common::uri::Url uri = common::uri::Url("file://" PROJECT_TEST_SOURCES_DIR "/big_buck_bunny_1080p_h264.mov");
     media::AppOptions opt;
     DictionaryOptions* dict = new DictionaryOptions;
     const media::ComplexOptions copt(dict->swr_opts, dict->sws_dict, dict->format_opts, dict->codec_opts);
     VideoStateHandler* handler = new FakeHandler;
-    VideoState* vs = new VideoState(id, uri, opt, copt);
-    vs->SetHandler(handler);
-    std::thread exec([vs]() { return vs->Exec(); });
+    /* the same file played as many streams, decoded on threads of their own or on a shared pool */
+    std::shared_ptr<WorkerPool> pool;
+    if (pool_threads_) {
+      pool = std::make_shared<WorkerPool>(pool_threads_);
+      if (!pool->Start()) {
+        return EXIT_FAILURE;
+      }
+    }
+    std::vector<VideoState*> streams;
+    std::vector<std::thread> execs;
+    for (int i = 0; i < streams_count_; ++i) {
+      VideoState* vs = new VideoState(common::ConvertToString(i), uri, opt, copt);
+      vs->SetHandler(handler);
+      if (pool) {
+        vs->SetWorkerPool(pool);
+        vs->SetTaskPriority(i == 0 ? TASK_PRIORITY_HIGH : TASK_PRIORITY_NORMAL);
+      }
+      streams.push_back(vs);
+      execs.emplace_back([vs]() { return vs->Exec(); });
+    }
 
-    std::thread audio([this, vs]() {
+    std::thread audio([this, &streams]() {
       while (!stop_) {
         uint8_t stream_buff[8192];
-        vs->UpdateAudioBuffer(stream_buff, sizeof(stream_buff), 100);
+        for (VideoState* vs : streams) {
+          vs->UpdateAudioBuffer(stream_buff, sizeof(stream_buff), 100, 2 * sizeof(stream_buff));
+        }
         std::this_thread::sleep_for(std::chrono::milliseconds(15));
       }
     });
@@ -153,14 +185,27 @@ class FakeApplication : public common::application::IApplication {
       std::cv_status interrupt_status = stop_cond_.wait_for(lock, std::chrono::milliseconds(20));
       if (interrupt_status == std::cv_status::no_timeout) {  // if notify
       } else {
-        vs->TryToGetVideoFrame();
+        for (VideoState* vs : streams) {
+          vs->TryToGetVideoFrame();
+        }
       }
     }
 
-    vs->Abort();
+    for (VideoState* vs : streams) {
+      vs->Abort();
+    }
     audio.join();
-    exec.join();
-    delete vs;
+    for (std::thread& exec : execs) {
+      exec.join();
+    }
+    for (VideoState* vs : streams) {
+      delete vs;
+    }
+    if (pool) {
+      std::cout << "Streams: " << streams_count_ << ", pool threads: " << pool->GetThreadsCount()
+                << ", stolen tasks: " << pool->GetStolenCount() << std::endl;
+      pool->Stop();
+    }
     delete handler;
     delete dict;
     return EXIT_SUCCESS;
@@ -226,6 +271,8 @@ class FakeApplication : public common::application::IApplication {
 
  private:
   typedef std::unique_lock<std::mutex> lock_t;
+  const int streams_count_;
+  const int pool_threads_;  // 0 for a thread per decoder
   std::condition_variable stop_cond_;
   std::mutex stop_mutex_;
   bool stop_;
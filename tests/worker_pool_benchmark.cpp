@@ -0,0 +1,238 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <player/media/worker_pool.h>
+
+// Decoding models without FFmpeg: every stream has a demuxer thread queuing 25 video and 50 audio packets per second
+// and two decoders burning a fixed cpu time per packet, either on a thread each or as serial jobs on the pool.
+// Usage: worker_pool_benchmark [seconds per run] [pool threads, 0 for the number of cores]
+
+#define VIDEO_PACKETS_PER_SEC 25
+#define AUDIO_PACKETS_PER_SEC 50
+#define VIDEO_DECODE_USEC 1000
+#define AUDIO_DECODE_USEC 200
+#define DEFAULT_RUN_SEC 5
+
+using fastoplayer::media::SerialJob;
+using fastoplayer::media::TASK_PRIORITY_HIGH;
+using fastoplayer::media::TASK_PRIORITY_NORMAL;
+using fastoplayer::media::TaskPriority;
+using fastoplayer::media::WorkerPool;
+
+namespace {
+typedef std::chrono::steady_clock steady_clock_t;
+typedef std::unique_lock<std::mutex> lock_t;
+
+int64_t GetUsec(steady_clock_t::time_point point) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(point.time_since_epoch()).count();
+}
+
+int64_t GetThreadCpuUsec() {
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return static_cast<int64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec +
+         usage.ru_stime.tv_usec;
+}
+
+void Burn(int64_t usec) {
+  const int64_t end = GetThreadCpuUsec() + usec;
+  while (GetThreadCpuUsec() < end) {
+  }
+}
+
+class Decoder {
+ public:
+  explicit Decoder(int64_t cost_usec) : cost_usec_(cost_usec), mutex_(), cond_(), packets_(), stop_(false) {}
+
+  void Put(int64_t arrival_usec) {
+    lock_t lock(mutex_);
+    packets_.push_back(arrival_usec);
+    cond_.notify_one();
+  }
+
+  void Stop() {
+    lock_t lock(mutex_);
+    stop_ = true;
+    cond_.notify_one();
+  }
+
+  // dedicated thread model
+  void Loop() {
+    while (true) {
+      int64_t arrival = 0;
+      {
+        lock_t lock(mutex_);
+        cond_.wait(lock, [this]() { return stop_ || !packets_.empty(); });
+        if (stop_) {
+          return;
+        }
+        arrival = packets_.front();
+        packets_.pop_front();
+      }
+      Decode(arrival);
+    }
+  }
+
+  // pool model, one packet per step
+  bool Step() {
+    int64_t arrival = 0;
+    {
+      lock_t lock(mutex_);
+      if (stop_ || packets_.empty()) {
+        return false;
+      }
+      arrival = packets_.front();
+      packets_.pop_front();
+    }
+    Decode(arrival);
+    lock_t lock(mutex_);
+    return !stop_ && !packets_.empty();
+  }
+
+  std::vector<int64_t> latencies;  // usec from the packet arrival to its decoded frame
+
+ private:
+  void Decode(int64_t arrival) {
+    Burn(cost_usec_);
+    latencies.push_back(GetUsec(steady_clock_t::now()) - arrival);
+  }
+
+  const int64_t cost_usec_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<int64_t> packets_;
+  bool stop_;
+};
+
+struct Result {
+  size_t threads;
+  size_t frames;
+  double late_percent;  // frames decoded later than a video frame duration after their packet
+  int64_t p50_usec;
+  int64_t p99_usec;
+  long context_switches;
+};
+
+Result Run(size_t streams, int pool_threads, int seconds) {
+  struct rusage before;
+  getrusage(RUSAGE_SELF, &before);
+
+  std::shared_ptr<WorkerPool> pool;
+  if (pool_threads >= 0) {
+    pool = std::make_shared<WorkerPool>(pool_threads);
+    pool->Start();
+  }
+
+  std::vector<std::unique_ptr<Decoder>> decoders;
+  std::vector<std::unique_ptr<SerialJob>> jobs;
+  std::vector<std::thread> threads;
+  std::atomic<bool> stop(false);
+  for (size_t i = 0; i < streams; ++i) {
+    Decoder* video = new Decoder(VIDEO_DECODE_USEC);
+    Decoder* audio = new Decoder(AUDIO_DECODE_USEC);
+    decoders.emplace_back(video);
+    decoders.emplace_back(audio);
+    SerialJob* video_job = nullptr;
+    SerialJob* audio_job = nullptr;
+    if (pool) {
+      const TaskPriority priority = i ? TASK_PRIORITY_NORMAL : TASK_PRIORITY_HIGH;
+      video_job = new SerialJob(pool, [video]() { return video->Step(); }, priority);
+      audio_job = new SerialJob(pool, [audio]() { return audio->Step(); }, priority);
+      jobs.emplace_back(video_job);
+      jobs.emplace_back(audio_job);
+    } else {
+      threads.emplace_back([video]() { video->Loop(); });
+      threads.emplace_back([audio]() { audio->Loop(); });
+    }
+
+    // demuxer, audio packets in between the video ones
+    threads.emplace_back([&stop, video, audio, video_job, audio_job, i, streams]() {
+      const auto period = std::chrono::microseconds(1000000 / AUDIO_PACKETS_PER_SEC);
+      auto next = steady_clock_t::now() + period * i / streams;
+      for (size_t packet = 0; !stop; ++packet) {
+        std::this_thread::sleep_until(next);
+        const int64_t now = GetUsec(steady_clock_t::now());
+        audio->Put(now);
+        if (audio_job) {
+          audio_job->Signal();
+        }
+        if (packet % (AUDIO_PACKETS_PER_SEC / VIDEO_PACKETS_PER_SEC) == 0) {
+          video->Put(now);
+          if (video_job) {
+            video_job->Signal();
+          }
+        }
+        next += period;
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop = true;
+  for (auto& decoder : decoders) {
+    decoder->Stop();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  jobs.clear();
+  if (pool) {
+    pool->Stop();
+  }
+
+  struct rusage after;
+  getrusage(RUSAGE_SELF, &after);
+
+  std::vector<int64_t> latencies;
+  for (auto& decoder : decoders) {
+    latencies.insert(latencies.end(), decoder->latencies.begin(), decoder->latencies.end());
+  }
+  std::sort(latencies.begin(), latencies.end());
+  const int64_t frame_usec = 1000000 / VIDEO_PACKETS_PER_SEC;
+  const size_t late = latencies.end() - std::upper_bound(latencies.begin(), latencies.end(), frame_usec);
+
+  Result result;
+  result.threads = streams * (pool ? 1 : 3) + (pool ? pool->GetThreadsCount() : 0);
+  result.frames = latencies.size();
+  result.late_percent = latencies.empty() ? 0 : 100.0 * late / latencies.size();
+  result.p50_usec = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+  result.p99_usec = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+  result.context_switches = (after.ru_nvcsw + after.ru_nivcsw) - (before.ru_nvcsw + before.ru_nivcsw);
+  return result;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int seconds = argc > 1 ? std::max(atoi(argv[1]), 1) : DEFAULT_RUN_SEC;
+  const int pool_threads = argc > 2 ? std::max(atoi(argv[2]), 0) : 0;
+
+  std::cout << "cores " << std::thread::hardware_concurrency() << ", " << seconds << " sec per run, video "
+            << VIDEO_DECODE_USEC << " usec x " << VIDEO_PACKETS_PER_SEC << "/s, audio " << AUDIO_DECODE_USEC
+            << " usec x " << AUDIO_PACKETS_PER_SEC << "/s per stream" << std::endl;
+  std::cout << "streams model     threads  frames   late%   p50_us   p99_us  ctx_switches" << std::endl;
+  const size_t streams_counts[] = {1, 4, 16};
+  for (size_t streams : streams_counts) {
+    for (int model = 0; model < 2; ++model) {
+      const Result result = Run(streams, model ? pool_threads : -1, seconds);
+      std::cout << std::setw(7) << streams << " " << std::setw(9) << std::left << (model ? "pool" : "threads")
+                << std::right << std::setw(7) << result.threads << std::setw(8) << result.frames << std::setw(8)
+                << std::fixed << std::setprecision(2) << result.late_percent << std::setw(9) << result.p50_usec
+                << std::setw(9) << result.p99_usec << std::setw(14) << result.context_switches << std::endl;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <player/media/worker_pool.h>
+
+#define STEPS_COUNT 10000
+#define SIGNALS_COUNT 1000
+#define TASKS_COUNT 64
+#define WAIT_MSEC 5000
+
+using fastoplayer::media::SerialJob;
+using fastoplayer::media::TASK_PRIORITY_HIGH;
+using fastoplayer::media::TASK_PRIORITY_LOW;
+using fastoplayer::media::TASK_PRIORITY_NORMAL;
+using fastoplayer::media::WorkerPool;
+
+namespace {
+typedef std::unique_lock<std::mutex> lock_t;
+
+class Gate {
+ public:
+  Gate() : mutex_(), cond_(), open_(false) {}
+
+  void Open() {
+    lock_t lock(mutex_);
+    open_ = true;
+    cond_.notify_all();
+  }
+
+  bool Wait() {
+    lock_t lock(mutex_);
+    return cond_.wait_for(lock, std::chrono::milliseconds(WAIT_MSEC), [this]() { return open_; });
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool open_;
+};
+
+// the steps of a job never overlap and a signal sent while one runs is not lost
+bool CheckSerialJob() {
+  std::shared_ptr<WorkerPool> pool = std::make_shared<WorkerPool>(4);
+  if (!pool->Start()) {
+    std::cout << "Can't start the pool" << std::endl;
+    return false;
+  }
+
+  std::atomic<int> running(0);
+  std::atomic<int> steps(0);
+  std::atomic<int> signals(0);
+  std::atomic<bool> overlap(false);
+  SerialJob job(pool,
+                [&]() {
+                  if (running.fetch_add(1)) {
+                    overlap = true;
+                  }
+                  steps++;
+                  const bool more = steps < STEPS_COUNT;
+                  running--;
+                  return more;
+                },
+                TASK_PRIORITY_NORMAL);
+  std::thread signaler([&]() {
+    for (int i = 0; i < SIGNALS_COUNT; ++i) {
+      signals++;
+      job.Signal();
+    }
+  });
+  signaler.join();
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WAIT_MSEC);
+  while (steps < STEPS_COUNT && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  job.Cancel();
+  const int done = steps;
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  pool->Stop();
+  if (overlap || done < STEPS_COUNT || steps != done) {
+    std::cout << "Serial job ran " << done << " steps, overlap " << overlap << ", after cancel " << steps - done
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// with the only worker busy, the queued high priority tasks run before the normal and low ones
+bool CheckPriorities() {
+  WorkerPool pool(1);
+  if (!pool.Start()) {
+    return false;
+  }
+
+  Gate busy, release, done;
+  std::mutex order_mutex;
+  std::vector<int> order;
+  pool.Post(
+      [&]() {
+        busy.Open();
+        release.Wait();
+      },
+      TASK_PRIORITY_NORMAL);
+  if (!busy.Wait()) {
+    return false;
+  }
+
+  const int priorities[] = {TASK_PRIORITY_LOW, TASK_PRIORITY_NORMAL, TASK_PRIORITY_HIGH, TASK_PRIORITY_LOW,
+                            TASK_PRIORITY_HIGH};
+  std::atomic<size_t> left(sizeof(priorities) / sizeof(priorities[0]));
+  for (int priority : priorities) {
+    pool.Post(
+        [&, priority]() {
+          {
+            lock_t lock(order_mutex);
+            order.push_back(priority);
+          }
+          if (--left == 0) {
+            done.Open();
+          }
+        },
+        static_cast<fastoplayer::media::TaskPriority>(priority));
+  }
+  release.Open();
+  const bool finished = done.Wait();
+  pool.Stop();
+
+  const int expected[] = {TASK_PRIORITY_HIGH, TASK_PRIORITY_HIGH, TASK_PRIORITY_NORMAL, TASK_PRIORITY_LOW,
+                          TASK_PRIORITY_LOW};
+  if (!finished || order != std::vector<int>(std::begin(expected), std::end(expected))) {
+    std::cout << "Tasks did not run in priority order" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// tasks posted from a busy worker stay on its queue until the idle workers steal them
+bool CheckStealing() {
+  WorkerPool pool(2);
+  if (!pool.Start()) {
+    return false;
+  }
+
+  Gate done;
+  std::atomic<int> left(TASKS_COUNT);
+  Gate release;
+  pool.Post(
+      [&]() {
+        for (int i = 0; i < TASKS_COUNT; ++i) {
+          pool.Post(
+              [&]() {
+                if (--left == 0) {
+                  done.Open();
+                }
+              },
+              TASK_PRIORITY_NORMAL);
+        }
+        release.Wait();
+      },
+      TASK_PRIORITY_NORMAL);
+  const bool finished = done.Wait();
+  release.Open();
+  pool.Stop();
+  if (!finished || !pool.GetStolenCount()) {
+    std::cout << "Idle worker stole " << pool.GetStolenCount() << " tasks, " << left << " left" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// a job woken the realtime way, repeated as the device callback does, runs
+bool CheckWake() {
+  std::shared_ptr<WorkerPool> pool = std::make_shared<WorkerPool>(2);
+  if (!pool->Start()) {
+    return false;
+  }
+
+  std::atomic<int> steps(0);
+  SerialJob job(pool,
+                [&]() {
+                  steps++;
+                  return false;
+                },
+                TASK_PRIORITY_HIGH);
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(WAIT_MSEC);
+  for (int i = 0; i < SIGNALS_COUNT && std::chrono::steady_clock::now() < deadline; ++i) {
+    const int before = steps;
+    while (steps == before && std::chrono::steady_clock::now() < deadline) {
+      job.Wake();
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  job.Cancel();
+  pool->Stop();
+  if (steps < SIGNALS_COUNT) {
+    std::cout << "Woken job ran " << steps << " steps" << std::endl;
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+int main() {
+  if (!CheckSerialJob() || !CheckPriorities() || !CheckStealing() || !CheckWake()) {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Worker pool: ok" << std::endl;
+  return EXIT_SUCCESS;
+}